@@ -0,0 +1,100 @@
+#define FMT_HEADER_ONLY
+#include "../src/internal/collection.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace nova;
+
+// Measures how long building an index over an already populated collection takes:
+//  - inserting the documents one by one
+//  - a bulk insert sorting the documents by key on one thread
+//  - a bulk insert sorting the documents by key on every hardware thread
+// for each of the four ordered index types. Documents are held in random key order.
+// usage: index_build_bench [document count]
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+double seconds_since(clock_type::time_point const start) {
+    return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+std::vector<document> make_documents(std::size_t const count) {
+    static char const* const houses[] = {"Gryffindor", "Hufflepuff", "Ravenclaw", "Slytherin"};
+    std::vector<std::size_t> order(count);
+    for (std::size_t i = 0; i < count; ++i)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937_64{42});
+
+    std::vector<document> docs;
+    docs.reserve(count);
+    for (auto const i : order) {
+        document doc(bson{bson_type<std::uint64_t>, i});
+        doc.values().insert("name", fmt::format("student {:09}", i));
+        doc.values().insert("house", houses[i % 4]);
+        doc.values().insert("gpa", static_cast<double>(i % 400) / 100.);
+        doc.values().insert("year", bson{bson_type<std::int32_t>, static_cast<std::int32_t>(i % 7)});
+        docs.push_back(std::move(doc));
+    }
+    return docs;
+}
+
+template<class Index, class Fields>
+void bench(char const* const name, Fields const& fields, std::vector<document>& docs) {
+    std::vector<non_null_ptr<document>> ptrs;
+    ptrs.reserve(docs.size());
+    for (auto&& doc : docs)
+        ptrs.push_back(std::addressof(doc));
+    span<non_null_ptr<document> const> const all{ptrs};
+
+    double one_by_one = 0.;
+    {
+        Index index;
+        auto const start = clock_type::now();
+        for (auto&& doc : docs) {
+            if constexpr (std::is_convertible_v<Fields const&, std::string_view>)
+                index.insert(doc.values().lookup(fields).value(), std::addressof(doc));
+            else {
+                std::vector<non_null_ptr<bson const>> vals;
+                for (auto&& field : fields)
+                    vals.push_back(std::addressof(doc.values().lookup(field).value()));
+                index.insert(vals, std::addressof(doc));
+            }
+        }
+        one_by_one = seconds_since(start);
+    }
+
+    auto bulk = [&](std::size_t const threads) {
+        Index index;
+        auto const start = clock_type::now();
+        index_manager::bulk_register(index, fields, all, threads);
+        return seconds_since(start);
+    };
+    auto const threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    auto const sorted = bulk(1);
+    auto const parallel = bulk(threads);
+
+    std::cout << fmt::format("{:>22}: one by one {:7.3f} s, bulk {:7.3f} s ({:.1f}x), bulk on {} threads {:7.3f} s ({:.1f}x)\n",
+                             name, one_by_one, sorted, one_by_one / sorted, threads, parallel, one_by_one / parallel);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t const count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 5'000'000;
+    std::cout << fmt::format("building indices over {} documents\n", count);
+    auto docs = make_documents(count);
+
+    bench<ordered_single_field_unique_index<>>("unique (name)", std::string{"name"}, docs);
+    bench<ordered_single_field_multi_index<>>("multi (gpa)", std::string{"gpa"}, docs);
+    bench<ordered_compound_unique_index<2>>("unique (name, year)", multi_string("name", "year"), docs);
+    bench<ordered_compound_multi_index<2>>("multi (house, gpa)", multi_string("house", "gpa"), docs);
+}
@@ -0,0 +1,114 @@
+#define FMT_HEADER_ONLY
+#include "../src/internal/collection.hpp"
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+using namespace nova;
+
+// Compares bulk insertion into a collection (arena-backed document storage) against
+// the previous strategy of heap allocating every document with new/delete.
+// usage: insert_bench [document count]
+
+namespace {
+
+bson student_id(std::size_t const i) {
+    return bson{bson_type<std::uint64_t>, i};
+}
+
+void fill_student(document& doc, std::size_t const i) {
+    static char const* const houses[] = {"Gryffindor", "Hufflepuff", "Ravenclaw", "Slytherin"};
+    doc.values().insert("name", fmt::format("student {}", i));
+    doc.values().insert("house", houses[i % 4]);
+    doc.values().insert("gpa", static_cast<double>(i % 400) / 100.);
+    doc.values().insert("year", bson{bson_type<std::int32_t>, static_cast<std::int32_t>(i % 7)});
+}
+
+document make_student(std::size_t const i) {
+    document doc(student_id(i));
+    fill_student(doc, i);
+    return doc;
+}
+
+// the new/delete path collection::insert used before documents were arena allocated
+struct heap_collection {
+    std::vector<non_null_ptr<document>> docs_{};
+    absl::flat_hash_map<bson, non_null_ptr<document>> id_index_{};
+
+    ~heap_collection() {
+        for (auto&& ptr : docs_)
+            delete ptr;
+    }
+
+    void insert(document&& new_doc) {
+        if (!id_index_.contains(new_doc.id())) {
+            auto const doc = docs_.emplace_back(new document(std::move(new_doc)));
+            id_index_.emplace(doc->id(), doc);
+        }
+    }
+};
+
+// documents are built outside of the collection and moved in
+struct insert_built {
+    template<class Collection>
+    void operator()(Collection& coll, std::size_t const i) const {
+        coll.insert(make_student(i));
+    }
+};
+
+// documents are created by the collection and their fields filled in place
+struct insert_in_place {
+    void operator()(collection& coll, std::size_t const i) const {
+        fill_student(*coll.insert(student_id(i)), i);
+    }
+};
+
+template<class Collection, class Insert>
+void run(char const* const name, std::size_t const count) {
+    using clock = std::chrono::steady_clock;
+
+    auto const start = clock::now();
+    auto coll = std::make_unique<Collection>();
+    for (std::size_t i = 0; i < count; ++i)
+        Insert{}(*coll, i);
+    auto const inserted = clock::now();
+    coll.reset();
+    auto const destroyed = clock::now();
+
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+
+    auto const secs = [](auto const dur) { return std::chrono::duration<double>(dur).count(); };
+    std::cout << fmt::format("{:>16}: {:>12.0f} inserts/s, teardown {:>8.3f} ms, max rss {:>8} KiB\n",
+        name, static_cast<double>(count) / secs(inserted - start), secs(destroyed - inserted) * 1e3, usage.ru_maxrss);
+}
+
+// run each variant in its own process so max rss is not shared between them
+template<class Collection, class Insert>
+void run_isolated(char const* const name, std::size_t const count) {
+    std::cout.flush();
+    if (auto const pid = fork(); pid == 0) {
+        run<Collection, Insert>(name, count);
+        std::cout.flush();
+        std::_Exit(0);
+    }
+    else if (pid > 0) 
+        waitpid(pid, nullptr, 0);
+    else
+        run<Collection, Insert>(name, count);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t const count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+    std::cout << fmt::format("inserting {} documents\n", count);
+    run_isolated<heap_collection, insert_built>("heap", count);
+    run_isolated<collection, insert_built>("arena", count);
+    run_isolated<collection, insert_in_place>("arena (in place)", count);
+}
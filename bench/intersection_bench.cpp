@@ -0,0 +1,112 @@
+#define FMT_HEADER_ONLY
+#include "../src/internal/collection.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string_view>
+#include <vector>
+
+using namespace nova;
+
+// Measures equality lookups on two fields, each held by a single field index, through:
+//  - the intersection of the documents both indices hold, smallest first
+//  - the index of the first field, filtering its documents by the second field
+//  - the index of the more selective field, filtering its documents by the other field
+// over pairs of fields of 4, 100 and 10000 distinct values, spread independently of each other.
+// usage: intersection_bench [document count] [queries per pair]
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct field_def {
+    char const* name;
+    std::int32_t distinct;
+};
+
+constexpr std::array<field_def, 6> field_defs{{{"a4", 4}, {"b4", 4}, {"a100", 100}, {"b100", 100}, {"a10k", 10000}, {"b10k", 10000}}};
+
+void fill(collection& coll, std::size_t const count) {
+    std::mt19937 rng{42};
+    for (auto&& def : field_defs)
+        coll.create_index<false>(def.name);
+    for (std::size_t i = 0; i < count; ++i) {
+        document doc(bson{bson_type<std::uint64_t>, i});
+        for (auto&& def : field_defs)
+            doc.values().insert(def.name, bson{bson_type<std::int32_t>, static_cast<std::int32_t>(rng() % static_cast<std::uint32_t>(def.distinct))});
+        coll.insert(std::move(doc));
+    }
+}
+
+// runs `lookup(values)` for every query, returning the time per query in microseconds and the documents found
+template<class Lookup>
+std::pair<double, std::size_t> run(std::vector<std::array<bson, 2>> const& queries, Lookup&& lookup) {
+    std::size_t found = 0;
+    auto const start = clock_type::now();
+    for (auto&& values : queries)
+        found += lookup(values);
+    auto const secs = std::chrono::duration<double>(clock_type::now() - start).count();
+    return {secs * 1e6 / static_cast<double>(queries.size()), found};
+}
+
+void bench_pair(collection const& coll, field_def const& first, field_def const& second, std::size_t const query_count) {
+    std::mt19937 rng{7};
+    std::vector<std::array<bson, 2>> queries;
+    for (std::size_t i = 0; i < query_count; ++i)
+        queries.push_back({bson{bson_type<std::int32_t>, static_cast<std::int32_t>(rng() % static_cast<std::uint32_t>(first.distinct))},
+                           bson{bson_type<std::int32_t>, static_cast<std::int32_t>(rng() % static_cast<std::uint32_t>(second.distinct))}});
+    std::array<std::string_view, 2> const fields{first.name, second.name};
+
+    auto const intersected = run(queries, [&](std::array<bson, 2> const& values) {
+        std::size_t count = 0;
+        auto const found = coll.lookup_indexed(span<std::string_view const>{fields}, span<bson const>{values});
+        for (auto&& doc : *found) {
+            static_cast<void>(doc);
+            ++count;
+        }
+        return count;
+    });
+    // looks `values[by]` up in its index and filters the documents by the other value
+    auto const filtered = [&](std::size_t const by) {
+        auto const other = 1 - by;
+        return run(queries, [&](std::array<bson, 2> const& values) {
+            std::size_t count = 0;
+            auto const found = coll.lookup_indexed(fields[by], values[by]);
+            for (auto&& doc : *found)
+                if (auto const val = doc.values().lookup(fields[other]); val && val.value() == values[other])
+                    ++count;
+            return count;
+        });
+    };
+    auto const by_first = filtered(0);
+    auto const by_selective = filtered(first.distinct >= second.distinct ? 0 : 1);
+
+    std::cout << fmt::format("{:>5} & {:<5} ({:>9.0f} matches/query): intersection {:9.1f} us, first index + filter {:9.1f} us ({:.1f}x), "
+                             "selective index + filter {:9.1f} us ({:.1f}x)\n",
+                             first.name, second.name, static_cast<double>(intersected.second) / static_cast<double>(queries.size()),
+                             intersected.first, by_first.first, by_first.first / intersected.first,
+                             by_selective.first, by_selective.first / intersected.first);
+    if (intersected.second != by_first.second || intersected.second != by_selective.second)
+        std::cout << "  result mismatch!\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t const count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+    std::size_t const queries = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 200;
+    std::cout << fmt::format("{} documents, {} queries per pair of fields\n", count, queries);
+    collection coll;
+    fill(coll, count);
+
+    auto const& [a4, b4, a100, b100, a10k, b10k] = field_defs;
+    bench_pair(coll, a4, b4, queries);
+    bench_pair(coll, a4, a100, queries);
+    bench_pair(coll, a100, b100, queries);
+    bench_pair(coll, a4, a10k, queries);
+    bench_pair(coll, a100, a10k, queries);
+    bench_pair(coll, a10k, b10k, queries);
+}
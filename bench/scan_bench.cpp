@@ -0,0 +1,139 @@
+#define FMT_HEADER_ONLY
+#include "../src/internal/collection.hpp"
+#include "../src/internal/compact_bson.hpp"
+#include "../src/internal/query_util.hpp"
+#include "../src/internal/simd.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace nova;
+
+// Measures single threaded scan throughput (rows per second per core) of:
+//  - collection::scan through the per-document predicate path
+//  - collection::scan over columnar fields
+//  - the raw comparison kernels at every instruction set level the cpu supports
+//  - short string equality over compact_bson values
+// usage: scan_bench [row count]
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+constexpr int repetitions = 5;
+
+template<class F>
+double best_seconds(F&& f) {
+    double best = 1e300;
+    for (int i = 0; i < repetitions; ++i) {
+        auto const start = clock_type::now();
+        f();
+        best = std::min(best, std::chrono::duration<double>(clock_type::now() - start).count());
+    }
+    return best;
+}
+
+void report(char const* const name, std::size_t const rows, double const secs, std::size_t const matches) {
+    std::cout << fmt::format("{:>36}: {:>14.0f} rows/s ({} matches)\n", name, static_cast<double>(rows) / secs, matches);
+}
+
+char const* const houses[] = {"Gryffindor", "Hufflepuff", "Ravenclaw", "Slytherin"};
+
+void fill(collection& coll, std::size_t const count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        document doc(bson{bson_type<std::uint64_t>, i});
+        doc.values().insert("name", fmt::format("student {}", i));
+        doc.values().insert("house", houses[i % 4]);
+        doc.values().insert("gpa", static_cast<double>(i % 400) / 100.);
+        doc.values().insert("year", bson{bson_type<std::int32_t>, static_cast<std::int32_t>(i % 7)});
+        coll.insert(std::move(doc));
+    }
+}
+
+void bench_collection(collection const& coll, char const* const label, std::size_t const n) {
+    std::size_t matches = 0;
+
+    auto const gpa = best_seconds([&] { matches = coll.scan(is_greater_eq_query("gpa", 3.)).size(); });
+    report(fmt::format("{} gpa >= 3.0", label).c_str(), n, gpa, matches);
+
+    auto const year = best_seconds([&] { matches = coll.scan(is_equal_query("year", 3)).size(); });
+    report(fmt::format("{} year == 3", label).c_str(), n, year, matches);
+
+    auto const house = best_seconds([&] { matches = coll.scan(is_equal_query("house", "Ravenclaw")).size(); });
+    report(fmt::format("{} house == Ravenclaw", label).c_str(), n, house, matches);
+}
+
+char const* level_name(simd_level const level) {
+    switch (level) {
+        case simd_level::avx2: return "avx2";
+        case simd_level::sse42: return "sse4.2";
+        default: return "scalar";
+    }
+}
+
+template<class T>
+void bench_kernel(char const* const type_name, std::size_t const count) {
+    std::vector<T> values(count);
+    for (std::size_t i = 0; i < count; ++i)
+        values[i] = static_cast<T>(i % 400);
+    std::vector<std::uint64_t> out((count + 63) / 64);
+
+    for (auto const level : {simd_level::scalar, simd_level::sse42, simd_level::avx2}) {
+        if (level > active_simd_level())
+            continue;
+        auto const secs = best_seconds([&] { compare(values.data(), count, static_cast<T>(300), cmp_op::ge, out.data(), level); });
+        std::size_t matches = 0;
+        for (auto const w : out)
+            matches += static_cast<std::size_t>(__builtin_popcountll(w));
+        report(fmt::format("{} >= ({})", type_name, level_name(level)).c_str(), count, secs, matches);
+    }
+}
+
+void bench_strings(std::size_t const count) {
+    compact_bson::array_t values;
+    values.reserve(count);
+    for (std::size_t i = 0; i < count; ++i)
+        values.emplace_back(houses[i % 4]);
+
+    std::size_t matches = 0;
+    auto const per_value = best_seconds([&] {
+        matches = 0;
+        for (auto&& val : values)
+            matches += val.equals_weak(std::string_view{"Ravenclaw"});
+    });
+    report("string == (equals_weak per value)", count, per_value, matches);
+
+    for (auto const level : {simd_level::scalar, simd_level::sse42, simd_level::avx2}) {
+        if (level > active_simd_level())
+            continue;
+        auto const secs = best_seconds([&] { matches = compact_bson::equal_strings(values, "Ravenclaw", level).count(); });
+        report(fmt::format("string == ({})", level_name(level)).c_str(), count, secs, matches);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t const count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+    std::cout << fmt::format("scanning {} rows, best of {} runs, cpu supports {}\n", count, repetitions, level_name(active_simd_level()));
+
+    {
+        collection coll;
+        fill(coll, count);
+        bench_collection(coll, "document", count);
+        coll.create_column<double>("gpa");
+        coll.create_column<std::int32_t>("year");
+        coll.create_column<std::string>("house");
+        bench_collection(coll, "column", count);
+    }
+
+    bench_kernel<std::int32_t>("int32", count);
+    bench_kernel<std::int64_t>("int64", count);
+    bench_kernel<std::uint32_t>("uint32", count);
+    bench_kernel<std::uint64_t>("uint64", count);
+    bench_kernel<float>("float", count);
+    bench_kernel<double>("double", count);
+    bench_strings(count);
+}
@@ -0,0 +1,100 @@
+#define FMT_HEADER_ONLY
+#include "../src/internal/database.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+
+using namespace nova;
+
+// Measures how long a database takes to start up from:
+//  - a write ahead log holding every insert
+//  - a checkpoint followed by a short log tail (1% of the documents)
+// The collection holds a unique, a multi and a compound index along with a column.
+// usage: startup_bench [document count] [log path]
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+double seconds_since(clock_type::time_point const start) {
+    return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+void fill(collection& coll, std::size_t const first, std::size_t const last) {
+    static char const* const houses[] = {"Gryffindor", "Hufflepuff", "Ravenclaw", "Slytherin"};
+    for (std::size_t i = first; i < last; ++i) {
+        document doc(bson{bson_type<std::uint64_t>, i});
+        doc.values().insert("name", fmt::format("student {}", i));
+        doc.values().insert("house", houses[i % 4]);
+        doc.values().insert("gpa", static_cast<double>(i % 400) / 100.);
+        doc.values().insert("year", bson{bson_type<std::int32_t>, static_cast<std::int32_t>(i % 7)});
+        coll.insert(std::move(doc));
+    }
+}
+
+void report(char const* const name, double const secs) {
+    std::cout << fmt::format("{:>32}: {:>8.3f} s\n", name, secs);
+}
+
+double startup(std::string const& path, std::size_t const expected) {
+    auto const start = clock_type::now();
+    database db;
+    db.set_checkpoint_threshold(0);
+    if (db.open(path, wal_options{fsync_policy::periodic}) != wal_status::ok || db["students"].value().size() != expected) {
+        std::cerr << "failed to restore " << path << '\n';
+        std::exit(1);
+    }
+    return seconds_since(start);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t const count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10'000'000;
+    std::string const path = argc > 2 ? argv[2] : "startup_bench.log";
+    std::string const full_log = path + ".full";
+    std::size_t const tail = count / 100;
+    for (auto&& file : {path, path + ".checkpoint", full_log, full_log + ".checkpoint"})
+        std::remove(file.c_str());
+
+    std::cout << fmt::format("{} documents, {} in the log tail, {} hardware threads\n", count, tail, std::thread::hardware_concurrency());
+    {
+        auto start = clock_type::now();
+        database db;
+        db.set_checkpoint_threshold(0);
+        if (db.open(path, wal_options{fsync_policy::periodic}) != wal_status::ok) {
+            std::cerr << "failed to open " << path << '\n';
+            return 1;
+        }
+        auto& students = db.insert("students")->value();
+        students.create_index<true>("name");
+        students.create_index<false>("house");
+        students.create_index<false>("house", "year");
+        students.create_column<double>("gpa");
+        fill(students, 0, count);
+        db.sync();
+        report("insert (logged)", seconds_since(start));
+        std::filesystem::copy_file(path, full_log);
+
+        start = clock_type::now();
+        if (db.checkpoint() != wal_status::ok) {
+            std::cerr << "failed to write a checkpoint\n";
+            return 1;
+        }
+        report("write checkpoint", seconds_since(start));
+        fill(students, count, count + tail);
+    }
+    std::cout << fmt::format("{:>32}: {:>8.1f} MiB\n", "log", static_cast<double>(std::filesystem::file_size(full_log)) / (1 << 20));
+    std::cout << fmt::format("{:>32}: {:>8.1f} MiB\n", "checkpoint", static_cast<double>(std::filesystem::file_size(path + ".checkpoint")) / (1 << 20));
+
+    report("startup, full log replay", startup(full_log, count));
+    report("startup, checkpoint + tail", startup(path, count + tail));
+
+    for (auto&& file : {path, path + ".checkpoint", full_log})
+        std::remove(file.c_str());
+}
@@ -0,0 +1,89 @@
+#define FMT_HEADER_ONLY
+#include "../src/internal/wal.hpp"
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace nova;
+
+// Measures durable append throughput of the write ahead log:
+//  - fsync per record (every_op) as the baseline
+//  - group commit through the flusher thread across a range of batch windows
+// Every writer thread appends records of `record size` bytes and waits for each to be durable,
+// so a batch holds at most one record per writer and a window longer than an fdatasync only adds latency.
+// usage: wal_bench [writer threads] [records per thread] [record size] [log path]
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct result {
+    double ops_per_sec;
+    double avg_batch;
+};
+
+result run(std::string const& path, wal_options const options, std::size_t const threads, std::size_t const records, std::size_t const size) {
+    std::remove(path.c_str());
+    write_ahead_log wal;
+    if (wal.open(path, options, [](auto&&...) {}) != wal_status::ok) {
+        std::cerr << "failed to open " << path << '\n';
+        std::exit(1);
+    }
+
+    std::string const payload(size, 'x');
+    std::atomic<bool> failed{false};
+    auto const start = clock_type::now();
+    std::vector<std::thread> writers;
+    for (std::size_t t = 0; t < threads; ++t) {
+        writers.emplace_back([&] {
+            for (std::size_t i = 0; i < records; ++i)
+                if (!wal.append(wal_op::insert, [&](byte_buffer& buf) { detail::store_bytes(buf, payload.data(), payload.size()); }))
+                    failed = true;
+        });
+    }
+    for (auto&& w : writers)
+        w.join();
+    auto const secs = std::chrono::duration<double>(clock_type::now() - start).count();
+
+    if (failed) {
+        std::cerr << "append failed\n";
+        std::exit(1);
+    }
+    auto const total = threads * records;
+    auto const batches = options.policy == fsync_policy::every_op ? total : wal.batches();
+    wal.close();
+    std::remove(path.c_str());
+    return {static_cast<double>(total) / secs, static_cast<double>(total) / static_cast<double>(batches)};
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t const threads = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 16;
+    std::size_t const records = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 500;
+    std::size_t const size = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 128;
+    std::string const path = argc > 4 ? argv[4] : "wal_bench.log";
+
+    std::cout << fmt::format("{} writers x {} durable appends of {} bytes\n", threads, records, size);
+    std::cout << fmt::format("{:>24} {:>14} {:>12}\n", "policy", "appends/s", "avg batch");
+
+    auto const base = run(path, wal_options{fsync_policy::every_op}, threads, records, size);
+    std::cout << fmt::format("{:>24} {:>14.0f} {:>12.1f}\n", "fsync per record", base.ops_per_sec, base.avg_batch);
+
+    for (auto const window : {0, 50, 100, 250, 500, 1000, 2000, 5000}) {
+        wal_options options{fsync_policy::group};
+        options.max_batch_records = std::numeric_limits<std::size_t>::max(); // only the window closes a batch
+        options.max_batch_latency = std::chrono::microseconds{window};
+        auto const r = run(path, options, threads, records, size);
+        std::cout << fmt::format("{:>24} {:>14.0f} {:>12.1f}\n", fmt::format("group, {}us window", window), r.ops_per_sec, r.avg_batch);
+    }
+}
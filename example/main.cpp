@@ -56,6 +56,9 @@ int main() {
     collection hogwart_students;
     hogwart_students.template create_index<false>("house");
     hogwart_students.template create_index<false>("name", "gpa");
+    hogwart_students.template create_multikey_index<false>("classes");
+    hogwart_students.template create_column<double>("gpa");
+    hogwart_students.template create_column<std::string>("house");
     hogwart_students.insert(std::move(harry_potter));
     hogwart_students.insert(std::move(ron_weasley));
     hogwart_students.insert(std::move(hermonie_granger));
@@ -91,7 +94,8 @@ int main() {
         return std::find(v.begin(), v.end(), "Transfiguration") != v.end();
     };
 
-    auto trans_result = hogwart_students.scan(std::make_tuple("classes", is_taking_transfiguration));
+    // the multikey index holds every student under each of their classes
+    auto trans_result = hogwart_students.lookup_indexed("classes", "Transfiguration").value();
     for (auto&& doc : trans_result)
         std::cout << fmt::format("{}\n", doc);
 
@@ -0,0 +1,524 @@
+#ifndef NOVA_BINARY_HPP
+#define NOVA_BINARY_HPP
+
+#include <fmt/format.h>
+
+#include "../debug.hpp"
+#include "bson.hpp"
+#include "document.hpp"
+#include "field_path.hpp"
+#include "unique_id.hpp"
+#include "util/optional.hpp"
+#include "util/span.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Binary layout (all integers are fixed width and stored in host byte order):
+//
+//  value    := type:u8 payload
+//  payload  := <nothing>                               (Null)
+//            | u8                                      (Bool)
+//            | 4 bytes                                 (Int32, uInt32, Float)
+//            | 8 bytes                                 (Int64, uInt64, Double)
+//            | 12 bytes                                (UniqueID)
+//            | len:u32 chars[len]                      (String)
+//            | byte_len:u32 count:u32 value[count]     (Array, byte_len covers the whole array)
+//            | document                                (Document)
+//  document := byte_len:u32 count:u32 id:value (key_len:u32 key[key_len] value)[count]
+//
+// Every variable sized value is length prefixed, so a reader can always skip over a value
+// without looking at its contents.
+
+namespace nova {
+
+using byte_buffer = std::vector<std::byte>;
+using byte_span = span<std::byte const>;
+
+namespace detail {
+
+using binary_len_t = std::uint32_t;
+
+template<class T>
+T load(std::byte const* const ptr) noexcept {
+    static_assert(std::is_trivially_copyable_v<T>);
+    T t;
+    std::memcpy(&t, ptr, sizeof(T));
+    return t;
+}
+
+template<class T>
+void store(byte_buffer& buf, T const t) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    auto const pos = buf.size();
+    buf.resize(pos + sizeof(T));
+    std::memcpy(buf.data() + pos, &t, sizeof(T));
+}
+
+template<class T>
+void store_at(byte_buffer& buf, std::size_t const pos, T const t) noexcept {
+    DEBUG_ASSERT(pos + sizeof(T) <= buf.size());
+    std::memcpy(buf.data() + pos, &t, sizeof(T));
+}
+
+inline void store_bytes(byte_buffer& buf, void const* const data, std::size_t const size) {
+    auto const pos = buf.size();
+    buf.resize(pos + size);
+    if (size > 0)
+        std::memcpy(buf.data() + pos, data, size);
+}
+
+[[nodiscard]] constexpr std::size_t fixed_payload_size(bson::types const type) noexcept {
+    switch (type) {
+        case bson::types::UniqueID: return unique_id::byte_size;
+        case bson::types::Null: return 0;
+        case bson::types::Bool: return 1;
+        case bson::types::Int32:
+        case bson::types::uInt32:
+        case bson::types::Float: return 4;
+        case bson::types::Int64:
+        case bson::types::uInt64:
+        case bson::types::Double: return 8;
+        default: return 0;
+    }
+}
+
+} // namespace detail
+
+void encode(bson const& b, byte_buffer& buf);
+void encode(document const& doc, byte_buffer& buf);
+
+inline void encode(bson const& b, byte_buffer& buf) {
+    auto const type = b.type();
+    detail::store(buf, static_cast<std::uint8_t>(type));
+    switch (type) {
+        case bson::types::UniqueID: {
+            auto const pos = buf.size();
+            buf.resize(pos + unique_id::byte_size);
+            b.as<unique_id>()->to_bytes(buf.data() + pos);
+            break;
+        }
+        case bson::types::Null: break;
+        case bson::types::Bool: detail::store(buf, static_cast<std::uint8_t>(*b.as<bool>())); break;
+        case bson::types::Int32: detail::store(buf, *b.as<std::int32_t>()); break;
+        case bson::types::Int64: detail::store(buf, *b.as<std::int64_t>()); break;
+        case bson::types::uInt32: detail::store(buf, *b.as<std::uint32_t>()); break;
+        case bson::types::uInt64: detail::store(buf, *b.as<std::uint64_t>()); break;
+        case bson::types::Float: detail::store(buf, *b.as<float>()); break;
+        case bson::types::Double: detail::store(buf, *b.as<double>()); break;
+        case bson::types::String: {
+            auto const& str = *b.as<std::string>();
+            detail::store(buf, static_cast<detail::binary_len_t>(str.size()));
+            detail::store_bytes(buf, str.data(), str.size());
+            break;
+        }
+        case bson::types::Array: {
+            auto const& arr = *b.as<bson::array_t>();
+            auto const start = buf.size();
+            detail::store(buf, detail::binary_len_t{});
+            detail::store(buf, static_cast<detail::binary_len_t>(arr.size()));
+            for (auto&& val : arr)
+                encode(val, buf);
+            detail::store_at(buf, start, static_cast<detail::binary_len_t>(buf.size() - start));
+            break;
+        }
+        case bson::types::Document: encode(*b.as<document>(), buf); break;
+    }
+}
+
+inline void encode(document const& doc, byte_buffer& buf) {
+    auto const start = buf.size();
+    detail::store(buf, detail::binary_len_t{});
+    detail::store(buf, detail::binary_len_t{});
+    encode(doc.id(), buf);
+    detail::binary_len_t count = 0;
+    for (auto&& [key, val] : doc.values()) {
+        detail::store(buf, static_cast<detail::binary_len_t>(key.size()));
+        detail::store_bytes(buf, key.data(), key.size());
+        encode(val, buf);
+        ++count;
+    }
+    detail::store_at(buf, start, static_cast<detail::binary_len_t>(buf.size() - start));
+    detail::store_at(buf, start + sizeof(detail::binary_len_t), count);
+}
+
+[[nodiscard]] inline byte_buffer encode(document const& doc) {
+    byte_buffer buf;
+    encode(doc, buf);
+    return buf;
+}
+
+class array_view;
+class document_view;
+
+// A read-only view of a single encoded bson value.
+// The view does not own the underlying bytes, which must outlive it.
+class bson_view {
+    std::byte const* data_ = nullptr;
+
+    [[nodiscard]] std::byte const* payload() const noexcept { return data_ + 1; }
+
+    template<class T>
+    static constexpr bool is_valid_type = std::disjunction_v<std::is_same<T, unique_id>,
+            std::is_same<T, bson::null_t>, std::is_same<T, bool>,
+            std::is_same<T, std::int32_t>, std::is_same<T, std::int64_t>,
+            std::is_same<T, std::uint32_t>, std::is_same<T, std::uint64_t>,
+            std::is_same<T, float>, std::is_same<T, double>,
+            std::is_same<T, std::string>, std::is_same<T, bson::array_t>,
+            std::is_same<T, document>>;
+
+public:
+    // the type returned from `as<T>()`
+    template<class T>
+    using view_t = std::conditional_t<std::is_same_v<T, std::string>, std::string_view,
+                   std::conditional_t<std::is_same_v<T, bson::array_t>, array_view,
+                   std::conditional_t<std::is_same_v<T, document>, document_view, T>>>;
+
+    constexpr bson_view() noexcept = default;
+    explicit constexpr bson_view(std::byte const* const data) noexcept : data_(data) {}
+
+    [[nodiscard]] bson::types type() const noexcept {
+        DEBUG_ASSERT(data_);
+        return static_cast<bson::types>(detail::load<std::uint8_t>(data_));
+    }
+
+    // return: number of bytes spanned by this value, including its type tag
+    [[nodiscard]] std::size_t byte_size() const noexcept {
+        switch (auto const t = type(); t) {
+            case bson::types::String: return 1 + sizeof(detail::binary_len_t) + detail::load<detail::binary_len_t>(payload());
+            case bson::types::Array:
+            case bson::types::Document: return 1 + detail::load<detail::binary_len_t>(payload());
+            default: return 1 + detail::fixed_payload_size(t);
+        }
+    }
+
+    [[nodiscard]] byte_span bytes() const noexcept { return {data_, byte_size()}; }
+    [[nodiscard]] std::byte const* data() const noexcept { return data_; }
+
+    template<class T>
+    [[nodiscard]] optional<view_t<T>> as() const noexcept;
+
+    template<class T>
+    [[nodiscard]] bool equals_weak(T const& t) const noexcept;
+
+    [[nodiscard]] bool operator==(bson_view const& other) const noexcept {
+        auto const size = byte_size();
+        return size == other.byte_size() && std::memcmp(data_, other.data_, size) == 0;
+    }
+
+    [[nodiscard]] bool operator!=(bson_view const& other) const noexcept {
+        return !(*this == other);
+    }
+
+    [[nodiscard]] bool operator==(bson const& other) const;
+
+    [[nodiscard]] bson to_bson() const;
+};
+
+// A read-only view of an encoded bson::array_t.
+class array_view {
+    std::byte const* data_ = nullptr; // points at the array's byte length
+
+    [[nodiscard]] std::byte const* first() const noexcept { return data_ + 2 * sizeof(detail::binary_len_t); }
+    [[nodiscard]] std::byte const* last() const noexcept { return data_ + detail::load<detail::binary_len_t>(data_); }
+
+public:
+    constexpr array_view() noexcept = default;
+    explicit constexpr array_view(std::byte const* const data) noexcept : data_(data) {}
+
+    [[nodiscard]] std::size_t size() const noexcept {
+        return detail::load<detail::binary_len_t>(data_ + sizeof(detail::binary_len_t));
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+    class iterator {
+        std::byte const* pos_;
+    public:
+        using value_type = bson_view;
+        using reference = bson_view;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::forward_iterator_tag;
+
+        explicit constexpr iterator(std::byte const* const pos) noexcept : pos_(pos) {}
+
+        [[nodiscard]] bson_view operator*() const noexcept { return bson_view{pos_}; }
+
+        iterator& operator++() noexcept {
+            pos_ += bson_view{pos_}.byte_size();
+            return *this;
+        }
+
+        [[nodiscard]] bool operator==(iterator const& other) const noexcept { return pos_ == other.pos_; }
+        [[nodiscard]] bool operator!=(iterator const& other) const noexcept { return pos_ != other.pos_; }
+    };
+
+    [[nodiscard]] iterator begin() const noexcept { return iterator{first()}; }
+    [[nodiscard]] iterator end() const noexcept { return iterator{last()}; }
+
+    // note: linear in `pos`
+    [[nodiscard]] bson_view operator[](std::size_t const pos) const noexcept {
+        DEBUG_ASSERT(pos < size());
+        auto it = begin();
+        for (std::size_t i = 0; i < pos; ++i)
+            ++it;
+        return *it;
+    }
+};
+
+// A read-only view of an encoded document.
+// Field lookups walk the encoded fields in place without materializing any bson values.
+class document_view {
+    std::byte const* data_ = nullptr; // points at the document's byte length
+
+    [[nodiscard]] std::byte const* id_ptr() const noexcept { return data_ + 2 * sizeof(detail::binary_len_t); }
+    [[nodiscard]] std::byte const* first_field() const noexcept { return id_ptr() + id().byte_size(); }
+    [[nodiscard]] std::byte const* last() const noexcept { return data_ + byte_size(); }
+
+public:
+    constexpr document_view() noexcept = default;
+    explicit constexpr document_view(std::byte const* const data) noexcept : data_(data) {}
+    explicit document_view(byte_span const bytes) noexcept
+        : data_(bytes.begin())
+    {
+        DEBUG_ASSERT(bytes.size() >= 2 * sizeof(detail::binary_len_t));
+        DEBUG_ASSERT(byte_size() <= bytes.size());
+    }
+
+    [[nodiscard]] std::size_t byte_size() const noexcept { return detail::load<detail::binary_len_t>(data_); }
+    [[nodiscard]] byte_span bytes() const noexcept { return {data_, byte_size()}; }
+    [[nodiscard]] std::byte const* data() const noexcept { return data_; }
+
+    // return: number of fields, not including the id
+    [[nodiscard]] std::size_t size() const noexcept {
+        return detail::load<detail::binary_len_t>(data_ + sizeof(detail::binary_len_t));
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+    [[nodiscard]] bson_view id() const noexcept { return bson_view{id_ptr()}; }
+
+    class iterator {
+        std::byte const* pos_; // points at a field's key length
+    public:
+        using value_type = std::pair<std::string_view, bson_view>;
+        using reference = value_type;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::forward_iterator_tag;
+
+        explicit constexpr iterator(std::byte const* const pos) noexcept : pos_(pos) {}
+
+        [[nodiscard]] std::string_view key() const noexcept {
+            return {reinterpret_cast<char const*>(pos_ + sizeof(detail::binary_len_t)),
+                    detail::load<detail::binary_len_t>(pos_)};
+        }
+
+        [[nodiscard]] bson_view value() const noexcept {
+            return bson_view{pos_ + sizeof(detail::binary_len_t) + detail::load<detail::binary_len_t>(pos_)};
+        }
+
+        [[nodiscard]] value_type operator*() const noexcept { return {key(), value()}; }
+
+        iterator& operator++() noexcept {
+            auto const val = value();
+            pos_ = val.data() + val.byte_size();
+            return *this;
+        }
+
+        [[nodiscard]] bool operator==(iterator const& other) const noexcept { return pos_ == other.pos_; }
+        [[nodiscard]] bool operator!=(iterator const& other) const noexcept { return pos_ != other.pos_; }
+    };
+
+    [[nodiscard]] iterator begin() const noexcept { return iterator{first_field()}; }
+    [[nodiscard]] iterator end() const noexcept { return iterator{last()}; }
+
+    [[nodiscard]] optional<bson_view> lookup(std::string_view const key) const noexcept {
+        for (auto it = begin(), last = end(); it != last; ++it)
+            if (it.key() == key)
+                return {it.value()};
+        return {};
+    }
+
+    // `path` is resolved through nested documents and arrays, elements of an array are found by a linear walk
+    [[nodiscard]] optional<bson_view> lookup(field_path const& path) const noexcept;
+
+    [[nodiscard]] optional<bson_view> operator[](std::string_view const key) const noexcept {
+        return lookup(key);
+    }
+
+    [[nodiscard]] bool contains(std::string_view const key) const noexcept {
+        return lookup(key).has_value();
+    }
+
+    [[nodiscard]] bool operator==(document_view const& other) const noexcept {
+        auto const size = byte_size();
+        return size == other.byte_size() && std::memcmp(data_, other.data_, size) == 0;
+    }
+
+    [[nodiscard]] document to_document() const;
+};
+
+template<class T>
+optional<bson_view::view_t<T>> bson_view::as() const noexcept {
+    static_assert(is_valid_type<T>);
+    auto const t = type();
+    if constexpr (std::is_same_v<T, unique_id>) {
+        if (t == bson::types::UniqueID)
+            return {unique_id::from_bytes(payload())};
+    }
+    else if constexpr (std::is_same_v<T, bson::null_t>) {
+        if (t == bson::types::Null)
+            return {bson::null_t{}};
+    }
+    else if constexpr (std::is_same_v<T, bool>) {
+        if (t == bson::types::Bool)
+            return {detail::load<std::uint8_t>(payload()) != 0};
+    }
+    else if constexpr (std::is_same_v<T, std::string>) {
+        if (t == bson::types::String)
+            return {std::string_view{reinterpret_cast<char const*>(payload() + sizeof(detail::binary_len_t)),
+                                     detail::load<detail::binary_len_t>(payload())}};
+    }
+    else if constexpr (std::is_same_v<T, bson::array_t>) {
+        if (t == bson::types::Array)
+            return {array_view{payload()}};
+    }
+    else if constexpr (std::is_same_v<T, document>) {
+        if (t == bson::types::Document)
+            return {document_view{payload()}};
+    }
+    else { // arithmetic
+        if (t == bson::type_of<T>())
+            return {detail::load<T>(payload())};
+    }
+    return {};
+}
+
+template<class T>
+bool bson_view::equals_weak(T const& t) const noexcept {
+    if constexpr (std::is_arithmetic_v<T>) {
+        switch (type()) {
+            case bson::types::Bool: return *as<bool>() == t;
+            case bson::types::Int32: return *as<std::int32_t>() == t;
+            case bson::types::Int64: return *as<std::int64_t>() == t;
+            case bson::types::uInt32: return *as<std::uint32_t>() == t;
+            case bson::types::uInt64: return *as<std::uint64_t>() == t;
+            case bson::types::Float: return *as<float>() == t;
+            case bson::types::Double: return *as<double>() == t;
+            default: return false;
+        }
+    }
+    else if constexpr (std::is_same_v<unique_id, T>) {
+        auto const id = as<unique_id>();
+        return id && *id == t;
+    }
+    else if constexpr (std::is_same_v<bson::null_t, T>) {
+        return type() == bson::types::Null;
+    }
+    else if constexpr (std::is_same_v<bson::array_t, T> || std::is_same_v<document, T>) {
+        return *this == bson{t};
+    }
+    else if constexpr (detail::is_string_comparable_v<T>) {
+        auto const str = as<std::string>();
+        return str && *str == t;
+    }
+    else {
+        static_assert(detail::always_false<T>::value);
+        return false;
+    }
+}
+
+inline bool bson_view::operator==(bson const& other) const {
+    byte_buffer buf;
+    encode(other, buf);
+    return byte_size() == buf.size() && std::memcmp(data_, buf.data(), buf.size()) == 0;
+}
+
+inline bson bson_view::to_bson() const {
+    switch (type()) {
+        case bson::types::UniqueID: return bson{bson_type<unique_id>, *as<unique_id>()};
+        case bson::types::Null: return bson{bson_type<bson::null_t>};
+        case bson::types::Bool: return bson{bson_type<bool>, *as<bool>()};
+        case bson::types::Int32: return bson{bson_type<std::int32_t>, *as<std::int32_t>()};
+        case bson::types::Int64: return bson{bson_type<std::int64_t>, *as<std::int64_t>()};
+        case bson::types::uInt32: return bson{bson_type<std::uint32_t>, *as<std::uint32_t>()};
+        case bson::types::uInt64: return bson{bson_type<std::uint64_t>, *as<std::uint64_t>()};
+        case bson::types::Float: return bson{bson_type<float>, *as<float>()};
+        case bson::types::Double: return bson{bson_type<double>, *as<double>()};
+        case bson::types::String: return bson{bson_type<std::string>, *as<std::string>()};
+        case bson::types::Array: {
+            auto const view = *as<bson::array_t>();
+            bson::array_t arr;
+            arr.reserve(view.size());
+            for (auto&& val : view)
+                arr.push_back(val.to_bson());
+            return bson{bson_type<bson::array_t>, std::move(arr)};
+        }
+        case bson::types::Document: return bson{bson_type<document>, as<document>()->to_document()};
+    }
+    DEBUG_ASSERT(false);
+    return bson{bson_type<bson::null_t>};
+}
+
+inline document document_view::to_document() const {
+    document doc(id().to_bson());
+    for (auto&& [key, val] : *this)
+        doc.values().insert(std::string{key}, val.to_bson());
+    return doc;
+}
+
+inline optional<bson_view> document_view::lookup(field_path const& path) const noexcept {
+    auto found = lookup(std::string_view{path.head()});
+    auto const segments = path.segments();
+    for (std::size_t i = 1; found && i < segments.size(); ++i) {
+        auto const& seg = segments[i];
+        if (auto const sub = found->as<document>(); sub)
+            found = sub->lookup(std::string_view{seg.name});
+        else if (auto const arr = found->as<bson::array_t>(); arr && seg.is_index() && seg.index < arr->size())
+            found = (*arr)[seg.index];
+        else
+            found = {};
+    }
+    return found;
+}
+
+[[nodiscard]] inline document decode(document_view const view) {
+    return view.to_document();
+}
+
+[[nodiscard]] inline bson decode(bson_view const view) {
+    return view.to_bson();
+}
+
+} // namespace nova
+
+template<>
+struct fmt::formatter<nova::bson_view> {
+    constexpr auto parse(fmt::format_parse_context& ctx) { return ctx.begin(); }
+
+    template<class FmtCtx>
+    auto format(nova::bson_view const& b, FmtCtx& ctx) {
+        return fmt::format_to(ctx.out(), "{}", b.to_bson());
+    }
+};
+
+template<>
+struct fmt::formatter<nova::document_view> {
+    constexpr auto parse(fmt::format_parse_context& ctx) const noexcept { return ctx.begin(); }
+
+    template<class FmtCtx>
+    auto format(nova::document_view const& doc, FmtCtx& ctx) const {
+        fmt::format_to(ctx.out(), "{{\n  _id: {}", doc.id());
+        for (auto&& [k, v] : doc)
+            fmt::format_to(ctx.out(), ",\n  {}: {}", k, v);
+        return fmt::format_to(ctx.out(), "\n}}");
+    }
+};
+
+#endif // NOVA_BINARY_HPP
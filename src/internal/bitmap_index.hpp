@@ -0,0 +1,242 @@
+#ifndef NOVA_BITMAP_INDEX_HPP
+#define NOVA_BITMAP_INDEX_HPP
+
+#include <absl/container/btree_map.h>
+#include <absl/container/flat_hash_map.h>
+
+#include "../debug.hpp"
+#include "bson.hpp"
+#include "cursor.hpp"
+#include "document.hpp"
+#include "field_path.hpp"
+#include "index.hpp"
+#include "index_stats.hpp"
+#include "util/non_null_ptr.hpp"
+#include "util/optional.hpp"
+#include "util/roaring_bitmap.hpp"
+#include "util/span.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace nova {
+
+// Dense numbers for the documents of a collection, shared by its bitmap indices so their bitmaps can be combined.
+// The numbers of erased documents are handed out again, the most recently freed first, so the numbers stay about
+// as many as the documents and a document erased and registered again, as on update, keeps its number.
+class document_ordinals {
+    absl::flat_hash_map<document const*, std::uint32_t> ordinals_{};
+    std::vector<document const*> docs_{}; // by ordinal, null once freed
+    std::vector<std::uint32_t> free_{};
+
+public:
+    [[nodiscard]] std::size_t size() const noexcept { return ordinals_.size(); }
+    // one past the greatest ordinal handed out
+    [[nodiscard]] std::size_t capacity() const noexcept { return docs_.size(); }
+
+    // return: the ordinal of `doc`, handed out now unless it has one
+    std::uint32_t assign(non_null_ptr<document const> const doc) {
+        if (auto const found = ordinals_.find(doc.get()); found != ordinals_.end())
+            return found->second;
+        std::uint32_t ordinal;
+        if (!free_.empty()) {
+            ordinal = free_.back();
+            free_.pop_back();
+            docs_[ordinal] = doc.get();
+        }
+        else {
+            DEBUG_ASSERT(docs_.size() < std::numeric_limits<std::uint32_t>::max());
+            ordinal = static_cast<std::uint32_t>(docs_.size());
+            docs_.push_back(doc.get());
+        }
+        ordinals_.emplace(doc.get(), ordinal);
+        return ordinal;
+    }
+
+    [[nodiscard]] optional<std::uint32_t> find(non_null_ptr<document const> const doc) const {
+        if (auto const found = ordinals_.find(doc.get()); found != ordinals_.end())
+            return found->second;
+        return {};
+    }
+
+    [[nodiscard]] document const& operator[](std::uint32_t const ordinal) const noexcept {
+        DEBUG_ASSERT(ordinal < docs_.size() && docs_[ordinal]);
+        return *docs_[ordinal];
+    }
+
+    bool release(non_null_ptr<document const> const doc) {
+        auto const found = ordinals_.find(doc.get());
+        if (found == ordinals_.end())
+            return false;
+        docs_[found->second] = nullptr;
+        free_.push_back(found->second);
+        ordinals_.erase(found);
+        return true;
+    }
+
+    // return: the documents numbered by `ordinals`
+    [[nodiscard]] const_cursor documents(roaring_bitmap const& ordinals) const {
+        // the cursor yields from the back, documents come out by ascending ordinal
+        auto const numbers = ordinals.to_vector();
+        std::vector<non_null_ptr<document const>> result;
+        result.reserve(numbers.size());
+        for (auto it = numbers.end(); it != numbers.begin();)
+            result.push_back(docs_[*--it]);
+        return multiple_index_lookup_vec{std::move(result)};
+    }
+};
+
+// An index of a single field holding, for each distinct value, the compressed bitmap of the ordinals of the documents
+// holding it. A value is stored once however many documents hold it, which suits fields of few distinct values,
+// and equality lookups on several bitmap indexed fields are answered by intersecting their bitmaps.
+// Values are held whole, arrays included. Ordinals are those of the collection's `document_ordinals`.
+class bitmap_index {
+    inline static constexpr std::uint32_t no_posting = std::numeric_limits<std::uint32_t>::max();
+
+    struct posting {
+        bson key;
+        roaring_bitmap docs;
+    };
+
+    field_path path_;
+    document_ordinals* ordinals_;
+    absl::btree_map<bson, std::uint32_t> keys_{}; // value -> position in `postings_`
+    std::vector<posting> postings_{};
+    std::vector<std::uint32_t> free_postings_{};
+    std::vector<std::uint32_t> posting_of_{}; // by ordinal, `no_posting` for the documents not held
+    std::size_t size_ = 0;
+
+public:
+    bitmap_index(std::string_view const field, document_ordinals& ordinals)
+        : path_(field), ordinals_(std::addressof(ordinals)) {}
+
+    [[nodiscard]] field_path const& path() const noexcept { return path_; }
+    [[nodiscard]] std::size_t size() const noexcept { return size_; }
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+    [[nodiscard]] std::size_t key_count() const noexcept { return keys_.size(); }
+    [[nodiscard]] document_ordinals const& ordinals() const noexcept { return *ordinals_; }
+
+    [[nodiscard]] bool contains_doc(non_null_ptr<document const> const doc) const {
+        auto const ordinal = ordinals_->find(doc);
+        return ordinal && *ordinal < posting_of_.size() && posting_of_[*ordinal] != no_posting;
+    }
+
+    // return: false if `doc` is indexed already
+    bool insert(bson const& val, non_null_ptr<document const> const doc) {
+        auto const ordinal = ordinals_->assign(doc);
+        if (ordinal >= posting_of_.size())
+            posting_of_.resize(ordinals_->capacity(), no_posting);
+        if (posting_of_[ordinal] != no_posting)
+            return false;
+
+        auto [it, added] = keys_.try_emplace(val, 0);
+        if (added) {
+            if (free_postings_.empty()) {
+                it->second = static_cast<std::uint32_t>(postings_.size());
+                postings_.push_back(posting{val, {}});
+            }
+            else {
+                it->second = free_postings_.back();
+                free_postings_.pop_back();
+                postings_[it->second].key = val;
+            }
+        }
+        postings_[it->second].docs.insert(ordinal);
+        posting_of_[ordinal] = it->second;
+        ++size_;
+        return true;
+    }
+
+    bool erase_doc(non_null_ptr<document const> const doc) {
+        auto const ordinal = ordinals_->find(doc);
+        if (!ordinal || *ordinal >= posting_of_.size() || posting_of_[*ordinal] == no_posting)
+            return false;
+        auto const pos = std::exchange(posting_of_[*ordinal], no_posting);
+        auto& found = postings_[pos];
+        found.docs.erase(*ordinal);
+        if (found.docs.empty()) {
+            keys_.erase(found.key);
+            free_postings_.push_back(pos); // the key is replaced once the posting is reused
+        }
+        --size_;
+        return true;
+    }
+
+    void clear() {
+        keys_.clear();
+        postings_.clear();
+        free_postings_.clear();
+        posting_of_.clear();
+        size_ = 0;
+    }
+
+    // return: the ordinals of the documents holding `val`, none if no document does
+    [[nodiscard]] optional<roaring_bitmap const&> lookup_bits(bson const& val) const {
+        if (auto const found = keys_.find(val); found != keys_.end())
+            return {postings_[found->second].docs};
+        return {};
+    }
+
+    // return: the ordinals of the documents holding any of `values`
+    [[nodiscard]] roaring_bitmap lookup_in(span<bson const> const values) const {
+        roaring_bitmap result;
+        for (auto&& val : values)
+            if (auto const found = lookup_bits(val); found)
+                result |= *found;
+        return result;
+    }
+
+    // return: the ordinals of the documents whose value lies between `lower` and `upper`,
+    // a missing bound leaves that end of the range open
+    [[nodiscard]] roaring_bitmap lookup_range(optional<bson const&> const lower, optional<bson const&> const upper,
+                                              range_bounds const bounds = range_bounds::closed) const {
+        roaring_bitmap result;
+        for (auto [first, last] = detail::ordered_range(keys_, lower, upper, bounds); first != last; ++first)
+            result |= postings_[first->second].docs;
+        return result;
+    }
+
+    [[nodiscard]] const_cursor lookup_many(bson const& val) const {
+        if (auto const found = lookup_bits(val); found)
+            return documents(*found);
+        return zero_index_lookup<document const>;
+    }
+
+    // return: the documents numbered by `ordinals`, a bitmap of this index or of another bitmap index of the collection
+    [[nodiscard]] const_cursor documents(roaring_bitmap const& ordinals) const {
+        return ordinals_->documents(ordinals);
+    }
+
+    // return: the statistics of the values held, counted exactly from the bitmaps rather than sampled
+    [[nodiscard]] index_stats statistics() const {
+        index_stats stats;
+        stats.entries = size_;
+        stats.documents = size_;
+        stats.distinct = keys_.size();
+        stats.sampled = size_;
+        std::vector<std::pair<bson const*, std::size_t>> runs;
+        runs.reserve(keys_.size());
+        for (auto&& [key, pos] : keys_) {
+            runs.emplace_back(std::addressof(key), postings_[pos].docs.size());
+            if (key.type() == bson::types::Null)
+                stats.nulls += postings_[pos].docs.size();
+        }
+        detail::fill_value_stats(stats, runs, 1.);
+        return stats;
+    }
+
+    // return: the bytes held by the bitmaps and the ordinal table, keys left out
+    [[nodiscard]] std::size_t bytes() const noexcept {
+        std::size_t result = posting_of_.capacity() * sizeof(std::uint32_t) + postings_.capacity() * sizeof(posting);
+        for (auto&& p : postings_)
+            result += p.docs.bytes();
+        return result;
+    }
+};
+
+} // namespace nova
+
+#endif // NOVA_BITMAP_INDEX_HPP
@@ -71,10 +71,32 @@ public:
         return static_cast<types>(storage_.index());
     }
 
+    // return: the `types` enumerator corresponding to the C++ type `T`
+    template<class T>
+    [[nodiscard]] static constexpr types type_of() noexcept {
+        static_assert(is_valid_type<T>);
+        if constexpr (std::is_same_v<T, unique_id>) return types::UniqueID;
+        else if constexpr (std::is_same_v<T, null_t>) return types::Null;
+        else if constexpr (std::is_same_v<T, bool>) return types::Bool;
+        else if constexpr (std::is_same_v<T, std::int32_t>) return types::Int32;
+        else if constexpr (std::is_same_v<T, std::int64_t>) return types::Int64;
+        else if constexpr (std::is_same_v<T, std::uint32_t>) return types::uInt32;
+        else if constexpr (std::is_same_v<T, std::uint64_t>) return types::uInt64;
+        else if constexpr (std::is_same_v<T, float>) return types::Float;
+        else if constexpr (std::is_same_v<T, double>) return types::Double;
+        else if constexpr (std::is_same_v<T, std::string>) return types::String;
+        else if constexpr (std::is_same_v<T, array_t>) return types::Array;
+        else return types::Document;
+    }
+
     template<class T>
     [[nodiscard]] optional<T&> as() noexcept {
         static_assert(is_valid_type<T>);
-        if (auto const ptr = std::get_if<T>(&storage_); ptr)
+        if constexpr (std::is_same_v<T, document>) {
+            if (auto const ptr = std::get_if<detail::recursive_wrapper<document>>(&storage_); ptr)
+                return {ptr->get()};
+        }
+        else if (auto const ptr = std::get_if<T>(&storage_); ptr)
             return {*ptr};
         return {};
     }
@@ -82,7 +104,11 @@ public:
     template<class T>
     [[nodiscard]] optional<T const&> as() const noexcept {
         static_assert(is_valid_type<T>);
-        if (auto const ptr = std::get_if<T>(&storage_); ptr)
+        if constexpr (std::is_same_v<T, document>) {
+            if (auto const ptr = std::get_if<detail::recursive_wrapper<document>>(&storage_); ptr)
+                return {ptr->get()};
+        }
+        else if (auto const ptr = std::get_if<T>(&storage_); ptr)
             return {*ptr};
         return {};
     }
@@ -149,12 +175,14 @@ public:
         return storage_ == other.storage_;
     }
 
+    // values of different types are ordered by their type
     constexpr bool operator<(bson const& other) const noexcept {
-        DEBUG_ASSERT(type() == other.type());
-        std::visit(detail::overloaded{
-            [](null_t) { DEBUG_ASSERT(false); return true; },
-            [](detail::recursive_wrapper<document> const&) { DEBUG_ASSERT(false); return true; },
-            [&other](auto&& val) { 
+        if (type() != other.type())
+            return type() < other.type();
+        return std::visit(detail::overloaded{
+            [](null_t) { return false; },
+            [](detail::recursive_wrapper<document> const&) { DEBUG_ASSERT(false); return false; },
+            [&other](auto&& val) -> bool { 
                 return val < std::get<std::remove_cv_t<std::remove_reference_t<decltype(val)>>>(other.storage_); 
             }
         }, storage_);
@@ -206,15 +234,16 @@ struct fmt::formatter<nova::bson> {
 namespace std {
     template<>
     struct hash<nova::bson> {
-        constexpr ::std::size_t operator()(nova::bson const& val) const noexcept {
+        ::std::size_t operator()(nova::bson const& val) const noexcept {
             return ::std::visit(nova::detail::overloaded{
                 [](nova::bson::null_t){
-                    DEBUG_ASSERT(false);
                     return static_cast<::std::size_t>(0);
                 }, 
-                [](nova::bson::array_t const&){
-                    DEBUG_ASSERT(false);
-                    return static_cast<::std::size_t>(0);
+                [this](nova::bson::array_t const& arr){
+                    ::std::size_t hash{arr.size()};
+                    for (auto&& elem : arr)
+                        hash ^= (*this)(elem) + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+                    return hash;
                 }, 
                 [](nova::detail::recursive_wrapper<nova::document> const&){
                     DEBUG_ASSERT(false);
@@ -227,7 +256,8 @@ namespace std {
                     return id.hash();
                 },
                 [](auto&& val) {
-                    return static_cast<size_t>(val);
+                    // floating point values are hashed by their bits rather than truncated
+                    return ::std::hash<::std::decay_t<decltype(val)>>{}(val);
                 }
             }, val.storage_);
         }
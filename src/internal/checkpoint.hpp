@@ -0,0 +1,476 @@
+#ifndef NOVA_CHECKPOINT_HPP
+#define NOVA_CHECKPOINT_HPP
+
+#include <absl/container/flat_hash_map.h>
+
+#include "../debug.hpp"
+#include "binary.hpp"
+#include "bson.hpp"
+#include "collection.hpp"
+#include "wal.hpp"
+#include "util/crc32.hpp"
+#include "util/mapped_file.hpp"
+#include "util/optional.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// File layout (integers in host byte order, strings and documents as in wal.hpp):
+//
+//  checkpoint := magic:u64 version:u32 lsn:u64 data[count] directory directory_offset:u64 crc:u32
+//  data       := document[doc_count] offsets:u64[doc_count] ids:id_entry[doc_count] entries:u64[entry_count][index_count]
+//  directory  := count:u32 collection[count]
+//  collection := name:str index_count:u32 index[index_count] column_count:u32 column[column_count]
+//                doc_count:u64 offsets_offset:u64 ids_offset:u64
+//  index      := flags:u8 filter:str count:u8 field:str[count] entry_count:u64 entries_offset:u64
+//  column     := type:u8 field:str
+//  id_entry   := hash:u64 doc:u64
+//
+// `lsn` is the last log record reflected in the checkpoint and `crc` covers every byte before it.
+// `offsets` holds the file offset of every document of a collection. `ids` is sorted by the hash
+// of the binary encoded id of document `doc`, so a document can be found without reading the others.
+// The `entries` of an index are the positions of the documents it holds, in the order of their keys,
+// hashed indices included. Multikey indices store no entries, they are rebuilt when a database loads the checkpoint.
+// `flags` are as in the log.
+// The directory follows the data so the file is written front to back in a single pass.
+
+namespace nova {
+
+namespace detail {
+
+inline static constexpr std::uint64_t checkpoint_magic = 0x54504B4341564F4E; // "NOVACKPT"
+inline static constexpr std::uint32_t checkpoint_version = 2;
+inline static constexpr std::size_t checkpoint_id_entry_size = 2 * sizeof(std::uint64_t);
+
+// FNV-1a, stable across processes unlike the hash of the in memory containers
+[[nodiscard]] inline std::uint64_t stable_hash(std::byte const* const data, std::size_t const size) noexcept {
+    std::uint64_t hash = 0xcbf29ce484222325;
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<std::uint64_t>(data[i]);
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+// Buffers writes to a file, keeping track of the offset and crc of everything written.
+class checkpoint_file_writer {
+    static constexpr std::size_t flush_size = 1 << 20;
+
+    int fd_;
+    byte_buffer buf_{};
+    std::uint64_t offset_ = 0;
+    std::uint32_t crc_ = 0;
+    bool ok_ = true;
+
+public:
+    explicit checkpoint_file_writer(int const fd) : fd_(fd) {
+        buf_.reserve(flush_size + (flush_size >> 2));
+    }
+
+    // everything appended to the buffer is written by the next `flush`
+    [[nodiscard]] byte_buffer& buffer() noexcept { return buf_; }
+
+    // return: the file offset the next byte appended to the buffer will be written at
+    [[nodiscard]] std::uint64_t offset() const noexcept { return offset_ + buf_.size(); }
+
+    void flush() {
+        if (ok_ && !buf_.empty()) {
+            crc_ = crc32(buf_.data(), buf_.size(), crc_);
+            ok_ = write_all(fd_, buf_.data(), buf_.size());
+        }
+        offset_ += buf_.size();
+        buf_.clear();
+    }
+
+    void maybe_flush() {
+        if (buf_.size() >= flush_size)
+            flush();
+    }
+
+    // writes the crc of everything written so far
+    [[nodiscard]] bool finish() {
+        flush();
+        store(buf_, crc_);
+        ok_ = ok_ && write_all(fd_, buf_.data(), buf_.size());
+        buf_.clear();
+        return ok_;
+    }
+};
+
+[[nodiscard]] inline bool sync_parent_directory(std::string const& path) noexcept {
+    auto const slash = path.rfind('/');
+    auto const dir = slash == std::string::npos ? std::string{"."} : path.substr(0, slash == 0 ? 1 : slash);
+    auto const fd = ::open(dir.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    auto const ok = sync_fd(fd) || errno == EINVAL; // some file systems do not sync directories
+    ::close(fd);
+    return ok;
+}
+
+} // namespace detail
+
+struct checkpoint_index {
+    bool unique;
+    index_kind kind;
+    bool multikey;
+    std::string_view filter;
+    std::vector<std::string_view> fields;
+    std::size_t size = 0;                 // number of documents held by the index
+    std::byte const* entries = nullptr;   // the position of every document held, in the order of their keys
+};
+
+struct checkpoint_column {
+    bson::types type;
+    std::string_view field;
+};
+
+// The documents and definitions of one collection stored in a checkpoint.
+// Every view references the mapped file and is valid as long as the owning checkpoint.
+class checkpoint_collection {
+    friend class checkpoint;
+
+    std::string_view name_{};
+    std::vector<checkpoint_index> indices_{};
+    std::vector<checkpoint_column> columns_{};
+    std::byte const* file_ = nullptr;
+    std::size_t size_ = 0;
+    std::byte const* offsets_ = nullptr;
+    std::byte const* ids_ = nullptr;
+
+    [[nodiscard]] std::uint64_t id_hash(std::size_t const i) const noexcept {
+        return detail::load<std::uint64_t>(ids_ + i * detail::checkpoint_id_entry_size);
+    }
+
+    [[nodiscard]] std::uint64_t id_doc(std::size_t const i) const noexcept {
+        return detail::load<std::uint64_t>(ids_ + i * detail::checkpoint_id_entry_size + sizeof(std::uint64_t));
+    }
+
+public:
+    class iterator {
+        checkpoint_collection const* coll_;
+        std::size_t pos_;
+    public:
+        using value_type = document_view;
+        using reference = document_view;
+        using pointer = void;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::input_iterator_tag;
+
+        iterator(checkpoint_collection const* const coll, std::size_t const pos) noexcept : coll_(coll), pos_(pos) {}
+
+        [[nodiscard]] document_view operator*() const noexcept { return (*coll_)[pos_]; }
+        iterator& operator++() noexcept { ++pos_; return *this; }
+        iterator operator++(int) noexcept { auto const tmp = *this; ++pos_; return tmp; }
+        [[nodiscard]] bool operator==(iterator const& other) const noexcept { return pos_ == other.pos_; }
+        [[nodiscard]] bool operator!=(iterator const& other) const noexcept { return pos_ != other.pos_; }
+    };
+
+    [[nodiscard]] std::string_view name() const noexcept { return name_; }
+    [[nodiscard]] std::vector<checkpoint_index> const& indices() const noexcept { return indices_; }
+    [[nodiscard]] std::vector<checkpoint_column> const& columns() const noexcept { return columns_; }
+    [[nodiscard]] std::size_t size() const noexcept { return size_; }
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+
+    [[nodiscard]] document_view operator[](std::size_t const pos) const noexcept {
+        DEBUG_ASSERT(pos < size_);
+        return document_view{file_ + detail::load<std::uint64_t>(offsets_ + pos * sizeof(std::uint64_t))};
+    }
+
+    [[nodiscard]] iterator begin() const noexcept { return {this, 0}; }
+    [[nodiscard]] iterator end() const noexcept { return {this, size_}; }
+
+    // return: the position of the document with the id `id`
+    [[nodiscard]] optional<std::size_t> find(doc_id const& id) const {
+        byte_buffer key;
+        encode(id, key);
+        auto const hash = detail::stable_hash(key.data(), key.size());
+
+        std::size_t first = 0;
+        for (std::size_t count = size_; count > 0;) {
+            auto const half = count / 2;
+            if (id_hash(first + half) < hash) {
+                first += half + 1;
+                count -= half + 1;
+            }
+            else
+                count = half;
+        }
+        for (; first < size_ && id_hash(first) == hash; ++first) {
+            auto const pos = static_cast<std::size_t>(id_doc(first));
+            auto const found = (*this)[pos].id();
+            if (found.byte_size() == key.size() && std::memcmp(found.data(), key.data(), key.size()) == 0)
+                return {pos};
+        }
+        return {};
+    }
+
+    [[nodiscard]] optional<document_view> lookup(doc_id const& id) const {
+        if (auto const pos = find(id); pos)
+            return {(*this)[*pos]};
+        return {};
+    }
+};
+
+// A checkpoint file mapped into memory.
+// Opening a checkpoint only reads the definitions of its collections, documents are read on access.
+class checkpoint {
+    mapped_file file_{};
+    std::uint64_t lsn_ = 0;
+    std::vector<checkpoint_collection> collections_{};
+
+public:
+    checkpoint() = default;
+
+    // `verify` checks the crc of the whole file, which reads every page of it
+    [[nodiscard]] wal_status open(std::string const& path, bool const verify = true) {
+        collections_.clear();
+        switch (file_.open(path)) {
+            case mapped_file::status::ok: break;
+            case mapped_file::status::not_found: return wal_status::not_found;
+            case mapped_file::status::io_error: return wal_status::io_error;
+        }
+
+        auto const bytes = file_.bytes();
+        if (bytes.size() < sizeof(std::uint32_t))
+            return wal_status::corrupt;
+        auto const body_size = bytes.size() - sizeof(std::uint32_t);
+        if (verify) {
+            file_.advise_sequential();
+            if (crc32(file_.data(), body_size) != detail::load<std::uint32_t>(file_.data() + body_size))
+                return wal_status::corrupt;
+        }
+
+        wal_payload_reader header{span<std::byte const>{file_.data(), body_size}};
+        if (header.read<std::uint64_t>() != detail::checkpoint_magic || header.read<std::uint32_t>() != detail::checkpoint_version)
+            return wal_status::corrupt;
+        lsn_ = header.read<std::uint64_t>();
+        if (!header.ok() || body_size < sizeof(std::uint64_t))
+            return wal_status::corrupt;
+
+        auto const directory_end = body_size - sizeof(std::uint64_t);
+        auto const directory_offset = detail::load<std::uint64_t>(file_.data() + directory_end);
+        if (directory_offset > directory_end)
+            return wal_status::corrupt;
+        wal_payload_reader reader{span<std::byte const>{file_.data() + directory_offset, static_cast<std::size_t>(directory_end - directory_offset)}};
+
+        // return: the table of `count` entries of `entry_size` bytes at `offset`, null if it is not within the file
+        auto table = [&](std::uint64_t const offset, std::uint64_t const count, std::size_t const entry_size) -> std::byte const* {
+            if (offset > directory_offset || count > (directory_offset - offset) / entry_size)
+                return nullptr;
+            return file_.data() + offset;
+        };
+
+        auto const count = reader.read<std::uint32_t>();
+        for (std::uint32_t c = 0; c < count && reader.ok(); ++c) {
+            checkpoint_collection coll;
+            coll.file_ = file_.data();
+            coll.name_ = reader.read_string();
+
+            auto const index_count = reader.read<std::uint32_t>();
+            for (std::uint32_t i = 0; i < index_count && reader.ok(); ++i) {
+                checkpoint_index index;
+                auto const flags = reader.read<std::uint8_t>();
+                index.unique = detail::index_flags_unique(flags);
+                index.kind = detail::index_flags_kind(flags);
+                index.multikey = detail::index_flags_multikey(flags);
+                index.filter = reader.read_string();
+                auto const field_count = reader.read<std::uint8_t>();
+                for (std::uint8_t f = 0; f < field_count; ++f)
+                    index.fields.push_back(reader.read_string());
+                auto const entry_count = reader.read<std::uint64_t>();
+                index.entries = table(reader.read<std::uint64_t>(), entry_count, sizeof(std::uint64_t));
+                index.size = static_cast<std::size_t>(entry_count);
+                if (!index.entries)
+                    return wal_status::corrupt;
+                coll.indices_.push_back(std::move(index));
+            }
+
+            auto const column_count = reader.read<std::uint32_t>();
+            for (std::uint32_t i = 0; i < column_count && reader.ok(); ++i) {
+                auto const type = static_cast<bson::types>(reader.read<std::uint8_t>());
+                coll.columns_.push_back(checkpoint_column{type, reader.read_string()});
+            }
+
+            auto const size = reader.read<std::uint64_t>();
+            coll.offsets_ = table(reader.read<std::uint64_t>(), size, sizeof(std::uint64_t));
+            coll.ids_ = table(reader.read<std::uint64_t>(), size, detail::checkpoint_id_entry_size);
+            coll.size_ = static_cast<std::size_t>(size);
+            if (!reader.ok() || !coll.offsets_ || !coll.ids_)
+                return wal_status::corrupt;
+            collections_.push_back(std::move(coll));
+        }
+        if (!reader.ok() || !reader.done())
+            return wal_status::corrupt;
+        return wal_status::ok;
+    }
+
+    // return: the last log record reflected in the checkpoint
+    [[nodiscard]] std::uint64_t lsn() const noexcept { return lsn_; }
+
+    [[nodiscard]] std::vector<checkpoint_collection> const& collections() const noexcept { return collections_; }
+
+    [[nodiscard]] optional<checkpoint_collection const&> lookup(std::string_view const name) const noexcept {
+        for (auto&& coll : collections_)
+            if (coll.name() == name)
+                return {coll};
+        return {};
+    }
+};
+
+// Writes a checkpoint of `collections`, a range of (name, collection pointer) pairs, reflecting the log up to `lsn`.
+// `filter_name(std::type_index)` returns the name an index filter is stored under, empty if it has none.
+// The file is written next to `path` and renamed over it once durable, so `path` always holds a complete checkpoint.
+template<class Collections, class FilterName>
+[[nodiscard]] wal_status write_checkpoint(std::string const& path, std::uint64_t const lsn,
+                                          Collections const& collections, FilterName&& filter_name) {
+    auto const tmp_path = path + ".tmp";
+    auto const fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return wal_status::io_error;
+    auto fail = [&](wal_status const status) {
+        ::close(fd);
+        std::remove(tmp_path.c_str());
+        return status;
+    };
+
+    detail::checkpoint_file_writer out{fd};
+    auto& buf = out.buffer();
+    detail::store(buf, detail::checkpoint_magic);
+    detail::store(buf, detail::checkpoint_version);
+    detail::store(buf, lsn);
+
+    // the directory is built while the data is written and appended at the end
+    byte_buffer directory;
+    detail::store(directory, static_cast<std::uint32_t>(std::distance(std::begin(collections), std::end(collections))));
+
+    std::vector<std::uint64_t> offsets;
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> ids;
+    absl::flat_hash_map<document const*, std::uint64_t> positions;
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> entries; // (count, offset) of the entries of every index
+    std::vector<document const*> sorted;
+    for (auto&& [name, coll_ptr] : collections) {
+        collection const& coll = *coll_ptr;
+
+        offsets.clear();
+        ids.clear();
+        offsets.reserve(coll.size());
+        ids.reserve(coll.size());
+        for (auto&& doc : coll) {
+            auto const start = buf.size();
+            offsets.push_back(out.offset());
+            encode(doc, buf);
+            // the id directly follows the two length fields of a document
+            auto const id = buf.data() + start + 2 * sizeof(detail::binary_len_t);
+            ids.emplace_back(detail::stable_hash(id, bson_view{id}.byte_size()), ids.size());
+            out.maybe_flush();
+        }
+
+        auto const offsets_offset = out.offset();
+        for (auto const offset : offsets) {
+            detail::store(buf, offset);
+            out.maybe_flush();
+        }
+        std::sort(ids.begin(), ids.end());
+        auto const ids_offset = out.offset();
+        for (auto&& [hash, doc] : ids) {
+            detail::store(buf, hash);
+            detail::store(buf, doc);
+            out.maybe_flush();
+        }
+
+        auto const indices = coll.index_definitions();
+        entries.clear();
+        positions.clear();
+        if (indices.size() > 0) {
+            positions.reserve(coll.size());
+            for (auto&& doc : coll)
+                positions.emplace(std::addressof(doc), positions.size());
+        }
+        for (auto&& index : indices) {
+            auto const entries_offset = out.offset();
+            std::uint64_t count = 0;
+            auto store_entry = [&](document const& doc) {
+                detail::store(buf, positions.find(std::addressof(doc))->second);
+                out.maybe_flush();
+                ++count;
+            };
+            if (index.multikey)
+                ; // a document is held once per element, the order of its keys is not the order of its fields
+            else if (index.kind == index_kind::text || index.kind == index_kind::spatial || index.kind == index_kind::bitmap)
+                ; // not ordered by the values of its fields, a database rebuilds the index on load
+            else if (index.kind == index_kind::ordered)
+                coll.for_each_indexed(index, store_entry);
+            else {
+                // the documents of a hashed index are sorted here, so every stored index can be binary searched
+                sorted.clear();
+                coll.for_each_indexed(index, [&](document const& doc) { sorted.push_back(std::addressof(doc)); });
+                std::stable_sort(sorted.begin(), sorted.end(), [&](document const* const lhs, document const* const rhs) {
+                    for (auto&& field : index.fields) {
+                        auto const& a = lhs->values().lookup(field).value();
+                        auto const& b = rhs->values().lookup(field).value();
+                        if (a < b)
+                            return true;
+                        if (b < a)
+                            return false;
+                    }
+                    return false;
+                });
+                for (auto const doc : sorted)
+                    store_entry(*doc);
+            }
+            entries.emplace_back(count, entries_offset);
+        }
+
+        detail::store_string(directory, name);
+        detail::store(directory, static_cast<std::uint32_t>(indices.size()));
+        for (std::size_t i = 0; i < indices.size(); ++i) {
+            auto const& index = indices[i];
+            optional<std::string_view> const filter = filter_name(index.filter);
+            if (!filter)
+                return fail(wal_status::unknown_filter);
+            detail::store(directory, detail::index_flags(index.unique, index.kind, index.multikey));
+            detail::store_string(directory, *filter);
+            detail::store(directory, static_cast<std::uint8_t>(index.fields.size()));
+            for (auto&& field : index.fields)
+                detail::store_string(directory, field);
+            detail::store(directory, entries[i].first);
+            detail::store(directory, entries[i].second);
+        }
+        auto const columns = coll.column_definitions();
+        detail::store(directory, static_cast<std::uint32_t>(columns.size()));
+        for (auto&& [field, type] : columns) {
+            detail::store(directory, static_cast<std::uint8_t>(type));
+            detail::store_string(directory, field);
+        }
+        detail::store(directory, static_cast<std::uint64_t>(coll.size()));
+        detail::store(directory, offsets_offset);
+        detail::store(directory, ids_offset);
+    }
+
+    auto const directory_offset = out.offset();
+    detail::store_bytes(buf, directory.data(), directory.size());
+    detail::store(buf, directory_offset);
+    if (!out.finish() || !detail::sync_fd(fd))
+        return fail(wal_status::io_error);
+    if (::close(fd) != 0 || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        return wal_status::io_error;
+    }
+    return detail::sync_parent_directory(path) ? wal_status::ok : wal_status::io_error;
+}
+
+} // namespace nova
+
+#endif // NOVA_CHECKPOINT_HPP
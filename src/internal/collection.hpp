@@ -3,15 +3,36 @@
 
 #include <absl/container/flat_hash_map.h>
 
+#include "binary.hpp"
 #include "bson.hpp"
+#include "column.hpp"
 #include "../debug.hpp"
 #include "document.hpp"
+#include "field_path.hpp"
 #include "index.hpp"
 #include "index_manager.hpp"
+#include "mutation_log.hpp"
+#include "query_util.hpp"
+#include "ttl_index.hpp"
+#include "util/arena.hpp"
+#include "util/bitmap.hpp"
+#include "util/bloom_filter.hpp"
 #include "util/map_results.hpp"
 #include "util/non_null_ptr.hpp"
+#include "util/slot_map.hpp"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <thread>
 #include <tuple>
+#include <typeindex>
+#include <vector>
 
 
 namespace nova {
@@ -62,52 +83,319 @@ public:
     [[nodiscard]] collection_const_iterator end() const noexcept { return docs_.end(); }
 };
 
+// an entry of a collection's id index
+struct doc_entry {
+    non_null_ptr<document> doc;
+    slot_handle handle;
+};
+
+// the arguments an index of a collection was created with
+struct index_definition {
+    bool unique;
+    index_kind kind;
+    bool multikey;
+    std::type_index filter;
+    std::vector<std::string> fields;
+};
+
 class collection {
-    std::vector<non_null_ptr<document>> docs_{};
-    absl::flat_hash_map<bson, non_null_ptr<document>> id_index_{}; // btree to enforce sorting?
+    // documents, and the memory backing their fields, are allocated from the arena
+    // and are never moved for the lifetime of the collection
+    arena arena_{};
+    shape_tree shapes_{};
+    slot_map<non_null_ptr<document>> docs_{};
+    absl::flat_hash_map<bson, doc_entry> id_index_{}; // btree to enforce sorting?
+    bloom_filter id_filter_{}; // disabled unless key filters are set
     index_manager index_manager_;
+    // row i of every column holds the field of the document at position i of `docs_`
+    absl::flat_hash_map<std::string, column, detail::string_like_hash, detail::string_like_key_eq> columns_{};
+    std::vector<index_definition> index_definitions_{};
+    std::unique_ptr<ttl_index> ttl_{};
+    std::chrono::steady_clock::time_point next_reap_{}; // the reaper's next batch is not run before
+    mutation_log* log_ = nullptr;
+
+    [[nodiscard]] document::allocator_type allocator() noexcept {
+        return document::allocator_type{std::addressof(arena_)};
+    }
+
+    template<class... Args>
+    [[nodiscard]] non_null_ptr<document> make_document(Args&&... args) {
+        auto const mem = arena_.allocate(sizeof(document), alignof(document));
+        return ::new (mem) document(std::forward<Args>(args)..., shapes_, allocator());
+    }
+
+    void destroy_document(non_null_ptr<document> const doc) {
+        doc->~document();
+        arena_.deallocate(doc, sizeof(document), alignof(document));
+    }
+
+    void rebuild_id_filter() {
+        id_filter_ = bloom_filter(2 * id_index_.size());
+        for (auto&& entry : id_index_)
+            id_filter_.insert(detail::index_key_hash{}(entry.first));
+    }
+
+    slot_handle add_document(non_null_ptr<document> const doc, bool const register_with_indices = true) {
+        auto const handle = docs_.emplace(doc);
+        if (id_filter_.enabled()) {
+            id_filter_.insert(detail::index_key_hash{}(doc->id()));
+            if (id_filter_.stale(id_index_.size()))
+                rebuild_id_filter();
+        }
+        for (auto&& [field, col] : columns_) {
+            auto const found = doc->values().lookup(field);
+            col.push_back(found ? std::addressof(found.value()) : nullptr);
+        }
+        if (register_with_indices)
+            index_manager_.register_document(doc);
+        if (ttl_)
+            ttl_->insert(*doc);
+        return handle;
+    }
+
+    void remove_document(non_null_ptr<document> const doc, slot_handle const handle) {
+        // slot_map::erase moves the last document into the erased position, columns do the same
+        auto const row = docs_.dense_index(handle);
+        docs_.erase(handle);
+        for (auto&& [field, col] : columns_)
+            col.swap_remove(row);
+        index_manager_.remove_document(doc);
+        if (ttl_)
+            ttl_->erase_doc(doc);
+        if (id_filter_.stale(id_index_.size()))
+            rebuild_id_filter();
+    }
 
 public:
     collection() = default;
 
+    collection(collection const&) = delete;
+    collection& operator=(collection const&) = delete;
+
     ~collection() {
+        // field memory lives in the arena, only the bson payloads own heap memory
         for (auto&& ptr : docs_)
-            delete ptr;
+            ptr->~document();
     }
 
-    template<bool Unique, class Filter = detail::no_filter, class... Fields>
-    bool create_index(Fields&&... fields) {
-        if (auto result = index_manager_.template create_index<Unique, Filter>(std::forward<Fields>(fields)...); result) {
+    // every following mutation is recorded in `log` before it is applied, a null `log` detaches the current one
+    void attach_log(mutation_log* const log) noexcept {
+        log_ = log;
+    }
+
+    [[nodiscard]] mutation_log* log() const noexcept { return log_; }
+
+    // Attaches a key filter to the id index and to every index of single field or compound keys, or drops them.
+    // Lookups of ids and keys the collection does not hold then mostly return without probing the indices.
+    void set_key_filters(bool const enabled) {
+        if (enabled)
+            rebuild_id_filter();
+        else
+            id_filter_ = {};
+        index_manager_.set_key_filters(enabled);
+    }
+
+    [[nodiscard]] bool key_filters() const noexcept { return id_filter_.enabled(); }
+
+private:
+    template<bool Unique, class Filter, index_kind Kind, class... Fields>
+    bool create_index_impl(bool const multikey, Fields&&... fields) {
+        if (log_ && !log_->can_log_index(typeid(Filter), sizeof...(Fields)))
+            return false;
+        std::array<std::string, sizeof...(Fields)> const names{std::string(fields)...};
+
+        if (auto result = index_manager_.template create_index<Unique, Filter, Kind>(std::forward<Fields>(fields)...); result) {
+            result.value().set_multikey(multikey);
             // if index was successfully created, insert all documents into the index
-            auto& field = result.key();
-            auto& index = result.value();
-            
-            if constexpr (sizeof...(Fields) == 1) {
-                for (auto&& doc : docs_)
-                    if (auto const found = doc->values().lookup(field); found)
-                        index.insert(found.value(), doc);
-            }
-            else { // multi
-                std::vector<non_null_ptr<bson const>> vals;
-                for (auto&& doc : docs_) {
-                    if (doc->values().contains(field.begin(), field.end())) {
-                        vals.reserve(index.field_count());
-                        for (auto&& f : field)
-                            vals.push_back(std::addressof(doc->values().lookup(f).value()));
-                        index.insert(vals, doc);
-                        vals.clear();
-                    }
-                }
-            }
+            index_manager::bulk_register(result.value(), result.key(), span<non_null_ptr<document> const>{docs_.data(), docs_.size()},
+                                         std::thread::hardware_concurrency());
+            index_definitions_.push_back(index_definition{Unique, Kind, multikey, typeid(Filter), {names.begin(), names.end()}});
+            // indices are rebuilt from the documents on recovery, a failed log write only loses the definition
+            if (log_)
+                static_cast<void>(log_->log_create_index(Unique, Kind, multikey, typeid(Filter), span<std::string const>{names}));
+            return true;
+        }
+        return false;
+    }
+
+public:
+    template<bool Unique, class Filter = detail::no_filter, index_kind Kind = index_kind::ordered, class... Fields>
+    bool create_index(Fields&&... fields) {
+        if constexpr (Kind == index_kind::spatial) {
+            static_assert(!Unique && std::is_same_v<Filter, detail::no_filter>, "spatial indices are neither unique nor filtered");
+            return create_spatial_index(std::forward<Fields>(fields)...);
+        }
+        else if constexpr (Kind == index_kind::bitmap) {
+            static_assert(!Unique && std::is_same_v<Filter, detail::no_filter>, "bitmap indices are neither unique nor filtered");
+            static_assert(sizeof...(Fields) == 1, "a bitmap index is over a single field");
+            return create_bitmap_index(std::string(std::forward<Fields>(fields)...));
+        }
+        else
+            return create_index_impl<Unique, Filter, Kind>(false, std::forward<Fields>(fields)...);
+    }
+
+    // Creates an index holding each document under every distinct element of its array fields,
+    // so documents can be found by one of the values of an array. A compound index takes at most one array field,
+    // documents with more are left out of it.
+    template<bool Unique, class Filter = detail::no_filter, index_kind Kind = index_kind::ordered, class... Fields>
+    bool create_multikey_index(Fields&&... fields) {
+        return create_index_impl<Unique, Filter, Kind>(true, std::forward<Fields>(fields)...);
+    }
+
+    // creates an index backed by a hash map, for fields only ever looked up by equality
+    template<bool Unique, class Filter = detail::no_filter, class... Fields>
+    bool create_hash_index(Fields&&... fields) {
+        return create_index<Unique, Filter, index_kind::hashed>(std::forward<Fields>(fields)...);
+    }
+
+    // Creates a full text index over the string field `field`, searched by the terms of its values through `lookup_text`.
+    bool create_text_index(std::string field) {
+        if (log_ && !log_->can_log_index(typeid(detail::no_filter), 1))
+            return false;
+        if (auto result = index_manager_.create_text_index(field); result) {
+            index_manager::register_text(result.value(), span<non_null_ptr<document> const>{docs_.data(), docs_.size()});
+            index_definitions_.push_back(index_definition{false, index_kind::text, false, typeid(detail::no_filter), {field}});
+            if (log_)
+                static_cast<void>(log_->log_create_index(false, index_kind::text, false, typeid(detail::no_filter), span<std::string const>{std::addressof(field), std::size_t{1}}));
             return true;
         }
         return false;
     }
 
+    // return: the text index over `field`, none if there is none
+    [[nodiscard]] optional<text_index const&> lookup_text(std::string_view const field) const {
+        return index_manager_.lookup_text(field);
+    }
+
+    // Creates an index holding the documents of each value of `field` in a compressed bitmap, for fields of few distinct
+    // values. Bitmaps are found through `lookup_bitmap` and combined with those of other bitmap indices of the collection.
+    // Also created by create_index with index_kind::bitmap.
+    bool create_bitmap_index(std::string field) {
+        if (log_ && !log_->can_log_index(typeid(detail::no_filter), 1))
+            return false;
+        if (auto result = index_manager_.create_bitmap_index(field); result) {
+            index_manager::register_bitmap(result.value(), span<non_null_ptr<document> const>{docs_.data(), docs_.size()});
+            index_definitions_.push_back(index_definition{false, index_kind::bitmap, false, typeid(detail::no_filter), {field}});
+            if (log_)
+                static_cast<void>(log_->log_create_index(false, index_kind::bitmap, false, typeid(detail::no_filter), span<std::string const>{std::addressof(field), std::size_t{1}}));
+            return true;
+        }
+        return false;
+    }
+
+    // return: the bitmap index over `field`, none if there is none
+    [[nodiscard]] optional<bitmap_index const&> lookup_bitmap(std::string_view const field) const {
+        return index_manager_.lookup_bitmap(field);
+    }
+
+    // Creates an index over the position held by `fields`, two number fields or one field holding an array of two numbers,
+    // searched by box or by distance through `lookup_spatial`. Also created by create_index with index_kind::spatial.
+    template<class... Fields>
+    bool create_spatial_index(Fields&&... fields) {
+        static_assert(sizeof...(Fields) == 1 || sizeof...(Fields) == 2, "a position is held by one or two fields");
+        if (log_ && !log_->can_log_index(typeid(detail::no_filter), sizeof...(Fields)))
+            return false;
+        std::vector<std::string> names{std::string(std::forward<Fields>(fields))...};
+        if (auto index = index_manager_.create_spatial_index(names); index) {
+            index_manager::register_spatial(*index, span<non_null_ptr<document> const>{docs_.data(), docs_.size()});
+            if (log_)
+                static_cast<void>(log_->log_create_index(false, index_kind::spatial, false, typeid(detail::no_filter), span<std::string const>{names}));
+            index_definitions_.push_back(index_definition{false, index_kind::spatial, false, typeid(detail::no_filter), std::move(names)});
+            return true;
+        }
+        return false;
+    }
+
+    // return: the spatial index over exactly `fields`, none if there is none
+    template<class... Fields>
+    [[nodiscard]] optional<spatial_index const&> lookup_spatial(Fields const&... fields) const {
+        std::array<std::string_view, sizeof...(Fields)> const names{std::string_view{fields}...};
+        return index_manager_.lookup_spatial(span<std::string_view const>{names});
+    }
+
+    [[nodiscard]] span<index_definition const> index_definitions() const noexcept {
+        return index_definitions_;
+    }
+
+    // calls `fn(document const&)` for every document held by the index `def`, in the order of its keys
+    template<class Fn>
+    void for_each_indexed(index_definition const& def, Fn&& fn) const {
+        [[maybe_unused]] auto const found = index_manager_.for_each_indexed(span<std::string const>{def.fields}, std::forward<Fn>(fn));
+        DEBUG_ASSERT(found);
+    }
+
+    // return: the field and value type of every column
+    [[nodiscard]] std::vector<std::pair<std::string_view, bson::types>> column_definitions() const {
+        std::vector<std::pair<std::string_view, bson::types>> defs;
+        for (auto&& [field, col] : columns_)
+            defs.emplace_back(field, col.type());
+        return defs;
+    }
+
+    // return: the documents whose `field` equals `val`, found through the single field index over `field`
+    // or a compound index led by it, none if there is no such index.
+    // A multikey index also finds the documents whose array `field` holds `val`.
+    [[nodiscard]] optional<const_cursor> lookup_indexed(std::string_view const field, bson const& val) const {
+        return index_manager_.lookup_equal(span<std::string_view const>{std::addressof(field), std::size_t{1}}, span<bson const>{std::addressof(val), std::size_t{1}});
+    }
+
+    // return: the documents whose `fields` equal `values`, found through the index led by `fields`,
+    // none if there is no such index. A compound index over more fields is searched by prefix.
+    [[nodiscard]] optional<const_cursor> lookup_indexed(span<std::string_view const> const fields, span<bson const> const values) const {
+        return index_manager_.lookup_equal(fields, values);
+    }
+
+    // return: the statistics of the index over `field`, none if there is no such index. See index_manager::statistics.
+    [[nodiscard]] optional<index_stats const&> index_statistics(std::string_view const field) {
+        return index_manager_.statistics(span<std::string_view const>{std::addressof(field), std::size_t{1}}, docs_.size());
+    }
+
+    // return: the statistics of the index over exactly `fields`, none if there is no such index
+    [[nodiscard]] optional<index_stats const&> index_statistics(span<std::string_view const> const fields) {
+        return index_manager_.statistics(fields, docs_.size());
+    }
+
     void print_indices() const noexcept {
         index_manager_.print_indices();
     }
 
+    // Like indices, a column captures a document's field when the document is inserted.
+    // `T` is the bson type the field is expected to hold, rows holding any other type are
+    // treated as not matching by queries evaluated over the column.
+    // Strings are dictionary encoded.
+    template<class T>
+    bool create_column(std::string field) {
+        static_assert(column::is_valid_type<T>);
+        if (columns_.contains(field))
+            return false;
+        if (log_ && !log_->log_create_column(field, bson::type_of<T>()))
+            return false;
+        column col{bson_type<T>};
+        col.reserve(docs_.size());
+        for (auto&& doc : docs_) {
+            auto const found = doc->values().lookup(field);
+            col.push_back(found ? std::addressof(found.value()) : nullptr);
+        }
+        columns_.emplace(std::move(field), std::move(col));
+        return true;
+    }
+
+    bool drop_column(std::string_view const field) {
+        if (auto const it = columns_.find(field); it != columns_.end()) {
+            columns_.erase(it);
+            return true;
+        }
+        return false;
+    }
+
+    [[nodiscard]] optional<column const&> lookup_column(std::string_view const field) const {
+        if (auto const it = columns_.find(field); it != columns_.end())
+            return {it->second};
+        return {};
+    }
+
+    // Queries built with query_util.hpp on columnar fields are evaluated over their column,
+    // the remaining queries are only evaluated on the documents selected by the columns.
     template<template<class, class> class... Tpls, class... Fields, class... Ops>
     [[nodiscard]] const_cursor scan(Tpls<Fields, Ops>... queries) const {
 
@@ -116,77 +404,280 @@ public:
 
         std::vector<non_null_ptr<document const>> result;
 
-        auto check_query = [] (auto&& query, auto&& doc) {
-            if (auto const lookup = doc.values().lookup(std::get<0>(query)); lookup) {
-                auto const [field, val] = *lookup;
-                if (std::get<1>(query)(val))
-                    return true;
+        std::array<bool, sizeof...(Fields)> on_column{};
+        bitmap selection;
+        if (!columns_.empty()) {
+            selection = bitmap(docs_.size(), true);
+            auto filter_column = [this, &selection](auto&& query, bool& used) {
+                if constexpr (is_query_predicate_v<std::decay_t<decltype(std::get<1>(query))>>) {
+                    if (auto const it = columns_.find(std::string_view{std::get<0>(query)}); it != columns_.end())
+                        used = it->second.filter(std::get<1>(query), selection);
+                }
+            };
+            auto used = on_column.begin();
+            (filter_column(queries, *used++), ...);
+        }
+
+        // documents built by the same sequence of inserts share a shape, so the 
+        // slot of each queried field is resolved once per shape rather than once per document.
+        // A dotted field naming no top level field is a path, its slot is the one of the field the path starts at
+        struct inline_cache {
+            shape const* shape_ = nullptr;
+            optional<std::uint32_t> slot_{};
+            bool nested_ = false;
+        };
+        std::array<inline_cache, sizeof...(Fields)> caches{};
+        std::array<field_path, sizeof...(Fields)> const paths{field_path{std::string_view{std::get<0>(queries)}}...};
+
+        auto check_query = [] (auto&& query, bool const evaluated, inline_cache& cache, field_path const& path, document const& doc) {
+            if (evaluated)
+                return true;
+            auto const& values = doc.values();
+            if (std::addressof(values.get_shape()) != cache.shape_) {
+                cache.shape_ = std::addressof(values.get_shape());
+                cache.slot_ = values.get_shape().slot(path.str());
+                cache.nested_ = !cache.slot_ && path.nested();
+                if (cache.nested_)
+                    cache.slot_ = values.get_shape().slot(path.head());
             }
-            return false;
+            if (!cache.slot_)
+                return false;
+            if (!cache.nested_)
+                return std::get<1>(query)(values.value_at(*cache.slot_));
+            auto const found = detail::descend(values.value_at(*cache.slot_), path);
+            return found && std::get<1>(query)(*found);
         };
 
-        for (auto&& doc : docs_) {
-            if ((check_query(queries, *doc) && ...))
-                result.push_back(doc);
+        auto check_doc = [&](document const& doc) {
+            auto cache = caches.begin();
+            auto evaluated = on_column.begin();
+            auto path = paths.begin();
+            return (check_query(queries, *evaluated++, *cache++, *path++, doc) && ...);
+        };
+
+        if (std::none_of(on_column.begin(), on_column.end(), [](bool const b) { return b; })) {
+            for (auto&& doc : docs_) {
+                if (check_doc(*doc))
+                    result.push_back(doc);
+            }
+        }
+        else {
+            auto const selected = selection.to_selection();
+            auto const docs = docs_.data();
+            result.reserve(selected.size());
+            for (auto const row : selected) {
+                if (check_doc(*docs[row]))
+                    result.push_back(docs[row]);
+            }
         }
         return multiple_index_lookup_vec{std::move(result)};
     }
 
     template<class ID>
     optional<document&> insert(ID&& id) {
-        static constexpr int _not_a_document{1};
-        static constexpr auto _fake_document_pointer = const_cast<document*>(reinterpret_cast<document const*>(&_not_a_document)); 
-        if (auto const [it, inserted] = id_index_.try_emplace(id, _fake_document_pointer); inserted) {
-            auto const& doc = docs_.emplace_back(new document(std::forward<ID>(id)));
-            it->second = doc;
-            index_manager_.register_document(doc);
+        reap_due();
+        static int const _not_a_document{1};
+        static auto const _fake_document_pointer = const_cast<document*>(reinterpret_cast<document const*>(&_not_a_document)); 
+        if (auto const [it, inserted] = id_index_.try_emplace(id, doc_entry{_fake_document_pointer, {}}); inserted) {
+            auto const doc = make_document(std::forward<ID>(id));
+            if (log_ && !log_->log_insert(*doc)) {
+                id_index_.erase(it);
+                destroy_document(doc);
+                return {};
+            }
+            it->second = doc_entry{doc, add_document(doc)};
             return {*doc};
         }
         return {};
     }
 
     optional<document const&> insert(document&& new_doc) {
-        static constexpr int _not_a_document{1};
-        static constexpr auto _fake_document_pointer = const_cast<document*>(reinterpret_cast<document const*>(&_not_a_document)); 
-        if (auto const [it, inserted] = id_index_.try_emplace(new_doc.id(), _fake_document_pointer); inserted) {
-            auto const& doc = docs_.emplace_back(new document(std::move(new_doc)));
-            it->second = doc;
-            index_manager_.register_document(doc);
+        reap_due();
+        static int const _not_a_document{1};
+        static auto const _fake_document_pointer = const_cast<document*>(reinterpret_cast<document const*>(&_not_a_document)); 
+        if (auto const [it, inserted] = id_index_.try_emplace(new_doc.id(), doc_entry{_fake_document_pointer, {}}); inserted) {
+            if (log_ && !log_->log_insert(new_doc)) {
+                id_index_.erase(it);
+                return {};
+            }
+            auto const doc = make_document(std::move(new_doc));
+            it->second = doc_entry{doc, add_document(doc)};
             return {*doc};
         }
         return {};
     }
 
+    // Inserts the documents of a range of document_views, skipping those whose id is already held.
+    // The documents are not logged, and are registered with the indices in parallel, one index per thread.
+    // return: the number of documents inserted
+    template<class It, class Sentinel>
+    std::size_t restore(It first, Sentinel const last) {
+        static int const _not_a_document{1};
+        static auto const _fake_document_pointer = const_cast<document*>(reinterpret_cast<document const*>(&_not_a_document)); 
+        auto const old_size = docs_.size();
+        if constexpr (std::is_same_v<It, Sentinel>) {
+            auto const count = static_cast<std::size_t>(std::distance(first, last));
+            docs_.reserve(old_size + count);
+            id_index_.reserve(id_index_.size() + count);
+            for (auto&& [field, col] : columns_)
+                col.reserve(old_size + count);
+        }
+        for (; first != last; ++first) {
+            document_view const view = *first;
+            auto id = view.id().to_bson();
+            if (auto const [it, inserted] = id_index_.try_emplace(id, doc_entry{_fake_document_pointer, {}}); inserted) {
+                auto const doc = make_document(std::move(id));
+                doc->values().reserve(view.size());
+                for (auto&& [key, val] : view)
+                    doc->values().insert(key, val.to_bson());
+                it->second = doc_entry{doc, add_document(doc, false)};
+            }
+        }
+        auto const added = docs_.size() - old_size;
+        if (added > 0)
+            index_manager_.register_documents_parallel(span<non_null_ptr<document> const>{docs_.data() + old_size, added});
+        return added;
+    }
+
+    // the returned document no longer references any memory owned by the collection
     [[nodiscard]] std::unique_ptr<document> remove(doc_id const& id) {
+        if (log_ && id_index_.contains(id) && !log_->log_erase(id))
+            return nullptr;
         if (auto const it = id_index_.extract(id); it) {
-            docs_.erase(std::find(docs_.begin(), docs_.end(), it.mapped()));
-            index_manager_.remove_document(it.mapped());
-            return std::unique_ptr<document>{it.mapped()};
+            auto const [doc, handle] = it.mapped();
+            remove_document(doc, handle);
+            auto removed = std::make_unique<document>(std::move(*doc), shape_tree::global(), std::pmr::get_default_resource());
+            destroy_document(doc);
+            return removed;
         }
         return nullptr;
     }
 
     bool erase(doc_id const& id) {
         if (auto const it = id_index_.find(id); it != id_index_.end()) {
-            DEBUG_ASSERT(it->second);
-            docs_.erase(std::find(docs_.begin(), docs_.end(), it->second));
-            index_manager_.remove_document(it->second);
-            delete it->second;
-            id_index_.erase(id);
+            if (log_ && !log_->log_erase(id))
+                return false;
+            auto const [doc, handle] = it->second;
+            remove_document(doc, handle);
+            id_index_.erase(it);
+            destroy_document(doc);
             return true;
         }
         return false;
     }
 
+    // Sets `field` of the document `id` to `value`, keeping indices and columns up to date.
+    // Fields changed through the document reference returned by `insert(id)` bypass both,
+    // as well as the ttl and the collection's log.
+    template<class Field, class T>
+    bool update(doc_id const& id, Field const& field, T&& value) {
+        reap_due();
+        if (auto const it = id_index_.find(id); it != id_index_.end()) {
+            bson val{std::forward<T>(value)};
+            if (log_ && !log_->log_update(id, std::string_view{field}, val))
+                return false;
+            auto const [doc, handle] = it->second;
+            index_manager_.remove_document(doc);
+            auto const updated = doc->values().update(field, std::move(val));
+            index_manager_.register_document(doc);
+            if (ttl_) {
+                ttl_->erase_doc(doc);
+                ttl_->insert(*doc);
+            }
+            if (auto const col = columns_.find(std::string_view{field}); col != columns_.end())
+                col->second.set(docs_.dense_index(handle), std::addressof(updated.value()));
+            return true;
+        }
+        return false;
+    }
+
+    // Expires documents `options.ttl` after their timestamp: the timestamp of their unique_id, or the time held by the
+    // date field `options.field`. Expired documents are erased like `erase` would, from every index and through the log,
+    // by `reap_expired`, and in batches of `options.batch_size` by the inserts and updates run `options.interval` apart,
+    // the first one `options.interval` after the ttl is set.
+    // Reads never reap, and may find expired documents the reaper has not reached yet.
+    // A document is timed when it is inserted and again by each `update`. Like the indices, the ttl does not see fields
+    // filled through the reference `insert(id)` returns: a document given its date field that way never expires, unless
+    // an `update` follows.
+    void set_ttl(ttl_options options) {
+        ttl_ = std::make_unique<ttl_index>(std::move(options));
+        for (auto&& doc : docs_)
+            ttl_->insert(*doc);
+        next_reap_ = std::chrono::steady_clock::now() + ttl_->options().interval;
+    }
+
+    void clear_ttl() noexcept { ttl_.reset(); }
+
+    // return: the index of the time documents expire at, none unless a ttl is set
+    [[nodiscard]] optional<ttl_index const&> ttl() const noexcept {
+        if (ttl_)
+            return {*ttl_};
+        return {};
+    }
+
+    // Erases up to `max` of the documents expired at `now`, oldest first, stopping at the first erase the log refuses.
+    // return: the number of documents erased
+    std::size_t reap_expired(expiry_time const now, std::size_t const max = std::numeric_limits<std::size_t>::max()) {
+        if (!ttl_)
+            return 0;
+        std::vector<doc_id> expired;
+        ttl_->for_each_expired(now, max, [&](document const& doc) { expired.push_back(doc.id()); });
+        std::size_t count = 0;
+        for (auto&& id : expired) {
+            if (!erase(id))
+                break;
+            ++count;
+        }
+        return count;
+    }
+
+private:
+    // runs a batch of the reaper once `interval` has passed since the last one
+    void reap_due() {
+        if (!ttl_)
+            return;
+        auto const now = std::chrono::steady_clock::now();
+        if (now < next_reap_)
+            return;
+        next_reap_ = now + ttl_->options().interval;
+        reap_expired(std::chrono::time_point_cast<std::chrono::seconds>(std::chrono::system_clock::now()), ttl_->options().batch_size);
+    }
+
+public:
+    // return: bytes of document storage handed out by the collection's arena
+    [[nodiscard]] std::size_t arena_bytes_used() const noexcept { return arena_.bytes_used(); }
+
+    // return: bytes the collection's arena obtained from the global heap
+    [[nodiscard]] std::size_t arena_bytes_reserved() const noexcept { return arena_.bytes_reserved(); }
+
     [[nodiscard]] optional<document const&> lookup(doc_id const& id) {
+        if (!id_filter_.may_contain(detail::index_key_hash{}(id)))
+            return {};
         if (auto const it = id_index_.find(id); it != id_index_.end())
-            return {*(it->second)};
+            return {*(it->second.doc)};
         return {};
     }
 
     [[nodiscard]] optional<document const&> lookup(doc_id const& id) const {
+        if (!id_filter_.may_contain(detail::index_key_hash{}(id)))
+            return {};
         if (auto const it = id_index_.find(id); it != id_index_.end())
-            return {*(it->second)};
+            return {*(it->second.doc)};
+        return {};
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept { return docs_.size(); }
+
+    // return: a stable handle to the document, which is invalidated once the document is erased
+    [[nodiscard]] optional<slot_handle> handle(doc_id const& id) const {
+        if (auto const it = id_index_.find(id); it != id_index_.end())
+            return {it->second.handle};
+        return {};
+    }
+
+    [[nodiscard]] optional<document const&> lookup(slot_handle const handle) const noexcept {
+        if (auto const doc = docs_.get(handle); doc)
+            return {**doc};
         return {};
     }
 
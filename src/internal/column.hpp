@@ -0,0 +1,262 @@
+#ifndef NOVA_COLUMN_HPP
+#define NOVA_COLUMN_HPP
+
+#include <absl/container/flat_hash_map.h>
+
+#include "../debug.hpp"
+#include "bson.hpp"
+#include "detail.hpp"
+#include "query_util.hpp"
+#include "simd.hpp"
+#include "util/bitmap.hpp"
+#include "util/optional.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace nova {
+
+// A dense column of the values of one field, holding the value of row i where
+// row i is the i'th document of the owning collection.
+// A row is only marked present when its document holds the field with exactly the type `T`.
+template<class T>
+class numeric_column {
+    static_assert(std::is_arithmetic_v<T>);
+    using storage_t = std::conditional_t<std::is_same_v<T, bool>, std::uint8_t, T>;
+
+    std::vector<storage_t> values_{};
+    bitmap present_{};
+
+public:
+    using value_type = T;
+
+    void push_back(bson const* const val) {
+        if (auto const opt = val ? val->template as<T>() : optional<T const&>{}; opt) {
+            values_.push_back(static_cast<storage_t>(*opt));
+            present_.push_back(true);
+        }
+        else {
+            values_.push_back(storage_t{});
+            present_.push_back(false);
+        }
+    }
+
+    void set(std::size_t const row, bson const* const val) {
+        DEBUG_ASSERT(row < size());
+        if (auto const opt = val ? val->template as<T>() : optional<T const&>{}; opt) {
+            values_[row] = static_cast<storage_t>(*opt);
+            present_.set(row, true);
+        }
+        else {
+            values_[row] = storage_t{};
+            present_.set(row, false);
+        }
+    }
+
+    void swap_remove(std::size_t const row) {
+        DEBUG_ASSERT(row < size());
+        values_[row] = values_.back();
+        values_.pop_back();
+        present_.swap_remove(row);
+    }
+
+    void reserve(std::size_t const n) { values_.reserve(n); }
+
+    [[nodiscard]] std::size_t size() const noexcept { return values_.size(); }
+
+    [[nodiscard]] optional<T> get(std::size_t const row) const noexcept {
+        if (present_.test(row))
+            return {static_cast<T>(values_[row])};
+        return {};
+    }
+
+    [[nodiscard]] bitmap const& present() const noexcept { return present_; }
+    [[nodiscard]] storage_t const* data() const noexcept { return values_.data(); }
+
+    // return: a bitmap holding, for every row, whether Cmp{}(row value, value) holds
+    template<class Cmp, class V>
+    [[nodiscard]] bitmap evaluate(V const& value) const {
+        bitmap result(size());
+        if constexpr (std::is_same_v<T, bool>)
+            compare<Cmp>(values_.data(), size(), static_cast<storage_t>(value), result.data());
+        else
+            compare<Cmp>(values_.data(), size(), value, result.data());
+        result &= present_;
+        return result;
+    }
+};
+
+// A dictionary encoded column of string values.
+// Each distinct string is stored once, rows hold the code of their string.
+// Codes are never reclaimed, the dictionary only grows.
+class string_column {
+    using code_t = std::uint32_t;
+
+    std::vector<code_t> codes_{};
+    bitmap present_{};
+    std::vector<std::string> dictionary_{};
+    absl::flat_hash_map<std::string, code_t, detail::string_like_hash, detail::string_like_key_eq> codes_by_value_{};
+
+    [[nodiscard]] code_t encode(std::string const& str) {
+        auto const [it, inserted] = codes_by_value_.try_emplace(str, static_cast<code_t>(dictionary_.size()));
+        if (inserted)
+            dictionary_.push_back(str);
+        return it->second;
+    }
+
+public:
+    using value_type = std::string;
+
+    void push_back(bson const* const val) {
+        if (auto const opt = val ? val->template as<std::string>() : optional<std::string const&>{}; opt) {
+            codes_.push_back(encode(*opt));
+            present_.push_back(true);
+        }
+        else {
+            codes_.push_back(0);
+            present_.push_back(false);
+        }
+    }
+
+    void set(std::size_t const row, bson const* const val) {
+        DEBUG_ASSERT(row < size());
+        if (auto const opt = val ? val->template as<std::string>() : optional<std::string const&>{}; opt) {
+            codes_[row] = encode(*opt);
+            present_.set(row, true);
+        }
+        else {
+            codes_[row] = 0;
+            present_.set(row, false);
+        }
+    }
+
+    void swap_remove(std::size_t const row) {
+        DEBUG_ASSERT(row < size());
+        codes_[row] = codes_.back();
+        codes_.pop_back();
+        present_.swap_remove(row);
+    }
+
+    void reserve(std::size_t const n) { codes_.reserve(n); }
+
+    [[nodiscard]] std::size_t size() const noexcept { return codes_.size(); }
+    [[nodiscard]] std::size_t dictionary_size() const noexcept { return dictionary_.size(); }
+
+    [[nodiscard]] optional<std::string const&> get(std::size_t const row) const noexcept {
+        if (present_.test(row))
+            return {dictionary_[codes_[row]]};
+        return {};
+    }
+
+    [[nodiscard]] bitmap const& present() const noexcept { return present_; }
+    [[nodiscard]] code_t const* data() const noexcept { return codes_.data(); }
+
+    template<class Cmp, class V>
+    [[nodiscard]] bitmap evaluate(V const& value) const {
+        bitmap result(size());
+        if constexpr (std::is_same_v<Cmp, std::equal_to<>>) {
+            // equality only needs the code of `value`, which is absent when no row can match
+            if (auto const it = codes_by_value_.find(std::string_view{value}); it != codes_by_value_.end())
+                compare<Cmp>(codes_.data(), size(), it->second, result.data());
+        }
+        else {
+            // evaluate the predicate once per distinct string, then map every row through its code
+            std::vector<std::uint8_t> matches(dictionary_.size());
+            for (std::size_t i = 0; i < dictionary_.size(); ++i)
+                matches[i] = Cmp{}(dictionary_[i], value);
+            for (std::size_t row = 0; row < codes_.size(); ++row)
+                if (matches[codes_[row]])
+                    result.set(row);
+        }
+        result &= present_;
+        return result;
+    }
+};
+
+// A column holding one of the supported value types.
+class column {
+    std::variant<numeric_column<bool>, numeric_column<std::int32_t>, numeric_column<std::int64_t>,
+        numeric_column<std::uint32_t>, numeric_column<std::uint64_t>, numeric_column<float>,
+        numeric_column<double>, string_column> storage_;
+
+    template<class T>
+    using column_t = std::conditional_t<std::is_same_v<T, std::string>, string_column, numeric_column<T>>;
+
+public:
+    template<class T>
+    static constexpr bool is_valid_type = std::disjunction_v<std::is_same<T, bool>,
+            std::is_same<T, std::int32_t>, std::is_same<T, std::int64_t>,
+            std::is_same<T, std::uint32_t>, std::is_same<T, std::uint64_t>,
+            std::is_same<T, float>, std::is_same<T, double>, std::is_same<T, std::string>>;
+
+    template<class T>
+    explicit column(bson_type_t<T>) : storage_(std::in_place_type<column_t<T>>) {
+        static_assert(is_valid_type<T>);
+    }
+
+    // `val` is null when the row's document does not hold the field
+    void push_back(bson const* const val) {
+        std::visit([val](auto& col) { col.push_back(val); }, storage_);
+    }
+
+    void set(std::size_t const row, bson const* const val) {
+        std::visit([row, val](auto& col) { col.set(row, val); }, storage_);
+    }
+
+    void swap_remove(std::size_t const row) {
+        std::visit([row](auto& col) { col.swap_remove(row); }, storage_);
+    }
+
+    void reserve(std::size_t const n) {
+        std::visit([n](auto& col) { col.reserve(n); }, storage_);
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept {
+        return std::visit([](auto const& col) { return col.size(); }, storage_);
+    }
+
+    [[nodiscard]] bitmap const& present() const noexcept {
+        return std::visit([](auto const& col) -> bitmap const& { return col.present(); }, storage_);
+    }
+
+    // return: the type of the values held by the column
+    [[nodiscard]] bson::types type() const noexcept {
+        return std::visit([](auto const& col) { return bson::type_of<typename std::decay_t<decltype(col)>::value_type>(); }, storage_);
+    }
+
+    template<class T>
+    [[nodiscard]] bool holds() const noexcept {
+        return std::holds_alternative<column_t<T>>(storage_);
+    }
+
+    template<class T>
+    [[nodiscard]] column_t<T> const& get() const noexcept {
+        DEBUG_ASSERT(holds<T>());
+        return std::get<column_t<T>>(storage_);
+    }
+
+    // ands the rows satisfying `pred` into `selection`
+    // return: false (leaving `selection` unchanged) if this column can not evaluate `pred`
+    template<class Cmp, class T>
+    bool filter(query_predicate<Cmp, T> const& pred, bitmap& selection) const {
+        using get_t = typename query_predicate<Cmp, T>::get_t;
+        if constexpr (!is_valid_type<get_t>)
+            return false;
+        else {
+            if (!holds<get_t>())
+                return false;
+            DEBUG_ASSERT(selection.size() == size());
+            selection &= get<get_t>().template evaluate<Cmp>(pred.value);
+            return true;
+        }
+    }
+};
+
+} // namespace nova
+
+#endif // NOVA_COLUMN_HPP
@@ -0,0 +1,451 @@
+#ifndef NOVA_COMPACT_BSON_HPP
+#define NOVA_COMPACT_BSON_HPP
+
+#include <fmt/format.h>
+
+#include "../debug.hpp"
+#include "bson.hpp"
+#include "detail.hpp"
+#include "document.hpp"
+#include "simd.hpp"
+#include "unique_id.hpp"
+#include "util/bitmap.hpp"
+#include "util/optional.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace nova {
+
+// A 16 byte alternative to `bson`.
+// Scalars, unique_ids and strings of up to `inline_string_capacity` characters are stored
+// inline, long strings, arrays and documents are stored behind a single owning pointer.
+// It stands alone: documents, indices and `doc_values` hold `bson`, nothing in the database stores a `compact_bson`.
+// Callers convert explicitly, with the `bson` constructor and `to_bson`.
+//
+// Layout: 15 bytes of payload followed by a tag byte. The low nibble of the tag
+// holds the `types` enumerator, for strings the high nibble holds the inline length
+// (or `heap_string` when the characters live on the heap).
+class compact_bson {
+public:
+    using types = bson::types;
+    using null_t = bson::null_t;
+    using array_t = std::vector<compact_bson>;
+
+    inline static constexpr std::size_t inline_string_capacity = 14;
+
+private:
+#pragma pack(push, 1)
+    struct heap_string_t {
+        char* data;
+        std::uint32_t size;
+    };
+#pragma pack(pop)
+
+    inline static constexpr std::uint8_t heap_string = 0xF;
+    inline static constexpr std::size_t payload_size = 15;
+    static_assert(sizeof(heap_string_t) <= payload_size && sizeof(unique_id) <= payload_size);
+
+    alignas(8) unsigned char data_[payload_size];
+    std::uint8_t tag_;
+
+    template<class T>
+    static constexpr bool is_valid_type = std::disjunction_v<std::is_same<T, unique_id>,
+            std::is_same<T, null_t>, std::is_same<T, bool>,
+            std::is_same<T, std::int32_t>, std::is_same<T, std::int64_t>,
+            std::is_same<T, std::uint32_t>, std::is_same<T, std::uint64_t>,
+            std::is_same<T, float>, std::is_same<T, double>,
+            std::is_same<T, std::string>, std::is_same<T, array_t>,
+            std::is_same<T, document>>;
+
+    template<class T>
+    static constexpr bool is_inline_type = is_valid_type<T> 
+        && !std::is_same_v<T, array_t> && !std::is_same_v<T, document> && !std::is_same_v<T, std::string>;
+
+    // strings are handed out as views since inline strings are not `std::string`s
+    template<class T, class Ref>
+    using ref_t = std::conditional_t<std::is_same_v<T, std::string>, std::string_view, Ref>;
+
+    template<class T>
+    T* ptr() noexcept { return std::launder(reinterpret_cast<T*>(data_)); }
+
+    template<class T>
+    T const* ptr() const noexcept { return std::launder(reinterpret_cast<T const*>(data_)); }
+
+    [[nodiscard]] std::uint8_t string_tag() const noexcept { return tag_ >> 4; }
+
+    void set_tag(types const type, std::uint8_t const extra = 0) noexcept {
+        tag_ = static_cast<std::uint8_t>(static_cast<std::uint8_t>(type) | (extra << 4));
+    }
+
+    void assign_string(std::string_view const str) {
+        if (str.size() <= inline_string_capacity) {
+            if (!str.empty())
+                std::memcpy(data_, str.data(), str.size());
+            set_tag(types::String, static_cast<std::uint8_t>(str.size()));
+        }
+        else {
+            DEBUG_ASSERT(str.size() <= std::numeric_limits<std::uint32_t>::max());
+            auto const data = new char[str.size()];
+            std::memcpy(data, str.data(), str.size());
+            ::new (data_) heap_string_t{data, static_cast<std::uint32_t>(str.size())};
+            set_tag(types::String, heap_string);
+        }
+    }
+
+    template<class T, class... Args>
+    void construct(Args&&... args) {
+        static_assert(is_valid_type<T>);
+        if constexpr (std::is_same_v<T, std::string>)
+            assign_string(std::string_view{std::forward<Args>(args)...});
+        else if constexpr (std::is_same_v<T, array_t>)
+            ::new (data_) array_t*(new array_t(std::forward<Args>(args)...));
+        else if constexpr (std::is_same_v<T, document>)
+            ::new (data_) document*(new document(std::forward<Args>(args)...));
+        else {
+            static_assert(sizeof(T) <= payload_size);
+            ::new (data_) T(std::forward<Args>(args)...);
+        }
+        if constexpr (!std::is_same_v<T, std::string>)
+            set_tag(type_of<T>());
+    }
+
+    void destroy() noexcept {
+        switch (type()) {
+            case types::String:
+                if (string_tag() == heap_string)
+                    delete[] ptr<heap_string_t>()->data;
+                break;
+            case types::Array: delete *ptr<array_t*>(); break;
+            case types::Document: delete *ptr<document*>(); break;
+            default: break;
+        }
+        set_tag(types::Null);
+    }
+
+    void copy_from(compact_bson const& other) {
+        switch (other.type()) {
+            case types::String: assign_string(other.string_view()); break;
+            case types::Array: construct<array_t>(**other.ptr<array_t*>()); break;
+            case types::Document: construct<document>(**other.ptr<document*>()); break;
+            default:
+                std::memcpy(data_, other.data_, payload_size);
+                tag_ = other.tag_;
+                break;
+        }
+    }
+
+    // the moved from value is left holding null
+    void steal_from(compact_bson& other) noexcept {
+        std::memcpy(data_, other.data_, payload_size);
+        tag_ = other.tag_;
+        other.set_tag(types::Null);
+    }
+
+    [[nodiscard]] std::string_view string_view() const noexcept {
+        DEBUG_ASSERT(type() == types::String);
+        if (string_tag() == heap_string) {
+            auto const str = ptr<heap_string_t>();
+            return {str->data, str->size};
+        }
+        return {reinterpret_cast<char const*>(data_), string_tag()};
+    }
+
+public:
+    compact_bson() noexcept { set_tag(types::Null); }
+
+    template<class T, std::enable_if_t<!std::is_same_v<std::decay_t<T>, compact_bson>
+        && !std::is_same_v<std::decay_t<T>, bson> && std::is_constructible_v<std::string_view, T>, int> = 0>
+    compact_bson(T&& str) : compact_bson(bson_type<std::string>, std::forward<T>(str)) {}
+
+    template<class T, std::enable_if_t<!std::is_same_v<std::decay_t<T>, compact_bson>
+        && !std::is_same_v<std::decay_t<T>, bson> && !std::is_constructible_v<std::string_view, T>, int> = 0>
+    compact_bson(T&& t) : compact_bson(bson_type<std::decay_t<T>>, std::forward<T>(t)) {}
+
+    template<class T, class... Args>
+    compact_bson(bson_type_t<T>, Args&&... args) {
+        construct<std::remove_cv_t<std::remove_reference_t<T>>>(std::forward<Args>(args)...);
+    }
+
+    explicit compact_bson(bson const& b) {
+        switch (b.type()) {
+            case types::UniqueID: construct<unique_id>(*b.as<unique_id>()); break;
+            case types::Null: construct<null_t>(); break;
+            case types::Bool: construct<bool>(*b.as<bool>()); break;
+            case types::Int32: construct<std::int32_t>(*b.as<std::int32_t>()); break;
+            case types::Int64: construct<std::int64_t>(*b.as<std::int64_t>()); break;
+            case types::uInt32: construct<std::uint32_t>(*b.as<std::uint32_t>()); break;
+            case types::uInt64: construct<std::uint64_t>(*b.as<std::uint64_t>()); break;
+            case types::Float: construct<float>(*b.as<float>()); break;
+            case types::Double: construct<double>(*b.as<double>()); break;
+            case types::String: construct<std::string>(*b.as<std::string>()); break;
+            case types::Array: {
+                auto const& arr = *b.as<bson::array_t>();
+                construct<array_t>(arr.begin(), arr.end());
+                break;
+            }
+            case types::Document: construct<document>(*b.as<document>()); break;
+        }
+    }
+
+    compact_bson(compact_bson const& other) { copy_from(other); }
+    compact_bson(compact_bson&& other) noexcept { steal_from(other); }
+
+    compact_bson& operator=(compact_bson const& other) {
+        if (this != std::addressof(other)) {
+            compact_bson tmp{other};
+            destroy();
+            steal_from(tmp);
+        }
+        return *this;
+    }
+
+    compact_bson& operator=(compact_bson&& other) noexcept {
+        if (this != std::addressof(other)) {
+            destroy();
+            steal_from(other);
+        }
+        return *this;
+    }
+
+    ~compact_bson() { destroy(); }
+
+    [[nodiscard]] types type() const noexcept {
+        return static_cast<types>(tag_ & 0xF);
+    }
+
+    template<class T>
+    [[nodiscard]] static constexpr types type_of() noexcept {
+        if constexpr (std::is_same_v<T, array_t>) return types::Array;
+        else return bson::type_of<T>();
+    }
+
+    // return: true if the value does not own any heap memory
+    [[nodiscard]] bool is_inline() const noexcept {
+        switch (type()) {
+            case types::String: return string_tag() != heap_string;
+            case types::Array: [[fallthrough]];
+            case types::Document: return false;
+            default: return true;
+        }
+    }
+
+    template<class T>
+    [[nodiscard]] optional<ref_t<T, T&>> as() noexcept {
+        static_assert(is_valid_type<T>);
+        if (type() != type_of<T>())
+            return {};
+        if constexpr (std::is_same_v<T, std::string>) return {string_view()};
+        else if constexpr (std::is_same_v<T, null_t>) return {*ptr<null_t>()};
+        else if constexpr (is_inline_type<T>) return {*ptr<T>()};
+        else return {**ptr<T*>()};
+    }
+
+    template<class T>
+    [[nodiscard]] optional<ref_t<T, T const&>> as() const noexcept {
+        static_assert(is_valid_type<T>);
+        if (type() != type_of<T>())
+            return {};
+        if constexpr (std::is_same_v<T, std::string>) return {string_view()};
+        else if constexpr (std::is_same_v<T, null_t>) return {*ptr<null_t>()};
+        else if constexpr (is_inline_type<T>) return {*ptr<T>()};
+        else return {**ptr<T*>()};
+    }
+
+    // calls `f` with the held value, strings are passed as `std::string_view`
+    template<class F>
+    decltype(auto) visit(F&& f) const {
+        switch (type()) {
+            case types::UniqueID: return f(*ptr<unique_id>());
+            case types::Null: return f(null_t{});
+            case types::Bool: return f(*ptr<bool>());
+            case types::Int32: return f(*ptr<std::int32_t>());
+            case types::Int64: return f(*ptr<std::int64_t>());
+            case types::uInt32: return f(*ptr<std::uint32_t>());
+            case types::uInt64: return f(*ptr<std::uint64_t>());
+            case types::Float: return f(*ptr<float>());
+            case types::Double: return f(*ptr<double>());
+            case types::String: return f(string_view());
+            case types::Array: return f(static_cast<array_t const&>(**ptr<array_t*>()));
+            default: return f(static_cast<document const&>(**ptr<document*>()));
+        }
+    }
+
+    template<class T>
+    [[nodiscard]] bool equals_strong(T const& t) const noexcept {
+        static_assert(is_valid_type<T>);
+        if (auto const val = as<T>(); val)
+            return *val == t;
+        return false;
+    }
+
+    template<class T>
+    [[nodiscard]] bool equals_weak(T const& t) const noexcept {
+        if constexpr (std::is_arithmetic_v<T>) {
+            switch (type()) {
+                case types::Bool: return detail::cmp_equal(*ptr<bool>(), t);
+                case types::Int32: return detail::cmp_equal(*ptr<std::int32_t>(), t);
+                case types::Int64: return detail::cmp_equal(*ptr<std::int64_t>(), t);
+                case types::uInt32: return detail::cmp_equal(*ptr<std::uint32_t>(), t);
+                case types::uInt64: return detail::cmp_equal(*ptr<std::uint64_t>(), t);
+                case types::Float: return detail::cmp_equal(*ptr<float>(), t);
+                case types::Double: return detail::cmp_equal(*ptr<double>(), t);
+                default: return false;
+            }
+        }
+        else if constexpr (std::is_same_v<unique_id, T>)
+            return type() == types::UniqueID && *ptr<unique_id>() == t;
+        else if constexpr (std::is_same_v<null_t, T>)
+            return type() == types::Null;
+        else if constexpr (std::is_same_v<array_t, T>)
+            return type() == types::Array && **ptr<array_t*>() == t;
+        else if constexpr (std::is_same_v<document, T>)
+            return type() == types::Document && **ptr<document*>() == t;
+        else if constexpr (detail::is_string_comparable_v<T>)
+            return type() == types::String && string_view() == t;
+        else {
+            static_assert(detail::always_false<T>::value);
+            return false;
+        }
+    }
+
+    bool operator==(compact_bson const& other) const noexcept {
+        if (type() != other.type())
+            return false;
+        return visit([&other](auto const& val) {
+            using T = std::remove_cv_t<std::remove_reference_t<decltype(val)>>;
+            if constexpr (std::is_same_v<T, std::string_view>)
+                return val == other.string_view();
+            else if constexpr (std::is_same_v<T, null_t>)
+                return true;
+            else
+                return val == *other.as<T>();
+        });
+    }
+
+    bool operator!=(compact_bson const& other) const noexcept { return !(*this == other); }
+
+    // values of different types are ordered by their type
+    bool operator<(compact_bson const& other) const noexcept {
+        if (type() != other.type())
+            return type() < other.type();
+        return visit([&other](auto const& val) {
+            using T = std::remove_cv_t<std::remove_reference_t<decltype(val)>>;
+            if constexpr (std::is_same_v<T, std::string_view>)
+                return val < other.string_view();
+            else if constexpr (std::is_same_v<T, null_t> || std::is_same_v<T, document>) {
+                DEBUG_ASSERT((!std::is_same_v<T, document>));
+                return false;
+            }
+            else
+                return val < *other.as<T>();
+        });
+    }
+
+    // return: a bitmap with bit i set if values[i] holds the string `str`
+    // strings short enough to be stored inline are matched 16 byte cell at a time
+    [[nodiscard]] static bitmap equal_strings(array_t const& values, std::string_view const str,
+        simd_level const level = active_simd_level())
+    {
+        static_assert(std::is_standard_layout_v<compact_bson> && sizeof(compact_bson) == payload_size + 1);
+        bitmap result(values.size());
+        if (str.size() <= inline_string_capacity) {
+            // heap strings are never short, so only the inline cells can match
+            unsigned char pattern[16] = {};
+            unsigned char mask[16] = {};
+            if (!str.empty())
+                std::memcpy(pattern, str.data(), str.size());
+            std::memset(mask, 0xFF, str.size());
+            compact_bson tag_only{str};
+            pattern[payload_size] = tag_only.tag_;
+            mask[payload_size] = 0xFF;
+            match_cells16(reinterpret_cast<unsigned char const*>(values.data()), values.size(), pattern, mask, result.data(), level);
+        }
+        else {
+            for (std::size_t i = 0; i < values.size(); ++i)
+                if (values[i].type() == types::String && values[i].string_tag() == heap_string && values[i].string_view() == str)
+                    result.set(i);
+        }
+        return result;
+    }
+
+    [[nodiscard]] bson to_bson() const {
+        return visit([](auto const& val) -> bson {
+            using T = std::remove_cv_t<std::remove_reference_t<decltype(val)>>;
+            if constexpr (std::is_same_v<T, std::string_view>)
+                return bson{bson_type<std::string>, val};
+            else if constexpr (std::is_same_v<T, array_t>) {
+                bson::array_t arr;
+                arr.reserve(val.size());
+                for (auto&& elem : val)
+                    arr.push_back(elem.to_bson());
+                return bson{std::move(arr)};
+            }
+            else
+                return bson{bson_type<T>, val};
+        });
+    }
+};
+
+static_assert(sizeof(compact_bson) == 16);
+
+} // namespace nova
+
+template<>
+struct fmt::formatter<nova::compact_bson> {
+    constexpr auto parse(fmt::format_parse_context& ctx) { return ctx.begin(); }
+
+    template<class FmtCtx>
+    auto format(nova::compact_bson const& b, FmtCtx& ctx) {
+        return b.visit(nova::detail::overloaded{
+                [&](nova::bson::null_t){
+                    return fmt::format_to(ctx.out(), "null");
+                },
+                [&](nova::compact_bson::array_t const& arr){
+                    fmt::format_to(ctx.out(), "[");
+                    auto first = true;
+                    for (auto&& val : arr) {
+                        if (!first)
+                            fmt::format_to(ctx.out(), ", ");
+                        fmt::format_to(ctx.out(), "{}", val);
+                        first = false;
+                    }
+                    return fmt::format_to(ctx.out(), "]");
+                },
+                [&](auto const& val) {
+                    return fmt::format_to(ctx.out(), "{}", val);
+                }
+            });
+    }
+};
+
+namespace std {
+    template<>
+    struct hash<nova::compact_bson> {
+        std::size_t operator()(nova::compact_bson const& val) const noexcept {
+            return val.visit([](auto const& v) -> std::size_t {
+                using T = std::remove_cv_t<std::remove_reference_t<decltype(v)>>;
+                if constexpr (std::is_same_v<T, std::string_view>)
+                    return std::hash<std::string_view>{}(v);
+                else if constexpr (std::is_same_v<T, nova::unique_id>)
+                    return v.hash();
+                else if constexpr (std::is_arithmetic_v<T>)
+                    return static_cast<std::size_t>(v);
+                else {
+                    DEBUG_ASSERT(false);
+                    return 0;
+                }
+            });
+        }
+    };
+} // namespace std
+
+#endif // NOVA_COMPACT_BSON_HPP
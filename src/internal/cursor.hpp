@@ -10,7 +10,8 @@
 namespace nova {
 
 namespace {
-    inline static constexpr std::size_t largest_gen_size = 32UL; // TODO: check all possible size, don't hard code in size
+    // a cursor over a whole hashed multi index holds two of its iterators, four pointers each
+    inline static constexpr std::size_t largest_gen_size = 64UL; // TODO: check all possible size, don't hard code in size
 }
 
 template<class T>
@@ -128,7 +129,7 @@ template<class T>
 class multiple_index_lookup_vec {
     std::vector<non_null_ptr<T>> vec_;
 public:
-    template<class V, std::enable_if_t<!std::is_same_v<V, multiple_index_lookup_vec>, int> = 0>
+    template<class V, std::enable_if_t<!std::is_same_v<std::decay_t<V>, multiple_index_lookup_vec>, int> = 0>
     explicit multiple_index_lookup_vec(V&& v) 
         : vec_(std::forward<V>(v)) 
     {
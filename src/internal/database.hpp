@@ -3,37 +3,404 @@
 
 #include <absl/container/flat_hash_map.h>
 
+#include "binary.hpp"
+#include "checkpoint.hpp"
 #include "collection.hpp"
+#include "mutation_log.hpp"
 #include "util/map_results.hpp"
+#include "util/optional.hpp"
+#include "wal.hpp"
 
+#include <algorithm>
 #include <memory>
+#include <string>
+#include <string_view>
+#include <typeindex>
 #include <vector>
 
 namespace nova {
 
+class database;
+
+namespace detail {
+
+// maximum number of fields of an index that can be recorded in a log
+inline static constexpr std::size_t max_logged_index_fields = 4;
+
+using index_factory = bool(*)(collection&, bool unique, index_kind kind, bool multikey, std::vector<std::string> const& fields);
+
+template<bool Unique, class Filter, index_kind Kind>
+bool create_logged_index(collection& coll, bool const multikey, std::vector<std::string> const& f) {
+    auto create = [&](auto const&... fields) {
+        return multikey ? coll.create_multikey_index<Unique, Filter, Kind>(fields...) : coll.create_index<Unique, Filter, Kind>(fields...);
+    };
+    switch (f.size()) {
+        case 1: return create(f[0]);
+        case 2: return create(f[0], f[1]);
+        case 3: return create(f[0], f[1], f[2]);
+        case 4: return create(f[0], f[1], f[2], f[3]);
+        default: return false;
+    }
+}
+
+template<class Filter>
+bool create_logged_index(collection& coll, bool const unique, index_kind const kind, bool const multikey, std::vector<std::string> const& f) {
+    if (kind == index_kind::text)
+        return f.size() == 1 && coll.create_text_index(f[0]);
+    if (kind == index_kind::spatial)
+        return f.size() == 1 ? coll.create_spatial_index(f[0]) : f.size() == 2 && coll.create_spatial_index(f[0], f[1]);
+    if (kind == index_kind::bitmap)
+        return f.size() == 1 && coll.create_bitmap_index(f[0]);
+    if (kind == index_kind::hashed)
+        return unique ? create_logged_index<true, Filter, index_kind::hashed>(coll, multikey, f)
+                      : create_logged_index<false, Filter, index_kind::hashed>(coll, multikey, f);
+    return unique ? create_logged_index<true, Filter, index_kind::ordered>(coll, multikey, f)
+                  : create_logged_index<false, Filter, index_kind::ordered>(coll, multikey, f);
+}
+
+// The write ahead log of a database along with the names its index filters are recorded under.
+struct database_log {
+    database* owner = nullptr;
+    write_ahead_log wal{};
+    absl::flat_hash_map<std::type_index, std::string> filter_names{};
+    absl::flat_hash_map<std::string, index_factory> filters{};
+    std::vector<std::unique_ptr<mutation_log>> collection_logs{};
+    std::string checkpoint_path{};
+    std::size_t checkpoint_threshold = std::size_t{64} << 20;
+    std::size_t next_checkpoint_at = std::size_t{64} << 20; // log size at which the next checkpoint is written
+
+    [[nodiscard]] bool checkpoint_due() const {
+        return checkpoint_threshold > 0 && wal.size_bytes() >= next_checkpoint_at;
+    }
+
+    database_log() {
+        filter_names.emplace(typeid(no_filter), std::string{});
+        filters.emplace(std::string{}, &create_logged_index<no_filter>);
+    }
+};
+
+// Records the mutations of a single collection in the database's write ahead log.
+class collection_log final : public mutation_log {
+    database_log* log_;
+    std::string name_;
+
+    // a checkpoint is only written before a record is appended, when every earlier record has been applied
+    template<class Build>
+    [[nodiscard]] bool append(wal_op op, Build&& build);
+
+public:
+    collection_log(database_log& log, std::string name) : log_(&log), name_(std::move(name)) {}
+
+    bool log_insert(document const& doc) override {
+        return append(wal_op::insert, [&](byte_buffer& buf) { encode(doc, buf); });
+    }
+
+    bool log_erase(doc_id const& id) override {
+        return append(wal_op::erase, [&](byte_buffer& buf) { encode(id, buf); });
+    }
+
+    bool log_update(doc_id const& id, std::string_view const field, bson const& value) override {
+        return append(wal_op::update, [&](byte_buffer& buf) {
+            encode(id, buf);
+            store_string(buf, field);
+            encode(value, buf);
+        });
+    }
+
+    bool can_log_index(std::type_index const filter, std::size_t const field_count) const override {
+        return field_count <= max_logged_index_fields && log_->filter_names.contains(filter);
+    }
+
+    bool log_create_index(bool const unique, index_kind const kind, bool const multikey, std::type_index const filter, span<std::string const> const fields) override {
+        auto const name = log_->filter_names.find(filter);
+        if (name == log_->filter_names.end())
+            return false;
+        return append(wal_op::create_index, [&](byte_buffer& buf) {
+            store(buf, index_flags(unique, kind, multikey));
+            store_string(buf, name->second);
+            store(buf, static_cast<std::uint8_t>(fields.size()));
+            for (auto&& field : fields)
+                store_string(buf, field);
+        });
+    }
+
+    bool log_create_column(std::string_view const field, bson::types const type) override {
+        return append(wal_op::create_column, [&](byte_buffer& buf) {
+            store(buf, static_cast<std::uint8_t>(type));
+            store_string(buf, field);
+        });
+    }
+};
+
+template<class T>
+bool create_logged_column(collection& coll, std::string field) {
+    if constexpr (column::is_valid_type<T>)
+        return coll.create_column<T>(std::move(field));
+    else
+        return false;
+}
+
+[[nodiscard]] inline bool create_logged_column(collection& coll, bson::types const type, std::string field) {
+    switch (type) {
+        case bson::types::Bool: return create_logged_column<bool>(coll, std::move(field));
+        case bson::types::Int32: return create_logged_column<std::int32_t>(coll, std::move(field));
+        case bson::types::Int64: return create_logged_column<std::int64_t>(coll, std::move(field));
+        case bson::types::uInt32: return create_logged_column<std::uint32_t>(coll, std::move(field));
+        case bson::types::uInt64: return create_logged_column<std::uint64_t>(coll, std::move(field));
+        case bson::types::Float: return create_logged_column<float>(coll, std::move(field));
+        case bson::types::Double: return create_logged_column<double>(coll, std::move(field));
+        case bson::types::String: return create_logged_column<std::string>(coll, std::move(field));
+        default: return false;
+    }
+}
+
+} // namespace detail
+
 class database {
-    absl::flat_hash_map<std::string, std::unique_ptr<collection> colls_{};
+    absl::flat_hash_map<std::string, std::unique_ptr<collection>> colls_{};
+    std::unique_ptr<detail::database_log> log_{};
+
+    detail::database_log& log_state() {
+        if (!log_)
+            log_ = std::make_unique<detail::database_log>();
+        return *log_;
+    }
+
+    [[nodiscard]] wal_status load(nova::checkpoint const& ckpt) {
+        auto& state = log_state();
+        for (auto&& stored : ckpt.collections()) {
+            auto const [it, inserted] = colls_.try_emplace(stored.name(), nullptr);
+            if (inserted)
+                it->second = std::make_unique<collection>();
+            auto& coll = *it->second;
+
+            for (auto&& index : stored.indices()) {
+                auto const factory = state.filters.find(index.filter);
+                if (factory == state.filters.end())
+                    return wal_status::unknown_filter;
+                static_cast<void>(factory->second(coll, index.unique, index.kind, index.multikey, {index.fields.begin(), index.fields.end()}));
+            }
+            for (auto&& col : stored.columns())
+                static_cast<void>(detail::create_logged_column(coll, col.type, std::string{col.field}));
+            // indices are created first and filled in parallel by restore
+            coll.restore(stored.begin(), stored.end());
+        }
+        return wal_status::ok;
+    }
+
+    void attach_log(std::string const& name, collection& coll) {
+        auto& state = log_state();
+        state.collection_logs.push_back(std::make_unique<detail::collection_log>(state, name));
+        coll.attach_log(state.collection_logs.back().get());
+    }
+
+    [[nodiscard]] wal_status replay(wal_op const op, byte_span const payload) {
+        wal_payload_reader reader{payload};
+        if (op == wal_op::create_collection) {
+            auto const name = reader.read_string();
+            if (!reader.ok())
+                return wal_status::corrupt;
+            auto const [it, inserted] = colls_.try_emplace(name, nullptr);
+            if (inserted)
+                it->second = std::make_unique<collection>();
+            return wal_status::ok;
+        }
+
+        auto const coll_it = colls_.find(reader.read_string());
+        if (!reader.ok() || coll_it == colls_.end())
+            return wal_status::corrupt;
+        auto& coll = *coll_it->second;
+
+        switch (op) {
+            case wal_op::insert: {
+                auto const doc = reader.read_document();
+                if (!doc)
+                    return wal_status::corrupt;
+                static_cast<void>(coll.insert(doc->to_document()));
+                return wal_status::ok;
+            }
+            case wal_op::erase: {
+                auto const id = reader.read_value();
+                if (!id)
+                    return wal_status::corrupt;
+                static_cast<void>(coll.erase(id->to_bson()));
+                return wal_status::ok;
+            }
+            case wal_op::update: {
+                auto const id = reader.read_value();
+                auto const field = reader.read_string();
+                auto const value = reader.read_value();
+                if (!id || !value || !reader.ok())
+                    return wal_status::corrupt;
+                static_cast<void>(coll.update(id->to_bson(), std::string{field}, value->to_bson()));
+                return wal_status::ok;
+            }
+            case wal_op::create_index: {
+                auto const flags = reader.read<std::uint8_t>();
+                auto const filter = reader.read_string();
+                auto const count = reader.read<std::uint8_t>();
+                std::vector<std::string> fields;
+                for (std::uint8_t i = 0; i < count; ++i)
+                    fields.emplace_back(reader.read_string());
+                if (!reader.ok())
+                    return wal_status::corrupt;
+                auto const factory = log_state().filters.find(filter);
+                if (factory == log_state().filters.end())
+                    return wal_status::unknown_filter;
+                static_cast<void>(factory->second(coll, detail::index_flags_unique(flags), detail::index_flags_kind(flags), detail::index_flags_multikey(flags), fields));
+                return wal_status::ok;
+            }
+            case wal_op::create_column: {
+                auto const type = static_cast<bson::types>(reader.read<std::uint8_t>());
+                auto const field = reader.read_string();
+                if (!reader.ok())
+                    return wal_status::corrupt;
+                static_cast<void>(detail::create_logged_column(coll, type, std::string{field}));
+                return wal_status::ok;
+            }
+            default:
+                return wal_status::corrupt;
+        }
+    }
 
 public:
     database() noexcept = default;
 
-    database(database&&) = default;
-    database& operator=(database&&) = default;
+    database(database&& other) noexcept
+        : colls_(std::move(other.colls_))
+        , log_(std::move(other.log_))
+    {
+        if (log_)
+            log_->owner = this;
+    }
+
+    database& operator=(database&& other) noexcept {
+        colls_ = std::move(other.colls_);
+        log_ = std::move(other.log_);
+        if (log_)
+            log_->owner = this;
+        return *this;
+    }
     
     database(database const&) = delete;
     database& operator=(database const&) = delete;
 
+    // Registers `Filter` under `name` so indices using it can be recorded in, and restored from, the log.
+    // Must happen before `open` for every filter used by a logged index.
+    template<class Filter>
+    void register_filter(std::string name) {
+        auto& state = log_state();
+        state.filter_names.insert_or_assign(typeid(Filter), name);
+        state.filters.insert_or_assign(std::move(name), &detail::create_logged_index<Filter>);
+    }
+
+    // Restores the database from the checkpoint at `path + ".checkpoint"`, if one exists, followed by
+    // the records of the write ahead log at `path` not reflected in the checkpoint. The log is created if it does not exist.
+    // Every later change to the database or its collections is appended to the log before being applied.
+    [[nodiscard]] wal_status open(std::string path, wal_options const options = {}) {
+        auto& state = log_state();
+        DEBUG_ASSERT(!state.wal.is_open());
+        state.owner = this;
+        state.checkpoint_path = path + ".checkpoint";
+
+        std::uint64_t checkpoint_lsn = 0;
+        {
+            nova::checkpoint ckpt;
+            if (auto const opened = ckpt.open(state.checkpoint_path); opened == wal_status::ok) {
+                if (auto const loaded = load(ckpt); loaded != wal_status::ok)
+                    return loaded;
+                checkpoint_lsn = ckpt.lsn();
+            }
+            else if (opened != wal_status::not_found)
+                return opened;
+        }
+
+        auto status = wal_status::ok;
+        auto const opened = state.wal.open(std::move(path), options, [&](std::uint64_t const lsn, wal_op const op, byte_span const payload) {
+            // the log may still hold records written before the checkpoint when the database stopped right after writing it
+            if (status == wal_status::ok && lsn > checkpoint_lsn)
+                status = replay(op, payload);
+        });
+        if (opened != wal_status::ok)
+            return opened;
+        if (status != wal_status::ok) {
+            state.wal.close();
+            return status;
+        }
+        state.wal.advance_lsn(checkpoint_lsn);
+        state.next_checkpoint_at = state.wal.size_bytes() + state.checkpoint_threshold;
+        for (auto&& [name, coll] : colls_)
+            attach_log(name, *coll);
+        return wal_status::ok;
+    }
+
+    // Writes every collection to a new checkpoint and empties the log, whose records the checkpoint now reflects.
+    // Checkpoints are also written automatically once the log grows past the checkpoint threshold.
+    wal_status checkpoint() {
+        if (!log_ || !log_->wal.is_open())
+            return wal_status::not_open;
+        auto& state = *log_;
+        if (auto const synced = state.wal.sync(); synced != wal_status::ok)
+            return synced;
+        auto const lsn = state.wal.last_lsn();
+
+        std::vector<std::pair<std::string_view, collection const*>> collections;
+        for (auto&& [name, coll] : colls_)
+            collections.emplace_back(name, coll.get());
+        auto const written = write_checkpoint(state.checkpoint_path, lsn, collections, [&](std::type_index const filter) {
+            if (auto const name = state.filter_names.find(filter); name != state.filter_names.end())
+                return optional<std::string_view>{name->second};
+            return optional<std::string_view>{};
+        });
+        // a failed checkpoint is retried once the log has grown by another threshold
+        state.next_checkpoint_at = state.wal.size_bytes() + state.checkpoint_threshold;
+        if (written != wal_status::ok)
+            return written;
+        auto const reset = state.wal.reset(lsn);
+        state.next_checkpoint_at = state.wal.size_bytes() + state.checkpoint_threshold;
+        return reset;
+    }
+
+    // a checkpoint is written once the log holds `bytes` of records, 0 disables automatic checkpoints
+    void set_checkpoint_threshold(std::size_t const bytes) {
+        auto& state = log_state();
+        state.checkpoint_threshold = bytes;
+        state.next_checkpoint_at = state.wal.size_bytes() + bytes;
+    }
+
+    // makes every logged change durable
+    wal_status sync() {
+        return log_ ? log_->wal.sync() : wal_status::not_open;
+    }
+
+    [[nodiscard]] write_ahead_log const* wal() const noexcept {
+        return log_ && log_->wal.is_open() ? &log_->wal : nullptr;
+    }
+
     template<class Str>
     [[nodiscard]] bool contains(Str const& str) const {
         return colls_.find(str) != colls_.end();
     }
 
+    // return: empty if the new collection could not be logged
     template<class Name, class... Args>
-    insert_result<std::string, collection> insert(Name&& name, Args&&... args) {
+    optional<insert_result<std::string, collection>> insert(Name&& name, Args&&... args) {
         auto const [iter, b] = colls_.try_emplace(std::forward<Name>(name), nullptr);
-        if (b)
+        if (b) {
+            if (log_ && log_->wal.is_open()) {
+                auto const logged = log_->wal.append(wal_op::create_collection, [&](byte_buffer& buf) {
+                    detail::store_string(buf, iter->first);
+                });
+                if (!logged) {
+                    colls_.erase(iter);
+                    return {};
+                }
+            }
             iter->second = std::make_unique<collection>(std::forward<Args>(args)...);
-        return {iter->first, iter->second, b};
+            if (log_ && log_->wal.is_open())
+                attach_log(iter->first, *iter->second);
+        }
+        return insert_result<std::string, collection>{iter->first, *(iter->second), b};
     }
 
     template<class Name>
@@ -52,15 +419,29 @@ public:
 
     template<class Name>
     [[nodiscard]] auto operator[](Name const& name) noexcept {
-        lookup(name);
+        return lookup(name);
     }
 
     template<class Name>
     [[nodiscard]] auto operator[](Name const& name) const noexcept {
-        lookup(name);
+        return lookup(name);
     }
 };
 
+namespace detail {
+
+template<class Build>
+bool collection_log::append(wal_op const op, Build&& build) {
+    if (log_->owner && log_->checkpoint_due())
+        static_cast<void>(log_->owner->checkpoint());
+    return log_->wal.append(op, [&](byte_buffer& buf) {
+        store_string(buf, name_);
+        build(buf);
+    }).has_value();
+}
+
+} // namespace detail
+
 } // namespace nova
 
-#endif // NOVA_DATABASE_HPP
\ No newline at end of file
+#endif // NOVA_DATABASE_HPP
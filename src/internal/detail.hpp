@@ -111,15 +111,28 @@ template<class... Ts> overloaded(Ts...) -> overloaded<Ts...>;
 template<class T>
 inline constexpr void ignore(T&&) noexcept {}
 
+// Compares two numbers by their value, as std::cmp_equal does for integers: a negative signed integer never equals
+// an unsigned one. Other arithmetic types compare with ==.
+template<class T, class U>
+[[nodiscard]] constexpr bool cmp_equal(T const t, U const u) noexcept {
+    constexpr bool integers = std::is_integral_v<T> && std::is_integral_v<U> && !std::is_same_v<T, bool> && !std::is_same_v<U, bool>;
+    if constexpr (integers && std::is_signed_v<T> && !std::is_signed_v<U>)
+        return t >= 0 && static_cast<std::make_unsigned_t<T>>(t) == u;
+    else if constexpr (integers && !std::is_signed_v<T> && std::is_signed_v<U>)
+        return u >= 0 && t == static_cast<std::make_unsigned_t<U>>(u);
+    else
+        return t == u;
+}
+
 template<class T>
 class recursive_wrapper {
     std::unique_ptr<T> ptr_;
 public:
-    template<class... Args, std::enable_if_t<!std::is_same_v<std::decay_t<T>, recursive_wrapper<T>>, int>>
-    recursive_wrapper(Args&&... args) 
-        : ptr_(std::make_unique<T>(std::forward<Args>(args)...)) 
+    template<class Arg, class... Args, std::enable_if_t<!std::is_same_v<std::decay_t<Arg>, recursive_wrapper>, int> = 0>
+    recursive_wrapper(Arg&& arg, Args&&... args) 
+        : ptr_(std::make_unique<T>(std::forward<Arg>(arg), std::forward<Args>(args)...)) 
     {
-        static_assert(std::is_constructible_v<T, Args...>);
+        static_assert(std::is_constructible_v<T, Arg, Args...>);
     }
 
     recursive_wrapper(recursive_wrapper&& other) = default;
@@ -131,6 +144,7 @@ public:
 
     recursive_wrapper& operator=(recursive_wrapper const& other) {
         ptr_ = std::make_unique<T>(*(other.ptr_));
+        return *this;
     }
 
     bool operator==(recursive_wrapper const& other) const noexcept {
@@ -6,10 +6,15 @@
 
 #include "bson.hpp"
 #include "detail.hpp"
+#include "field_path.hpp"
+#include "shape.hpp"
 #include "util/err_result.hpp"
 #include "util/map_results.hpp"
 
+#include <algorithm>
 #include <cstring>
+#include <iterator>
+#include <memory_resource>
 #include <string>
 #include <type_traits>
 #include <variant>
@@ -23,60 +28,157 @@ enum class value_error : std::uint8_t {
 
 using doc_id = bson;
 
+template<class Value>
+class doc_values_iterator {
+    shape const* shape_;
+    Value* values_;
+    std::size_t pos_;
+public:
+    using value_type = std::pair<std::string const&, Value&>;
+    using reference = value_type;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::forward_iterator_tag;
+
+    constexpr doc_values_iterator(shape const* const s, Value* const values, std::size_t const pos) noexcept
+        : shape_(s), values_(values), pos_(pos) {}
+
+    [[nodiscard]] value_type operator*() const noexcept { return {shape_->field(pos_), values_[pos_]}; }
+
+    doc_values_iterator& operator++() noexcept { ++pos_; return *this; }
+    [[nodiscard]] bool operator==(doc_values_iterator const& other) const noexcept { return pos_ == other.pos_; }
+    [[nodiscard]] bool operator!=(doc_values_iterator const& other) const noexcept { return pos_ != other.pos_; }
+};
+
+// The fields of a document, stored as a shared shape (the ordered field names) 
+// plus a dense array of values indexed by the shape's slots.
 class doc_values {
     using key_t = std::string;
     using value_t = bson;
-    absl::flat_hash_map<key_t, value_t> values_;
+    using vector_t = std::pmr::vector<value_t>;
+    shape const* shape_ = std::addressof(shape_tree::global().root());
+    vector_t values_;
 
 public:
+    using allocator_type = typename vector_t::allocator_type;
+
+    doc_values() = default;
+    explicit doc_values(allocator_type const alloc) : values_(alloc) {}
+    doc_values(shape_tree& tree, allocator_type const alloc) 
+        : shape_(std::addressof(tree.root())), values_(alloc) {}
+
+    // copies always use the global shape tree, so they may outlive the owner of `other`'s shapes
+    doc_values(doc_values const& other) 
+        : doc_values(other, shape_tree::global(), allocator_type{}) {}
+    doc_values(doc_values&&) = default;
+    doc_values(doc_values const& other, shape_tree& tree, allocator_type const alloc)
+        : shape_(std::addressof(tree.adopt(*other.shape_))), values_(other.values_, alloc) {}
+    doc_values(doc_values&& other, shape_tree& tree, allocator_type const alloc)
+        : shape_(std::addressof(tree.adopt(*other.shape_))), values_(std::move(other.values_), alloc) {}
+
+    doc_values& operator=(doc_values const& other) {
+        if (this != std::addressof(other)) {
+            shape_ = std::addressof(shape_->tree().adopt(*other.shape_));
+            values_ = other.values_;
+        }
+        return *this;
+    }
+
+    doc_values& operator=(doc_values&& other) {
+        shape_ = std::addressof(shape_->tree().adopt(*other.shape_));
+        values_ = std::move(other.values_);
+        return *this;
+    }
+
+    [[nodiscard]] allocator_type get_allocator() const noexcept { return values_.get_allocator(); }
+
+    [[nodiscard]] shape const& get_shape() const noexcept { return *shape_; }
+
+    // return: the value held in `slot` of this document's shape
+    [[nodiscard]] value_t& value_at(std::size_t const slot) noexcept {
+        DEBUG_ASSERT(slot < values_.size());
+        return values_[slot];
+    }
+
+    [[nodiscard]] value_t const& value_at(std::size_t const slot) const noexcept {
+        DEBUG_ASSERT(slot < values_.size());
+        return values_[slot];
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept { return values_.size(); }
+    [[nodiscard]] bool empty() const noexcept { return values_.empty(); }
+
+    void reserve(std::size_t const n) { values_.reserve(n); }
+
     template<class Key>
     [[nodiscard]] bool contains(Key const& key) const {
-        return values_.contains(key);
+        return shape_->contains(key) || (field_path::is_dotted(key) && contains(field_path{key}));
+    }
+
+    [[nodiscard]] bool contains(field_path const& path) const {
+        return static_cast<bool>(lookup(path));
     }
 
     template<class It, class Sent>
     [[nodiscard]] bool contains(It const it, Sent const sent) const {
-        detail::all_of(it, sent, [this](auto&& field){ return contains(field); });
+        return detail::all_of(it, sent, [this](auto&& field){ return contains(field); });
     }
 
     template<class Key, class... Args>
-    insert_result<key_t, value_t> insert(Key&& key, Args&&... args) {
-        auto [iter, b] = values_.try_emplace(std::forward<Key>(key), std::forward<Args>(args)...);
-        return {iter->first, iter->second, b};
+    insert_result<key_t, value_t> insert(Key const& key, Args&&... args) {
+        if (auto const slot = shape_->slot(key); slot)
+            return {shape_->field(*slot), values_[*slot], false};
+        return append(key, std::forward<Args>(args)...);
     }
 
     template<class Key, class T, class... Args>
-    insert_result<key_t, value_t> insert(Key&& key, bson_type_t<T>, Args&&... args) {
-        auto [iter, b] = values_.try_emplace(std::forward<Key>(key), bson_type<T>, std::forward<Args>(args)...);
-        return {iter->first, iter->second, b};
+    insert_result<key_t, value_t> insert(Key const& key, bson_type_t<T>, Args&&... args) {
+        if (auto const slot = shape_->slot(key); slot)
+            return {shape_->field(*slot), values_[*slot], false};
+        return append(key, bson_type<T>, std::forward<Args>(args)...);
     }
 
     template<class T, class Key, class... Args>
-    update_result<key_t, value_t> update(Key&& key, Args&&... args) {
-        auto [iter, b] = values_.insert_or_assign(std::forward<Key>(key), bson{bson_type<T>, std::forward<Args>(args)...});
-        return {iter->first, iter->seconds, b};
+    update_result<key_t, value_t> update(Key const& key, Args&&... args) {
+        if (auto const slot = shape_->slot(key); slot) {
+            values_[*slot] = bson{bson_type<T>, std::forward<Args>(args)...};
+            return {shape_->field(*slot), values_[*slot], false};
+        }
+        return append(key, bson_type<T>, std::forward<Args>(args)...);
     }
 
     template<class Key, class T>
-    update_result<key_t, value_t> update(Key&& key, T&& t) {
-        auto [iter, b] = values_.insert_or_assign(std::forward<Key>(key), bson{std::forward<T>(t)});
-        return {iter->first, iter->seconds, b};
+    update_result<key_t, value_t> update(Key const& key, T&& t) {
+        if (auto const slot = shape_->slot(key); slot) {
+            values_[*slot] = bson{std::forward<T>(t)};
+            return {shape_->field(*slot), values_[*slot], false};
+        }
+        return append(key, std::forward<T>(t));
     }
 
+    // A key holding a dot that names no field is resolved as a path, see field_path.
+    // Lookups repeated over many documents split the path once with a field_path instead.
     template<class Key>
     [[nodiscard]] lookup_result<key_t, value_t> lookup(Key const& key) {
-        if (auto const iter = values_.find(key); iter != values_.end())
-            return {iter->first, iter->second};
+        if (auto const slot = shape_->slot(key); slot)
+            return {shape_->field(*slot), values_[*slot]};
+        if (field_path::is_dotted(key))
+            return lookup(field_path{key});
         return {};
     }
 
     template<class Key>
     [[nodiscard]] lookup_result<key_t, value_t const> lookup(Key const& key) const {
-        if (auto const iter = values_.find(key); iter != values_.end())
-            return {iter->first, iter->second};
+        if (auto const slot = shape_->slot(key); slot)
+            return {shape_->field(*slot), values_[*slot]};
+        if (field_path::is_dotted(key))
+            return lookup(field_path{key});
         return {};
     }
 
+    // the key of a nested value is the top level field it is found under
+    [[nodiscard]] lookup_result<key_t, value_t> lookup(field_path const& path);
+    [[nodiscard]] lookup_result<key_t, value_t const> lookup(field_path const& path) const;
+
     template<class Key>
     [[nodiscard]] auto operator[](Key const& key) {
         return lookup(key);
@@ -89,8 +191,8 @@ public:
 
     template<class T, class Key>
     [[nodiscard]] err_result<T&, value_error> lookup_as(Key const& key) {
-        if (auto const iter = values_.find(key); iter != values_.end()) {
-            if (auto opt = iter->second.template as<T>(); opt)
+        if (auto const found = lookup(key); found) {
+            if (auto opt = found.value().template as<T>(); opt)
                 return {*opt};
             return {err_tag, value_error::WrongType};
         }
@@ -99,21 +201,40 @@ public:
 
     template<class T, class Key>
     [[nodiscard]] err_result<T const&, value_error> lookup_as(Key const& key) const {
-        if (auto const iter = values_.find(key); iter != values_.end()) {
-            if (auto const opt = iter->second.template as<T>(); opt)
+        if (auto const found = lookup(key); found) {
+            if (auto const opt = found.value().template as<T>(); opt)
                 return {*opt};
             return {err_tag, value_error::WrongType};
         }
         return {err_tag, value_error::Missing};
     }
 
-    [[nodiscard]] auto begin() noexcept { return values_.begin(); }
-    [[nodiscard]] auto begin() const noexcept { return values_.begin(); }
-    [[nodiscard]] auto end() noexcept { return values_.end(); }
-    [[nodiscard]] auto end() const noexcept { return values_.end(); }
+    [[nodiscard]] auto begin() noexcept { return doc_values_iterator<value_t>{shape_, values_.data(), 0}; }
+    [[nodiscard]] auto begin() const noexcept { return doc_values_iterator<value_t const>{shape_, values_.data(), 0}; }
+    [[nodiscard]] auto end() noexcept { return doc_values_iterator<value_t>{shape_, values_.data(), values_.size()}; }
+    [[nodiscard]] auto end() const noexcept { return doc_values_iterator<value_t const>{shape_, values_.data(), values_.size()}; }
 
+    // field order is not significant
     bool operator==(doc_values const& other) const noexcept {
-        return values_ == other.values_;
+        if (size() != other.size())
+            return false;
+        if (shape_->fields() == other.shape_->fields())
+            return std::equal(values_.begin(), values_.end(), other.values_.begin());
+        for (std::size_t i = 0; i < values_.size(); ++i) {
+            auto const found = other.lookup(shape_->field(i));
+            if (!found || !(found.value() == values_[i]))
+                return false;
+        }
+        return true;
+    }
+
+private:
+    template<class Key, class... Args>
+    insert_result<key_t, value_t> append(Key const& key, Args&&... args) {
+        auto const& next = shape_->transition(std::string_view{key});
+        auto& val = values_.emplace_back(std::forward<Args>(args)...);
+        shape_ = std::addressof(next);
+        return {shape_->field(values_.size() - 1), val, true};
     }
 };
 
@@ -123,12 +244,22 @@ class document {
     doc_values values_{};
     doc_id id_;
 public:
+    using allocator_type = doc_values::allocator_type;
 
     template<class T, std::enable_if_t<!std::is_same_v<std::decay_t<T>, document>, int> = 0>
     explicit document(T&& t) : id_(std::forward<T>(t)) {}
 
+    template<class T, std::enable_if_t<!std::is_same_v<std::decay_t<T>, document>, int> = 0>
+    document(T&& t, shape_tree& tree, allocator_type const alloc) : values_(tree, alloc), id_(std::forward<T>(t)) {}
+
     document(document const&) = default;
     document(document&&) = default;
+    document(document const& other, shape_tree& tree, allocator_type const alloc) 
+        : values_(other.values_, tree, alloc), id_(other.id_) {}
+    document(document&& other, shape_tree& tree, allocator_type const alloc) 
+        : values_(std::move(other.values_), tree, alloc), id_(std::move(other.id_)) {}
+
+    [[nodiscard]] allocator_type get_allocator() const noexcept { return values_.get_allocator(); }
 
     [[nodiscard]] auto const& id() const noexcept { return id_; }
     [[nodiscard]] auto& values() noexcept { return values_; }
@@ -139,6 +270,45 @@ public:
     }
 };
 
+namespace detail {
+
+// return: the value named below `val` by the segments of `path` following its head, none if a segment is missing
+template<class Value>
+[[nodiscard]] optional<Value&> descend(Value& val, field_path const& path) {
+    auto const segments = path.segments();
+    auto cur = std::addressof(val);
+    for (std::size_t i = 1; i < segments.size(); ++i) {
+        auto const& seg = segments[i];
+        if (auto sub = cur->template as<document>(); sub) {
+            auto const found = sub->values().lookup(seg.name);
+            if (!found)
+                return {};
+            cur = std::addressof(found.value());
+        }
+        else if (auto arr = cur->template as<bson::array_t>(); arr && seg.is_index() && seg.index < arr->size())
+            cur = std::addressof((*arr)[seg.index]);
+        else
+            return {};
+    }
+    return {*cur};
+}
+
+} // namespace detail
+
+inline lookup_result<doc_values::key_t, doc_values::value_t> doc_values::lookup(field_path const& path) {
+    if (auto const slot = shape_->slot(path.head()); slot)
+        if (auto found = detail::descend(values_[*slot], path); found)
+            return {shape_->field(*slot), *found};
+    return {};
+}
+
+inline lookup_result<doc_values::key_t, doc_values::value_t const> doc_values::lookup(field_path const& path) const {
+    if (auto const slot = shape_->slot(path.head()); slot)
+        if (auto found = detail::descend(values_[*slot], path); found)
+            return {shape_->field(*slot), *found};
+    return {};
+}
+
 using doc_lookup = lookup_result<doc_id, doc_values>;
 using const_doc_lookup = lookup_result<doc_id, doc_values const>;
 using doc_ref = valid_lookup<doc_id, doc_values>;
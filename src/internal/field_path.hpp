@@ -0,0 +1,75 @@
+#ifndef NOVA_FIELD_PATH_HPP
+#define NOVA_FIELD_PATH_HPP
+
+#include "../debug.hpp"
+#include "util/span.hpp"
+
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace nova {
+
+// A field named by a dotted path into nested documents and arrays, e.g. "address.city" or "grades.0".
+// The path is split once, so it is resolved against any number of documents without being parsed again.
+// A segment names a field of a nested document, or an element of an array when it is a number.
+class field_path {
+public:
+    inline static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    struct segment {
+        std::string name;
+        std::size_t index; // the array element `name` refers to, npos unless `name` is a number
+
+        [[nodiscard]] bool is_index() const noexcept { return index != npos; }
+    };
+
+    explicit field_path(std::string_view const path)
+        : path_(path)
+    {
+        for (std::size_t first = 0;;) {
+            auto const dot = path.find('.', first);
+            auto const name = path.substr(first, dot == std::string_view::npos ? std::string_view::npos : dot - first);
+            segments_.push_back(segment{std::string{name}, parse_index(name)});
+            if (dot == std::string_view::npos)
+                break;
+            first = dot + 1;
+        }
+    }
+
+    [[nodiscard]] std::string const& str() const noexcept { return path_; }
+
+    // the top level field the path starts at
+    [[nodiscard]] std::string const& head() const noexcept { return segments_.front().name; }
+
+    [[nodiscard]] bool nested() const noexcept { return segments_.size() > 1; }
+
+    [[nodiscard]] span<segment const> segments() const noexcept { return segments_; }
+
+    // return: whether `name` holds a dot, and so is a path rather than the name of a top level field
+    [[nodiscard]] static bool is_dotted(std::string_view const name) noexcept {
+        return name.find('.') != std::string_view::npos;
+    }
+
+private:
+    std::string path_;
+    std::vector<segment> segments_;
+
+    [[nodiscard]] static std::size_t parse_index(std::string_view const name) noexcept {
+        if (name.empty() || name.size() > std::numeric_limits<std::size_t>::digits10)
+            return npos;
+        std::size_t index = 0;
+        for (auto const c : name) {
+            if (c < '0' || c > '9')
+                return npos;
+            index = index * 10 + static_cast<std::size_t>(c - '0');
+        }
+        return index;
+    }
+};
+
+} // namespace nova
+
+#endif // NOVA_FIELD_PATH_HPP
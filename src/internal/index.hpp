@@ -2,15 +2,27 @@
 #define NOVA_INDEX_HPP
 
 #include <absl/container/btree_map.h>
+#include <absl/container/btree_set.h>
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
 #include <absl/container/node_hash_map.h>
 
 #include "cursor.hpp"
 #include "document.hpp"
+#include "field_path.hpp"
+#include "util/bloom_filter.hpp"
 #include "util/function_ref.hpp"
 #include "util/inplace_function.hpp"
+#include "util/optional.hpp"
+#include "util/parallel_sort.hpp"
 #include "util/span.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <iterator>
 #include <numeric>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -107,6 +119,17 @@ struct compound_index_key_cmp {
         return false;
     }
 
+    template<class T, std::size_t N, class U, std::size_t M>
+    constexpr bool operator()(span<T, N> const a, span<U, M> const b) const noexcept {
+        auto const min = std::min(a.size(), b.size());
+        for (std::size_t i = 0; i < min; ++i) {
+            if (a[i] == b[i])
+                continue;
+            return a[i] < b[i];
+        }
+        return false;
+    }
+
     template<class T, std::size_t N, class U, std::size_t M>
     constexpr bool operator()(std::array<T, N> const& a, span<non_null_ptr<U>, M> const s) const noexcept {
         auto const min = std::min(N, s.size());
@@ -130,6 +153,406 @@ struct compound_index_key_cmp {
     }
 };
 
+// the key of an entry of a multi index, or a bare key
+template<class K, class V>
+[[nodiscard]] constexpr K const& entry_key(std::pair<K, V> const& entry) noexcept { return entry.first; }
+
+template<class T>
+[[nodiscard]] constexpr T const& entry_key(T const& key) noexcept { return key; }
+
+// a key and the document held under it, to find a single entry of a multi index
+template<class Key>
+struct index_entry_probe {
+    Key const& key;
+    document const* doc;
+};
+
+// Orders the entries of an ordered multi index by key, then by document, so the entry of a document is found with one
+// descent of the tree however many documents share its key. A bare key compares equal to every entry held under it.
+template<class Cmp>
+struct index_entry_less : private Cmp {
+    using is_transparent = void;
+
+    template<class K, class V>
+    [[nodiscard]] bool operator()(std::pair<K, V> const& a, std::pair<K, V> const& b) const noexcept {
+        return less(a.first, a.second, b.first, b.second);
+    }
+
+    template<class K, class V, class Key>
+    [[nodiscard]] bool operator()(std::pair<K, V> const& a, index_entry_probe<Key> const& b) const noexcept {
+        return less(a.first, a.second, b.key, b.doc);
+    }
+
+    template<class Key, class K, class V>
+    [[nodiscard]] bool operator()(index_entry_probe<Key> const& a, std::pair<K, V> const& b) const noexcept {
+        return less(a.key, a.doc, b.first, b.second);
+    }
+
+    template<class A, class B>
+    [[nodiscard]] bool operator()(A const& a, B const& b) const noexcept {
+        return Cmp::operator()(entry_key(a), entry_key(b));
+    }
+
+private:
+    template<class A, class B>
+    [[nodiscard]] bool less(A const& a, document const* const a_doc, B const& b, document const* const b_doc) const noexcept {
+        if (Cmp::operator()(a, b))
+            return true;
+        if (Cmp::operator()(b, a))
+            return false;
+        return std::less<document const*>{}(a_doc, b_doc);
+    }
+};
+
+// spreads the bits of a hash, std::hash of an integer is the integer itself
+[[nodiscard]] constexpr std::size_t mix_hash(std::size_t h) noexcept {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+[[nodiscard]] constexpr std::size_t hash_combine(std::size_t const seed, std::size_t const h) noexcept {
+    return seed ^ (h + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+// hashes the values of a compound index key in order, `deref` maps an element of the key to its bson
+template<class It, class Deref>
+[[nodiscard]] std::size_t hash_index_key(It first, It const last, Deref deref) noexcept {
+    std::size_t hash{};
+    for (; first != last; ++first)
+        hash = hash_combine(hash, std::hash<bson>{}(deref(*first)));
+    return hash;
+}
+
+struct deref_bson {
+    constexpr bson const& operator()(bson const& b) const noexcept { return b; }
+    constexpr bson const& operator()(non_null_ptr<bson const> const b) const noexcept { return *b; }
+};
+
+// Hash of the keys of hashed indices.
+// Compound keys hash the same whether they are held as an array, a span of values or a span of pointers to values.
+struct index_key_hash {
+    using is_transparent = void;
+
+    [[nodiscard]] std::size_t operator()(bson const& b) const noexcept {
+        return mix_hash(std::hash<bson>{}(b));
+    }
+
+    template<std::size_t N>
+    [[nodiscard]] std::size_t operator()(std::array<bson, N> const& a) const noexcept {
+        return mix_hash(hash_index_key(a.begin(), a.end(), deref_bson{}));
+    }
+
+    template<class U, std::size_t M>
+    [[nodiscard]] std::size_t operator()(span<U, M> const s) const noexcept {
+        return mix_hash(hash_index_key(s.begin(), s.end(), deref_bson{}));
+    }
+};
+
+struct index_key_eq {
+    using is_transparent = void;
+
+    [[nodiscard]] bool operator()(bson const& a, bson const& b) const noexcept {
+        return a == b;
+    }
+
+    template<std::size_t N>
+    [[nodiscard]] bool operator()(std::array<bson, N> const& a, std::array<bson, N> const& b) const noexcept {
+        return a == b;
+    }
+
+    template<std::size_t N, class U, std::size_t M>
+    [[nodiscard]] bool operator()(std::array<bson, N> const& a, span<U, M> const s) const noexcept {
+        return s.size() == N && std::equal(a.begin(), a.end(), s.begin(), [](bson const& lhs, auto&& rhs) { return lhs == deref_bson{}(rhs); });
+    }
+
+    template<class U, std::size_t M, std::size_t N>
+    [[nodiscard]] bool operator()(span<U, M> const s, std::array<bson, N> const& a) const noexcept {
+        return (*this)(a, s);
+    }
+};
+
+// std::unordered_multimap only looks up keys of its own key type before C++20
+template<class Map>
+struct supports_heterogeneous_lookup : std::true_type {};
+
+template<class... Ts>
+struct supports_heterogeneous_lookup<std::unordered_multimap<Ts...>> : std::false_type {};
+
+// erases every element of `map` whose key satisfies `pred`, `erased` is given the document of each erased element
+template<class Map, class Pred, class Erased>
+std::size_t erase_map_if(Map& map, Pred&& pred, Erased&& erased) {
+    std::size_t count = 0;
+    for (auto it = map.begin(); it != map.end();) {
+        if (pred(it->first)) {
+            erased(it->second);
+            if constexpr (std::is_void_v<decltype(map.erase(it))>)
+                map.erase(it++); // absl hash maps, erasing does not invalidate other iterators
+            else
+                it = map.erase(it);
+            ++count;
+        }
+        else
+            ++it;
+    }
+    return count;
+}
+
+template<class Map, class = void>
+struct is_ordered_map : std::false_type {};
+
+template<class Map>
+struct is_ordered_map<Map, std::void_t<typename Map::key_compare>> : std::true_type {};
+
+// A hashed multimap holding the documents of each key in a set, so the entry of a document is found, and erased,
+// in O(1) however many documents share its key. It iterates like a multimap of (key, document) pairs, key by key.
+template<class K, class V, class Hash>
+class index_hash_multimap {
+    static_assert(std::is_same_v<V, non_null_ptr<document>>, "a multi index maps keys to documents");
+    using docs_t = absl::flat_hash_set<document*>;
+    using map_t = std::unordered_map<K, docs_t, Hash, index_key_eq>;
+
+    map_t map_{};
+    std::size_t size_ = 0;
+
+    template<class Outer>
+    class basic_iterator {
+        friend class index_hash_multimap;
+        template<class> friend class basic_iterator;
+        Outer outer_{};
+        typename docs_t::const_iterator doc_{};
+        Outer end_{};
+
+        basic_iterator(Outer const outer, Outer const end) : outer_(outer), end_(end) {
+            if (outer_ != end_)
+                doc_ = outer_->second.begin();
+        }
+
+        basic_iterator(Outer const outer, typename docs_t::const_iterator const doc, Outer const end)
+            : outer_(outer), doc_(doc), end_(end) {}
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<K const&, non_null_ptr<document>>;
+        using difference_type = std::ptrdiff_t;
+        using reference = value_type;
+
+        struct pointer {
+            value_type entry;
+            [[nodiscard]] value_type const* operator->() const noexcept { return std::addressof(entry); }
+        };
+
+        basic_iterator() = default;
+
+        template<class O, std::enable_if_t<std::is_convertible_v<O, Outer> && !std::is_same_v<O, Outer>, int> = 0>
+        basic_iterator(basic_iterator<O> const& other) : outer_(other.outer_), doc_(other.doc_), end_(other.end_) {}
+
+        [[nodiscard]] reference operator*() const noexcept { return {outer_->first, *doc_}; }
+        [[nodiscard]] pointer operator->() const noexcept { return {**this}; }
+
+        basic_iterator& operator++() noexcept {
+            if (++doc_ == outer_->second.end() && ++outer_ != end_)
+                doc_ = outer_->second.begin();
+            return *this;
+        }
+
+        basic_iterator operator++(int) noexcept {
+            auto const tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        [[nodiscard]] friend bool operator==(basic_iterator const& a, basic_iterator const& b) noexcept {
+            return a.outer_ == b.outer_ && (a.outer_ == a.end_ || a.doc_ == b.doc_);
+        }
+
+        [[nodiscard]] friend bool operator!=(basic_iterator const& a, basic_iterator const& b) noexcept {
+            return !(a == b);
+        }
+    };
+
+    // an empty range erases nothing, and gives a mutable iterator to where it lies
+    [[nodiscard]] typename map_t::iterator mutable_outer(typename map_t::const_iterator const outer) {
+        return map_.erase(outer, outer);
+    }
+
+public:
+    using key_type = K;
+    using iterator = basic_iterator<typename map_t::iterator>;
+    using const_iterator = basic_iterator<typename map_t::const_iterator>;
+
+    [[nodiscard]] std::size_t size() const noexcept { return size_; }
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+
+    [[nodiscard]] iterator begin() noexcept { return {map_.begin(), map_.end()}; }
+    [[nodiscard]] iterator end() noexcept { return {map_.end(), map_.end()}; }
+    [[nodiscard]] const_iterator begin() const noexcept { return {map_.begin(), map_.end()}; }
+    [[nodiscard]] const_iterator end() const noexcept { return {map_.end(), map_.end()}; }
+    [[nodiscard]] const_iterator cbegin() const noexcept { return begin(); }
+    [[nodiscard]] const_iterator cend() const noexcept { return end(); }
+
+    // the number of distinct keys is not known ahead, the sets of the keys grow as their documents are inserted
+    void reserve(std::size_t) noexcept {}
+
+    iterator emplace(K key, V const doc) {
+        auto const outer = map_.try_emplace(std::move(key)).first;
+        auto const [it, inserted] = outer->second.insert(doc.get());
+        size_ += inserted;
+        return {outer, it, map_.end()};
+    }
+
+    iterator emplace(std::pair<K, V> entry) {
+        return emplace(std::move(entry.first), entry.second);
+    }
+
+    template<class Key>
+    [[nodiscard]] iterator find(Key const& key) {
+        return {map_.find(key), map_.end()};
+    }
+
+    template<class Key>
+    [[nodiscard]] const_iterator find(Key const& key) const {
+        return {map_.find(key), map_.end()};
+    }
+
+    template<class Key>
+    [[nodiscard]] std::pair<iterator, iterator> equal_range(Key const& key) {
+        auto const outer = map_.find(key);
+        if (outer == map_.end())
+            return {end(), end()};
+        return {iterator{outer, map_.end()}, iterator{std::next(outer), map_.end()}};
+    }
+
+    template<class Key>
+    [[nodiscard]] std::pair<const_iterator, const_iterator> equal_range(Key const& key) const {
+        auto const outer = map_.find(key);
+        if (outer == map_.end())
+            return {end(), end()};
+        return {const_iterator{outer, map_.end()}, const_iterator{std::next(outer), map_.end()}};
+    }
+
+    // return: the entry following the one erased, the other entries stay where they are
+    iterator erase(const_iterator const it) {
+        auto const next = std::next(it);
+        auto const outer = mutable_outer(it.outer_);
+        outer->second.erase(it.doc_);
+        --size_;
+        if (outer->second.empty())
+            map_.erase(outer);
+        return {mutable_outer(next.outer_), next.doc_, map_.end()};
+    }
+
+    iterator erase(const_iterator first, const_iterator const last) {
+        while (first != last)
+            first = erase(first);
+        return {mutable_outer(first.outer_), first.doc_, map_.end()};
+    }
+
+    iterator erase(iterator const it) {
+        return erase(const_iterator{it});
+    }
+
+    iterator erase(iterator const first, iterator const last) {
+        return erase(const_iterator{first}, const_iterator{last});
+    }
+
+    template<class Key>
+    std::size_t erase(Key const& key) {
+        if (auto const outer = map_.find(key); outer != map_.end()) {
+            auto const count = outer->second.size();
+            size_ -= count;
+            map_.erase(outer);
+            return count;
+        }
+        return 0;
+    }
+
+    // return: whether `doc` was held under `key`
+    template<class Key>
+    bool erase_entry(Key const& key, document const* const doc) {
+        auto const outer = map_.find(key);
+        if (outer == map_.end() || outer->second.erase(const_cast<document*>(doc)) == 0)
+            return false;
+        --size_;
+        if (outer->second.empty())
+            map_.erase(outer);
+        return true;
+    }
+
+    void clear() noexcept {
+        map_.clear();
+        size_ = 0;
+    }
+};
+
+template<class K, class V, class Hash>
+struct supports_heterogeneous_lookup<index_hash_multimap<K, V, Hash>> : std::false_type {};
+
+// Erases the entry of `doc` under `key` in a multi index's map, with one search of the map.
+// return: whether `doc` was held under `key`
+template<class Map, class Key>
+bool erase_map_entry(Map& map, Key const& key, non_null_ptr<document const> const doc) {
+    if constexpr (is_ordered_map<Map>::value) {
+        auto const it = map.find(index_entry_probe<Key>{key, doc});
+        if (it == map.end())
+            return false;
+        map.erase(it);
+        return true;
+    }
+    else
+        return map.erase_entry(key, doc);
+}
+
+// The key each document is held under by an index.
+// Indices are searched by key, this is what lets a document be found, and erased, without knowing its fields.
+template<class Key>
+using index_doc_map = absl::flat_hash_map<document const*, Key>;
+
+// Calls `fn` with every key a multikey index holds a document under for `val`.
+// An array is held under each of its distinct elements, and an empty array under none, any other value under itself.
+// return: always true, like the compound overload
+template<class Fn>
+bool for_each_multikey(bson const& val, Fn&& fn) {
+    if (auto const arr = val.as<bson::array_t>(); arr) {
+        for (auto it = arr->begin(); it != arr->end(); ++it)
+            if (std::none_of(arr->begin(), it, [&](bson const& prev) { return prev == *it; }))
+                fn(*it);
+    }
+    else
+        fn(val);
+    return true;
+}
+
+// A compound key holds at most one array, and is expanded over the distinct elements of that array.
+// return: false, without calling `fn`, when more than one value of `vals` is an array
+template<std::size_t N, class Fn>
+bool for_each_multikey(std::array<bson, N> const& vals, Fn&& fn) {
+    auto const is_array = [](bson const& b) { return b.type() == bson::types::Array; };
+    auto const found = std::find_if(vals.begin(), vals.end(), is_array);
+    if (found == vals.end()) {
+        fn(vals);
+        return true;
+    }
+    if (std::any_of(std::next(found), vals.end(), is_array))
+        return false;
+    auto key = vals;
+    auto& slot = key[static_cast<std::size_t>(found - vals.begin())];
+    return for_each_multikey(*found, [&](bson const& elem) {
+        slot = elem;
+        fn(std::as_const(key));
+    });
+}
+
+// calls `fn` with the keys of `val`, expanded when the index is multikey
+template<class Key, class Fn>
+void for_each_multikey_if(bool const multikey, Key const& val, Fn&& fn) {
+    if (multikey)
+        for_each_multikey(val, fn);
+    else
+        fn(val);
+}
+
 template<class Filter>
 struct filter_wrapper : public Filter {
     template<class... Args, std::enable_if_t<std::is_constructible_v<Filter, Args...>, int> = 0>
@@ -143,6 +566,26 @@ struct filter_wrapper : public Filter {
     }
 };
 
+} // namespace detail
+
+// An entry of a single field index as its cursors yield it, read as `auto&& [key, doc]` like a pair.
+// The key is held by pointer so a cursor can step from entry to entry.
+template<class Doc>
+struct sf_index_entry {
+    bson const* key;
+    non_null_ptr<Doc> doc;
+
+    template<std::size_t I>
+    [[nodiscard]] decltype(auto) get() const noexcept {
+        if constexpr (I == 0)
+            return static_cast<bson const&>(*key);
+        else
+            return static_cast<non_null_ptr<Doc>>(doc);
+    }
+};
+
+namespace detail {
+
 struct deref_map_iter_second {
     template<class It>
     constexpr decltype(auto) operator()(It&& it) const noexcept {
@@ -152,8 +595,8 @@ struct deref_map_iter_second {
 
 struct sf_cursor_deref {
     template<class It>
-    constexpr decltype(auto) operator()(It&& it) const noexcept {
-        return *std::forward<It>(it);
+    constexpr auto operator()(It&& it) const noexcept {
+        return sf_index_entry<document>{std::addressof(it->first), it->second};
     }
 };
 
@@ -166,8 +609,8 @@ struct cmp_cursor_deref {
 
 struct sf_const_cursor_deref {
     template<class It>
-    constexpr decltype(auto) operator()(It&& it) const noexcept {
-        return *reinterpret_cast<std::pair<bson const, non_null_ptr<const document>> const*>(std::addressof(*it));
+    constexpr auto operator()(It&& it) const noexcept {
+        return sf_index_entry<document const>{std::addressof(it->first), it->second};
     }
 };
 
@@ -185,36 +628,413 @@ namespace {
                                                           , sizeof(typename absl::btree_multimap<int, int>::iterator));
 }
 
-using sf_index_cursor = basic_cursor<std::pair<bson const, non_null_ptr<document>>&>;
+using sf_index_cursor = basic_cursor<sf_index_entry<document>>;
 using cmp_index_cursor = basic_cursor<std::pair<span<bson const>, non_null_ptr<document>>>;
-using sf_index_const_cursor = basic_cursor<std::pair<bson const, non_null_ptr<document const>> const&>;
+using sf_index_const_cursor = basic_cursor<sf_index_entry<document const>>;
 using cmp_index_const_cursor = basic_cursor<std::pair<span<bson const>, non_null_ptr<document const>>>;
 
 enum class index_insert_result : std::uint8_t {
     success,
     already_exists,
     filter_failed,
+    // a multikey compound index holds at most one array per key
+    parallel_arrays,
+};
+
+// The structure backing an index.
+// Hashed indices find a key in O(1) rather than O(log n), but iterate their keys in no particular order.
+// Text indices hold the terms of a string field rather than its value, see text_index.
+// Spatial indices hold the position a pair of numbers gives, see spatial_index.
+// Bitmap indices hold the documents of each value in a compressed bitmap, see bitmap_index.
+enum class index_kind : std::uint8_t {
+    ordered,
+    hashed,
+    text,
+    spatial,
+    bitmap,
+};
+
+// The bounds of a range lookup that are part of the range.
+enum class range_bounds : std::uint8_t {
+    open,         // (lower, upper)
+    lower_closed, // [lower, upper)
+    upper_closed, // (lower, upper]
+    closed,       // [lower, upper]
+};
+
+namespace detail {
+
+[[nodiscard]] constexpr bool includes_lower(range_bounds const bounds) noexcept {
+    return bounds == range_bounds::lower_closed || bounds == range_bounds::closed;
+}
+
+[[nodiscard]] constexpr bool includes_upper(range_bounds const bounds) noexcept {
+    return bounds == range_bounds::upper_closed || bounds == range_bounds::closed;
+}
+
+// an empty span leaves that end of a compound range open
+[[nodiscard]] inline optional<span<bson const>> range_bound(span<bson const> const s) noexcept {
+    if (s.size() > 0)
+        return s;
+    return {};
+}
+
+// return: whether `key` lies between `lower` and `upper`, a missing bound leaves that end of the range open
+template<class Comp, class Key, class K>
+[[nodiscard]] bool in_range(Comp const& comp, Key const& key, optional<K> const& lower, optional<K> const& upper, range_bounds const bounds) {
+    if (lower && (includes_lower(bounds) ? comp(key, *lower) : !comp(*lower, key)))
+        return false;
+    if (upper && (includes_upper(bounds) ? comp(*upper, key) : !comp(key, *upper)))
+        return false;
+    return true;
+}
+
+// return: the iterators delimiting the keys of the ordered `map` that lie between `lower` and `upper`,
+// found with two descents of the tree
+template<class Map, class K>
+[[nodiscard]] auto ordered_range(Map& map, optional<K> const& lower, optional<K> const& upper, range_bounds const bounds) {
+    auto const comp = map.key_comp();
+    auto first = !lower ? map.begin() : includes_lower(bounds) ? map.lower_bound(*lower) : map.upper_bound(*lower);
+    auto last = !upper ? map.end() : includes_upper(bounds) ? map.upper_bound(*upper) : map.lower_bound(*upper);
+    // the lower bound lies past the upper bound, `last` would precede `first`
+    if (first == map.end() || (upper && (includes_upper(bounds) ? comp(*upper, first->first) : !comp(first->first, *upper))))
+        last = first;
+    return std::make_pair(first, last);
+}
+
+// A range over the field following `prefix` in a compound key, as a range over the whole key.
+// An open end is bounded by the prefix itself, which compares equal to every key it leads.
+struct prefix_range {
+    std::vector<bson> lower;
+    std::vector<bson> upper;
+    range_bounds bounds;
+
+    prefix_range(span<bson const> const prefix, optional<bson const&> const lo, optional<bson const&> const hi, range_bounds const b)
+        : lower(prefix.begin(), prefix.end())
+        , upper(prefix.begin(), prefix.end())
+    {
+        if (lo)
+            lower.push_back(*lo);
+        if (hi)
+            upper.push_back(*hi);
+        bool const lower_closed = !lo || includes_lower(b);
+        bool const upper_closed = !hi || includes_upper(b);
+        bounds = lower_closed ? (upper_closed ? range_bounds::closed : range_bounds::lower_closed)
+                              : (upper_closed ? range_bounds::upper_closed : range_bounds::open);
+    }
 };
 
+// The key of an entry of a bulk insert, pointing to the values held by its document.
+template<std::size_t N>
+using bulk_key = std::conditional_t<N == 1, bson const*, std::array<bson const*, N>>;
+
+[[nodiscard]] inline bson const& bulk_key_value(bson const* const key) noexcept {
+    return *key;
+}
+
+template<std::size_t N, std::size_t... Is>
+[[nodiscard]] std::array<bson, N> bulk_key_value(std::array<bson const*, N> const& key, std::index_sequence<Is...>) {
+    return {*key[Is]...};
+}
+
+template<std::size_t N>
+[[nodiscard]] std::array<bson, N> bulk_key_value(std::array<bson const*, N> const& key) {
+    return bulk_key_value(key, std::make_index_sequence<N>{});
+}
+
+// An integer ordered like the values of one bson type, so most comparisons of a sort never read the values themselves.
+// Numbers are mapped exactly, strings by their first 8 bytes.
+struct sort_prefix {
+    bson::types type;
+    bool exact;
+    std::uint64_t bits;
+
+    explicit sort_prefix(bson const& b) noexcept : type(b.type()), exact(true), bits(0) {
+        auto float_bits = [](auto const val, auto const sign) {
+            // flips the sign bit of positive numbers and every bit of negative ones, -0 is 0
+            auto u = decltype(sign){};
+            if (val != 0)
+                std::memcpy(&u, &val, sizeof(u));
+            return static_cast<std::uint64_t>(u & sign ? ~u : u | sign);
+        };
+        switch (type) {
+            case bson::types::Null: break;
+            case bson::types::Bool: bits = *b.as<bool>(); break;
+            case bson::types::Int32: bits = static_cast<std::uint32_t>(*b.as<std::int32_t>()) ^ 0x8000'0000U; break;
+            case bson::types::Int64: bits = static_cast<std::uint64_t>(*b.as<std::int64_t>()) ^ 0x8000'0000'0000'0000ULL; break;
+            case bson::types::uInt32: bits = *b.as<std::uint32_t>(); break;
+            case bson::types::uInt64: bits = *b.as<std::uint64_t>(); break;
+            case bson::types::Float: bits = float_bits(*b.as<float>(), std::uint32_t{0x8000'0000U}); break;
+            case bson::types::Double: bits = float_bits(*b.as<double>(), std::uint64_t{0x8000'0000'0000'0000ULL}); break;
+            case bson::types::String: {
+                auto const& str = *b.as<std::string>();
+                for (std::size_t i = 0; i < 8; ++i)
+                    bits = (bits << 8) | (i < str.size() ? static_cast<unsigned char>(str[i]) : 0U);
+                exact = false;
+                break;
+            }
+            default: exact = false; break;
+        }
+    }
+};
+
+template<std::size_t N>
+struct bulk_entry {
+    sort_prefix prefix;
+    bulk_key<N> key;
+    non_null_ptr<document> doc;
+};
+
+template<std::size_t N>
+using bulk_entries = std::vector<bulk_entry<N>>;
+
+// orders the entries of a bulk insert like the keys of an ordered index
+struct bulk_entry_less {
+    [[nodiscard]] static bool less(bson const* const a, bson const* const b, std::size_t) noexcept {
+        return *a < *b;
+    }
+
+    template<std::size_t N>
+    [[nodiscard]] static bool less(std::array<bson const*, N> const& a, std::array<bson const*, N> const& b, std::size_t const first) noexcept {
+        for (std::size_t i = first; i < N; ++i) {
+            if (*a[i] == *b[i])
+                continue;
+            return *a[i] < *b[i];
+        }
+        return false;
+    }
+
+    template<std::size_t N>
+    [[nodiscard]] bool operator()(bulk_entry<N> const& a, bulk_entry<N> const& b) const noexcept {
+        if (a.prefix.type != b.prefix.type)
+            return a.prefix.type < b.prefix.type;
+        if (a.prefix.bits != b.prefix.bits)
+            return a.prefix.bits < b.prefix.bits;
+        // equal exact prefixes are equal leading values
+        if (a.prefix.exact)
+            return N > 1 && less(a.key, b.key, 1);
+        return less(a.key, b.key, 0);
+    }
+};
+
+// orders the entries of a bulk insert like the entries of an ordered multi index, by key then by document
+struct bulk_entry_doc_less {
+    template<std::size_t N>
+    [[nodiscard]] bool operator()(bulk_entry<N> const& a, bulk_entry<N> const& b) const noexcept {
+        if (bulk_entry_less{}(a, b))
+            return true;
+        if (bulk_entry_less{}(b, a))
+            return false;
+        return std::less<document const*>{}(a.doc, b.doc);
+    }
+};
+
+// return: the entries of a bulk insert that pass `filter`, N values of `keys` per document
+template<std::size_t N, class Filter>
+[[nodiscard]] bulk_entries<N> make_bulk_entries(span<non_null_ptr<bson const> const> const keys, span<non_null_ptr<document> const> const docs, Filter const& filter) {
+    DEBUG_ASSERT(keys.size() == docs.size() * N);
+    bulk_entries<N> entries;
+    entries.reserve(docs.size());
+    for (std::size_t i = 0; i < docs.size(); ++i) {
+        if constexpr (N == 1) {
+            if (filter(*keys[i]))
+                entries.push_back(bulk_entry<N>{sort_prefix{*keys[i]}, keys[i], docs[i]});
+        }
+        else {
+            span<non_null_ptr<bson const> const> const vals{keys.begin() + i * N, N};
+            if (filter(vals)) {
+                std::array<bson const*, N> key;
+                for (std::size_t j = 0; j < N; ++j)
+                    key[j] = vals[j];
+                entries.push_back(bulk_entry<N>{sort_prefix{*key[0]}, key, docs[i]});
+            }
+        }
+    }
+    return entries;
+}
+
+// Inserts `entries` into the index `map`, recording their keys in `docs`.
+// Ordered maps are filled in the order of their entries, each entry is appended next to the last one rather than found
+// by a descent of the tree, and the duplicate keys a unique index refuses are found next to each other.
+// Hashed maps are sized once for every entry.
+// return: the number of entries inserted
+template<bool Unique, class Map, class DocMap, std::size_t N>
+std::size_t bulk_load(Map& map, DocMap& docs, bulk_entries<N>& entries, std::size_t const max_threads) {
+    docs.reserve(docs.size() + entries.size());
+    std::size_t count = 0;
+    if constexpr (is_ordered_map<Map>::value) {
+        if constexpr (Unique)
+            parallel_stable_sort(entries.begin(), entries.end(), bulk_entry_less{}, max_threads);
+        else
+            parallel_stable_sort(entries.begin(), entries.end(), bulk_entry_doc_less{}, max_threads);
+        for (std::size_t i = 0; i < entries.size(); ++i) {
+            auto&& [prefix, key, doc] = entries[i];
+            // the sort is stable, the first document of a key is the one inserting one by one would keep
+            if constexpr (Unique)
+                if (i > 0 && !bulk_entry_less{}(entries[i - 1], entries[i]))
+                    continue;
+            auto const it = map.emplace_hint(map.end(), bulk_key_value(key), doc);
+            if constexpr (Unique)
+                if (it->second != doc) // the key was held before the bulk insert
+                    continue;
+            docs.insert_or_assign(doc, it->first);
+            ++count;
+        }
+    }
+    else {
+        map.reserve(map.size() + entries.size());
+        for (auto&& [prefix, key, doc] : entries) {
+            if constexpr (Unique) {
+                auto const [it, inserted] = map.try_emplace(bulk_key_value(key), doc);
+                if (!inserted)
+                    continue;
+                docs.insert_or_assign(doc, it->first);
+            }
+            else {
+                auto const it = map.emplace(bulk_key_value(key), doc);
+                docs.insert_or_assign(doc, it->first);
+            }
+            ++count;
+        }
+    }
+    return count;
+}
+
+// return: a filter of every key of the index `map`, sized for twice as many keys
+template<class Map>
+[[nodiscard]] bloom_filter make_key_filter(Map const& map) {
+    bloom_filter filter(2 * static_cast<std::size_t>(map.size()));
+    for (auto&& entry : map)
+        filter.insert(index_key_hash{}(entry.first));
+    return filter;
+}
+
+// Erases every document held under a key satisfying `pred` from a multikey `index`, along with the rest of its entries.
+// return: the number of documents erased
+template<class Index, class Map, class Pred>
+std::size_t erase_docs_if(Index& index, Map const& map, Pred&& pred) {
+    std::vector<document const*> erased;
+    for (auto&& [key, doc] : map)
+        if (pred(key))
+            erased.push_back(doc);
+    std::size_t count = 0;
+    for (auto const doc : erased)
+        count += index.erase_doc(doc); // a document matched under two of its keys is erased once
+    return count;
+}
+
+// Inserts the documents of a bulk insert one by one, multikey indices expand their keys on insert.
+// return: the number of documents inserted
+template<std::size_t N, class Index>
+std::size_t insert_each(Index& index, span<non_null_ptr<bson const> const> const keys, span<non_null_ptr<document> const> const docs) {
+    DEBUG_ASSERT(keys.size() == docs.size() * N);
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < docs.size(); ++i) {
+        index_insert_result result;
+        if constexpr (N == 1)
+            result = index.insert(*keys[i], docs[i]);
+        else {
+            std::array<bson const*, N> ptrs;
+            for (std::size_t j = 0; j < N; ++j)
+                ptrs[j] = keys[i * N + j];
+            auto const key = bulk_key_value(ptrs);
+            result = index.insert(span<bson const>{key}, docs[i]);
+        }
+        count += result == index_insert_result::success;
+    }
+    return count;
+}
+
+} // namespace detail
+
 //
 // index base classes:
 //
 struct _base_index_interface {
     [[nodiscard]] virtual bool empty() const noexcept = 0;
     [[nodiscard]] virtual std::size_t size() const noexcept = 0;
+    // the number of documents held, fewer than `size()` when a multikey index holds a document under several keys
+    [[nodiscard]] virtual std::size_t document_count() const noexcept = 0;
+    // whether the keys are held in order, so a prefix or a range of them is found without visiting every key
+    [[nodiscard]] virtual bool ordered() const noexcept = 0;
     [[nodiscard]] virtual std::size_t field_count() const noexcept = 0;
     [[nodiscard]] virtual bool contains_doc(non_null_ptr<document const> const doc) const = 0;
+    // erases every entry of `doc` held by the index
+    virtual bool erase_doc(non_null_ptr<document const> const doc) = 0;
+    // Inserts every document of `docs`, held under `field_count()` values of `keys` each, as `insert` would one by one.
+    // Ordered indices sort the entries on up to `max_threads` threads and fill the tree in key order.
+    // return: the number of documents inserted
+    virtual std::size_t bulk_insert(span<non_null_ptr<bson const> const> keys, span<non_null_ptr<document> const> docs, std::size_t max_threads = 1) = 0;
     virtual void clear() = 0;
     virtual ~_base_index_interface() = default;
+
+    // Multikey indices hold a document under each distinct element of an array value rather than under the array,
+    // compound keys may hold one array at most. A scan or range of the index can meet a document once per element.
+    // Only an empty index changes mode.
+    void set_multikey(bool const multikey) noexcept {
+        DEBUG_ASSERT(empty());
+        multikey_ = multikey;
+    }
+
+    [[nodiscard]] bool multikey() const noexcept { return multikey_; }
+
+    // the indexed fields split into paths once, index_manager sets them when it creates the index
+    void set_paths(std::vector<field_path> paths) { paths_ = std::move(paths); }
+
+    [[nodiscard]] span<field_path const> paths() const noexcept { return paths_; }
+
+    // A key filter answers most lookups of keys the index does not hold without probing the index.
+    // It holds every key inserted, and is rebuilt from the keys held once erases leave it mostly stale.
+    void set_key_filter(bool const enabled) {
+        if (enabled)
+            rebuild_key_filter();
+        else
+            key_filter_ = {};
+    }
+
+    [[nodiscard]] bloom_filter const& key_filter() const noexcept { return key_filter_; }
+
+protected:
+    bool multikey_ = false;
+    std::vector<field_path> paths_;
+    bloom_filter key_filter_{};
+
+    virtual void rebuild_key_filter() = 0;
+
+    // records the keys of `val` in the key filter, expanded when the index is multikey
+    template<class Key>
+    void filter_insert(Key const& val) {
+        if (!key_filter_.enabled())
+            return;
+        detail::for_each_multikey_if(multikey_, val, [this](auto const& key) { key_filter_.insert(detail::index_key_hash{}(key)); });
+        if (key_filter_.stale(size()))
+            rebuild_key_filter();
+    }
+
+    void filter_erased() {
+        if (key_filter_.stale(size()))
+            rebuild_key_filter();
+    }
+
+    // return: whether the index surely holds no entry under `key`
+    template<class Key>
+    [[nodiscard]] bool filter_excludes(Key const& key) const noexcept {
+        return !key_filter_.may_contain(detail::index_key_hash{}(key));
+    }
 };
 
 struct _single_field_index_interface : public _base_index_interface {
     virtual index_insert_result insert(bson const&, non_null_ptr<document> const) = 0;
     [[nodiscard]] virtual bool contains(bson const&) const = 0;
+    // return: the number of documents held under a value, counted no further than `limit`
+    [[nodiscard]] virtual std::size_t count(bson const&, std::size_t limit) const = 0;
     [[nodiscard]] virtual lookup_result<bson, document> lookup_one(bson const&) = 0;
     [[nodiscard]] virtual lookup_result<bson, document const> lookup_one(bson const&) const = 0;
     [[nodiscard]] virtual cursor lookup_if(function_ref<bool(bson const&)>) = 0;
     [[nodiscard]] virtual const_cursor lookup_if(function_ref<bool(bson const&)>) const = 0;
+    // a missing bound leaves that end of the range open, values of different types are ordered by their type
+    [[nodiscard]] virtual cursor lookup_range(optional<bson const&>, optional<bson const&>, range_bounds = range_bounds::closed) = 0;
+    [[nodiscard]] virtual const_cursor lookup_range(optional<bson const&>, optional<bson const&>, range_bounds = range_bounds::closed) const = 0;
     virtual std::size_t erase(bson const&) = 0;
     virtual std::size_t erase_if(function_ref<bool(bson const&)>) = 0;
     [[nodiscard]] virtual function_ref<bool(bson const&)> value_filter() const noexcept = 0;
@@ -243,6 +1063,16 @@ struct _compound_index_interface : public _base_index_interface {
     [[nodiscard]] virtual lookup_result<span<bson const>, document const> lookup_one(span<bson const>) const = 0;
     [[nodiscard]] virtual cursor lookup_if(function_ref<bool(span<bson const>)>) = 0;
     [[nodiscard]] virtual const_cursor lookup_if(function_ref<bool(span<bson const>)>) const = 0;
+    // bounds shorter than the key are compared against its leading fields, an empty bound leaves that end of the range open
+    [[nodiscard]] virtual cursor lookup_range(span<bson const>, span<bson const>, range_bounds = range_bounds::closed) = 0;
+    [[nodiscard]] virtual const_cursor lookup_range(span<bson const>, span<bson const>, range_bounds = range_bounds::closed) const = 0;
+    // the documents whose leading fields equal `prefix`, ordered indices yield them lazily in the order of their keys
+    [[nodiscard]] virtual cursor lookup_prefix(span<bson const>) = 0;
+    [[nodiscard]] virtual const_cursor lookup_prefix(span<bson const>) const = 0;
+    // the documents whose leading fields equal `prefix` and whose following field lies between the bounds,
+    // a missing bound leaves that end of the range open
+    [[nodiscard]] virtual cursor lookup_prefix_range(span<bson const>, optional<bson const&>, optional<bson const&>, range_bounds = range_bounds::closed) = 0;
+    [[nodiscard]] virtual const_cursor lookup_prefix_range(span<bson const>, optional<bson const&>, optional<bson const&>, range_bounds = range_bounds::closed) const = 0;
     virtual std::size_t erase(span<bson const>) = 0;
     virtual std::size_t erase(span<non_null_ptr<bson const>> const) = 0;
     virtual std::size_t erase_if(function_ref<bool(span<bson const>)>) = 0;
@@ -270,8 +1100,32 @@ struct compound_multi_index_interface : public _compound_index_interface {
 template<template<class...> class MapT, class Filter>
 class basic_single_field_unique_index final : public single_field_unique_index_interface, private detail::filter_wrapper<Filter> {
     MapT<bson, non_null_ptr<document>> map_{};
+    detail::index_doc_map<bson> docs_{};
     using map_iter_t = decltype(map_.begin());
     using const_map_iter_t = decltype(map_.cbegin());
+
+    // a document is refused when any of its elements is held by another document
+    index_insert_result insert_elements(bson const& val, non_null_ptr<document> const doc) {
+        bool passed = false;
+        bool taken = false;
+        detail::for_each_multikey(val, [&](bson const& key) {
+            if (this->filter(key)) {
+                passed = true;
+                taken = taken || map_.find(key) != map_.end();
+            }
+        });
+        if (taken)
+            return index_insert_result::already_exists;
+        if (!passed)
+            return index_insert_result::filter_failed;
+        detail::for_each_multikey(val, [&](bson const& key) {
+            if (this->filter(key))
+                map_.try_emplace(key, doc);
+        });
+        docs_.insert_or_assign(doc, val);
+        filter_insert(val);
+        return index_insert_result::success;
+    }
 public:
     basic_single_field_unique_index() = default;
     
@@ -283,32 +1137,51 @@ public:
     ~basic_single_field_unique_index() = default;
 
     [[nodiscard]] bool contains(bson const& val) const final {
-        return map_.contains(val);
+        return !filter_excludes(val) && map_.find(val) != map_.end();
+    }
+
+    [[nodiscard]] std::size_t count(bson const& val, std::size_t const limit) const final {
+        return limit > 0 && contains(val) ? 1 : 0;
     }
 
     [[nodiscard]] bool contains_doc(non_null_ptr<document const> const doc) const final {
-        for (auto&& [val, doc_ptr] : map_) {
-            if (doc == doc_ptr)
-                return true;
-        }
-        return false;
+        return docs_.contains(doc);
     }
 
     index_insert_result insert(bson const& val, non_null_ptr<document> const doc) final {
+        if (multikey_ && val.type() == bson::types::Array)
+            return insert_elements(val, doc);
         if (this->filter(val)) {
-            auto const result = map_.try_emplace(val, doc);
-            return result.second ? index_insert_result::success : index_insert_result::already_exists;
+            if (!map_.try_emplace(val, doc).second)
+                return index_insert_result::already_exists;
+            docs_.insert_or_assign(doc, val);
+            filter_insert(val);
+            return index_insert_result::success;
         }
         return index_insert_result::filter_failed;
     }
 
+    std::size_t bulk_insert(span<non_null_ptr<bson const> const> const keys, span<non_null_ptr<document> const> const docs, std::size_t const max_threads = 1) final {
+        if (multikey_)
+            return detail::insert_each<1>(*this, keys, docs);
+        auto entries = detail::make_bulk_entries<1>(keys, docs, [this](auto&& key) { return this->filter(key); });
+        auto const count = detail::bulk_load<true>(map_, docs_, entries, max_threads);
+        if (key_filter_.enabled())
+            rebuild_key_filter();
+        return count;
+    }
+
     [[nodiscard]] lookup_result<bson, document> lookup_one(bson const& val) final {
+        if (filter_excludes(val))
+            return {};
         if (auto const it = map_.find(val); it != map_.end())
             return {it->first, *(it->second)};
         return {};
     }
 
     [[nodiscard]] lookup_result<bson, document const> lookup_one(bson const& val) const final {
+        if (filter_excludes(val))
+            return {};
         if (auto const it = map_.find(val); it != map_.end())
             return {it->first, *(it->second)};
         return {};
@@ -342,18 +1215,56 @@ public:
             return multiple_index_lookup_vec{std::move(vec)};
     }
 
+    [[nodiscard]] cursor lookup_range(optional<bson const&> const lower, optional<bson const&> const upper, range_bounds const bounds = range_bounds::closed) final {
+        if constexpr (detail::is_ordered_map<decltype(map_)>::value) {
+            auto const [first, last] = detail::ordered_range(map_, lower, upper, bounds);
+            return multiple_index_lookup_iter<document&, detail::deref_map_iter_second, map_iter_t>{first, last};
+        }
+        else
+            return lookup_if([&](bson const& key) { return detail::in_range(std::less<bson>{}, key, lower, upper, bounds); });
+    }
+
+    [[nodiscard]] const_cursor lookup_range(optional<bson const&> const lower, optional<bson const&> const upper, range_bounds const bounds = range_bounds::closed) const final {
+        if constexpr (detail::is_ordered_map<decltype(map_)>::value) {
+            auto const [first, last] = detail::ordered_range(map_, lower, upper, bounds);
+            return multiple_index_lookup_iter<document const&, detail::deref_map_iter_second, const_map_iter_t>{first, last};
+        }
+        else
+            return lookup_if([&](bson const& key) { return detail::in_range(std::less<bson>{}, key, lower, upper, bounds); });
+    }
+
     std::size_t erase(bson const& val) final {
-        return map_.erase(val);
+        if (auto const it = map_.find(val); it != map_.end()) {
+            document const* const doc = it->second;
+            map_.erase(it);
+            if (multikey_)
+                erase_doc(doc);
+            else
+                docs_.erase(doc);
+            filter_erased();
+            return 1;
+        }
+        return 0;
+    }
+
+    bool erase_doc(non_null_ptr<document const> const doc) final {
+        if (auto const it = docs_.find(doc); it != docs_.end()) {
+            detail::for_each_multikey_if(multikey_, it->second, [&](bson const& key) {
+                if (auto const found = map_.find(key); found != map_.end() && found->second == doc)
+                    map_.erase(found);
+            });
+            docs_.erase(it);
+            filter_erased();
+            return true;
+        }
+        return false;
     }
 
     std::size_t erase_if(function_ref<bool(bson const&)> fn) final {
-        std::size_t count = 0;
-        for (auto it = map_.begin(); it != map_.end(); ++it) {
-            if (fn(it->first)) {
-                map_.erase(it);
-                ++count;
-            }
-        }
+        if (multikey_)
+            return detail::erase_docs_if(*this, map_, fn);
+        auto const count = detail::erase_map_if(map_, fn, [this](document const* const doc) { docs_.erase(doc); });
+        filter_erased();
         return count;
     }
 
@@ -361,9 +1272,16 @@ public:
 
     [[nodiscard]] std::size_t size() const noexcept  final { return map_.size(); }
 
+    [[nodiscard]] std::size_t document_count() const noexcept final { return docs_.size(); }
+    [[nodiscard]] bool ordered() const noexcept final { return detail::is_ordered_map<decltype(map_)>::value; }
+
     [[nodiscard]] constexpr std::size_t field_count() const noexcept final { return 1; }
 
-    void clear() final { map_.clear(); }
+    void clear() final {
+        map_.clear();
+        docs_.clear();
+        filter_erased();
+    }
 
     [[nodiscard]] function_ref<bool(bson const&)> value_filter() const noexcept final {
         return static_cast<Filter const&>(*this);
@@ -378,11 +1296,15 @@ public:
         return multiple_index_lookup_iter<typename sf_index_const_cursor::value_type, 
             detail::sf_const_cursor_deref, const_map_iter_t>{map_.cbegin(), map_.cend()};
     }
+
+private:
+    void rebuild_key_filter() final { key_filter_ = detail::make_key_filter(map_); }
 };
 
 template<template<class...> class MapT, class Filter>
 class basic_single_field_multi_index final : public single_field_multi_index_interface, private detail::filter_wrapper<Filter> {
     MapT<bson, non_null_ptr<document>> map_{};
+    detail::index_doc_map<bson> docs_{};
     using map_iter_t = decltype(map_.begin());
     using const_map_iter_t = decltype(map_.cbegin());
 public:
@@ -395,44 +1317,83 @@ public:
     {}
 
     [[nodiscard]] bool contains(bson const& val) const final {
-        return map_.contains(val);
+        return !filter_excludes(val) && map_.find(val) != map_.end();
+    }
+
+    [[nodiscard]] std::size_t count(bson const& val, std::size_t const limit) const final {
+        if (filter_excludes(val))
+            return 0;
+        std::size_t count = 0;
+        for (auto [first, last] = map_.equal_range(val); first != last && count < limit; ++first)
+            ++count;
+        return count;
     }
 
     [[nodiscard]] bool contains_doc(non_null_ptr<document const> const doc) const final {
-        for (auto&& [val, doc_ptr] : map_) {
-            if (doc == doc_ptr)
-                return true;
-        }
-        return false;
+        return docs_.contains(doc);
     }
 
     index_insert_result insert(bson const& val, non_null_ptr<document> const doc) final {
+        if (multikey_ && val.type() == bson::types::Array) {
+            bool passed = false;
+            detail::for_each_multikey(val, [&](bson const& key) {
+                if (this->filter(key)) {
+                    map_.emplace(key, doc);
+                    passed = true;
+                }
+            });
+            if (!passed)
+                return index_insert_result::filter_failed;
+            docs_.insert_or_assign(doc, val);
+            filter_insert(val);
+            return index_insert_result::success;
+        }
         if (this->filter(val)) {
             map_.emplace(std::make_pair(val, doc));
+            docs_.insert_or_assign(doc, val);
+            filter_insert(val);
             return index_insert_result::success;
         }
         return index_insert_result::filter_failed;
     }
 
+    std::size_t bulk_insert(span<non_null_ptr<bson const> const> const keys, span<non_null_ptr<document> const> const docs, std::size_t const max_threads = 1) final {
+        if (multikey_)
+            return detail::insert_each<1>(*this, keys, docs);
+        auto entries = detail::make_bulk_entries<1>(keys, docs, [this](auto&& key) { return this->filter(key); });
+        auto const count = detail::bulk_load<false>(map_, docs_, entries, max_threads);
+        if (key_filter_.enabled())
+            rebuild_key_filter();
+        return count;
+    }
+
     [[nodiscard]] lookup_result<bson, document> lookup_one(bson const& val) final {
+        if (filter_excludes(val))
+            return {};
         if (auto const it = map_.find(val); it != map_.end())
             return {it->first, *(it->second)};
         return {};
     }
 
     [[nodiscard]] lookup_result<bson, document const> lookup_one(bson const& val) const final {
+        if (filter_excludes(val))
+            return {};
         if (auto const it = map_.find(val); it != map_.end())
             return {it->first, *(it->second)};
         return {};
     }
 
     [[nodiscard]] cursor lookup_many(bson const& val) final {
+        if (filter_excludes(val))
+            return zero_index_lookup<document>;
         if (auto const [first, last] = map_.equal_range(val); first != map_.end())
             return multiple_index_lookup_iter<document&, detail::deref_map_iter_second, map_iter_t>{first, last};
         return zero_index_lookup<document>;
     }
 
     [[nodiscard]] const_cursor lookup_many(bson const& val) const final {
+        if (filter_excludes(val))
+            return zero_index_lookup<document const>;
         if (auto const [first, last] = map_.equal_range(val); first != map_.end())
             return multiple_index_lookup_iter<document const&, detail::deref_map_iter_second, const_map_iter_t>{first, last};
         return zero_index_lookup<document const>;
@@ -468,31 +1429,67 @@ public:
             return multiple_index_lookup_vec{std::move(vec)};
     }
 
+    [[nodiscard]] cursor lookup_range(optional<bson const&> const lower, optional<bson const&> const upper, range_bounds const bounds = range_bounds::closed) final {
+        if constexpr (detail::is_ordered_map<decltype(map_)>::value) {
+            auto const [first, last] = detail::ordered_range(map_, lower, upper, bounds);
+            return multiple_index_lookup_iter<document&, detail::deref_map_iter_second, map_iter_t>{first, last};
+        }
+        else
+            return lookup_if([&](bson const& key) { return detail::in_range(std::less<bson>{}, key, lower, upper, bounds); });
+    }
+
+    [[nodiscard]] const_cursor lookup_range(optional<bson const&> const lower, optional<bson const&> const upper, range_bounds const bounds = range_bounds::closed) const final {
+        if constexpr (detail::is_ordered_map<decltype(map_)>::value) {
+            auto const [first, last] = detail::ordered_range(map_, lower, upper, bounds);
+            return multiple_index_lookup_iter<document const&, detail::deref_map_iter_second, const_map_iter_t>{first, last};
+        }
+        else
+            return lookup_if([&](bson const& key) { return detail::in_range(std::less<bson>{}, key, lower, upper, bounds); });
+    }
+
     std::size_t erase(bson const& val) final {
-        return map_.erase(val);
+        if (multikey_) {
+            std::vector<document const*> erased;
+            for (auto [first, last] = map_.equal_range(val); first != last; ++first)
+                erased.push_back(first->second);
+            for (auto const doc : erased)
+                erase_doc(doc);
+            return erased.size();
+        }
+        for (auto [first, last] = map_.equal_range(val); first != last; ++first)
+            docs_.erase(first->second);
+        auto const count = map_.erase(val);
+        filter_erased();
+        return count;
     }
 
     bool erase(bson const& val, non_null_ptr<document const> const doc) final {
-        if (auto [first, last] = map_.equal_range(val); first != map_.end()) {
-            while (first != last) {
-                if (first->second == doc) {
-                    map_.erase(first);
-                    return true;
-                }
-                ++first;
-            }
+        if (detail::erase_map_entry(map_, val, doc)) {
+            if (multikey_)
+                erase_doc(doc);
+            else
+                docs_.erase(doc);
+            filter_erased();
+            return true;
         }
         return false;
     }
 
-    std::size_t erase_if(function_ref<bool(bson const&)> fn) final {
-        std::size_t count = 0;
-        for (auto it = map_.begin(); it != map_.end(); ++it) {
-            if (fn(it->first)) {
-                map_.erase(it);
-                ++count;
-            }
+    bool erase_doc(non_null_ptr<document const> const doc) final {
+        if (auto const it = docs_.find(doc); it != docs_.end()) {
+            detail::for_each_multikey_if(multikey_, it->second, [&](bson const& key) { detail::erase_map_entry(map_, key, doc); });
+            docs_.erase(it);
+            filter_erased();
+            return true;
         }
+        return false;
+    }
+
+    std::size_t erase_if(function_ref<bool(bson const&)> fn) final {
+        if (multikey_)
+            return detail::erase_docs_if(*this, map_, fn);
+        auto const count = detail::erase_map_if(map_, fn, [this](document const* const doc) { docs_.erase(doc); });
+        filter_erased();
         return count;
     }
 
@@ -500,9 +1497,16 @@ public:
 
     [[nodiscard]] std::size_t size() const noexcept  final { return map_.size(); }
 
+    [[nodiscard]] std::size_t document_count() const noexcept final { return docs_.size(); }
+    [[nodiscard]] bool ordered() const noexcept final { return detail::is_ordered_map<decltype(map_)>::value; }
+
     [[nodiscard]] constexpr std::size_t field_count() const noexcept final { return 1; }
 
-    void clear() final { map_.clear(); }
+    void clear() final {
+        map_.clear();
+        docs_.clear();
+        filter_erased();
+    }
 
     [[nodiscard]] function_ref<bool(bson const&)> value_filter() const noexcept final {
         return static_cast<Filter const&>(*this);
@@ -517,13 +1521,67 @@ public:
         return multiple_index_lookup_iter<typename sf_index_const_cursor::value_type, 
             detail::sf_const_cursor_deref, const_map_iter_t>{map_.cbegin(), map_.cend()};
     }
+
+private:
+    void rebuild_key_filter() final { key_filter_ = detail::make_key_filter(map_); }
 };
 
 template<template<class...> class MapT, std::size_t N, class Func, class Filter>
 class basic_compound_unique_index final : public compound_unique_index_interface, private detail::filter_wrapper<Filter> {
     MapT<std::array<bson, N>, non_null_ptr<document>, Func> map_;
+    detail::index_doc_map<std::array<bson, N>> docs_{};
     using map_iter_t = decltype(map_.begin());
     using const_map_iter_t = decltype(map_.cbegin());
+
+    // maps without heterogeneous lookup are searched with a copy of the key
+    [[nodiscard]] static auto lookup_key(span<bson const> const s) {
+        if constexpr (detail::supports_heterogeneous_lookup<decltype(map_)>::value)
+            return s;
+        else
+            return span_to_array<bson, N>(s);
+    }
+
+    [[nodiscard]] static auto lookup_key(span<non_null_ptr<bson const>> const s) {
+        if constexpr (detail::supports_heterogeneous_lookup<decltype(map_)>::value)
+            return s;
+        else
+            return span_to_array_deref<bson, N>(s);
+    }
+
+    // a document is refused when any of its keys is held by another document
+    index_insert_result insert_elements(std::array<bson, N> const& vals, non_null_ptr<document> const doc) {
+        bool passed = false;
+        bool taken = false;
+        auto const single_array = detail::for_each_multikey(vals, [&](std::array<bson, N> const& key) {
+            if (this->filter(span<bson const>{key})) {
+                passed = true;
+                taken = taken || map_.find(key) != map_.end();
+            }
+        });
+        if (!single_array)
+            return index_insert_result::parallel_arrays;
+        if (taken)
+            return index_insert_result::already_exists;
+        if (!passed)
+            return index_insert_result::filter_failed;
+        detail::for_each_multikey(vals, [&](std::array<bson, N> const& key) {
+            if (this->filter(span<bson const>{key}))
+                map_.try_emplace(key, doc);
+        });
+        docs_.insert_or_assign(doc, vals);
+        filter_insert(vals);
+        return index_insert_result::success;
+    }
+
+    void erase_entry(map_iter_t const it) {
+        document const* const doc = it->second;
+        map_.erase(it);
+        if (multikey_)
+            erase_doc(doc);
+        else
+            docs_.erase(doc);
+        filter_erased();
+    }
 public:
     basic_compound_unique_index() = default;
     ~basic_compound_unique_index() = default;
@@ -534,39 +1592,61 @@ public:
     {}
 
     [[nodiscard]] bool contains_doc(non_null_ptr<document const> const doc) const final {
-        for (auto&& [fields, doc_ptr] : map_) {
-            if (doc == doc_ptr)
-                return true;
-        }
-        return false;
+        return docs_.contains(doc);
     }
 
     index_insert_result insert(span<bson const> vals, non_null_ptr<document> const doc) final {
         DEBUG_ASSERT(vals.size() == N);
+        if (multikey_)
+            return insert_elements(span_to_array<bson, N>(vals), doc);
         if (this->filter(vals)) {
             auto const result = map_.try_emplace(span_to_array<bson, N>(vals), doc);
-            return result.second ? index_insert_result::success : index_insert_result::already_exists;
+            if (!result.second)
+                return index_insert_result::already_exists;
+            docs_.insert_or_assign(doc, result.first->first);
+            filter_insert(result.first->first);
+            return index_insert_result::success;
         }
         return index_insert_result::filter_failed;
     }
 
     index_insert_result insert(span<non_null_ptr<bson const>> vals, non_null_ptr<document> const doc) final {
         DEBUG_ASSERT(vals.size() == N);
+        if (multikey_)
+            return insert_elements(span_to_array_deref<bson, N>(vals), doc);
         if (this->filter(vals)) {
             auto const result = map_.try_emplace(span_to_array_deref<bson, N>(vals), doc);
-            return result.second ? index_insert_result::success : index_insert_result::already_exists;
+            if (!result.second)
+                return index_insert_result::already_exists;
+            docs_.insert_or_assign(doc, result.first->first);
+            filter_insert(result.first->first);
+            return index_insert_result::success;
         }
         return index_insert_result::filter_failed;
     }
 
+    std::size_t bulk_insert(span<non_null_ptr<bson const> const> const keys, span<non_null_ptr<document> const> const docs, std::size_t const max_threads = 1) final {
+        if (multikey_)
+            return detail::insert_each<N>(*this, keys, docs);
+        auto entries = detail::make_bulk_entries<N>(keys, docs, [this](auto&& key) { return this->filter(key); });
+        auto const count = detail::bulk_load<true>(map_, docs_, entries, max_threads);
+        if (key_filter_.enabled())
+            rebuild_key_filter();
+        return count;
+    }
+
     [[nodiscard]] lookup_result<span<bson const>, document> lookup_one(span<bson const> const s) final {
-        if (auto const found = map_.find(s); found != map_.end())
+        if (filter_excludes(s))
+            return {};
+        if (auto const found = map_.find(lookup_key(s)); found != map_.end())
             return {found->first, *(found->second)};
         return {};
     }
 
     [[nodiscard]] lookup_result<span<bson const>, document const> lookup_one(span<bson const> const s) const final {
-        if (auto const found = map_.find(s); found != map_.end())
+        if (filter_excludes(s))
+            return {};
+        if (auto const found = map_.find(lookup_key(s)); found != map_.end())
             return {found->first, *(found->second)};
         return {};
     }
@@ -597,24 +1677,98 @@ public:
             return multiple_index_lookup_vec{std::move(docs)};
     }
 
+    [[nodiscard]] cursor lookup_range(span<bson const> const lower, span<bson const> const upper, range_bounds const bounds = range_bounds::closed) final {
+        DEBUG_ASSERT(lower.size() <= N && upper.size() <= N);
+        if constexpr (detail::is_ordered_map<decltype(map_)>::value) {
+            auto const [first, last] = detail::ordered_range(map_, detail::range_bound(lower), detail::range_bound(upper), bounds);
+            return multiple_index_lookup_iter<document&, detail::deref_map_iter_second, map_iter_t>{first, last};
+        }
+        else
+            return lookup_if([&](span<bson const> const key) {
+                return detail::in_range(detail::compound_index_key_cmp{}, key, detail::range_bound(lower), detail::range_bound(upper), bounds);
+            });
+    }
+
+    [[nodiscard]] const_cursor lookup_range(span<bson const> const lower, span<bson const> const upper, range_bounds const bounds = range_bounds::closed) const final {
+        DEBUG_ASSERT(lower.size() <= N && upper.size() <= N);
+        if constexpr (detail::is_ordered_map<decltype(map_)>::value) {
+            auto const [first, last] = detail::ordered_range(map_, detail::range_bound(lower), detail::range_bound(upper), bounds);
+            return multiple_index_lookup_iter<document const&, detail::deref_map_iter_second, const_map_iter_t>{first, last};
+        }
+        else
+            return lookup_if([&](span<bson const> const key) {
+                return detail::in_range(detail::compound_index_key_cmp{}, key, detail::range_bound(lower), detail::range_bound(upper), bounds);
+            });
+    }
+
+    [[nodiscard]] cursor lookup_prefix(span<bson const> const prefix) final {
+        DEBUG_ASSERT(prefix.size() <= N);
+        if (prefix.size() == N) { // a full key is found directly, hashed indices included
+            if (auto const found = lookup_one(prefix); found)
+                return single_index_lookup{non_null_ptr<document>{std::addressof(found.value())}};
+            return zero_index_lookup<document>;
+        }
+        return lookup_range(prefix, prefix);
+    }
+
+    [[nodiscard]] const_cursor lookup_prefix(span<bson const> const prefix) const final {
+        DEBUG_ASSERT(prefix.size() <= N);
+        if (prefix.size() == N) { // a full key is found directly, hashed indices included
+            if (auto const found = lookup_one(prefix); found)
+                return single_index_lookup{non_null_ptr<document const>{std::addressof(found.value())}};
+            return zero_index_lookup<document const>;
+        }
+        return lookup_range(prefix, prefix);
+    }
+
+    [[nodiscard]] cursor lookup_prefix_range(span<bson const> const prefix, optional<bson const&> const lower, optional<bson const&> const upper, range_bounds const bounds = range_bounds::closed) final {
+        DEBUG_ASSERT(prefix.size() < N);
+        detail::prefix_range const range{prefix, lower, upper, bounds};
+        return lookup_range(span<bson const>{range.lower}, span<bson const>{range.upper}, range.bounds);
+    }
+
+    [[nodiscard]] const_cursor lookup_prefix_range(span<bson const> const prefix, optional<bson const&> const lower, optional<bson const&> const upper, range_bounds const bounds = range_bounds::closed) const final {
+        DEBUG_ASSERT(prefix.size() < N);
+        detail::prefix_range const range{prefix, lower, upper, bounds};
+        return lookup_range(span<bson const>{range.lower}, span<bson const>{range.upper}, range.bounds);
+    }
+
     std::size_t erase(span<bson const> s) final {
         DEBUG_ASSERT(s.size() == N);
-        return map_.erase(span_to_array<bson, N>(s));
+        if (auto const it = map_.find(lookup_key(s)); it != map_.end()) {
+            erase_entry(it);
+            return 1;
+        }
+        return 0;
     }
 
     std::size_t erase(span<non_null_ptr<bson const>> const s) final {
         DEBUG_ASSERT(s.size() == N);
-        return map_.erase(span_to_array_deref<bson, N>(s));
+        if (auto const it = map_.find(lookup_key(s)); it != map_.end()) {
+            erase_entry(it);
+            return 1;
+        }
+        return 0;
+    }
+
+    bool erase_doc(non_null_ptr<document const> const doc) final {
+        if (auto const it = docs_.find(doc); it != docs_.end()) {
+            detail::for_each_multikey_if(multikey_, it->second, [&](std::array<bson, N> const& key) {
+                if (auto const found = map_.find(key); found != map_.end() && found->second == doc)
+                    map_.erase(found);
+            });
+            docs_.erase(it);
+            filter_erased();
+            return true;
+        }
+        return false;
     }
 
     std::size_t erase_if(function_ref<bool(span<bson const>)> fn) final {
-        std::size_t count = 0;
-        for (auto it = map_.begin(); it != map_.end(); ++it) {
-            if (fn(it->first)) {
-                map_.erase(it);
-                ++count;
-            }
-        }
+        if (multikey_)
+            return detail::erase_docs_if(*this, map_, fn);
+        auto const count = detail::erase_map_if(map_, fn, [this](document const* const doc) { docs_.erase(doc); });
+        filter_erased();
         return count;
     }
 
@@ -622,9 +1776,16 @@ public:
 
     [[nodiscard]] std::size_t size() const noexcept final { return map_.size(); }
 
+    [[nodiscard]] std::size_t document_count() const noexcept final { return docs_.size(); }
+    [[nodiscard]] bool ordered() const noexcept final { return detail::is_ordered_map<decltype(map_)>::value; }
+
     [[nodiscard]] std::size_t field_count() const noexcept final { return N; }
 
-    void clear() final { map_.clear(); }
+    void clear() final {
+        map_.clear();
+        docs_.clear();
+        filter_erased();
+    }
 
     [[nodiscard]] function_ref<bool(span<bson const>)> value_filter() const noexcept final {
         return static_cast<Filter const&>(*this);
@@ -639,13 +1800,67 @@ public:
         return multiple_index_lookup_iter<typename cmp_index_const_cursor::value_type, 
             detail::cmp_const_cursor_deref, const_map_iter_t>{map_.cbegin(), map_.cend()};
     }
+
+private:
+    void rebuild_key_filter() final { key_filter_ = detail::make_key_filter(map_); }
 };
 
 template<template<class...> class MapT, std::size_t N, class Func, class Filter>
 class basic_compound_multi_index final : public compound_multi_index_interface, private detail::filter_wrapper<Filter> {
     MapT<std::array<bson, N>, non_null_ptr<document>, Func> map_;
+    detail::index_doc_map<std::array<bson, N>> docs_{};
     using map_iter_t = decltype(map_.begin());
     using const_map_iter_t = decltype(map_.cbegin());
+
+    // maps without heterogeneous lookup are searched with a copy of the key
+    [[nodiscard]] static auto lookup_key(span<bson const> const s) {
+        if constexpr (detail::supports_heterogeneous_lookup<decltype(map_)>::value)
+            return s;
+        else
+            return span_to_array<bson, N>(s);
+    }
+
+    [[nodiscard]] static auto lookup_key(span<non_null_ptr<bson const>> const s) {
+        if constexpr (detail::supports_heterogeneous_lookup<decltype(map_)>::value)
+            return s;
+        else
+            return span_to_array_deref<bson, N>(s);
+    }
+
+    index_insert_result insert_elements(std::array<bson, N> const& vals, non_null_ptr<document> const doc) {
+        bool passed = false;
+        auto const single_array = detail::for_each_multikey(vals, [&](std::array<bson, N> const& key) {
+            if (this->filter(span<bson const>{key})) {
+                map_.emplace(key, doc);
+                passed = true;
+            }
+        });
+        if (!single_array)
+            return index_insert_result::parallel_arrays;
+        if (!passed)
+            return index_insert_result::filter_failed;
+        docs_.insert_or_assign(doc, vals);
+        filter_insert(vals);
+        return index_insert_result::success;
+    }
+
+    // erases the entries of [first, last), with the other entries of their documents in a multikey index
+    std::size_t erase_range(map_iter_t const first, map_iter_t const last) {
+        if (multikey_) {
+            std::vector<document const*> erased;
+            for (auto it = first; it != last; ++it)
+                erased.push_back(it->second);
+            for (auto const doc : erased)
+                erase_doc(doc);
+            return erased.size();
+        }
+        std::size_t count = 0;
+        for (auto it = first; it != last; ++it, ++count)
+            docs_.erase(it->second);
+        map_.erase(first, last);
+        filter_erased();
+        return count;
+    }
 public: 
     basic_compound_multi_index() = default;
     ~basic_compound_multi_index() = default;
@@ -656,17 +1871,17 @@ public:
     {}
 
     [[nodiscard]] bool contains_doc(non_null_ptr<document const> const doc) const final {
-        for (auto&& [fields, doc_ptr] : map_) {
-            if (doc == doc_ptr)
-                return true;
-        }
-        return false;
+        return docs_.contains(doc);
     }
 
     index_insert_result insert(span<bson const> vals, non_null_ptr<document> const doc) final {
         DEBUG_ASSERT(vals.size() == N);
+        if (multikey_)
+            return insert_elements(span_to_array<bson, N>(vals), doc);
         if (this->filter(vals)) {
-            map_.emplace(std::make_pair(span_to_array<bson, N>(vals), doc));
+            auto const it = map_.emplace(std::make_pair(span_to_array<bson, N>(vals), doc));
+            docs_.insert_or_assign(doc, it->first);
+            filter_insert(it->first);
             return index_insert_result::success;
         }
         return index_insert_result::filter_failed;
@@ -674,33 +1889,55 @@ public:
 
     index_insert_result insert(span<non_null_ptr<bson const>> vals, non_null_ptr<document> const doc) final {
         DEBUG_ASSERT(vals.size() == N);
+        if (multikey_)
+            return insert_elements(span_to_array_deref<bson, N>(vals), doc);
         if (this->filter(vals)) {
-            map_.emplace(std::make_pair(span_to_array_deref<bson, N>(vals), doc));
+            auto const it = map_.emplace(std::make_pair(span_to_array_deref<bson, N>(vals), doc));
+            docs_.insert_or_assign(doc, it->first);
+            filter_insert(it->first);
             return index_insert_result::success;
         }
         return index_insert_result::filter_failed;
     }
 
+    std::size_t bulk_insert(span<non_null_ptr<bson const> const> const keys, span<non_null_ptr<document> const> const docs, std::size_t const max_threads = 1) final {
+        if (multikey_)
+            return detail::insert_each<N>(*this, keys, docs);
+        auto entries = detail::make_bulk_entries<N>(keys, docs, [this](auto&& key) { return this->filter(key); });
+        auto const count = detail::bulk_load<false>(map_, docs_, entries, max_threads);
+        if (key_filter_.enabled())
+            rebuild_key_filter();
+        return count;
+    }
+
     [[nodiscard]] lookup_result<span<bson const>, document> lookup_one(span<bson const> const vals) final {
-        if (auto const found = map_.find(vals); found != map_.end())
+        if (filter_excludes(vals))
+            return {};
+        if (auto const found = map_.find(lookup_key(vals)); found != map_.end())
             return {found->first, *(found->second)};
         return {};
     }
 
     [[nodiscard]] lookup_result<span<bson const>, document const> lookup_one(span<bson const> const vals) const final {
-        if (auto const found = map_.find(vals); found != map_.end())
+        if (filter_excludes(vals))
+            return {};
+        if (auto const found = map_.find(lookup_key(vals)); found != map_.end())
             return {found->first, *(found->second)};
         return {};
     }
 
     [[nodiscard]] cursor lookup_many(span<bson const> const vals) final {
-        if (auto const [first, last] = map_.equal_range(vals); first != map_.end())
+        if (filter_excludes(vals))
+            return zero_index_lookup<document>;
+        if (auto const [first, last] = map_.equal_range(lookup_key(vals)); first != map_.end())
             return multiple_index_lookup_iter<document&, detail::deref_map_iter_second, map_iter_t>{first, last};
         return zero_index_lookup<document>;
     }
 
     [[nodiscard]] const_cursor lookup_many(span<bson const> const vals) const final {
-        if (auto const [first, last] = map_.equal_range(vals); first != map_.end())
+        if (filter_excludes(vals))
+            return zero_index_lookup<document const>;
+        if (auto const [first, last] = map_.equal_range(lookup_key(vals)); first != map_.end())
             return multiple_index_lookup_iter<document const&, detail::deref_map_iter_second, const_map_iter_t>{first, last};
         return zero_index_lookup<document const>;
     }
@@ -731,50 +1968,107 @@ public:
             return multiple_index_lookup_vec{std::move(docs)};
     }
 
-    std::size_t erase(span<bson const> s) final { // todo maybe take span<bson*> to avoid copy
+    [[nodiscard]] cursor lookup_range(span<bson const> const lower, span<bson const> const upper, range_bounds const bounds = range_bounds::closed) final {
+        DEBUG_ASSERT(lower.size() <= N && upper.size() <= N);
+        if constexpr (detail::is_ordered_map<decltype(map_)>::value) {
+            auto const [first, last] = detail::ordered_range(map_, detail::range_bound(lower), detail::range_bound(upper), bounds);
+            return multiple_index_lookup_iter<document&, detail::deref_map_iter_second, map_iter_t>{first, last};
+        }
+        else
+            return lookup_if([&](span<bson const> const key) {
+                return detail::in_range(detail::compound_index_key_cmp{}, key, detail::range_bound(lower), detail::range_bound(upper), bounds);
+            });
+    }
+
+    [[nodiscard]] const_cursor lookup_range(span<bson const> const lower, span<bson const> const upper, range_bounds const bounds = range_bounds::closed) const final {
+        DEBUG_ASSERT(lower.size() <= N && upper.size() <= N);
+        if constexpr (detail::is_ordered_map<decltype(map_)>::value) {
+            auto const [first, last] = detail::ordered_range(map_, detail::range_bound(lower), detail::range_bound(upper), bounds);
+            return multiple_index_lookup_iter<document const&, detail::deref_map_iter_second, const_map_iter_t>{first, last};
+        }
+        else
+            return lookup_if([&](span<bson const> const key) {
+                return detail::in_range(detail::compound_index_key_cmp{}, key, detail::range_bound(lower), detail::range_bound(upper), bounds);
+            });
+    }
+
+    [[nodiscard]] cursor lookup_prefix(span<bson const> const prefix) final {
+        DEBUG_ASSERT(prefix.size() <= N);
+        if (prefix.size() == N) // a full key is found directly, hashed indices included
+            return lookup_many(prefix);
+        return lookup_range(prefix, prefix);
+    }
+
+    [[nodiscard]] const_cursor lookup_prefix(span<bson const> const prefix) const final {
+        DEBUG_ASSERT(prefix.size() <= N);
+        if (prefix.size() == N) // a full key is found directly, hashed indices included
+            return lookup_many(prefix);
+        return lookup_range(prefix, prefix);
+    }
+
+    [[nodiscard]] cursor lookup_prefix_range(span<bson const> const prefix, optional<bson const&> const lower, optional<bson const&> const upper, range_bounds const bounds = range_bounds::closed) final {
+        DEBUG_ASSERT(prefix.size() < N);
+        detail::prefix_range const range{prefix, lower, upper, bounds};
+        return lookup_range(span<bson const>{range.lower}, span<bson const>{range.upper}, range.bounds);
+    }
+
+    [[nodiscard]] const_cursor lookup_prefix_range(span<bson const> const prefix, optional<bson const&> const lower, optional<bson const&> const upper, range_bounds const bounds = range_bounds::closed) const final {
+        DEBUG_ASSERT(prefix.size() < N);
+        detail::prefix_range const range{prefix, lower, upper, bounds};
+        return lookup_range(span<bson const>{range.lower}, span<bson const>{range.upper}, range.bounds);
+    }
+
+    std::size_t erase(span<bson const> s) final {
         DEBUG_ASSERT(s.size() == N);
-        return map_.erase(span_to_array<bson, N>(s)); // return array<bson*> ????
+        auto const [first, last] = map_.equal_range(lookup_key(s));
+        return erase_range(first, last);
     }
 
     std::size_t erase(span<non_null_ptr<bson const>> const s) final {
         DEBUG_ASSERT(s.size() == N);
-        return map_.erase(span_to_array_deref<bson, N>(s));
+        auto const [first, last] = map_.equal_range(lookup_key(s));
+        return erase_range(first, last);
     }
 
     bool erase(span<bson const> const vals, non_null_ptr<document const> const doc) final {
-        if (auto [first, last] = map_.equal_range(vals); first != map_.end()) {
-            while (first != last) {
-                if (first->second == doc) {
-                    map_.erase(first);
-                    return true;
-                }
-                ++first;
-            }
+        if (detail::erase_map_entry(map_, lookup_key(vals), doc)) {
+            if (multikey_)
+                erase_doc(doc);
+            else
+                docs_.erase(doc);
+            filter_erased();
+            return true;
         }
         return false;
     }
 
     bool erase(span<non_null_ptr<bson const>> const vals, non_null_ptr<document const> const doc) final {
-        if (auto [first, last] = map_.equal_range(vals); first != map_.end()) {
-            while (first != last) {
-                if (first->second == doc) {
-                    map_.erase(first);
-                    return true;
-                }
-                ++first;
-            }
+        if (detail::erase_map_entry(map_, lookup_key(vals), doc)) {
+            if (multikey_)
+                erase_doc(doc);
+            else
+                docs_.erase(doc);
+            filter_erased();
+            return true;
         }
         return false;
     }
 
-    std::size_t erase_if(function_ref<bool(span<bson const>)> fn) final {
-        std::size_t count = 0;
-        for (auto it = map_.begin(); it != map_.end(); ++it) {
-            if (fn(it->first)) {
-                map_.erase(it);
-                ++count;
-            }
+    bool erase_doc(non_null_ptr<document const> const doc) final {
+        if (auto const it = docs_.find(doc); it != docs_.end()) {
+            detail::for_each_multikey_if(multikey_, it->second, [&](std::array<bson, N> const& key) { detail::erase_map_entry(map_, key, doc); });
+            docs_.erase(it);
+            filter_erased();
+            return true;
         }
+        return false;
+    }
+
+    std::size_t erase_if(function_ref<bool(span<bson const>)> fn) final {
+        if (multikey_)
+            return detail::erase_docs_if(*this, map_, fn);
+        auto const count = detail::erase_map_if(map_, fn, [this](document const* const doc) { docs_.erase(doc); });
+        filter_erased();
         return count;
     }
 
@@ -782,9 +2076,16 @@ public:
 
     [[nodiscard]] std::size_t size() const noexcept  final { return map_.size(); }
 
+    [[nodiscard]] std::size_t document_count() const noexcept final { return docs_.size(); }
+    [[nodiscard]] bool ordered() const noexcept final { return detail::is_ordered_map<decltype(map_)>::value; }
+
     [[nodiscard]] std::size_t field_count() const noexcept final { return N; }
 
-    void clear() final { map_.clear(); }
+    void clear() final {
+        map_.clear();
+        docs_.clear();
+        filter_erased();
+    }
 
     [[nodiscard]] function_ref<bool(span<bson const>)> value_filter() const noexcept final {
         return static_cast<Filter const&>(*this);
@@ -799,35 +2100,66 @@ public:
         return multiple_index_lookup_iter<typename cmp_index_const_cursor::value_type, 
             detail::cmp_const_cursor_deref, const_map_iter_t>{map_.cbegin(), map_.cend()};
     }
+
+private:
+    void rebuild_key_filter() final { key_filter_ = detail::make_key_filter(map_); }
 };
 
 } // namespace nova
 
 namespace std {
+    template<class Doc>
+    struct tuple_size<nova::sf_index_entry<Doc>> : std::integral_constant<std::size_t, 2> {};
+
+    template<class Doc>
+    struct tuple_element<0, nova::sf_index_entry<Doc>> { using type = nova::bson const&; };
+
+    template<class Doc>
+    struct tuple_element<1, nova::sf_index_entry<Doc>> { using type = nova::non_null_ptr<Doc>; };
+
     template<std::size_t N>
     struct hash<std::array<nova::bson, N>> {
-        [[nodiscard]] constexpr std::size_t operator()(std::array<nova::bson, N> const& arr) const noexcept {
-            std::size_t hash{};
-            for (auto&& val : arr)
-                hash += std::hash<nova::bson>{}(val);
-            return hash;
+        [[nodiscard]] std::size_t operator()(std::array<nova::bson, N> const& arr) const noexcept {
+            return nova::detail::index_key_hash{}(arr);
         }
     };
 } // namespace std
 
 namespace nova {
 
+// The entries of ordered multi indices are ordered by key, then by document, see detail::index_entry_less.
+template<class K, class V, class Cmp = std::less<K>>
+using index_btree_multimap = absl::btree_multiset<std::pair<K, V>, detail::index_entry_less<Cmp>>;
+
 template<class Filter = detail::no_filter>
 using ordered_single_field_unique_index = basic_single_field_unique_index<absl::btree_map, Filter>;
 
 template<class Filter = detail::no_filter>
-using ordered_single_field_multi_index = basic_single_field_multi_index<absl::btree_multimap, Filter>;
+using ordered_single_field_multi_index = basic_single_field_multi_index<index_btree_multimap, Filter>;
 
 template<std::size_t N, class Filter = detail::no_filter>
 using ordered_compound_unique_index = basic_compound_unique_index<absl::btree_map, N, detail::compound_index_key_cmp, Filter>;
 
 template<std::size_t N, class Filter = detail::no_filter>
-using ordered_compound_multi_index = basic_compound_multi_index<absl::btree_multimap, N, detail::compound_index_key_cmp, Filter>;
+using ordered_compound_multi_index = basic_compound_multi_index<index_btree_multimap, N, detail::compound_index_key_cmp, Filter>;
+
+template<class K, class V, class Hash = detail::index_key_hash>
+using index_hash_map = absl::flat_hash_map<K, V, Hash, detail::index_key_eq>;
+
+template<class K, class V, class Hash = detail::index_key_hash>
+using index_hash_multimap = detail::index_hash_multimap<K, V, Hash>;
+
+template<class Filter = detail::no_filter>
+using hashed_single_field_unique_index = basic_single_field_unique_index<index_hash_map, Filter>;
+
+template<class Filter = detail::no_filter>
+using hashed_single_field_multi_index = basic_single_field_multi_index<index_hash_multimap, Filter>;
+
+template<std::size_t N, class Filter = detail::no_filter>
+using hashed_compound_unique_index = basic_compound_unique_index<index_hash_map, N, detail::index_key_hash, Filter>;
+
+template<std::size_t N, class Filter = detail::no_filter>
+using hashed_compound_multi_index = basic_compound_multi_index<index_hash_multimap, N, detail::index_key_hash, Filter>;
 
 } // namespace nova
 
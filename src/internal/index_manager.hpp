@@ -4,17 +4,30 @@
 #include <absl/container/btree_map.h>
 #include <absl/container/flat_hash_map.h>
 
+#include "bitmap_index.hpp"
 #include "detail.hpp"
+#include "field_path.hpp"
 #include "index.hpp"
+#include "index_stats.hpp"
+#include "spatial_index.hpp"
+#include "text_index.hpp"
+#include "util/bitmap.hpp"
 #include "util/multi_string.hpp"
 #include "util/non_null_ptr.hpp"
+#include "util/span.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <iostream>
+#include <limits>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <tuple>
+#include <utility>
+#include <variant>
 #include <vector>
 
 namespace nova {
@@ -44,7 +57,7 @@ struct compound_index_map_compare {
         return false;
     }
 
-    template<class... Views, std::size_t I>
+    template<std::size_t I, class... Views>
     bool tpl_cmp_impl(multi_string const& ms, std::tuple<Views...> const& tpl, std::size_t const min) const noexcept {
         if constexpr (I == sizeof...(Views))
             return false;
@@ -57,7 +70,7 @@ struct compound_index_map_compare {
         }
     }
 
-    template<class... Views, std::size_t I>
+    template<std::size_t I, class... Views>
     bool tpl_cmp_impl(std::tuple<Views...> const& tpl, multi_string const& ms, std::size_t const min) const noexcept {
         if constexpr (I == sizeof...(Views))
             return false;
@@ -72,15 +85,54 @@ struct compound_index_map_compare {
 
     template<class... Views>
     bool operator()(multi_string const& ms, std::tuple<Views...> const& tpl) const noexcept {
-        return tpl_cmp_impl<0>(ms, tpl, std::min(ms.size(), std::tuple_size_v<decltype(tpl)>));
+        return tpl_cmp_impl<0>(ms, tpl, std::min(ms.size(), sizeof...(Views)));
     }
 
     template<class... Views>
     bool operator()(std::tuple<Views...> const& tpl, multi_string const& ms) const noexcept {
-        return tpl_cmp_impl<0>(tpl, ms, std::min(ms.size(), std::tuple_size_v<decltype(tpl)>));
+        return tpl_cmp_impl<0>(tpl, ms, std::min(ms.size(), sizeof...(Views)));
+    }
+
+    bool operator()(multi_string const& ms, span<std::string_view const> const fields) const noexcept {
+        auto const min = std::min(ms.size(), fields.size());
+        for (std::size_t i = 0; i < min; ++i) {
+            if (ms[i] == fields[i])
+                continue;
+            return ms[i] < fields[i];
+        }
+        return false;
+    }
+
+    bool operator()(span<std::string_view const> const fields, multi_string const& ms) const noexcept {
+        auto const min = std::min(ms.size(), fields.size());
+        for (std::size_t i = 0; i < min; ++i) {
+            if (fields[i] == ms[i])
+                continue;
+            return fields[i] < ms[i];
+        }
+        return false;
     }
 };
 
+// return: the index of `index_map` over the fewest fields whose leading fields are the `count` fields of `fields`,
+// an index over exactly those fields if there is one. Indices `accept(fields, index)` refuses are passed over.
+template<class Map, class Fields, class Accept>
+[[nodiscard]] auto find_leading(Map& index_map, Fields const& fields, std::size_t const count, Accept&& accept) {
+    // fields are compared up to the shorter of two field lists, so an index over more fields compares equal
+    auto [first, last] = index_map.equal_range(fields);
+    auto best = index_map.end();
+    for (; first != last; ++first)
+        if (first->first.size() >= count && (best == index_map.end() || first->first.size() < best->first.size())
+            && accept(first->first, *first->second))
+            best = first;
+    return best;
+}
+
+template<class Map, class Fields>
+[[nodiscard]] auto find_leading(Map& index_map, Fields const& fields, std::size_t const count) {
+    return find_leading(index_map, fields, count, [](auto const&, auto const&) { return true; });
+}
+
 template<class Base, class Derived, class... Args>
 class lazy_allocation {
     std::tuple<Args...> args_;
@@ -100,6 +152,74 @@ public:
 template<class B, class D, class... Args>
 lazy_allocation(Args...) -> lazy_allocation<B, D, Args...>;
 
+// splits the fields of an index, a single field or the fields of a compound index, into paths
+template<class Fields>
+[[nodiscard]] std::vector<field_path> make_paths(Fields const& fields) {
+    std::vector<field_path> paths;
+    if constexpr (std::is_convertible_v<Fields const&, std::string_view>)
+        paths.emplace_back(std::string_view{fields});
+    else
+        for (auto&& field : fields)
+            paths.emplace_back(std::string_view{field});
+    return paths;
+}
+
+// Appends the values `doc` holds at `paths` to `keys`.
+// return: whether `doc` holds every path, `keys` is left as it was otherwise
+inline bool lookup_paths(document& doc, span<field_path const> const paths, std::vector<non_null_ptr<bson const>>& keys) {
+    auto const size = keys.size();
+    for (auto&& path : paths) {
+        auto const found = doc.values().lookup(path);
+        if (!found) {
+            keys.erase(keys.begin() + static_cast<std::ptrdiff_t>(size), keys.end());
+            return false;
+        }
+        keys.push_back(std::addressof(found.value()));
+    }
+    return true;
+}
+
+// return: whether `doc` holds `val` at `path`, as an element of an array as well for a multikey index
+inline bool holds_value(document const& doc, field_path const& path, bool const multikey, bson const& val) {
+    auto const found = doc.values().lookup(path);
+    if (!found)
+        return false;
+    if (found.value() == val)
+        return true;
+    if (auto const arr = found.value().as<bson::array_t>(); multikey && arr)
+        return std::find(arr->begin(), arr->end(), val) != arr->end();
+    return false;
+}
+
+// Intersects the documents of `cursors`, each holding a document once at most.
+// The smallest cursor gives the candidates. Every other cursor, smallest first, marks the candidates it holds in a
+// bitmap and the unmarked ones are dropped, so no cursor is checked against more candidates than the smallest holds,
+// and the intersection stops once none are left.
+// return: the documents held by every cursor, in the order of the smallest
+inline std::vector<document const*> intersect_cursors(std::vector<const_cursor>& cursors) {
+    DEBUG_ASSERT(!cursors.empty());
+    std::sort(cursors.begin(), cursors.end(), [](const_cursor const& a, const_cursor const& b) { return a.size() < b.size(); });
+    std::vector<document const*> candidates;
+    candidates.reserve(cursors[0].size());
+    for (auto&& doc : cursors[0])
+        candidates.push_back(std::addressof(doc));
+
+    for (std::size_t i = 1; i < cursors.size() && !candidates.empty(); ++i) {
+        absl::flat_hash_map<document const*, std::size_t> positions;
+        positions.reserve(candidates.size());
+        for (std::size_t j = 0; j < candidates.size(); ++j)
+            positions.emplace(candidates[j], j);
+        bitmap held(candidates.size());
+        for (auto&& doc : cursors[i])
+            if (auto const found = positions.find(std::addressof(doc)); found != positions.end())
+                held.set(found->second);
+        std::size_t kept = 0;
+        held.for_each_set([&](std::size_t const j) { candidates[kept++] = candidates[j]; });
+        candidates.erase(candidates.begin() + static_cast<std::ptrdiff_t>(kept), candidates.end());
+    }
+    return candidates;
+}
+
 } // namespace detail
 
 template<class Index>
@@ -120,14 +240,50 @@ class index_manager {
     single_field_index_map<single_field_multi_index_interface> single_field_multi_indices_{};
     compound_index_map<compound_unique_index_interface> compound_unique_indices_{};
     compound_index_map<compound_multi_index_interface> compound_multi_indices_{};
+    single_field_index_map<text_index> text_indices_{};
+    std::vector<std::unique_ptr<spatial_index>> spatial_indices_{};
+    single_field_index_map<bitmap_index> bitmap_indices_{};
+    // held apart so the bitmap indices referring to them survive the manager being moved
+    std::unique_ptr<document_ordinals> ordinals_ = std::make_unique<document_ordinals>();
+    bool key_filters_ = false;
+
+    struct cached_stats {
+        index_stats stats;
+        std::size_t changes = 0; // `changes_` when the statistics were gathered
+    };
+
+    // statistics are gathered again once a tenth as many documents as the index held have been registered or removed since
+    inline static constexpr std::size_t stats_refresh_ratio = 10;
+
+    absl::flat_hash_map<void const*, cached_stats> stats_{};
+    std::size_t changes_ = 0; // documents registered and removed
+
+    // return: the statistics of `index`, gathered by `collect()` unless those gathered before are recent enough
+    template<class Index, class Collect>
+    index_stats const& cached_statistics(Index const& index, std::size_t const document_count, Collect&& collect) {
+        auto [it, added] = stats_.try_emplace(std::addressof(index));
+        auto& cached = it->second;
+        auto const held = std::max(cached.stats.entries, cached.stats.documents);
+        if (added || (changes_ - cached.changes) * stats_refresh_ratio > held) {
+            cached.stats = collect();
+            cached.changes = changes_;
+        }
+        cached.stats.missing = document_count > cached.stats.documents ? document_count - cached.stats.documents : 0;
+        return cached.stats;
+    }
 public:
     index_manager() = default;
     index_manager(index_manager&&) = default;
     index_manager& operator=(index_manager&&) = default;
 
-    template<bool Unique, class Filter = detail::no_filter, class... Fields, 
+    // indices of either kind over the same fields are found by `lookup` alike
+    template<bool Unique, class Filter = detail::no_filter, index_kind Kind = index_kind::ordered, class... Fields, 
              std::enable_if_t<std::conjunction_v<std::is_constructible<std::string, Fields>...>, int> = 0>
     decltype(auto) create_index(Fields&&... fields) {
+        static_assert(Kind != index_kind::text, "text indices are created by create_text_index");
+        static_assert(Kind != index_kind::spatial, "spatial indices are created by create_spatial_index");
+        static_assert(Kind != index_kind::bitmap, "bitmap indices are created by create_bitmap_index");
+        constexpr bool ordered = Kind == index_kind::ordered;
 
         if constexpr (sizeof...(Fields) == 0) {
             static_assert(detail::always_false<Filter>::value, "index must reference at least 1 document field");
@@ -135,22 +291,28 @@ public:
         else if constexpr (sizeof...(Fields) == 1) { // single field index
             if constexpr (Unique) {
                 using base_t = single_field_unique_index_interface;
-                using derived_t = ordered_single_field_unique_index<Filter>;
+                using derived_t = std::conditional_t<ordered, ordered_single_field_unique_index<Filter>, hashed_single_field_unique_index<Filter>>;
                 using result_t = lookup_result<std::string, derived_t>;
 
                 if (!single_field_multi_indices_.contains(fields...))
-                    if (auto const [it, b] = single_field_unique_indices_.try_emplace(std::forward<Fields>(fields)..., detail::lazy_allocation<base_t, derived_t>{}); b)
-                        return result_t{it->first, *static_cast<derived_t*>(it->second.get())}; 
+                    if (auto const [it, b] = single_field_unique_indices_.try_emplace(std::forward<Fields>(fields)..., detail::lazy_allocation<base_t, derived_t>{}); b) {
+                        it->second->set_paths(detail::make_paths(it->first));
+                        it->second->set_key_filter(key_filters_);
+                        return result_t{it->first, *static_cast<derived_t*>(it->second.get())};
+                    }
                 return result_t{};
             }
             else { // multi
                 using base_t = single_field_multi_index_interface;
-                using derived_t = ordered_single_field_multi_index<Filter>;
+                using derived_t = std::conditional_t<ordered, ordered_single_field_multi_index<Filter>, hashed_single_field_multi_index<Filter>>;
                 using result_t = lookup_result<std::string, derived_t>;
 
                 if (!single_field_unique_indices_.contains(fields...))
-                    if (auto const [it, b] = single_field_multi_indices_.try_emplace(std::forward<Fields>(fields)..., detail::lazy_allocation<base_t, derived_t>{}); b)
-                        return result_t{it->first, *static_cast<derived_t*>(it->second.get())}; 
+                    if (auto const [it, b] = single_field_multi_indices_.try_emplace(std::forward<Fields>(fields)..., detail::lazy_allocation<base_t, derived_t>{}); b) {
+                        it->second->set_paths(detail::make_paths(it->first));
+                        it->second->set_key_filter(key_filters_);
+                        return result_t{it->first, *static_cast<derived_t*>(it->second.get())};
+                    }
                 return result_t{};
             }
         } 
@@ -158,7 +320,8 @@ public:
             multi_string fields_string(std::forward<Fields>(fields)...);
             if constexpr (Unique) {
                 using base_t = compound_unique_index_interface;
-                using derived_t = ordered_compound_unique_index<sizeof...(Fields), Filter>;
+                using derived_t = std::conditional_t<ordered, ordered_compound_unique_index<sizeof...(Fields), Filter>,
+                                                                 hashed_compound_unique_index<sizeof...(Fields), Filter>>;
                 using result_t = lookup_result<multi_string, derived_t>;
 
                 if (auto const [first, last] = compound_multi_indices_.equal_range(fields_string)
@@ -168,6 +331,8 @@ public:
                         std::piecewise_construct,
                         std::forward_as_tuple(std::move(fields_string)),
                         std::forward_as_tuple(std::unique_ptr<base_t>((base_t*) new derived_t())));
+                    it->second->set_paths(detail::make_paths(it->first));
+                    it->second->set_key_filter(key_filters_);
 
                     return result_t{it->first, *reinterpret_cast<derived_t*>(it->second.get())};
                 }
@@ -175,7 +340,8 @@ public:
             }
             else { // multi
                 using base_t = compound_multi_index_interface;
-                using derived_t = ordered_compound_multi_index<sizeof...(Fields), Filter>;
+                using derived_t = std::conditional_t<ordered, ordered_compound_multi_index<sizeof...(Fields), Filter>,
+                                                                 hashed_compound_multi_index<sizeof...(Fields), Filter>>;
                 using result_t = lookup_result<multi_string, derived_t>;
 
                 if (auto const [first, last] = compound_unique_indices_.equal_range(fields_string)
@@ -185,6 +351,8 @@ public:
                         std::piecewise_construct,
                         std::forward_as_tuple(std::move(fields_string)),
                         std::forward_as_tuple(std::unique_ptr<base_t>((base_t*) new derived_t())));
+                    it->second->set_paths(detail::make_paths(it->first));
+                    it->second->set_key_filter(key_filters_);
 
                     return result_t{it->first, *reinterpret_cast<derived_t*>(it->second.get())};
                 }
@@ -193,66 +361,171 @@ public:
         }
     }
 
-    // remove a document from all indices held.
-    // precondition: the document *must* have been previously inserted
-    void remove_document(document const& doc) {
-        for (auto&& [field, index] : single_field_unique_indices_) {
-            if (auto const value = doc.values().lookup(field); value) {
-                DEBUG_ASSERT(index->contains_doc(std::addressof(doc)));
-                index->erase(value.value());
-            }
-        }
+    // Attaches a key filter to every index of single field or compound keys, and to those created later, or drops them.
+    // Lookups of keys an index does not hold then mostly return without probing the index.
+    void set_key_filters(bool const enabled) {
+        key_filters_ = enabled;
+        auto set_for = [enabled](auto&& index_map) {
+            for (auto&& [fields, index] : index_map)
+                index->set_key_filter(enabled);
+        };
 
-        for (auto&& [field, index] : single_field_multi_indices_) {
-            if (auto const value = doc.values().lookup(field); value) {
-                DEBUG_ASSERT(index->contains_doc(std::addressof(doc)));
-                index->erase(value.value(), std::addressof(doc));
-            }
+        set_for(single_field_unique_indices_);
+        set_for(single_field_multi_indices_);
+        set_for(compound_unique_indices_);
+        set_for(compound_multi_indices_);
+    }
+
+    [[nodiscard]] bool key_filters() const noexcept { return key_filters_; }
+
+    // Creates a full text index over the string field `field`, a field may have a text index besides its other indices.
+    // return: none if `field` has a text index already
+    lookup_result<std::string, text_index> create_text_index(std::string field) {
+        if (auto const [it, b] = text_indices_.try_emplace(field, nullptr); b) {
+            it->second = std::make_unique<text_index>(it->first);
+            return {it->first, *it->second};
         }
+        return {};
+    }
 
-        for (auto&& [fields, index] : compound_unique_indices_) {
-            if (doc.values().contains(fields.begin(), fields.end())) {
-                DEBUG_ASSERT(index->contains_doc(std::addressof(doc)));
-                std::vector<non_null_ptr<bson const>> values;
-                values.reserve(fields.size());
-                for (auto&& field : fields)
-                    values.push_back(std::addressof(doc.values().lookup(field).value()));
-                index->erase(values);
-            }
+    // return: the text index over `field`, none if there is none
+    [[nodiscard]] optional<text_index const&> lookup_text(std::string_view const field) const {
+        if (auto const found = text_indices_.find(field); found != text_indices_.end())
+            return {*found->second};
+        return {};
+    }
+
+    // inserts the documents of `docs` holding `index`'s field into `index`
+    // return: the number of documents inserted
+    static std::size_t register_text(text_index& index, span<non_null_ptr<document> const> const docs) {
+        std::size_t count = 0;
+        for (auto&& doc : docs)
+            if (auto const found = doc->values().lookup(index.path()); found)
+                count += index.insert(found.value(), doc);
+        return count;
+    }
+
+    // Creates a spatial index over the position held by `fields`: two number fields, or one field holding an array of two numbers.
+    // return: none if `fields` have a spatial index already
+    optional<spatial_index&> create_spatial_index(std::vector<std::string> fields) {
+        DEBUG_ASSERT(fields.size() == 1 || fields.size() == 2);
+        if (std::as_const(*this).lookup_spatial(span<std::string const>{fields}))
+            return {};
+        return {*spatial_indices_.emplace_back(std::make_unique<spatial_index>(std::move(fields)))};
+    }
+
+    // return: the spatial index over exactly `fields`, none if there is none
+    template<class Field>
+    [[nodiscard]] optional<spatial_index const&> lookup_spatial(span<Field const> const fields) const {
+        for (auto&& index : spatial_indices_)
+            if (index->fields().size() == fields.size() && std::equal(fields.begin(), fields.end(), index->fields().begin()))
+                return {*index};
+        return {};
+    }
+
+    // inserts the documents of `docs` holding a position into `index`
+    // return: the number of documents inserted
+    static std::size_t register_spatial(spatial_index& index, span<non_null_ptr<document> const> const docs) {
+        std::size_t count = 0;
+        for (auto&& doc : docs)
+            count += index.insert(*doc);
+        return count;
+    }
+
+    // Creates a bitmap index over `field`, a field may have a bitmap index besides its other indices.
+    // return: none if `field` has a bitmap index already
+    lookup_result<std::string, bitmap_index> create_bitmap_index(std::string field) {
+        if (auto const [it, b] = bitmap_indices_.try_emplace(field, nullptr); b) {
+            it->second = std::make_unique<bitmap_index>(it->first, *ordinals_);
+            return {it->first, *it->second};
         }
+        return {};
+    }
 
-        for (auto&& [fields, index] : compound_multi_indices_) {
-            if (doc.values().contains(fields.begin(), fields.end())) {
-                DEBUG_ASSERT(index->contains_doc(std::addressof(doc)));
-                std::vector<non_null_ptr<bson const>> values;
-                values.reserve(fields.size());
-                for (auto&& field : fields)
-                    values.push_back(std::addressof(doc.values().lookup(field).value()));
-                index->erase(values, std::addressof(doc));
-            }
+    // return: the bitmap index over `field`, none if there is none
+    [[nodiscard]] optional<bitmap_index const&> lookup_bitmap(std::string_view const field) const {
+        if (auto const found = bitmap_indices_.find(field); found != bitmap_indices_.end())
+            return {*found->second};
+        return {};
+    }
+
+    // inserts the documents of `docs` holding `index`'s field into `index`
+    // return: the number of documents inserted
+    static std::size_t register_bitmap(bitmap_index& index, span<non_null_ptr<document> const> const docs) {
+        std::size_t count = 0;
+        for (auto&& doc : docs)
+            if (auto const found = doc->values().lookup(index.path()); found)
+                count += index.insert(found.value(), doc);
+        return count;
+    }
+
+    // Returns the statistics of the index over exactly `fields`, a unique index before a multi index and a bitmap index
+    // last. They are gathered when first asked for and again once the documents registered and removed since outnumber
+    // a tenth of those the index held, so they describe the index as it was at most that many changes ago.
+    // `document_count` is the number of documents of the collection, those the index does not hold are `missing`.
+    // return: none if no index of single field or compound keys and no bitmap index is over exactly `fields`
+    [[nodiscard]] optional<index_stats const&> statistics(span<std::string_view const> const fields, std::size_t const document_count) {
+        DEBUG_ASSERT(fields.size() > 0);
+        auto from_index = [&](auto const& index) -> index_stats const& {
+            return cached_statistics(index, document_count, [&index] { return detail::collect_index_stats(index); });
+        };
+        if (fields.size() == 1) {
+            if (auto const found = single_field_unique_indices_.find(fields[0]); found != single_field_unique_indices_.end())
+                return {from_index(std::as_const(*found->second))};
+            if (auto const found = single_field_multi_indices_.find(fields[0]); found != single_field_multi_indices_.end())
+                return {from_index(std::as_const(*found->second))};
+            if (auto const found = bitmap_indices_.find(fields[0]); found != bitmap_indices_.end())
+                return {cached_statistics(*found->second, document_count, [&found] { return found->second->statistics(); })};
+            return {};
         }
+        if (auto const found = detail::find_leading(compound_unique_indices_, fields, fields.size())
+            ; found != compound_unique_indices_.end() && found->first.size() == fields.size())
+            return {from_index(std::as_const(*found->second))};
+        if (auto const found = detail::find_leading(compound_multi_indices_, fields, fields.size())
+            ; found != compound_multi_indices_.end() && found->first.size() == fields.size())
+            return {from_index(std::as_const(*found->second))};
+        return {};
+    }
+
+    // remove a document from all indices held.
+    // indices find the document's entries themselves, so its fields need not hold the values it was registered with
+    void remove_document(document const& doc) {
+        ++changes_;
+        auto remove_from = [&doc](auto&& index_map) {
+            for (auto&& [fields, index] : index_map)
+                index->erase_doc(std::addressof(doc));
+        };
+
+        remove_from(single_field_unique_indices_);
+        remove_from(single_field_multi_indices_);
+        remove_from(compound_unique_indices_);
+        remove_from(compound_multi_indices_);
+        remove_from(text_indices_);
+        for (auto&& index : spatial_indices_)
+            index->erase_doc(std::addressof(doc));
+        remove_from(bitmap_indices_);
+        ordinals_->release(std::addressof(doc));
     }
 
     void remove_document(non_null_ptr<document> const doc) {
         remove_document(*doc);
     }
 
+    // fields are found by the paths each index was created with, so dotted fields index nested values
     void register_document(document& doc) {
+        ++changes_;
         auto register_single_field = [&doc](auto&& index_map) {
             for (auto&& [field, index] : index_map)
-                if (auto const found = doc.values().lookup(field); found)
+                if (auto const found = doc.values().lookup(index->paths()[0]); found)
                     index->insert(found.value(), std::addressof(doc));
         };
 
         auto register_compound = [&doc](auto&& index_map) {
+            std::vector<non_null_ptr<bson const>> vals;
             for (auto&& [fields, index] : index_map) {
-                if (doc.values().contains(fields.begin(), fields.end())) {
-                    std::vector<non_null_ptr<bson const>> vals;
-                    vals.reserve(index->field_count());
-                    for (auto&& field : fields)
-                        vals.push_back(std::addressof(doc.values().lookup(field).value()));
+                vals.clear();
+                if (detail::lookup_paths(doc, index->paths(), vals))
                     index->insert(vals, std::addressof(doc));
-                }
             }
         };
 
@@ -260,6 +533,14 @@ public:
         register_single_field(single_field_multi_indices_);
         register_compound(compound_unique_indices_);
         register_compound(compound_multi_indices_);
+        for (auto&& [field, index] : text_indices_)
+            if (auto const found = doc.values().lookup(index->path()); found)
+                index->insert(found.value(), std::addressof(doc));
+        for (auto&& index : spatial_indices_)
+            index->insert(doc);
+        for (auto&& [field, index] : bitmap_indices_)
+            if (auto const found = doc.values().lookup(index->path()); found)
+                index->insert(found.value(), std::addressof(doc));
     }
 
     void register_document(non_null_ptr<document> const doc) {
@@ -271,6 +552,98 @@ public:
         std::for_each(first, last, [this](auto&& doc){ register_document(doc); });
     }
 
+    // Inserts the documents of `docs` holding every field of `fields` into `index`, an index over `fields`, in bulk.
+    // Ordered indices sort the documents by key on up to `max_threads` threads rather than descending the tree per document.
+    // return: the number of documents inserted
+    // `fields` are split into paths here unless the index was created with them.
+    template<class Index, class Fields>
+    static std::size_t bulk_register(Index& index, Fields const& fields, span<non_null_ptr<document> const> const docs, std::size_t const max_threads = 1) {
+        std::vector<field_path> own_paths;
+        if (index.paths().size() == 0)
+            own_paths = detail::make_paths(fields);
+        span<field_path const> const paths = own_paths.empty() ? index.paths() : span<field_path const>{own_paths};
+
+        std::vector<non_null_ptr<bson const>> keys;
+        std::vector<non_null_ptr<document>> indexed;
+        keys.reserve(docs.size() * index.field_count());
+        indexed.reserve(docs.size());
+        for (auto&& doc : docs)
+            if (detail::lookup_paths(*doc, paths, keys))
+                indexed.push_back(doc);
+        return index.bulk_insert(keys, indexed, max_threads);
+    }
+
+    // Registers `docs` with every index, filling each index in bulk on its own thread.
+    // Indices share no state, so the result is the same as registering the documents one by one.
+    void register_documents_parallel(span<non_null_ptr<document> const> const docs,
+                                     std::size_t const max_threads = std::thread::hardware_concurrency()) {
+        changes_ += docs.size();
+        std::vector<std::function<void()>> tasks;
+        auto add_tasks = [&](auto&& index_map) {
+            for (auto&& [fields, index] : index_map)
+                tasks.emplace_back([&, &fields = fields, index = index.get()] { bulk_register(*index, fields, docs); });
+        };
+        add_tasks(single_field_unique_indices_);
+        add_tasks(single_field_multi_indices_);
+        add_tasks(compound_unique_indices_);
+        add_tasks(compound_multi_indices_);
+        for (auto&& [field, index] : text_indices_)
+            tasks.emplace_back([&, index = index.get()] { register_text(*index, docs); });
+        for (auto&& index : spatial_indices_)
+            tasks.emplace_back([&, index = index.get()] { register_spatial(*index, docs); });
+        // bitmap indices share the ordinals, handed out here so the tasks only read them
+        if (!bitmap_indices_.empty())
+            for (auto&& doc : docs)
+                ordinals_->assign(doc);
+        for (auto&& [field, index] : bitmap_indices_)
+            tasks.emplace_back([&, index = index.get()] { register_bitmap(*index, docs); });
+
+        auto const thread_count = std::min(tasks.size(), std::max<std::size_t>(max_threads, 1));
+        if (thread_count <= 1) {
+            for (auto&& task : tasks)
+                task();
+            return;
+        }
+        std::atomic<std::size_t> next{0};
+        auto worker = [&] {
+            for (auto i = next++; i < tasks.size(); i = next++)
+                tasks[i]();
+        };
+        std::vector<std::thread> threads;
+        for (std::size_t i = 1; i < thread_count; ++i)
+            threads.emplace_back(worker);
+        worker();
+        for (auto&& t : threads)
+            t.join();
+    }
+
+    // Calls `fn(document const&)` for every document held by the index over `fields`, in the order of its keys.
+    // return: false if no index is over exactly `fields`
+    template<class Fn>
+    bool for_each_indexed(span<std::string const> const fields, Fn&& fn) const {
+        auto visit_single_field = [&](auto&& index_map) {
+            if (auto const found = index_map.find(fields[0]); found != index_map.end()) {
+                for (auto&& [val, doc] : std::as_const(*found->second).iterate())
+                    fn(*doc);
+                return true;
+            }
+            return false;
+        };
+        auto visit_compound = [&](auto&& index_map) {
+            for (auto&& [index_fields, index] : index_map) {
+                if (index_fields.size() == fields.size() && std::equal(fields.begin(), fields.end(), index_fields.begin())) {
+                    for (auto&& [vals, doc] : std::as_const(*index).iterate())
+                        fn(*doc);
+                    return true;
+                }
+            }
+            return false;
+        };
+        if (fields.size() == 1)
+            return visit_single_field(single_field_unique_indices_) || visit_single_field(single_field_multi_indices_);
+        return visit_compound(compound_unique_indices_) || visit_compound(compound_multi_indices_);
+    }
+
     template<class... Fields>
     auto lookup(Fields const&... fields) {
         if constexpr(sizeof...(Fields) == 0) {
@@ -290,21 +663,142 @@ public:
             using variant_t = std::variant<sf_index_cursor, cmp_index_cursor>;
             using result_t = optional<variant_t>;
             auto const sv_tpl = std::make_tuple(std::string_view{fields}...);
-            
-            // check compound indices first
-            if (auto const found = compound_unique_indices_.find(sv_tpl); found != compound_unique_indices_.end())
-                return result_t{variant_t{found->second->iterate()}};
-            if (auto const found = compound_multi_indices_.find(sv_tpl); found != compound_multi_indices_.end())
-                return result_t{variant_t{found->second->iterate()}};
+
+            // check compound indices first, an index led by the fields holds its documents in their order as well
+            if (auto const found = detail::find_leading(compound_unique_indices_, sv_tpl, sizeof...(Fields)); found != compound_unique_indices_.end())
+                return result_t{variant_t{std::in_place_index<1>, found->second->iterate()}};
+            if (auto const found = detail::find_leading(compound_multi_indices_, sv_tpl, sizeof...(Fields)); found != compound_multi_indices_.end())
+                return result_t{variant_t{std::in_place_index<1>, found->second->iterate()}};
 
             // check single field indices
-            if (auto const found = lookup_fields_in_single_filed_indices(sv_tpl); found)
-                return result_t{variant_t{std::move(found.value())}};
+            if (auto found = lookup_fields_in_single_filed_indices<0>(sv_tpl); found)
+                return result_t{variant_t{std::in_place_index<0>, std::move(found.value())}};
 
             return result_t{}; 
         }
     }
 
+    // return: the documents the single field index over `field` holds under `val`, none if `field` has no such index
+    [[nodiscard]] optional<const_cursor> lookup_value(std::string_view const field, bson const& val) const {
+        if (auto const found = single_field_unique_indices_.find(field); found != single_field_unique_indices_.end()) {
+            if (auto const doc = std::as_const(*found->second).lookup_one(val); doc)
+                return const_cursor{single_index_lookup{non_null_ptr<document const>{std::addressof(doc.value())}}};
+            return const_cursor{zero_index_lookup<document const>};
+        }
+        if (auto const found = single_field_multi_indices_.find(field); found != single_field_multi_indices_.end())
+            return std::as_const(*found->second).lookup_many(val);
+        if (auto const found = bitmap_indices_.find(field); found != bitmap_indices_.end())
+            return found->second->lookup_many(val);
+        return {};
+    }
+
+    // Finds the documents whose `fields` equal `values` through their indices.
+    // A single field is looked up in its single field index first. Otherwise the compound index over the fewest fields
+    // led by `fields` is searched by prefix, a unique index is preferred over a multi index of as many fields.
+    // A hashed compound index only serves a lookup of all its fields, a shorter prefix would visit every key.
+    // Without one, several fields each held by a bitmap index are found by intersecting their bitmaps, else several
+    // fields each held by a single field index are looked up in each and the results intersected.
+    // return: none if no index is led by `fields` and some field has no single field index
+    [[nodiscard]] optional<const_cursor> lookup_equal(span<std::string_view const> const fields, span<bson const> const values) const {
+        DEBUG_ASSERT(fields.size() > 0 && fields.size() == values.size());
+        if (fields.size() == 1)
+            if (auto found = lookup_value(fields[0], values[0]); found)
+                return found;
+        auto const by_prefix = [&fields](multi_string const& index_fields, _base_index_interface const& index) {
+            return index.ordered() || index_fields.size() == fields.size();
+        };
+        auto const unique = detail::find_leading(compound_unique_indices_, fields, fields.size(), by_prefix);
+        auto const multi = detail::find_leading(compound_multi_indices_, fields, fields.size(), by_prefix);
+        if (unique != compound_unique_indices_.end() && (multi == compound_multi_indices_.end() || unique->first.size() <= multi->first.size()))
+            return std::as_const(*unique->second).lookup_prefix(values);
+        if (multi != compound_multi_indices_.end())
+            return std::as_const(*multi->second).lookup_prefix(values);
+        if (fields.size() > 1) {
+            if (auto found = lookup_bitmaps(fields, values); found)
+                return found;
+            return lookup_intersection(fields, values);
+        }
+        return {};
+    }
+
+    // Finds the documents whose `fields` equal `values` by intersecting the bitmaps of their bitmap indices.
+    // return: none if some field has no bitmap index
+    [[nodiscard]] optional<const_cursor> lookup_bitmaps(span<std::string_view const> const fields, span<bson const> const values) const {
+        DEBUG_ASSERT(fields.size() > 0 && fields.size() == values.size());
+        std::vector<bitmap_index const*> indices;
+        indices.reserve(fields.size());
+        for (auto&& field : fields) {
+            auto const found = bitmap_indices_.find(field);
+            if (found == bitmap_indices_.end())
+                return {};
+            indices.push_back(found->second.get());
+        }
+        std::vector<roaring_bitmap const*> bits;
+        bits.reserve(fields.size());
+        for (std::size_t i = 0; i < fields.size(); ++i) {
+            auto const found = indices[i]->lookup_bits(values[i]);
+            if (!found)
+                return const_cursor{zero_index_lookup<document const>};
+            bits.push_back(std::addressof(*found));
+        }
+        // the smallest bitmap first, the result only shrinks
+        std::sort(bits.begin(), bits.end(), [](auto const* a, auto const* b) { return a->size() < b->size(); });
+        auto result = *bits.front();
+        for (std::size_t i = 1; i < bits.size() && !result.empty(); ++i)
+            result &= *bits[i];
+        return ordinals_->documents(result);
+    }
+
+    // Finds the documents whose `fields` equal `values` by intersecting the documents of their single field indices.
+    // Each index counts the documents of its value up to a bound growing eightfold until one of them stays under it,
+    // so no index is gone through much further than the smallest. The documents of the indices holding at most
+    // `probe_cost` times as many as the smallest are intersected, the others are checked on the few documents left.
+    // return: none if some field has no single field index
+    [[nodiscard]] optional<const_cursor> lookup_intersection(span<std::string_view const> const fields, span<bson const> const values) const {
+        // checking a document's value costs about as much as going through this many entries of an index
+        constexpr std::size_t probe_cost = 8;
+        DEBUG_ASSERT(fields.size() > 0 && fields.size() == values.size());
+        std::vector<_single_field_index_interface const*> indices;
+        indices.reserve(fields.size());
+        for (auto&& field : fields) {
+            indices.push_back(find_single_field(field));
+            if (!indices.back())
+                return {};
+        }
+
+        std::vector<std::size_t> counts(fields.size());
+        auto smallest = std::numeric_limits<std::size_t>::max();
+        for (std::size_t bound = 64; smallest == std::numeric_limits<std::size_t>::max(); bound *= 8)
+            for (std::size_t i = 0; i < fields.size(); ++i) {
+                counts[i] = indices[i]->count(values[i], bound);
+                if (counts[i] < bound)
+                    smallest = std::min(smallest, counts[i]);
+            }
+        if (smallest == 0)
+            return const_cursor{zero_index_lookup<document const>};
+
+        // a count stopped at the bound only tells the index holds at least as many
+        auto const intersected = probe_cost * smallest;
+        std::vector<const_cursor> cursors;
+        std::vector<std::size_t> probed;
+        for (std::size_t i = 0; i < fields.size(); ++i) {
+            if (counts[i] > smallest && counts[i] <= intersected)
+                counts[i] = indices[i]->count(values[i], intersected + 1);
+            if (counts[i] <= intersected)
+                cursors.push_back(*lookup_value(fields[i], values[i]));
+            else
+                probed.push_back(i);
+        }
+        auto found = detail::intersect_cursors(cursors);
+        // the most selective values are checked first
+        std::sort(probed.begin(), probed.end(), [&](std::size_t const a, std::size_t const b) { return counts[a] < counts[b]; });
+        for (auto const i : probed)
+            found.erase(std::remove_if(found.begin(), found.end(), [&](document const* const doc) {
+                return !detail::holds_value(*doc, indices[i]->paths()[0], indices[i]->multikey(), values[i]);
+            }), found.end());
+        return const_cursor{multiple_index_lookup_vec{std::vector<non_null_ptr<document const>>(found.begin(), found.end())}};
+    }
+
     void print_indices() const {
         auto print_single_field = [](auto&& index_map) {
             for (auto&& [field, map] : index_map) {
@@ -349,9 +843,28 @@ public:
         print_single_field(single_field_multi_indices_);
         print_compound(compound_unique_indices_);
         print_compound(compound_multi_indices_);
+        for (auto&& [field, index] : text_indices_)
+            std::cout << fmt::format("    text indexed field: \"{}\" ({} terms, {} documents)\n", field, index->term_count(), index->size());
+        for (auto&& index : spatial_indices_) {
+            std::cout << "    spatially indexed fields:";
+            for (auto&& field : index->fields())
+                std::cout << fmt::format(" \"{}\"", field);
+            std::cout << fmt::format(" ({} documents)\n", index->size());
+        }
+        for (auto&& [field, index] : bitmap_indices_)
+            std::cout << fmt::format("    bitmap indexed field: \"{}\" ({} values, {} documents)\n", field, index->key_count(), index->size());
     }
 
 private:
+    // return: the single field index over `field`, null if there is none
+    [[nodiscard]] _single_field_index_interface const* find_single_field(std::string_view const field) const {
+        if (auto const found = single_field_unique_indices_.find(field); found != single_field_unique_indices_.end())
+            return found->second.get();
+        if (auto const found = single_field_multi_indices_.find(field); found != single_field_multi_indices_.end())
+            return found->second.get();
+        return nullptr;
+    }
+
     template<std::size_t I, class... Fields>
     optional<sf_index_cursor> lookup_fields_in_single_filed_indices(std::tuple<Fields...> const& fields) {
         if constexpr (I == sizeof...(Fields))
@@ -0,0 +1,203 @@
+#ifndef NOVA_INDEX_STATS_HPP
+#define NOVA_INDEX_STATS_HPP
+
+#include "../debug.hpp"
+#include "bson.hpp"
+#include "index.hpp"
+#include "util/optional.hpp"
+#include "util/span.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace nova {
+
+// A range of the values an index holds, a bucket of its histogram.
+struct histogram_bucket {
+    bson lower;
+    bson upper;
+    std::size_t entries = 0;  // the entries held under a value of the range
+    std::size_t distinct = 0; // the distinct values of the range
+};
+
+// How many entries an index holds under which values, so the documents a lookup finds can be estimated without making it.
+// Compound indices describe their leading field, but for `distinct` which counts whole keys.
+// `most_common` and `histogram` are taken from a sample of the entries once there are more than a sample holds,
+// their counts scaled to the whole index. The histogram leaves the most common values out, its buckets are equi-depth:
+// each holds about as many entries as the others.
+struct index_stats {
+    std::size_t entries = 0;   // one per element of an array held by a multikey index
+    std::size_t documents = 0; // the documents held
+    std::size_t distinct = 0;  // the distinct keys held
+    std::size_t nulls = 0;     // the entries of a null value
+    std::size_t missing = 0;   // the documents of the collection not held, lacking the field or refused by the filter
+    std::size_t sampled = 0;   // the entries `most_common` and `histogram` were taken from
+    std::vector<std::pair<bson, std::size_t>> most_common{}; // by descending count
+    std::vector<histogram_bucket> histogram{};               // by ascending values
+
+    // return: the estimated number of entries held under `val`
+    [[nodiscard]] double estimate_equal(bson const& val) const {
+        for (auto&& [common, count] : most_common)
+            if (common == val)
+                return static_cast<double>(count);
+        auto const bucket = std::lower_bound(histogram.begin(), histogram.end(), val,
+                                             [](histogram_bucket const& b, bson const& v) { return b.upper < v; });
+        if (bucket != histogram.end() && !(val < bucket->lower))
+            return static_cast<double>(bucket->entries) / static_cast<double>(std::max<std::size_t>(bucket->distinct, 1));
+        if (sampled == entries)
+            return 0.;
+        // a value the sample missed is held about as often as the other values left out of the most common
+        std::size_t common_entries = 0;
+        for (auto&& [common, count] : most_common)
+            common_entries += count;
+        auto const rest = distinct > most_common.size() ? distinct - most_common.size() : 1;
+        return static_cast<double>(entries > common_entries ? entries - common_entries : 0) / static_cast<double>(rest);
+    }
+
+    // return: the estimated number of entries whose value lies between `lower` and `upper`,
+    // a missing bound leaves that end of the range open. Buckets the range cuts through count half their entries.
+    [[nodiscard]] double estimate_range(optional<bson const&> const lower, optional<bson const&> const upper,
+                                        range_bounds const bounds = range_bounds::closed) const {
+        auto const less = std::less<bson>{};
+        double result = 0.;
+        for (auto&& [common, count] : most_common)
+            if (detail::in_range(less, common, lower, upper, bounds))
+                result += static_cast<double>(count);
+        for (auto&& bucket : histogram) {
+            if ((upper && less(*upper, bucket.lower)) || (lower && less(bucket.upper, *lower)))
+                continue;
+            auto const whole = detail::in_range(less, bucket.lower, lower, upper, bounds)
+                            && detail::in_range(less, bucket.upper, lower, upper, bounds);
+            result += static_cast<double>(bucket.entries) * (whole ? 1. : .5);
+        }
+        return result;
+    }
+
+    // return: the estimated fraction of the collection's documents held under `val`
+    [[nodiscard]] double selectivity(bson const& val) const {
+        auto const total = documents + missing;
+        return total == 0 ? 0. : std::min(1., estimate_equal(val) / static_cast<double>(total));
+    }
+};
+
+namespace detail {
+
+inline constexpr std::size_t stats_sample_size = 30000;
+inline constexpr std::size_t stats_buckets = 100;
+inline constexpr std::size_t stats_most_common = 100;
+
+[[nodiscard]] inline bson const* stats_key(bson const& key) noexcept { return std::addressof(key); }
+[[nodiscard]] inline span<bson const> stats_key(span<bson const> const key) noexcept { return key; }
+
+[[nodiscard]] inline bool same_stats_key(bson const* const a, bson const* const b) noexcept { return *a == *b; }
+[[nodiscard]] inline bool same_stats_key(span<bson const> const a, span<bson const> const b) noexcept {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+// the value statistics describe, the leading field of a compound key
+[[nodiscard]] inline bson const& stats_value(bson const* const key) noexcept { return *key; }
+[[nodiscard]] inline bson const& stats_value(span<bson const> const key) noexcept {
+    DEBUG_ASSERT(key.size() > 0);
+    return key[0];
+}
+
+// Fills the most common values and the histogram of `stats` from `runs`, the distinct values of a sample by ascending
+// value with the entries the sample holds of each, scaling the counts by `scale`.
+// A value is common when the sample holds it more than once and more often than the average value.
+inline void fill_value_stats(index_stats& stats, std::vector<std::pair<bson const*, std::size_t>> const& runs, double const scale,
+                             std::size_t const max_common = stats_most_common, std::size_t const max_buckets = stats_buckets) {
+    auto const scaled = [scale](std::size_t const count) { return static_cast<std::size_t>(static_cast<double>(count) * scale + .5); };
+    if (runs.empty())
+        return;
+
+    std::size_t total = 0;
+    for (auto&& run : runs)
+        total += run.second;
+    std::vector<std::size_t> candidates;
+    for (std::size_t i = 0; i < runs.size(); ++i)
+        if (runs[i].second > 1 && runs[i].second * runs.size() > total)
+            candidates.push_back(i);
+    auto const common_count = std::min(candidates.size(), max_common);
+    std::partial_sort(candidates.begin(), candidates.begin() + static_cast<std::ptrdiff_t>(common_count), candidates.end(),
+                      [&runs](std::size_t const a, std::size_t const b) { return runs[a].second > runs[b].second; });
+    std::vector<bool> common(runs.size(), false);
+    std::size_t rest = total;
+    for (std::size_t i = 0; i < common_count; ++i) {
+        auto const& [val, count] = runs[candidates[i]];
+        stats.most_common.emplace_back(*val, scaled(count));
+        common[candidates[i]] = true;
+        rest -= count;
+    }
+
+    auto const depth = std::max<std::size_t>((rest + max_buckets - 1) / std::max<std::size_t>(max_buckets, 1), 1);
+    std::size_t filled = 0;
+    bool open = false;
+    for (std::size_t i = 0; i < runs.size(); ++i) {
+        if (common[i])
+            continue;
+        auto const& [val, count] = runs[i];
+        if (!open) {
+            stats.histogram.push_back(histogram_bucket{*val, *val, 0, 0});
+            filled = 0;
+            open = true;
+        }
+        auto& bucket = stats.histogram.back();
+        bucket.upper = *val;
+        bucket.entries += count;
+        ++bucket.distinct;
+        filled += count;
+        open = filled < depth;
+    }
+    for (auto&& bucket : stats.histogram)
+        bucket.entries = scaled(bucket.entries);
+}
+
+// Gathers the statistics of `index`, an index of single field or compound keys, walking its entries once and keeping
+// every k-th of them as the sample, `sample_size` at most. Ordered and hashed maps alike iterate equal keys next to
+// each other, so `distinct` and `nulls` are counted exactly, only the values are sampled.
+template<class Index>
+[[nodiscard]] index_stats collect_index_stats(Index const& index, std::size_t const sample_size = stats_sample_size) {
+    index_stats stats;
+    stats.entries = index.size();
+    stats.documents = index.document_count();
+    auto const step = std::max<std::size_t>((stats.entries + sample_size - 1) / std::max<std::size_t>(sample_size, 1), 1);
+
+    std::vector<bson const*> sample;
+    sample.reserve(stats.entries / step + 1);
+    std::conditional_t<std::is_base_of_v<_single_field_index_interface, Index>, bson const*, span<bson const>> prev{};
+    std::size_t i = 0;
+    for (auto&& [key, doc] : index.iterate()) {
+        auto const k = stats_key(key);
+        if (i == 0 || !same_stats_key(prev, k))
+            ++stats.distinct;
+        if (stats_value(k).type() == bson::types::Null)
+            ++stats.nulls;
+        if (i % step == 0)
+            sample.push_back(std::addressof(stats_value(k)));
+        prev = k;
+        ++i;
+    }
+    stats.sampled = sample.size();
+
+    // hashed indices iterate in no order, ordered ones in order of their keys already
+    std::sort(sample.begin(), sample.end(), [](bson const* const a, bson const* const b) { return *a < *b; });
+    std::vector<std::pair<bson const*, std::size_t>> runs;
+    for (auto const val : sample) {
+        if (runs.empty() || !(*runs.back().first == *val))
+            runs.emplace_back(val, 0);
+        ++runs.back().second;
+    }
+    fill_value_stats(stats, runs, sample.empty() ? 1. : static_cast<double>(stats.entries) / static_cast<double>(sample.size()));
+    return stats;
+}
+
+} // namespace detail
+
+} // namespace nova
+
+#endif // NOVA_INDEX_STATS_HPP
@@ -0,0 +1,320 @@
+#ifndef NOVA_MAPPED_COLLECTION_HPP
+#define NOVA_MAPPED_COLLECTION_HPP
+
+#include "../debug.hpp"
+#include "binary.hpp"
+#include "bson.hpp"
+#include "checkpoint.hpp"
+#include "cursor.hpp"
+#include "field_path.hpp"
+#include "query_util.hpp"
+#include "wal.hpp"
+#include "util/optional.hpp"
+#include "util/span.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace nova {
+
+namespace detail {
+
+// three way comparison of an encoded value against a bson, ordered like bson::operator<
+[[nodiscard]] inline int compare(bson_view const view, bson const& b) {
+    auto three_way = [](auto const& lhs, auto const& rhs) { return lhs < rhs ? -1 : rhs < lhs ? 1 : 0; };
+    if (view.type() != b.type())
+        return three_way(view.type(), b.type());
+    switch (view.type()) {
+        case bson::types::Null: return 0;
+        case bson::types::UniqueID: return three_way(*view.as<unique_id>(), *b.as<unique_id>());
+        case bson::types::Bool: return three_way(*view.as<bool>(), *b.as<bool>());
+        case bson::types::Int32: return three_way(*view.as<std::int32_t>(), *b.as<std::int32_t>());
+        case bson::types::Int64: return three_way(*view.as<std::int64_t>(), *b.as<std::int64_t>());
+        case bson::types::uInt32: return three_way(*view.as<std::uint32_t>(), *b.as<std::uint32_t>());
+        case bson::types::uInt64: return three_way(*view.as<std::uint64_t>(), *b.as<std::uint64_t>());
+        case bson::types::Float: return three_way(*view.as<float>(), *b.as<float>());
+        case bson::types::Double: return three_way(*view.as<double>(), *b.as<double>());
+        case bson::types::String: return view.as<std::string>()->compare(*b.as<std::string>());
+        default: return three_way(view.to_bson(), b); // arrays and documents are rarely indexed
+    }
+}
+
+// evaluates a query on an encoded value, predicates from query_util.hpp without decoding it
+template<class Op>
+[[nodiscard]] bool evaluate(Op const& op, bson_view const view) {
+    if constexpr (is_query_predicate_v<Op>) {
+        using predicate_t = std::decay_t<Op>;
+        if (auto const val = view.template as<typename predicate_t::get_t>(); val)
+            return typename predicate_t::compare_type{}(*val, op.value);
+        return false;
+    }
+    else
+        return op(view.to_bson());
+}
+
+// a dotted field naming no top level field of `doc` is resolved as a path, as documents do
+[[nodiscard]] inline optional<bson_view> lookup_field(document_view const doc, field_path const& path) noexcept {
+    if (auto const found = doc.lookup(std::string_view{path.str()}); found || !path.nested())
+        return found;
+    return doc.lookup(path);
+}
+
+} // namespace detail
+
+using mapped_cursor = basic_cursor<document_view>;
+
+// Yields the documents whose positions are stored in a table of a checkpoint.
+class mapped_position_lookup {
+    checkpoint_collection const* coll_;
+    std::byte const* first_;
+    std::byte const* last_;
+public:
+    constexpr mapped_position_lookup(checkpoint_collection const& coll, std::byte const* const first, std::byte const* const last) noexcept
+        : coll_(std::addressof(coll)), first_(first), last_(last) {}
+
+    [[nodiscard]] optional<document_view> operator()() noexcept {
+        if (first_ != last_) {
+            auto const pos = detail::load<std::uint64_t>(first_);
+            first_ += sizeof(std::uint64_t);
+            return {(*coll_)[static_cast<std::size_t>(pos)]};
+        }
+        return {};
+    }
+
+    std::size_t size() const noexcept {
+        return static_cast<std::size_t>(last_ - first_) / sizeof(std::uint64_t);
+    }
+};
+
+// Yields every document of a checkpoint's collection, in the order they are stored.
+class mapped_full_lookup {
+    checkpoint_collection const* coll_;
+    std::size_t pos_ = 0;
+public:
+    explicit constexpr mapped_full_lookup(checkpoint_collection const& coll) noexcept : coll_(std::addressof(coll)) {}
+
+    [[nodiscard]] optional<document_view> operator()() noexcept {
+        if (pos_ != coll_->size())
+            return {(*coll_)[pos_++]};
+        return {};
+    }
+
+    std::size_t size() const noexcept {
+        return coll_->size() - pos_;
+    }
+};
+
+// Yields the documents selected by a scan, copies of the cursor share the selection.
+class mapped_view_lookup {
+    std::shared_ptr<std::vector<document_view> const> views_;
+    std::size_t pos_ = 0;
+public:
+    explicit mapped_view_lookup(std::vector<document_view> views)
+        : views_(std::make_shared<std::vector<document_view> const>(std::move(views))) {}
+
+    [[nodiscard]] optional<document_view> operator()() noexcept {
+        if (pos_ != views_->size())
+            return {(*views_)[pos_++]};
+        return {};
+    }
+
+    std::size_t size() const noexcept {
+        return views_->size() - pos_;
+    }
+};
+
+// An index stored in a checkpoint, searched in place by binary search over the indexed fields of its documents.
+class mapped_index {
+    checkpoint_collection const* coll_;
+    checkpoint_index const* def_;
+    std::vector<field_path> paths_;
+
+    [[nodiscard]] std::byte const* entry(std::size_t const pos) const noexcept {
+        return def_->entries + pos * sizeof(std::uint64_t);
+    }
+
+    // return: the comparison of the leading indexed fields of the document at `pos` against `key`
+    [[nodiscard]] int compare(std::size_t const pos, span<bson const> const key) const {
+        auto const doc = (*this)[pos];
+        for (std::size_t i = 0; i < key.size(); ++i) {
+            auto const val = detail::lookup_field(doc, paths_[i]);
+            DEBUG_ASSERT(val);
+            if (auto const cmp = detail::compare(*val, key[i]); cmp != 0)
+                return cmp;
+        }
+        return 0;
+    }
+
+    // return: the range of positions holding a document whose leading indexed fields equal `key`
+    [[nodiscard]] std::pair<std::size_t, std::size_t> equal_range(span<bson const> const key) const {
+        DEBUG_ASSERT(key.size() > 0 && key.size() <= def_->fields.size());
+        auto bound = [&](bool const upper) {
+            std::size_t first = 0;
+            for (auto count = size(); count > 0;) {
+                auto const half = count / 2;
+                auto const cmp = compare(first + half, key);
+                if (cmp < 0 || (upper && cmp == 0)) {
+                    first += half + 1;
+                    count -= half + 1;
+                }
+                else
+                    count = half;
+            }
+            return first;
+        };
+        auto const first = bound(false);
+        if (def_->unique && key.size() == def_->fields.size())
+            return {first, first < size() && compare(first, key) == 0 ? first + 1 : first};
+        return {first, bound(true)};
+    }
+
+public:
+    mapped_index(checkpoint_collection const& coll, checkpoint_index const& def)
+        : coll_(std::addressof(coll)), def_(std::addressof(def))
+    {
+        paths_.reserve(def.fields.size());
+        for (auto const field : def.fields)
+            paths_.emplace_back(field);
+    }
+
+    [[nodiscard]] bool unique() const noexcept { return def_->unique; }
+    // the kind of the index the table was written from, stored tables are ordered either way
+    [[nodiscard]] index_kind kind() const noexcept { return def_->kind; }
+    [[nodiscard]] std::vector<std::string_view> const& fields() const noexcept { return def_->fields; }
+    [[nodiscard]] std::size_t size() const noexcept { return def_->size; }
+
+    // return: the document at `pos` in the order of the index's keys
+    [[nodiscard]] document_view operator[](std::size_t const pos) const noexcept {
+        DEBUG_ASSERT(pos < size());
+        return (*coll_)[static_cast<std::size_t>(detail::load<std::uint64_t>(entry(pos)))];
+    }
+
+    // every document held by the index, in the order of their keys
+    [[nodiscard]] mapped_cursor iterate() const noexcept {
+        return mapped_position_lookup{*coll_, entry(0), entry(size())};
+    }
+
+    // `keys` are matched against the leading fields of the index, so a compound index can be searched by a prefix
+    template<class... Keys>
+    [[nodiscard]] mapped_cursor lookup_many(Keys&&... keys) const {
+        static_assert(sizeof...(Keys) > 0);
+        std::array<bson, sizeof...(Keys)> const key{bson{std::forward<Keys>(keys)}...};
+        if (key.size() > fields().size())
+            return mapped_position_lookup{*coll_, entry(0), entry(0)};
+        auto const [first, last] = equal_range(span<bson const>{key});
+        return mapped_position_lookup{*coll_, entry(first), entry(last)};
+    }
+
+    template<class... Keys>
+    [[nodiscard]] optional<document_view> lookup_one(Keys&&... keys) const {
+        static_assert(sizeof...(Keys) > 0);
+        std::array<bson, sizeof...(Keys)> const key{bson{std::forward<Keys>(keys)}...};
+        if (key.size() > fields().size())
+            return {};
+        if (auto const [first, last] = equal_range(span<bson const>{key}); first != last)
+            return {(*this)[first]};
+        return {};
+    }
+};
+
+// A read only collection served directly from the pages of a mapped checkpoint.
+// Opening reads only the checkpoint's directory, documents are never decoded and indices are never rebuilt,
+// so startup does not depend on the size of the collection. The mapping is shared, every process opening
+// the same checkpoint reads it through the same pages of the page cache.
+class mapped_collection {
+    checkpoint checkpoint_{};
+    checkpoint_collection const* coll_ = nullptr;
+    std::vector<mapped_index> indices_{};
+
+public:
+    mapped_collection() = default;
+
+    // Maps the checkpoint at `path` and opens its collection `name`.
+    // `verify` checks the crc of the whole file, which reads every page of it.
+    [[nodiscard]] wal_status open(std::string const& path, std::string_view const name, bool const verify = false) {
+        coll_ = nullptr;
+        indices_.clear();
+        if (auto const opened = checkpoint_.open(path, verify); opened != wal_status::ok)
+            return opened;
+        auto const found = checkpoint_.lookup(name);
+        if (!found)
+            return wal_status::not_found;
+        coll_ = std::addressof(found.value());
+        for (auto&& def : coll_->indices())
+            if (!def.multikey && def.kind != index_kind::text && def.kind != index_kind::spatial && def.kind != index_kind::bitmap) // stored without entries
+                indices_.emplace_back(*coll_, def);
+        return wal_status::ok;
+    }
+
+    [[nodiscard]] bool is_open() const noexcept { return coll_ != nullptr; }
+    [[nodiscard]] std::string_view name() const noexcept { return coll_->name(); }
+    [[nodiscard]] std::size_t size() const noexcept { return coll_->size(); }
+    [[nodiscard]] bool empty() const noexcept { return coll_->empty(); }
+
+    // return: the last log record reflected in the collection
+    [[nodiscard]] std::uint64_t lsn() const noexcept { return checkpoint_.lsn(); }
+
+    [[nodiscard]] optional<document_view> lookup(doc_id const& id) const {
+        return coll_->lookup(id);
+    }
+
+    [[nodiscard]] optional<document_view> operator[](doc_id const& id) const {
+        return lookup(id);
+    }
+
+    // return: the index over exactly `fields`
+    template<class... Fields>
+    [[nodiscard]] optional<mapped_index const&> index(Fields const&... fields) const {
+        static_assert(sizeof...(Fields) > 0);
+        std::array<std::string_view, sizeof...(Fields)> const names{std::string_view{fields}...};
+        for (auto&& idx : indices_)
+            if (idx.fields().size() == names.size() && std::equal(names.begin(), names.end(), idx.fields().begin()))
+                return {idx};
+        return {};
+    }
+
+    [[nodiscard]] std::vector<mapped_index> const& indices() const noexcept { return indices_; }
+
+    // Queries built with query_util.hpp are evaluated on the encoded fields,
+    // any other query is given its field decoded into a bson.
+    template<template<class, class> class... Tpls, class... Fields, class... Ops>
+    [[nodiscard]] mapped_cursor scan(Tpls<Fields, Ops>... queries) const {
+        static_assert(std::conjunction_v<detail::is_string_comparable<Fields>...>);
+        static_assert(std::conjunction_v<std::is_invocable_r<bool, Ops, bson const&>...>);
+
+        // fields are split into paths once for the whole scan
+        std::array<field_path, sizeof...(Fields)> const paths{field_path{std::string_view{std::get<0>(queries)}}...};
+        auto check_query = [](auto&& query, field_path const& path, document_view const doc) {
+            auto const val = detail::lookup_field(doc, path);
+            return val && detail::evaluate(std::get<1>(query), *val);
+        };
+
+        std::vector<document_view> result;
+        for (auto&& doc : *coll_) {
+            auto path = paths.begin();
+            if ((check_query(queries, *path++, doc) && ...))
+                result.push_back(doc);
+        }
+        return mapped_view_lookup{std::move(result)};
+    }
+
+    // every document, in the order they are stored
+    [[nodiscard]] mapped_cursor iterate() const noexcept {
+        return mapped_full_lookup{*coll_};
+    }
+
+    [[nodiscard]] checkpoint_collection::iterator begin() const noexcept { return coll_->begin(); }
+    [[nodiscard]] checkpoint_collection::iterator end() const noexcept { return coll_->end(); }
+};
+
+} // namespace nova
+
+#endif // NOVA_MAPPED_COLLECTION_HPP
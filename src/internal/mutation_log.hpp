@@ -0,0 +1,64 @@
+#ifndef NOVA_MUTATION_LOG_HPP
+#define NOVA_MUTATION_LOG_HPP
+
+#include "bson.hpp"
+#include "document.hpp"
+#include "index.hpp"
+#include "util/span.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <typeindex>
+
+namespace nova {
+
+namespace detail {
+
+// an index's uniqueness, kind and mode as recorded in a single byte,
+// logs written before hashed, multikey, text, spatial or bitmap indices read as ordered and single key
+[[nodiscard]] constexpr std::uint8_t index_flags(bool const unique, index_kind const kind, bool const multikey = false) noexcept {
+    return static_cast<std::uint8_t>(unique) | static_cast<std::uint8_t>(kind == index_kind::hashed) << 1
+         | static_cast<std::uint8_t>(multikey) << 2 | static_cast<std::uint8_t>(kind == index_kind::text) << 3
+         | static_cast<std::uint8_t>(kind == index_kind::spatial) << 4 | static_cast<std::uint8_t>(kind == index_kind::bitmap) << 5;
+}
+
+[[nodiscard]] constexpr bool index_flags_unique(std::uint8_t const flags) noexcept {
+    return (flags & 1) != 0;
+}
+
+[[nodiscard]] constexpr index_kind index_flags_kind(std::uint8_t const flags) noexcept {
+    if ((flags & 8) != 0)
+        return index_kind::text;
+    if ((flags & 16) != 0)
+        return index_kind::spatial;
+    if ((flags & 32) != 0)
+        return index_kind::bitmap;
+    return (flags & 2) != 0 ? index_kind::hashed : index_kind::ordered;
+}
+
+[[nodiscard]] constexpr bool index_flags_multikey(std::uint8_t const flags) noexcept {
+    return (flags & 4) != 0;
+}
+
+} // namespace detail
+
+// Receives every mutation of a collection before it is applied.
+// A mutation is rejected, and the collection left unchanged, when logging it fails.
+class mutation_log {
+public:
+    virtual ~mutation_log() = default;
+
+    [[nodiscard]] virtual bool log_insert(document const& doc) = 0;
+    [[nodiscard]] virtual bool log_erase(doc_id const& id) = 0;
+    [[nodiscard]] virtual bool log_update(doc_id const& id, std::string_view field, bson const& value) = 0;
+
+    // return: true if an index with this filter and number of fields can be recorded
+    [[nodiscard]] virtual bool can_log_index(std::type_index filter, std::size_t field_count) const = 0;
+    [[nodiscard]] virtual bool log_create_index(bool unique, index_kind kind, bool multikey, std::type_index filter, span<std::string const> fields) = 0;
+    [[nodiscard]] virtual bool log_create_column(std::string_view field, bson::types type) = 0;
+};
+
+} // namespace nova
+
+#endif // NOVA_MUTATION_LOG_HPP
@@ -4,17 +4,46 @@
 #include "bson.hpp"
 #include "detail.hpp"
 
+#include <functional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
 namespace nova {
 
+// A comparison of a field against a fixed value.
+// Exposes the comparison and the value so that collections can evaluate it without
+// visiting documents, e.g. over a column.
 template<class Cmp, class T>
-auto query_cmp(std::string_view const field, T&& value) {
+struct query_predicate {
+    using compare_type = Cmp;
+    using value_type = T;
+    // the bson type a value must hold to satisfy the predicate
     using get_t = std::conditional_t<detail::is_string_comparable_v<T>, std::string, T>;
-    auto query = [t = std::forward<T>(value)](bson const& b) -> bool {
+
+    T value;
+
+    bool operator()(bson const& b) const {
         if (auto const opt = b.template as<get_t>(); opt)
-            return Cmp{}(*opt, t);
+            return Cmp{}(*opt, value);
         return false;
-    };
-    return std::make_tuple(field, query);
+    }
+};
+
+template<class T>
+struct is_query_predicate : std::false_type {};
+
+template<class Cmp, class T>
+struct is_query_predicate<query_predicate<Cmp, T>> : std::true_type {};
+
+template<class T>
+inline static constexpr bool is_query_predicate_v = is_query_predicate<T>::value;
+
+// `field` may be a dotted path into nested documents and arrays, see field_path
+template<class Cmp, class T>
+auto query_cmp(std::string_view const field, T&& value) {
+    return std::make_tuple(field, query_predicate<Cmp, std::decay_t<T>>{std::forward<T>(value)});
 }
 
 template<class T>
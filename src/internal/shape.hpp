@@ -0,0 +1,157 @@
+#ifndef NOVA_SHAPE_HPP
+#define NOVA_SHAPE_HPP
+
+#include <absl/container/flat_hash_map.h>
+
+#include "../debug.hpp"
+#include "detail.hpp"
+#include "util/optional.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace nova {
+
+class shape_tree;
+
+// A shape is an ordered list of field names shared by every document holding exactly
+// those fields, inserted in that order (a "hidden class").
+// A document stores its shape along with a dense array of values, where the value of the 
+// i'th field of the shape lives in slot i.
+// Shapes are immutable once created, adding a field transitions a document to a child shape.
+class shape {
+    friend class shape_tree;
+
+    // shapes with at most this many fields are searched linearly
+    inline static constexpr std::size_t linear_search_limit = 8;
+
+    shape_tree* tree_;
+    shape const* parent_;
+    std::uint32_t id_;
+    std::vector<std::string> fields_;
+    absl::flat_hash_map<std::string, std::uint32_t, detail::string_like_hash, detail::string_like_key_eq> slots_{};
+    absl::flat_hash_map<std::string, std::unique_ptr<shape>, detail::string_like_hash, detail::string_like_key_eq> transitions_{};
+
+    shape(shape_tree* const tree, shape const* const parent, std::uint32_t const id, std::vector<std::string> fields)
+        : tree_(tree), parent_(parent), id_(id), fields_(std::move(fields))
+    {
+        if (fields_.size() > linear_search_limit)
+            for (std::uint32_t i = 0; i < fields_.size(); ++i)
+                slots_.emplace(fields_[i], i);
+    }
+
+public:
+    shape(shape const&) = delete;
+    shape& operator=(shape const&) = delete;
+
+    // return: the slot holding `field`, if this shape contains it
+    [[nodiscard]] optional<std::uint32_t> slot(std::string_view const field) const noexcept {
+        if (fields_.size() <= linear_search_limit) {
+            for (std::uint32_t i = 0; i < fields_.size(); ++i)
+                if (fields_[i] == field)
+                    return {i};
+            return {};
+        }
+        if (auto const it = slots_.find(field); it != slots_.end())
+            return {it->second};
+        return {};
+    }
+
+    [[nodiscard]] bool contains(std::string_view const field) const noexcept {
+        return slot(field).has_value();
+    }
+
+    [[nodiscard]] std::string const& field(std::size_t const slot) const noexcept {
+        DEBUG_ASSERT(slot < fields_.size());
+        return fields_[slot];
+    }
+
+    [[nodiscard]] std::vector<std::string> const& fields() const noexcept { return fields_; }
+    [[nodiscard]] std::size_t size() const noexcept { return fields_.size(); }
+    [[nodiscard]] std::uint32_t id() const noexcept { return id_; }
+    [[nodiscard]] shape const* parent() const noexcept { return parent_; }
+    [[nodiscard]] shape_tree& tree() const noexcept { return *tree_; }
+
+    // return: the shape reached by appending `field` to this shape
+    [[nodiscard]] shape const& transition(std::string_view field) const;
+};
+
+// Owns every shape reachable from its root (the empty shape).
+// Each collection owns a tree for its documents, documents outside a collection
+// use the process wide `shape_tree::global()` tree.
+class shape_tree {
+    std::unique_ptr<shape> root_;
+    std::uint32_t next_id_ = 1;
+    absl::flat_hash_map<shape const*, shape const*> adopted_{}; // global shape -> shape in this tree
+    mutable std::mutex mutex_{};
+
+public:
+    shape_tree() : root_(new shape(this, nullptr, 0, {})) {}
+
+    shape_tree(shape_tree const&) = delete;
+    shape_tree& operator=(shape_tree const&) = delete;
+
+    [[nodiscard]] static shape_tree& global() {
+        static shape_tree tree;
+        return tree;
+    }
+
+    [[nodiscard]] shape const& root() const noexcept { return *root_; }
+
+    // return: total number of shapes created, including the root
+    [[nodiscard]] std::size_t size() const noexcept {
+        std::lock_guard lock{mutex_};
+        return next_id_;
+    }
+
+    [[nodiscard]] shape const& transition(shape const& from, std::string_view const field) {
+        DEBUG_ASSERT(std::addressof(from.tree()) == this);
+        DEBUG_ASSERT(!from.contains(field));
+        std::lock_guard lock{mutex_};
+        auto& transitions = const_cast<shape&>(from).transitions_;
+        if (auto const it = transitions.find(field); it != transitions.end())
+            return *(it->second);
+
+        auto fields = from.fields_;
+        fields.emplace_back(field);
+        auto const [it, b] = transitions.emplace(field, std::unique_ptr<shape>(new shape(this, std::addressof(from), next_id_++, std::move(fields))));
+        DEBUG_ASSERT(b);
+        return *(it->second);
+    }
+
+    // return: the shape in this tree with the same fields as `other`
+    [[nodiscard]] shape const& adopt(shape const& other) {
+        if (std::addressof(other.tree()) == this)
+            return other;
+
+        // shapes of the global tree are never destroyed, so their mapping can be cached
+        auto const cacheable = std::addressof(other.tree()) == std::addressof(global());
+        if (cacheable) {
+            std::lock_guard lock{mutex_};
+            if (auto const it = adopted_.find(std::addressof(other)); it != adopted_.end())
+                return *(it->second);
+        }
+
+        auto const* s = root_.get();
+        for (auto&& field : other.fields())
+            s = std::addressof(transition(*s, field));
+
+        if (cacheable) {
+            std::lock_guard lock{mutex_};
+            adopted_.emplace(std::addressof(other), s);
+        }
+        return *s;
+    }
+};
+
+inline shape const& shape::transition(std::string_view const field) const {
+    return tree_->transition(*this, field);
+}
+
+} // namespace nova
+
+#endif // NOVA_SHAPE_HPP
@@ -0,0 +1,359 @@
+#ifndef NOVA_SIMD_HPP
+#define NOVA_SIMD_HPP
+
+#include "../debug.hpp"
+#include "detail.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define NOVA_SIMD_X86 1
+#include <immintrin.h>
+#define NOVA_TARGET_SSE42 __attribute__((target("sse4.2")))
+#define NOVA_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define NOVA_SIMD_X86 0
+#endif
+
+// Comparison kernels over contiguous values.
+// Every kernel writes one bit per value into 64 bit words: bit i of the output is set
+// if value i satisfies the comparison. Kernels are selected at runtime from the
+// instruction sets the cpu supports, falling back to a scalar loop.
+
+namespace nova {
+
+enum class cmp_op : std::uint8_t { eq, ne, lt, le, gt, ge };
+
+enum class simd_level : std::uint8_t { scalar, sse42, avx2 };
+
+template<class Cmp>
+struct cmp_op_of;
+
+template<> struct cmp_op_of<std::equal_to<>> { static constexpr cmp_op value = cmp_op::eq; };
+template<> struct cmp_op_of<std::not_equal_to<>> { static constexpr cmp_op value = cmp_op::ne; };
+template<> struct cmp_op_of<std::less<>> { static constexpr cmp_op value = cmp_op::lt; };
+template<> struct cmp_op_of<std::less_equal<>> { static constexpr cmp_op value = cmp_op::le; };
+template<> struct cmp_op_of<std::greater<>> { static constexpr cmp_op value = cmp_op::gt; };
+template<> struct cmp_op_of<std::greater_equal<>> { static constexpr cmp_op value = cmp_op::ge; };
+
+template<class Cmp, class = void>
+struct has_cmp_op : std::false_type {};
+
+template<class Cmp>
+struct has_cmp_op<Cmp, std::void_t<decltype(cmp_op_of<Cmp>::value)>> : std::true_type {};
+
+// return: the widest instruction set supported by the running cpu
+[[nodiscard]] inline simd_level detect_simd_level() noexcept {
+#if NOVA_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return simd_level::avx2;
+    if (__builtin_cpu_supports("sse4.2"))
+        return simd_level::sse42;
+#endif
+    return simd_level::scalar;
+}
+
+[[nodiscard]] inline simd_level active_simd_level() noexcept {
+    static simd_level const level = detect_simd_level();
+    return level;
+}
+
+template<class T>
+inline static constexpr bool is_simd_comparable = std::disjunction_v<
+    std::is_same<T, std::int32_t>, std::is_same<T, std::int64_t>,
+    std::is_same<T, std::uint32_t>, std::is_same<T, std::uint64_t>,
+    std::is_same<T, float>, std::is_same<T, double>>;
+
+namespace detail {
+
+template<cmp_op Op>
+struct cmp_functor;
+
+template<> struct cmp_functor<cmp_op::eq> { using type = std::equal_to<>; };
+template<> struct cmp_functor<cmp_op::ne> { using type = std::not_equal_to<>; };
+template<> struct cmp_functor<cmp_op::lt> { using type = std::less<>; };
+template<> struct cmp_functor<cmp_op::le> { using type = std::less_equal<>; };
+template<> struct cmp_functor<cmp_op::gt> { using type = std::greater<>; };
+template<> struct cmp_functor<cmp_op::ge> { using type = std::greater_equal<>; };
+
+template<class Cmp, class T, class V>
+void scalar_compare(T const* const values, std::size_t const n, V const& value, std::uint64_t* const out) noexcept {
+    Cmp const cmp{};
+    std::size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        std::uint64_t word = 0;
+        for (std::size_t j = 0; j < 64; ++j)
+            word |= static_cast<std::uint64_t>(cmp(values[i + j], value)) << j;
+        out[i / 64] = word;
+    }
+    if (i < n) {
+        std::uint64_t word = 0;
+        for (std::size_t j = 0; i + j < n; ++j)
+            word |= static_cast<std::uint64_t>(cmp(values[i + j], value)) << j;
+        out[i / 64] = word;
+    }
+}
+
+#if NOVA_SIMD_X86
+
+// integers are compared as signed, unsigned values are biased by their sign bit first
+template<class T>
+inline static constexpr bool needs_bias = std::is_unsigned_v<T>;
+
+template<bool Wide>
+NOVA_TARGET_SSE42 inline __m128i sse42_eq(__m128i const a, __m128i const b) noexcept {
+    if constexpr (Wide) return _mm_cmpeq_epi64(a, b);
+    else return _mm_cmpeq_epi32(a, b);
+}
+
+template<bool Wide>
+NOVA_TARGET_SSE42 inline __m128i sse42_gt(__m128i const a, __m128i const b) noexcept {
+    if constexpr (Wide) return _mm_cmpgt_epi64(a, b);
+    else return _mm_cmpgt_epi32(a, b);
+}
+
+template<bool Wide>
+NOVA_TARGET_AVX2 inline __m256i avx2_eq(__m256i const a, __m256i const b) noexcept {
+    if constexpr (Wide) return _mm256_cmpeq_epi64(a, b);
+    else return _mm256_cmpeq_epi32(a, b);
+}
+
+template<bool Wide>
+NOVA_TARGET_AVX2 inline __m256i avx2_gt(__m256i const a, __m256i const b) noexcept {
+    if constexpr (Wide) return _mm256_cmpgt_epi64(a, b);
+    else return _mm256_cmpgt_epi32(a, b);
+}
+
+template<cmp_op Op, class T>
+NOVA_TARGET_SSE42 inline std::uint32_t sse42_mask(T const* const ptr, T const value) noexcept {
+    if constexpr (std::is_same_v<T, float>) {
+        auto const a = _mm_loadu_ps(ptr);
+        auto const b = _mm_set1_ps(value);
+        if constexpr (Op == cmp_op::eq) return static_cast<std::uint32_t>(_mm_movemask_ps(_mm_cmpeq_ps(a, b)));
+        else if constexpr (Op == cmp_op::ne) return static_cast<std::uint32_t>(_mm_movemask_ps(_mm_cmpneq_ps(a, b)));
+        else if constexpr (Op == cmp_op::lt) return static_cast<std::uint32_t>(_mm_movemask_ps(_mm_cmplt_ps(a, b)));
+        else if constexpr (Op == cmp_op::le) return static_cast<std::uint32_t>(_mm_movemask_ps(_mm_cmple_ps(a, b)));
+        else if constexpr (Op == cmp_op::gt) return static_cast<std::uint32_t>(_mm_movemask_ps(_mm_cmpgt_ps(a, b)));
+        else return static_cast<std::uint32_t>(_mm_movemask_ps(_mm_cmpge_ps(a, b)));
+    }
+    else if constexpr (std::is_same_v<T, double>) {
+        auto const a = _mm_loadu_pd(ptr);
+        auto const b = _mm_set1_pd(value);
+        if constexpr (Op == cmp_op::eq) return static_cast<std::uint32_t>(_mm_movemask_pd(_mm_cmpeq_pd(a, b)));
+        else if constexpr (Op == cmp_op::ne) return static_cast<std::uint32_t>(_mm_movemask_pd(_mm_cmpneq_pd(a, b)));
+        else if constexpr (Op == cmp_op::lt) return static_cast<std::uint32_t>(_mm_movemask_pd(_mm_cmplt_pd(a, b)));
+        else if constexpr (Op == cmp_op::le) return static_cast<std::uint32_t>(_mm_movemask_pd(_mm_cmple_pd(a, b)));
+        else if constexpr (Op == cmp_op::gt) return static_cast<std::uint32_t>(_mm_movemask_pd(_mm_cmpgt_pd(a, b)));
+        else return static_cast<std::uint32_t>(_mm_movemask_pd(_mm_cmpge_pd(a, b)));
+    }
+    else {
+        constexpr bool wide = sizeof(T) == 8;
+        auto a = _mm_loadu_si128(reinterpret_cast<__m128i const*>(ptr));
+        auto b = wide ? _mm_set1_epi64x(static_cast<std::int64_t>(value)) : _mm_set1_epi32(static_cast<std::int32_t>(value));
+        if constexpr (needs_bias<T>) {
+            auto const bias = wide ? _mm_set1_epi64x(INT64_MIN) : _mm_set1_epi32(INT32_MIN);
+            a = _mm_xor_si128(a, bias);
+            b = _mm_xor_si128(b, bias);
+        }
+        auto const ones = _mm_set1_epi32(-1);
+        __m128i r;
+        if constexpr (Op == cmp_op::eq) r = sse42_eq<wide>(a, b);
+        else if constexpr (Op == cmp_op::ne) r = _mm_xor_si128(sse42_eq<wide>(a, b), ones);
+        else if constexpr (Op == cmp_op::lt) r = sse42_gt<wide>(b, a);
+        else if constexpr (Op == cmp_op::le) r = _mm_xor_si128(sse42_gt<wide>(a, b), ones);
+        else if constexpr (Op == cmp_op::gt) r = sse42_gt<wide>(a, b);
+        else r = _mm_xor_si128(sse42_gt<wide>(b, a), ones);
+        if constexpr (wide)
+            return static_cast<std::uint32_t>(_mm_movemask_pd(_mm_castsi128_pd(r)));
+        else
+            return static_cast<std::uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(r)));
+    }
+}
+
+template<cmp_op Op, class T>
+NOVA_TARGET_AVX2 inline std::uint32_t avx2_mask(T const* const ptr, T const value) noexcept {
+    if constexpr (std::is_floating_point_v<T>) {
+        constexpr int pred = Op == cmp_op::eq ? _CMP_EQ_OQ
+            : Op == cmp_op::ne ? _CMP_NEQ_UQ
+            : Op == cmp_op::lt ? _CMP_LT_OQ
+            : Op == cmp_op::le ? _CMP_LE_OQ
+            : Op == cmp_op::gt ? _CMP_GT_OQ
+            : _CMP_GE_OQ;
+        if constexpr (std::is_same_v<T, float>)
+            return static_cast<std::uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(ptr), _mm256_set1_ps(value), pred)));
+        else
+            return static_cast<std::uint32_t>(_mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(ptr), _mm256_set1_pd(value), pred)));
+    }
+    else {
+        constexpr bool wide = sizeof(T) == 8;
+        auto a = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(ptr));
+        auto b = wide ? _mm256_set1_epi64x(static_cast<std::int64_t>(value)) : _mm256_set1_epi32(static_cast<std::int32_t>(value));
+        if constexpr (needs_bias<T>) {
+            auto const bias = wide ? _mm256_set1_epi64x(INT64_MIN) : _mm256_set1_epi32(INT32_MIN);
+            a = _mm256_xor_si256(a, bias);
+            b = _mm256_xor_si256(b, bias);
+        }
+        auto const ones = _mm256_set1_epi32(-1);
+        __m256i r;
+        if constexpr (Op == cmp_op::eq) r = avx2_eq<wide>(a, b);
+        else if constexpr (Op == cmp_op::ne) r = _mm256_xor_si256(avx2_eq<wide>(a, b), ones);
+        else if constexpr (Op == cmp_op::lt) r = avx2_gt<wide>(b, a);
+        else if constexpr (Op == cmp_op::le) r = _mm256_xor_si256(avx2_gt<wide>(a, b), ones);
+        else if constexpr (Op == cmp_op::gt) r = avx2_gt<wide>(a, b);
+        else r = _mm256_xor_si256(avx2_gt<wide>(b, a), ones);
+        if constexpr (wide)
+            return static_cast<std::uint32_t>(_mm256_movemask_pd(_mm256_castsi256_pd(r)));
+        else
+            return static_cast<std::uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(r)));
+    }
+}
+
+template<cmp_op Op, class T>
+NOVA_TARGET_SSE42 void sse42_compare(T const* const values, std::size_t const n, T const value, std::uint64_t* const out) noexcept {
+    constexpr std::size_t lanes = 16 / sizeof(T);
+    std::size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        std::uint64_t word = 0;
+        for (std::size_t j = 0; j < 64; j += lanes)
+            word |= static_cast<std::uint64_t>(sse42_mask<Op>(values + i + j, value)) << j;
+        out[i / 64] = word;
+    }
+    if (i < n)
+        scalar_compare<typename cmp_functor<Op>::type>(values + i, n - i, value, out + i / 64);
+}
+
+template<cmp_op Op, class T>
+NOVA_TARGET_AVX2 void avx2_compare(T const* const values, std::size_t const n, T const value, std::uint64_t* const out) noexcept {
+    constexpr std::size_t lanes = 32 / sizeof(T);
+    std::size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        std::uint64_t word = 0;
+        for (std::size_t j = 0; j < 64; j += lanes)
+            word |= static_cast<std::uint64_t>(avx2_mask<Op>(values + i + j, value)) << j;
+        out[i / 64] = word;
+    }
+    if (i < n)
+        scalar_compare<typename cmp_functor<Op>::type>(values + i, n - i, value, out + i / 64);
+}
+
+NOVA_TARGET_SSE42 inline void sse42_match_cells16(unsigned char const* const cells, std::size_t const n,
+    unsigned char const* const pattern, unsigned char const* const mask, std::uint64_t* const out) noexcept
+{
+    auto const p = _mm_loadu_si128(reinterpret_cast<__m128i const*>(pattern));
+    auto const m = _mm_loadu_si128(reinterpret_cast<__m128i const*>(mask));
+    for (std::size_t i = 0; i < n; i += 64) {
+        std::uint64_t word = 0;
+        for (std::size_t j = 0; j < 64 && i + j < n; ++j) {
+            auto const c = _mm_loadu_si128(reinterpret_cast<__m128i const*>(cells + (i + j) * 16));
+            auto const diff = _mm_and_si128(_mm_xor_si128(c, p), m);
+            word |= static_cast<std::uint64_t>(_mm_testz_si128(diff, diff)) << j;
+        }
+        out[i / 64] = word;
+    }
+}
+
+NOVA_TARGET_AVX2 inline void avx2_match_cells16(unsigned char const* const cells, std::size_t const n,
+    unsigned char const* const pattern, unsigned char const* const mask, std::uint64_t* const out) noexcept
+{
+    auto const p128 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(pattern));
+    auto const m128 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(mask));
+    auto const p = _mm256_set_m128i(p128, p128);
+    auto const m = _mm256_set_m128i(m128, m128);
+    std::size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        std::uint64_t word = 0;
+        for (std::size_t j = 0; j < 64; j += 2) {
+            auto const c = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(cells + (i + j) * 16));
+            // a cell matches when all 16 of its masked bytes are equal to the pattern
+            auto const eq = _mm256_or_si256(_mm256_cmpeq_epi8(c, p), _mm256_xor_si256(m, _mm256_set1_epi8(-1)));
+            auto const bits = static_cast<std::uint32_t>(_mm256_movemask_epi8(eq));
+            word |= static_cast<std::uint64_t>((bits & 0xFFFFu) == 0xFFFFu) << j;
+            word |= static_cast<std::uint64_t>((bits >> 16) == 0xFFFFu) << (j + 1);
+        }
+        out[i / 64] = word;
+    }
+    if (i < n)
+        sse42_match_cells16(cells + i * 16, n - i, pattern, mask, out + i / 64);
+}
+
+#endif // NOVA_SIMD_X86
+
+inline void scalar_match_cells16(unsigned char const* const cells, std::size_t const n,
+    unsigned char const* const pattern, unsigned char const* const mask, std::uint64_t* const out) noexcept
+{
+    for (std::size_t i = 0; i < n; i += 64) {
+        std::uint64_t word = 0;
+        for (std::size_t j = 0; j < 64 && i + j < n; ++j) {
+            auto const cell = cells + (i + j) * 16;
+            bool match = true;
+            for (std::size_t b = 0; b < 16; ++b)
+                match &= ((cell[b] ^ pattern[b]) & mask[b]) == 0;
+            word |= static_cast<std::uint64_t>(match) << j;
+        }
+        out[i / 64] = word;
+    }
+}
+
+template<cmp_op Op, class T>
+void compare_op(T const* const values, std::size_t const n, T const value, std::uint64_t* const out, simd_level const level) noexcept {
+#if NOVA_SIMD_X86
+    if constexpr (is_simd_comparable<T>) {
+        if (level == simd_level::avx2)
+            return avx2_compare<Op>(values, n, value, out);
+        if (level == simd_level::sse42)
+            return sse42_compare<Op>(values, n, value, out);
+    }
+#endif
+    detail::ignore(level);
+    scalar_compare<typename cmp_functor<Op>::type>(values, n, value, out);
+}
+
+} // namespace detail
+
+// sets bit i of `out` to (values[i] `op` value), `out` must hold at least `n` bits
+template<class T>
+void compare(T const* const values, std::size_t const n, T const value, cmp_op const op,
+    std::uint64_t* const out, simd_level const level = active_simd_level()) noexcept
+{
+    switch (op) {
+        case cmp_op::eq: return detail::compare_op<cmp_op::eq>(values, n, value, out, level);
+        case cmp_op::ne: return detail::compare_op<cmp_op::ne>(values, n, value, out, level);
+        case cmp_op::lt: return detail::compare_op<cmp_op::lt>(values, n, value, out, level);
+        case cmp_op::le: return detail::compare_op<cmp_op::le>(values, n, value, out, level);
+        case cmp_op::gt: return detail::compare_op<cmp_op::gt>(values, n, value, out, level);
+        case cmp_op::ge: return detail::compare_op<cmp_op::ge>(values, n, value, out, level);
+    }
+}
+
+// sets bit i of `out` to Cmp{}(values[i], value), using a simd kernel when one exists for `Cmp` and `T`
+template<class Cmp, class T, class V>
+void compare(T const* const values, std::size_t const n, V const& value, std::uint64_t* const out) noexcept {
+    if constexpr (has_cmp_op<Cmp>::value && is_simd_comparable<T> && std::is_same_v<T, V>)
+        detail::compare_op<cmp_op_of<Cmp>::value>(values, n, value, out, active_simd_level());
+    else
+        detail::scalar_compare<Cmp>(values, n, value, out);
+}
+
+// Compares `n` consecutive 16 byte cells against `pattern`, only considering the bytes
+// whose `mask` byte is 0xFF. Sets bit i of `out` if cell i matches.
+inline void match_cells16(unsigned char const* const cells, std::size_t const n, unsigned char const (&pattern)[16],
+    unsigned char const (&mask)[16], std::uint64_t* const out, simd_level const level = active_simd_level()) noexcept
+{
+#if NOVA_SIMD_X86
+    if (level == simd_level::avx2)
+        return detail::avx2_match_cells16(cells, n, pattern, mask, out);
+    if (level == simd_level::sse42)
+        return detail::sse42_match_cells16(cells, n, pattern, mask, out);
+#endif
+    detail::ignore(level);
+    detail::scalar_match_cells16(cells, n, pattern, mask, out);
+}
+
+} // namespace nova
+
+#endif // NOVA_SIMD_HPP
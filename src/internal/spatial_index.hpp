@@ -0,0 +1,288 @@
+#ifndef NOVA_SPATIAL_INDEX_HPP
+#define NOVA_SPATIAL_INDEX_HPP
+
+#include <absl/container/flat_hash_map.h>
+
+#include "../debug.hpp"
+#include "bson.hpp"
+#include "cursor.hpp"
+#include "document.hpp"
+#include "field_path.hpp"
+#include "util/non_null_ptr.hpp"
+#include "util/optional.hpp"
+#include "util/span.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace nova {
+
+struct point {
+    double x;
+    double y;
+};
+
+// an axis aligned box, its edges are part of it
+struct bounding_box {
+    point min;
+    point max;
+
+    [[nodiscard]] bool contains(point const p) const noexcept {
+        return p.x >= min.x && p.x <= max.x && p.y >= min.y && p.y <= max.y;
+    }
+
+    [[nodiscard]] bool intersects(bounding_box const& other) const noexcept {
+        return min.x <= other.max.x && other.min.x <= max.x && min.y <= other.max.y && other.min.y <= max.y;
+    }
+};
+
+namespace detail {
+
+// return: the value of a number of any type as a double, none for other values
+[[nodiscard]] inline optional<double> to_coordinate(bson const& val) noexcept {
+    switch (val.type()) {
+        case bson::types::Int32: return static_cast<double>(*val.as<std::int32_t>());
+        case bson::types::Int64: return static_cast<double>(*val.as<std::int64_t>());
+        case bson::types::uInt32: return static_cast<double>(*val.as<std::uint32_t>());
+        case bson::types::uInt64: return static_cast<double>(*val.as<std::uint64_t>());
+        case bson::types::Float: return static_cast<double>(*val.as<float>());
+        case bson::types::Double: return *val.as<double>();
+        default: return {};
+    }
+}
+
+// Coordinates from 2^1000 on are refused, the root region grows past a position by doubling and would overflow
+// to infinity on the way to the largest doubles.
+// return: whether `coordinate` is finite and below 2^1000 in magnitude
+[[nodiscard]] inline bool valid_coordinate(double const coordinate) noexcept {
+    return std::abs(coordinate) < 0x1p1000;
+}
+
+} // namespace detail
+
+// An index over the position of documents in the plane, answering which documents lie in a box or within a distance
+// of a point. A position is held by two number fields, or by one field holding an array of two numbers.
+// Positions are kept in a bucket quadtree: a square region holds up to `bucket_size` documents before it is split
+// into four, so dense areas are split finer than sparse ones and a query visits only the regions it overlaps.
+// The root region doubles towards positions outside of it. Documents without a position whose coordinates are
+// finite and below 2^1000 in magnitude are not indexed.
+class spatial_index {
+    inline static constexpr std::size_t bucket_size = 32;
+    // regions are not split below this depth, so documents at the same position share a bucket
+    inline static constexpr std::size_t max_depth = 48;
+
+    struct entry {
+        point pos;
+        document const* doc;
+    };
+
+    struct node {
+        std::vector<entry> entries{}; // held by leaves only
+        std::uint32_t children = 0;   // the first of four consecutive nodes, 0 for a leaf as the root is no child
+    };
+
+    // the square around `center` reaching `half` along both axes, its lower edges are part of it and its upper edges
+    // are not, so every position lies in exactly one quadrant of a region
+    struct region {
+        point center;
+        double half;
+
+        [[nodiscard]] bool contains(point const p) const noexcept {
+            return p.x >= center.x - half && p.x < center.x + half && p.y >= center.y - half && p.y < center.y + half;
+        }
+
+        [[nodiscard]] bounding_box box() const noexcept {
+            return {{center.x - half, center.y - half}, {center.x + half, center.y + half}};
+        }
+
+        [[nodiscard]] std::uint32_t quadrant(point const p) const noexcept {
+            return static_cast<std::uint32_t>(p.x >= center.x) | static_cast<std::uint32_t>(p.y >= center.y) << 1;
+        }
+
+        [[nodiscard]] region child(std::uint32_t const q) const noexcept {
+            auto const h = half / 2;
+            return {{center.x + ((q & 1) != 0 ? h : -h), center.y + ((q & 2) != 0 ? h : -h)}, h};
+        }
+    };
+
+    std::vector<std::string> fields_;
+    std::vector<field_path> paths_;
+    std::vector<node> nodes_{};
+    region root_{{0., 0.}, 1.};
+    absl::flat_hash_map<document const*, point> positions_{};
+
+public:
+    explicit spatial_index(std::vector<std::string> fields)
+        : fields_(std::move(fields))
+    {
+        DEBUG_ASSERT(fields_.size() == 1 || fields_.size() == 2);
+        for (auto&& field : fields_)
+            paths_.emplace_back(field);
+    }
+
+    [[nodiscard]] span<std::string const> fields() const noexcept { return fields_; }
+    [[nodiscard]] span<field_path const> paths() const noexcept { return paths_; }
+    [[nodiscard]] std::size_t size() const noexcept { return positions_.size(); }
+    [[nodiscard]] bool empty() const noexcept { return positions_.empty(); }
+
+    [[nodiscard]] bool contains_doc(non_null_ptr<document const> const doc) const {
+        return positions_.contains(doc.get());
+    }
+
+    // return: the position `doc` holds in the indexed fields, none if they hold no pair of valid coordinates
+    [[nodiscard]] optional<point> position_of(document const& doc) const {
+        optional<double> x, y;
+        if (paths_.size() == 2) {
+            if (auto const found = doc.values().lookup(paths_[0]); found)
+                x = detail::to_coordinate(found.value());
+            if (auto const found = doc.values().lookup(paths_[1]); found)
+                y = detail::to_coordinate(found.value());
+        }
+        else if (auto const found = doc.values().lookup(paths_[0]); found) {
+            if (auto const arr = found.value().as<bson::array_t>(); arr && arr->size() == 2) {
+                x = detail::to_coordinate((*arr)[0]);
+                y = detail::to_coordinate((*arr)[1]);
+            }
+        }
+        if (x && y && detail::valid_coordinate(*x) && detail::valid_coordinate(*y))
+            return point{*x, *y};
+        return {};
+    }
+
+    // return: false if `doc` holds no valid position or is indexed already
+    bool insert(document& doc) {
+        if (auto const pos = position_of(doc); pos)
+            return insert(*pos, std::addressof(doc));
+        return false;
+    }
+
+    bool insert(point const pos, non_null_ptr<document const> const doc) {
+        if (!detail::valid_coordinate(pos.x) || !detail::valid_coordinate(pos.y) || !positions_.try_emplace(doc.get(), pos).second)
+            return false;
+        if (nodes_.empty()) {
+            nodes_.emplace_back();
+            root_ = {pos, 1.};
+        }
+        while (!root_.contains(pos))
+            grow(pos);
+
+        auto [index, reg, depth] = leaf_of(pos);
+        nodes_[index].entries.push_back(entry{pos, doc.get()});
+        if (nodes_[index].entries.size() > bucket_size)
+            split(index, reg, depth);
+        return true;
+    }
+
+    bool erase_doc(non_null_ptr<document const> const doc) {
+        auto const it = positions_.find(doc.get());
+        if (it == positions_.end())
+            return false;
+        auto& entries = nodes_[std::get<0>(leaf_of(it->second))].entries;
+        auto const found = std::find_if(entries.begin(), entries.end(), [&](entry const& e) { return e.doc == doc.get(); });
+        DEBUG_ASSERT(found != entries.end());
+        *found = entries.back();
+        entries.pop_back();
+        positions_.erase(it);
+        if (positions_.empty())
+            nodes_.clear();
+        return true;
+    }
+
+    void clear() {
+        nodes_.clear();
+        positions_.clear();
+    }
+
+    // return: the documents positioned inside `box`
+    [[nodiscard]] const_cursor lookup_box(bounding_box const& box) const {
+        std::vector<non_null_ptr<document const>> result;
+        for_each_in(box, [&](entry const& e) { result.push_back(e.doc); });
+        return multiple_index_lookup_vec{std::move(result)};
+    }
+
+    // return: the documents positioned at most `radius` away from `center`
+    [[nodiscard]] const_cursor lookup_radius(point const center, double const radius) const {
+        std::vector<non_null_ptr<document const>> result;
+        for_each_in({{center.x - radius, center.y - radius}, {center.x + radius, center.y + radius}}, [&](entry const& e) {
+            auto const dx = e.pos.x - center.x;
+            auto const dy = e.pos.y - center.y;
+            if (dx * dx + dy * dy <= radius * radius)
+                result.push_back(e.doc);
+        });
+        return multiple_index_lookup_vec{std::move(result)};
+    }
+
+private:
+    // return: the leaf holding `pos`, its region and its depth
+    [[nodiscard]] std::tuple<std::uint32_t, region, std::size_t> leaf_of(point const pos) const noexcept {
+        std::uint32_t index = 0;
+        auto reg = root_;
+        std::size_t depth = 0;
+        while (nodes_[index].children != 0) {
+            auto const q = reg.quadrant(pos);
+            index = nodes_[index].children + q;
+            reg = reg.child(q);
+            ++depth;
+        }
+        return {index, reg, depth};
+    }
+
+    // doubles the root region towards `pos`, the current root becomes one of its quadrants
+    void grow(point const pos) {
+        region const grown{{root_.center.x + (pos.x < root_.center.x ? -root_.half : root_.half),
+                            root_.center.y + (pos.y < root_.center.y ? -root_.half : root_.half)}, root_.half * 2};
+        auto const first = static_cast<std::uint32_t>(nodes_.size());
+        nodes_.resize(nodes_.size() + 4);
+        nodes_[first + grown.quadrant(root_.center)] = std::move(nodes_[0]);
+        nodes_[0] = node{{}, first};
+        root_ = grown;
+    }
+
+    void split(std::uint32_t const index, region const reg, std::size_t const depth) {
+        if (depth >= max_depth)
+            return;
+        auto const first = static_cast<std::uint32_t>(nodes_.size());
+        nodes_.resize(nodes_.size() + 4);
+        auto entries = std::move(nodes_[index].entries);
+        nodes_[index] = node{{}, first};
+        for (auto&& e : entries)
+            nodes_[first + reg.quadrant(e.pos)].entries.push_back(e);
+        // every entry may have landed in the same quadrant
+        for (std::uint32_t q = 0; q < 4; ++q)
+            if (nodes_[first + q].entries.size() > bucket_size)
+                split(first + q, reg.child(q), depth + 1);
+    }
+
+    // calls `fn(entry const&)` for every entry positioned inside `box`, visiting only the regions overlapping it
+    template<class Fn>
+    void for_each_in(bounding_box const& box, Fn&& fn) const {
+        if (nodes_.empty())
+            return;
+        std::vector<std::pair<std::uint32_t, region>> pending{{0, root_}};
+        while (!pending.empty()) {
+            auto const [index, reg] = pending.back();
+            pending.pop_back();
+            if (!box.intersects(reg.box()))
+                continue;
+            auto const& n = nodes_[index];
+            if (n.children == 0) {
+                for (auto&& e : n.entries)
+                    if (box.contains(e.pos))
+                        fn(e);
+            }
+            else
+                for (std::uint32_t q = 0; q < 4; ++q)
+                    pending.emplace_back(n.children + q, reg.child(q));
+        }
+    }
+};
+
+} // namespace nova
+
+#endif // NOVA_SPATIAL_INDEX_HPP
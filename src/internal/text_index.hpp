@@ -0,0 +1,347 @@
+#ifndef NOVA_TEXT_INDEX_HPP
+#define NOVA_TEXT_INDEX_HPP
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/node_hash_map.h>
+
+#include "../debug.hpp"
+#include "../parsing/util.hpp"
+#include "bson.hpp"
+#include "cursor.hpp"
+#include "document.hpp"
+#include "field_path.hpp"
+#include "util/non_null_ptr.hpp"
+#include "util/span.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace nova {
+
+namespace detail {
+
+// Calls `fn(term, position)` for every term of `text` in order, positions count the terms from 0.
+// A term is a run of letters and digits, lowercased as str_eq compares.
+template<class Fn>
+void tokenize(std::string_view const text, Fn&& fn) {
+    std::string term;
+    std::uint32_t position = 0;
+    for (std::size_t i = 0; i <= text.size(); ++i) {
+        if (i < text.size() && std::isalnum(static_cast<unsigned char>(text[i])))
+            term.push_back(to_lower(text[i]));
+        else if (!term.empty()) {
+            fn(std::string_view{term}, position++);
+            term.clear();
+        }
+    }
+}
+
+inline void store_varint(std::vector<std::uint8_t>& out, std::uint32_t val) {
+    for (; val >= 0x80; val >>= 7)
+        out.push_back(static_cast<std::uint8_t>(val | 0x80));
+    out.push_back(static_cast<std::uint8_t>(val));
+}
+
+[[nodiscard]] inline std::uint32_t load_varint(std::uint8_t const*& pos) noexcept {
+    std::uint32_t val = 0;
+    for (unsigned shift = 0;; shift += 7) {
+        auto const byte = *pos++;
+        val |= static_cast<std::uint32_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return val;
+    }
+}
+
+// keeps the elements of the ascending `lhs` also found in the ascending `rhs`
+inline void intersect(std::vector<std::uint32_t>& lhs, span<std::uint32_t const> const rhs) {
+    std::vector<std::uint32_t> result;
+    result.reserve(std::min(lhs.size(), rhs.size()));
+    std::set_intersection(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), std::back_inserter(result));
+    lhs = std::move(result);
+}
+
+} // namespace detail
+
+// The documents holding a term, by ascending number, along with the positions of the term in each.
+// Every entry is stored as varints: the gap to the number of the previous document, the count of positions,
+// then the gaps between positions. Documents are appended in ascending order, so an insert only writes its own entry.
+// Entries of erased documents stay in place until the list is renumbered, they are only counted off.
+class posting_list {
+    std::vector<std::uint8_t> bytes_;
+    std::uint32_t last_ = 0;
+    std::uint32_t size_ = 0;
+    std::uint32_t erased_ = 0;
+
+public:
+    // return: the entries held, erased ones included
+    [[nodiscard]] std::size_t size() const noexcept { return size_; }
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+    // return: the entries of documents not erased
+    [[nodiscard]] std::size_t live() const noexcept { return size_ - erased_; }
+    [[nodiscard]] std::size_t bytes() const noexcept { return bytes_.size(); }
+
+    // counts off the entry of an erased document, it is dropped by the next renumber
+    void mark_erased() noexcept {
+        DEBUG_ASSERT(erased_ < size_);
+        ++erased_;
+    }
+
+    // `doc` must be greater than every number held, `positions` ascending and not empty
+    void append(std::uint32_t const doc, span<std::uint32_t const> const positions) {
+        DEBUG_ASSERT(empty() || doc > last_);
+        DEBUG_ASSERT(positions.size() > 0);
+        detail::store_varint(bytes_, doc - last_);
+        detail::store_varint(bytes_, static_cast<std::uint32_t>(positions.size()));
+        std::uint32_t prev = 0;
+        for (auto const pos : positions) {
+            detail::store_varint(bytes_, pos - prev);
+            prev = pos;
+        }
+        last_ = doc;
+        ++size_;
+    }
+
+    // calls `fn(doc, positions)` for every entry, by ascending number
+    template<class Fn>
+    void for_each(Fn&& fn) const {
+        std::vector<std::uint32_t> positions;
+        auto pos = bytes_.data();
+        std::uint32_t doc = 0;
+        for (std::uint32_t i = 0; i < size_; ++i) {
+            doc += detail::load_varint(pos);
+            positions.resize(detail::load_varint(pos));
+            std::uint32_t prev = 0;
+            for (auto&& p : positions)
+                p = prev += detail::load_varint(pos);
+            fn(doc, span<std::uint32_t const>{positions});
+        }
+    }
+
+    // return: the numbers of the documents held, ascending
+    [[nodiscard]] std::vector<std::uint32_t> docs() const {
+        std::vector<std::uint32_t> result;
+        result.reserve(size_);
+        for_each([&](std::uint32_t const doc, auto&&) { result.push_back(doc); });
+        return result;
+    }
+
+    // Rewrites every entry with the number `number_of(doc)`, dropping the entries numbered `erased`.
+    // Numbers must keep their order. The list is encoded again as a whole.
+    template<class Fn>
+    void renumber(Fn&& number_of, std::uint32_t const erased) {
+        posting_list result;
+        result.bytes_.reserve(bytes_.size());
+        for_each([&](std::uint32_t const doc, span<std::uint32_t const> const positions) {
+            if (auto const number = number_of(doc); number != erased)
+                result.append(number, positions);
+        });
+        *this = std::move(result);
+    }
+};
+
+// An inverted index over the terms of a string field, answering which documents hold all, any or a sequence of terms.
+// Documents are numbered in the order they are inserted, each term keeps the compressed list of the documents
+// holding it. Inserting a document appends to the lists of its terms; erasing one only clears its number, lookups
+// skip cleared numbers. The lists are encoded again without them once erased numbers outnumber the documents held.
+// Values other than strings are not indexed.
+class text_index {
+    inline static constexpr std::uint32_t erased_number = static_cast<std::uint32_t>(-1);
+
+    struct entry {
+        std::uint32_t number;
+        std::vector<std::string_view> terms; // keys of `terms_`, node keys do not move
+    };
+
+    field_path path_;
+    absl::node_hash_map<std::string, posting_list> terms_{};
+    absl::flat_hash_map<document const*, entry> entries_{};
+    std::vector<document const*> docs_{}; // by number, null once erased
+    std::size_t erased_ = 0;
+
+public:
+    explicit text_index(std::string_view const field)
+        : path_(field) {}
+
+    [[nodiscard]] field_path const& path() const noexcept { return path_; }
+    [[nodiscard]] std::size_t size() const noexcept { return entries_.size(); }
+    [[nodiscard]] bool empty() const noexcept { return entries_.empty(); }
+    [[nodiscard]] std::size_t term_count() const noexcept { return terms_.size(); }
+
+    [[nodiscard]] bool contains_doc(non_null_ptr<document const> const doc) const {
+        return entries_.contains(doc.get());
+    }
+
+    // return: the number of documents holding `term`, compared as str_eq compares
+    [[nodiscard]] std::size_t count(std::string_view const term) const {
+        std::size_t result = 0;
+        detail::tokenize(term, [&](std::string_view const t, std::uint32_t const pos) {
+            if (pos == 0)
+                if (auto const it = terms_.find(t); it != terms_.end())
+                    result = it->second.live();
+        });
+        return result;
+    }
+
+    // return: false if `val` is not a string or `doc` is indexed already
+    bool insert(bson const& val, non_null_ptr<document> const doc) {
+        auto const text = val.as<std::string>();
+        if (!text || entries_.contains(doc.get()))
+            return false;
+
+        absl::flat_hash_map<std::string, std::vector<std::uint32_t>> positions;
+        detail::tokenize(*text, [&](std::string_view const term, std::uint32_t const pos) {
+            positions[term].push_back(pos);
+        });
+
+        auto const number = static_cast<std::uint32_t>(docs_.size());
+        auto& added = entries_.emplace(doc.get(), entry{number, {}}).first->second;
+        added.terms.reserve(positions.size());
+        for (auto&& [term, pos] : positions) {
+            auto& [key, list] = *terms_.try_emplace(term).first;
+            list.append(number, pos);
+            added.terms.push_back(key);
+        }
+        docs_.push_back(doc.get());
+        return true;
+    }
+
+    bool erase_doc(non_null_ptr<document const> const doc) {
+        auto const it = entries_.find(doc.get());
+        if (it == entries_.end())
+            return false;
+        for (auto const term : it->second.terms) {
+            auto const list = terms_.find(term);
+            list->second.mark_erased();
+            if (list->second.live() == 0)
+                terms_.erase(list);
+        }
+        docs_[it->second.number] = nullptr;
+        ++erased_;
+        entries_.erase(it);
+        if (erased_ > 64 && erased_ > entries_.size())
+            compact();
+        return true;
+    }
+
+    void clear() {
+        terms_.clear();
+        entries_.clear();
+        docs_.clear();
+        erased_ = 0;
+    }
+
+    // return: the documents holding every term of `text`, none if `text` holds no term
+    [[nodiscard]] const_cursor lookup_all(std::string_view const text) const {
+        return to_cursor(match_all(terms_of(text)));
+    }
+
+    // return: the documents holding any term of `text`
+    [[nodiscard]] const_cursor lookup_any(std::string_view const text) const {
+        std::vector<std::uint32_t> result;
+        for (auto&& term : terms_of(text)) {
+            if (auto const it = terms_.find(term); it != terms_.end()) {
+                auto const docs = it->second.docs();
+                std::vector<std::uint32_t> merged;
+                merged.reserve(result.size() + docs.size());
+                std::set_union(result.begin(), result.end(), docs.begin(), docs.end(), std::back_inserter(merged));
+                result = std::move(merged);
+            }
+        }
+        return to_cursor(result);
+    }
+
+    // return: the documents holding the terms of `text` next to each other and in order, none if `text` holds no term
+    [[nodiscard]] const_cursor lookup_phrase(std::string_view const text) const {
+        auto const terms = terms_of(text);
+        auto const candidates = match_all(terms);
+        // the positions each candidate could start the phrase at, narrowed down term by term
+        std::vector<std::vector<std::uint32_t>> starts(candidates.size());
+        for (std::uint32_t i = 0; i < terms.size() && !candidates.empty(); ++i) {
+            std::size_t c = 0;
+            terms_.find(terms[i])->second.for_each([&](std::uint32_t const doc, span<std::uint32_t const> const positions) {
+                for (; c < candidates.size() && candidates[c] < doc; ++c) {}
+                if (c == candidates.size() || candidates[c] != doc)
+                    return;
+                std::vector<std::uint32_t> shifted;
+                for (auto const pos : positions)
+                    if (pos >= i)
+                        shifted.push_back(pos - i);
+                if (i == 0)
+                    starts[c] = std::move(shifted);
+                else
+                    detail::intersect(starts[c], shifted);
+            });
+        }
+        std::vector<std::uint32_t> result;
+        for (std::size_t c = 0; c < candidates.size(); ++c)
+            if (!starts[c].empty())
+                result.push_back(candidates[c]);
+        return to_cursor(result);
+    }
+
+private:
+    [[nodiscard]] static std::vector<std::string> terms_of(std::string_view const text) {
+        std::vector<std::string> terms;
+        detail::tokenize(text, [&](std::string_view const term, std::uint32_t) { terms.emplace_back(term); });
+        return terms;
+    }
+
+    // return: the numbers of the documents holding every term of `terms`, ascending, erased ones left out
+    [[nodiscard]] std::vector<std::uint32_t> match_all(span<std::string const> const terms) const {
+        std::vector<posting_list const*> lists;
+        for (auto&& term : terms) {
+            auto const it = terms_.find(term);
+            if (it == terms_.end())
+                return {};
+            lists.push_back(std::addressof(it->second));
+        }
+        if (lists.empty())
+            return {};
+        // intersect the shortest lists first, the result only shrinks
+        std::sort(lists.begin(), lists.end(), [](auto const* a, auto const* b) { return a->size() < b->size(); });
+        auto result = lists.front()->docs();
+        result.erase(std::remove_if(result.begin(), result.end(), [this](std::uint32_t const n) { return docs_[n] == nullptr; }), result.end());
+        for (std::size_t i = 1; i < lists.size() && !result.empty(); ++i)
+            detail::intersect(result, lists[i]->docs());
+        return result;
+    }
+
+    [[nodiscard]] const_cursor to_cursor(span<std::uint32_t const> const numbers) const {
+        // the cursor yields from the back, documents come out in the order they were inserted
+        std::vector<non_null_ptr<document const>> result;
+        result.reserve(numbers.size());
+        for (auto it = numbers.end(); it != numbers.begin();)
+            if (auto const doc = docs_[*--it])
+                result.push_back(doc);
+        return multiple_index_lookup_vec{std::move(result)};
+    }
+
+    // numbers the documents held from 0 again, in the same order
+    void compact() {
+        std::vector<std::uint32_t> numbers(docs_.size(), erased_number);
+        std::vector<document const*> docs;
+        docs.reserve(entries_.size());
+        for (std::size_t i = 0; i < docs_.size(); ++i) {
+            if (docs_[i]) {
+                numbers[i] = static_cast<std::uint32_t>(docs.size());
+                docs.push_back(docs_[i]);
+            }
+        }
+        for (auto&& [term, list] : terms_)
+            list.renumber([&numbers](std::uint32_t const doc) { return numbers[doc]; }, erased_number);
+        for (auto&& [doc, e] : entries_)
+            e.number = numbers[e.number];
+        docs_ = std::move(docs);
+        erased_ = 0;
+    }
+};
+
+} // namespace nova
+
+#endif // NOVA_TEXT_INDEX_HPP
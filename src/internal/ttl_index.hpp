@@ -0,0 +1,147 @@
+#ifndef NOVA_TTL_INDEX_HPP
+#define NOVA_TTL_INDEX_HPP
+
+#include <absl/container/btree_set.h>
+#include <absl/container/flat_hash_map.h>
+
+#include "bson.hpp"
+#include "document.hpp"
+#include "field_path.hpp"
+#include "util/non_null_ptr.hpp"
+#include "util/optional.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <utility>
+
+namespace nova {
+
+// the time a document expires at, with the seconds resolution of unique_id timestamps
+using expiry_time = std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds>;
+
+struct ttl_options {
+    // how long a document lives past its timestamp
+    std::chrono::seconds ttl{0};
+    // the date field holding the timestamp, the timestamp of the document's unique_id when empty
+    std::string field{};
+    // documents erased at most by a batch of the reaper
+    std::size_t batch_size = 128;
+    // time between two batches of the reaper run by the collection's writes
+    std::chrono::milliseconds interval{50};
+};
+
+namespace detail {
+
+// return: the time `val` holds, none unless it is a unique_id or a number of seconds since the Unix epoch
+[[nodiscard]] inline optional<expiry_time> to_timestamp(bson const& val) noexcept {
+    auto const seconds = [](auto const count) { return expiry_time{std::chrono::seconds{static_cast<std::int64_t>(count)}}; };
+    // beyond +-2^62 seconds a time is of no use and no longer fits the duration
+    auto const from_fraction = [&](double const count) {
+        optional<expiry_time> result;
+        if (auto const floored = std::floor(count); std::isfinite(floored) && std::abs(floored) < 0x1p62)
+            result.emplace(seconds(floored));
+        return result;
+    };
+    switch (val.type()) {
+        case bson::types::UniqueID: return std::chrono::time_point_cast<std::chrono::seconds>(val.as<unique_id>()->time_point());
+        case bson::types::Int32: return seconds(*val.as<std::int32_t>());
+        case bson::types::Int64: return seconds(*val.as<std::int64_t>());
+        case bson::types::uInt32: return seconds(*val.as<std::uint32_t>());
+        case bson::types::uInt64:
+            if (*val.as<std::uint64_t>() > static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max()))
+                return {};
+            return seconds(*val.as<std::uint64_t>());
+        case bson::types::Float: return from_fraction(static_cast<double>(*val.as<float>()));
+        case bson::types::Double: return from_fraction(*val.as<double>());
+        default: return {};
+    }
+}
+
+} // namespace detail
+
+// An index of the time each document expires at, ordered by time so the expired documents are found oldest first
+// without a scan of the collection. A document expires `ttl` after the timestamp of its unique_id, or after the time
+// held by a date field: a unique_id or a number of seconds since the Unix epoch. Documents without one never expire.
+class ttl_index {
+    ttl_options options_;
+    optional<field_path> path_{};
+    absl::btree_set<std::pair<expiry_time, document const*>> by_time_{};
+    absl::flat_hash_map<document const*, expiry_time> expiries_{};
+
+public:
+    explicit ttl_index(ttl_options options)
+        : options_(std::move(options))
+    {
+        if (!options_.field.empty())
+            path_.emplace(options_.field);
+    }
+
+    [[nodiscard]] ttl_options const& options() const noexcept { return options_; }
+    [[nodiscard]] std::size_t size() const noexcept { return expiries_.size(); }
+    [[nodiscard]] bool empty() const noexcept { return expiries_.empty(); }
+
+    [[nodiscard]] bool contains_doc(non_null_ptr<document const> const doc) const {
+        return expiries_.contains(doc.get());
+    }
+
+    // return: the time `doc` expires at, none if it holds no timestamp
+    [[nodiscard]] optional<expiry_time> expiry_of(document const& doc) const {
+        optional<expiry_time> expiry;
+        if (!path_) {
+            if (doc.id().type() == bson::types::UniqueID) // other ids are no times, even if they are numbers
+                expiry = detail::to_timestamp(doc.id());
+        }
+        else if (auto const found = doc.values().lookup(*path_); found)
+            expiry = detail::to_timestamp(found.value());
+        if (expiry)
+            *expiry += options_.ttl;
+        return expiry;
+    }
+
+    // return: false if `doc` holds no timestamp or is indexed already
+    bool insert(document const& doc) {
+        auto const expiry = expiry_of(doc);
+        if (!expiry || !expiries_.try_emplace(std::addressof(doc), *expiry).second)
+            return false;
+        by_time_.emplace(*expiry, std::addressof(doc));
+        return true;
+    }
+
+    bool erase_doc(non_null_ptr<document const> const doc) {
+        auto const it = expiries_.find(doc.get());
+        if (it == expiries_.end())
+            return false;
+        by_time_.erase({it->second, doc.get()});
+        expiries_.erase(it);
+        return true;
+    }
+
+    void clear() {
+        by_time_.clear();
+        expiries_.clear();
+    }
+
+    // return: the time the next document expires at, none if no document expires
+    [[nodiscard]] optional<expiry_time> next_expiry() const {
+        if (by_time_.empty())
+            return {};
+        return by_time_.begin()->first;
+    }
+
+    // calls `fn(document const&)` for up to `max` documents expired at `now`, oldest first
+    // return: the number of documents `fn` was called for
+    template<class Fn>
+    std::size_t for_each_expired(expiry_time const now, std::size_t const max, Fn&& fn) const {
+        std::size_t count = 0;
+        for (auto it = by_time_.begin(); it != by_time_.end() && count < max && it->first <= now; ++it, ++count)
+            fn(*it->second);
+        return count;
+    }
+};
+
+} // namespace nova
+
+#endif // NOVA_TTL_INDEX_HPP
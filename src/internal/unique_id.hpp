@@ -74,6 +74,24 @@ public:
         return *this;
     }
 
+    // number of bytes written by `to_bytes` and read by `from_bytes`
+    inline static constexpr std::size_t byte_size = sizeof(tp_t) + sizeof(std::uint64_t);
+
+    void to_bytes(void* const dst) const noexcept {
+        auto const count = time_.time_since_epoch().count();
+        std::memcpy(dst, &count, sizeof(count));
+        std::memcpy(static_cast<char*>(dst) + sizeof(count), &u64_, sizeof(u64_));
+    }
+
+    [[nodiscard]] static unique_id from_bytes(void const* const src) noexcept {
+        unique_id id;
+        typename dur_t::rep count{};
+        std::memcpy(&count, src, sizeof(count));
+        std::memcpy(&id.u64_, static_cast<char const*>(src) + sizeof(count), sizeof(id.u64_));
+        id.time_ = tp_t{dur_t{count}};
+        return id;
+    }
+
     [[nodiscard]] static unique_id generate() {
         thread_local std::random_device rd{};
         thread_local std::mt19937_64 engine{rd()};
@@ -86,7 +104,7 @@ public:
     }
 
     constexpr bool operator<(unique_id const& other) const noexcept {
-        return time_ < other.time_ && u64_ < other.u64_;
+        return time_ < other.time_ || (time_ == other.time_ && u64_ < other.u64_);
     }
 
     [[nodiscard]] constexpr auto time_point() const noexcept {
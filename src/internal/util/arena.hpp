@@ -0,0 +1,135 @@
+#ifndef NOVA_ARENA_HPP
+#define NOVA_ARENA_HPP
+
+#include "../../debug.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <utility>
+
+namespace nova {
+
+// A bump allocator handing out memory from a list of geometrically growing blocks.
+// Small deallocated blocks are kept on per-size free lists and recycled by later allocations
+// of the same size, nothing is returned to the global heap until `release()` is called
+// or the arena is destroyed.
+class arena final : public std::pmr::memory_resource {
+    struct block {
+        block* next;
+        std::size_t size; // usable bytes following the header
+    };
+
+    struct free_node {
+        free_node* next;
+    };
+
+    inline static constexpr std::size_t initial_block_size = 64 * 1024;
+    inline static constexpr std::size_t max_block_size = 4 * 1024 * 1024;
+    inline static constexpr std::size_t size_class_granularity = 16;
+    inline static constexpr std::size_t max_recycled_size = 4096;
+    inline static constexpr std::size_t size_class_count = max_recycled_size / size_class_granularity;
+
+    block* head_ = nullptr;
+    free_node* free_lists_[size_class_count] = {};
+    std::byte* cur_ = nullptr;
+    std::byte* end_ = nullptr;
+    std::size_t next_block_size_ = initial_block_size;
+    std::size_t reserved_ = 0;
+    std::size_t used_ = 0;
+
+    [[nodiscard]] static std::byte* block_data(block* const b) noexcept {
+        return reinterpret_cast<std::byte*>(b) + sizeof(block);
+    }
+
+    void add_block(std::size_t const min_size, std::size_t const alignment) {
+        auto const size = std::max(next_block_size_, min_size + alignment);
+        auto const b = static_cast<block*>(::operator new(sizeof(block) + size));
+        b->next = head_;
+        b->size = size;
+        head_ = b;
+        cur_ = block_data(b);
+        end_ = cur_ + size;
+        reserved_ += size;
+        next_block_size_ = std::min(next_block_size_ * 2, max_block_size);
+    }
+
+    [[nodiscard]] static constexpr bool is_recyclable(std::size_t const bytes, std::size_t const alignment) noexcept {
+        return bytes <= max_recycled_size && alignment <= size_class_granularity;
+    }
+
+    [[nodiscard]] static constexpr std::size_t size_class(std::size_t const bytes) noexcept {
+        return bytes == 0 ? 0 : (bytes - 1) / size_class_granularity;
+    }
+
+    void* do_allocate(std::size_t const requested, std::size_t alignment) final {
+        auto bytes = requested;
+        used_ += requested;
+        if (is_recyclable(bytes, alignment)) {
+            auto& list = free_lists_[size_class(bytes)];
+            if (list)
+                return std::exchange(list, list->next);
+            bytes = (size_class(bytes) + 1) * size_class_granularity;
+            alignment = size_class_granularity;
+        }
+
+        auto aligned = [&] {
+            auto const addr = reinterpret_cast<std::uintptr_t>(cur_);
+            return reinterpret_cast<std::byte*>((addr + alignment - 1) & ~(alignment - 1));
+        };
+
+        auto ptr = aligned();
+        if (cur_ == nullptr || ptr + bytes > end_) {
+            add_block(bytes, alignment);
+            ptr = aligned();
+        }
+        DEBUG_ASSERT(ptr + bytes <= end_);
+        cur_ = ptr + bytes;
+        return ptr;
+    }
+
+    void do_deallocate(void* const ptr, std::size_t const bytes, std::size_t const alignment) noexcept final {
+        if (is_recyclable(bytes, alignment)) {
+            auto& list = free_lists_[size_class(bytes)];
+            list = ::new (ptr) free_node{list};
+        }
+        used_ -= bytes;
+    }
+
+    [[nodiscard]] bool do_is_equal(std::pmr::memory_resource const& other) const noexcept final {
+        return this == std::addressof(other);
+    }
+
+public:
+    arena() noexcept = default;
+
+    arena(arena const&) = delete;
+    arena& operator=(arena const&) = delete;
+
+    ~arena() { release(); }
+
+    // free every block owned by the arena, invalidating all memory handed out
+    void release() noexcept {
+        while (head_) {
+            auto const next = head_->next;
+            ::operator delete(head_);
+            head_ = next;
+        }
+        cur_ = end_ = nullptr;
+        std::fill(std::begin(free_lists_), std::end(free_lists_), nullptr);
+        next_block_size_ = initial_block_size;
+        reserved_ = used_ = 0;
+    }
+
+    // return: total bytes obtained from the global heap
+    [[nodiscard]] std::size_t bytes_reserved() const noexcept { return reserved_; }
+
+    // return: total bytes currently handed out to callers
+    [[nodiscard]] std::size_t bytes_used() const noexcept { return used_; }
+};
+
+} // namespace nova
+
+#endif // NOVA_ARENA_HPP
@@ -0,0 +1,133 @@
+#ifndef NOVA_BITMAP_HPP
+#define NOVA_BITMAP_HPP
+
+#include "../../debug.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace nova {
+
+// A dense, growable sequence of bits stored in 64 bit words.
+// Bits past `size()` in the last word are always zero.
+class bitmap {
+    std::vector<std::uint64_t> words_{};
+    std::size_t size_ = 0;
+
+    [[nodiscard]] static constexpr std::size_t word_count(std::size_t const bits) noexcept {
+        return (bits + 63) / 64;
+    }
+
+    void clear_tail() noexcept {
+        if (auto const rem = size_ % 64; rem != 0)
+            words_.back() &= (std::uint64_t{1} << rem) - 1;
+    }
+
+public:
+    bitmap() = default;
+    explicit bitmap(std::size_t const size, bool const value = false)
+        : words_(word_count(size), value ? ~std::uint64_t{0} : 0), size_(size)
+    {
+        clear_tail();
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept { return size_; }
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+
+    [[nodiscard]] bool test(std::size_t const i) const noexcept {
+        DEBUG_ASSERT(i < size_);
+        return (words_[i / 64] >> (i % 64)) & 1;
+    }
+
+    void set(std::size_t const i, bool const value = true) noexcept {
+        DEBUG_ASSERT(i < size_);
+        auto const mask = std::uint64_t{1} << (i % 64);
+        if (value)
+            words_[i / 64] |= mask;
+        else
+            words_[i / 64] &= ~mask;
+    }
+
+    void push_back(bool const value) {
+        if (size_ % 64 == 0)
+            words_.push_back(0);
+        ++size_;
+        set(size_ - 1, value);
+    }
+
+    void pop_back() noexcept {
+        DEBUG_ASSERT(size_ > 0);
+        set(size_ - 1, false);
+        --size_;
+        if (size_ % 64 == 0)
+            words_.pop_back();
+    }
+
+    // moves the last bit into position `i` and shrinks by one, mirroring `slot_map::erase`
+    void swap_remove(std::size_t const i) noexcept {
+        DEBUG_ASSERT(i < size_);
+        set(i, test(size_ - 1));
+        pop_back();
+    }
+
+    void resize(std::size_t const size) {
+        words_.resize(word_count(size), 0);
+        size_ = size;
+        clear_tail();
+    }
+
+    void clear() noexcept {
+        words_.clear();
+        size_ = 0;
+    }
+
+    [[nodiscard]] std::size_t count() const noexcept {
+        std::size_t n = 0;
+        for (auto const w : words_)
+            n += static_cast<std::size_t>(__builtin_popcountll(w));
+        return n;
+    }
+
+    bitmap& operator&=(bitmap const& other) noexcept {
+        DEBUG_ASSERT(size_ == other.size_);
+        for (std::size_t i = 0; i < words_.size(); ++i)
+            words_[i] &= other.words_[i];
+        return *this;
+    }
+
+    bitmap& operator|=(bitmap const& other) noexcept {
+        DEBUG_ASSERT(size_ == other.size_);
+        for (std::size_t i = 0; i < words_.size(); ++i)
+            words_[i] |= other.words_[i];
+        return *this;
+    }
+
+    // calls `f` with the position of every set bit, in increasing order
+    template<class F>
+    void for_each_set(F&& f) const {
+        for (std::size_t w = 0; w < words_.size(); ++w) {
+            for (auto word = words_[w]; word != 0; word &= word - 1)
+                f(w * 64 + static_cast<std::size_t>(__builtin_ctzll(word)));
+        }
+    }
+
+    // return: the positions of every set bit, in increasing order
+    [[nodiscard]] std::vector<std::uint32_t> to_selection() const {
+        std::vector<std::uint32_t> selection;
+        selection.reserve(count());
+        for_each_set([&selection](std::size_t const i) { selection.push_back(static_cast<std::uint32_t>(i)); });
+        return selection;
+    }
+
+    [[nodiscard]] std::uint64_t* data() noexcept { return words_.data(); }
+    [[nodiscard]] std::uint64_t const* data() const noexcept { return words_.data(); }
+    [[nodiscard]] std::size_t word_size() const noexcept { return words_.size(); }
+
+    bool operator==(bitmap const& other) const noexcept {
+        return size_ == other.size_ && words_ == other.words_;
+    }
+};
+
+} // namespace nova
+
+#endif // NOVA_BITMAP_HPP
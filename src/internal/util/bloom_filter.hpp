@@ -0,0 +1,78 @@
+#ifndef NOVA_BLOOM_FILTER_HPP
+#define NOVA_BLOOM_FILTER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace nova {
+
+// A Bloom filter over well mixed hashes. `may_contain` is true for every hash inserted, and for about 1% of the
+// others while it holds no more than its capacity. A default constructed filter is disabled and may contain anything.
+// Hashes cannot be removed, a filter is rebuilt from the hashes still held once it is `stale`.
+class bloom_filter {
+    // 10 bits and 7 probes per hash give about 1% false positives at capacity
+    inline static constexpr std::size_t bits_per_hash = 10;
+    inline static constexpr std::size_t probes = 7;
+    inline static constexpr std::size_t min_capacity = 1024;
+
+    std::vector<std::uint64_t> words_{};
+    std::uint64_t mask_ = 0; // bit count - 1, the bit count is a power of 2
+    std::size_t capacity_ = 0;
+    std::size_t count_ = 0;
+
+    // the i-th probe of `hash`, by double hashing of its two halves
+    [[nodiscard]] std::uint64_t probe(std::uint64_t const hash, std::size_t const i) const noexcept {
+        auto const step = (hash >> 32 | hash << 32) | 1;
+        return (hash + i * step) & mask_;
+    }
+
+public:
+    bloom_filter() = default;
+
+    explicit bloom_filter(std::size_t const capacity) {
+        std::uint64_t bits = 64;
+        while (bits < std::max(capacity, min_capacity) * bits_per_hash)
+            bits *= 2;
+        words_.assign(static_cast<std::size_t>(bits / 64), 0);
+        mask_ = bits - 1;
+        capacity_ = static_cast<std::size_t>(bits / bits_per_hash);
+    }
+
+    [[nodiscard]] bool enabled() const noexcept { return !words_.empty(); }
+    [[nodiscard]] std::size_t capacity() const noexcept { return capacity_; }
+    // the number of hashes inserted, repeated hashes included
+    [[nodiscard]] std::size_t count() const noexcept { return count_; }
+
+    void insert(std::uint64_t const hash) noexcept {
+        if (!enabled())
+            return;
+        for (std::size_t i = 0; i < probes; ++i) {
+            auto const bit = probe(hash, i);
+            words_[bit / 64] |= std::uint64_t{1} << (bit % 64);
+        }
+        ++count_;
+    }
+
+    [[nodiscard]] bool may_contain(std::uint64_t const hash) const noexcept {
+        if (!enabled())
+            return true;
+        for (std::size_t i = 0; i < probes; ++i) {
+            auto const bit = probe(hash, i);
+            if ((words_[bit / 64] & std::uint64_t{1} << (bit % 64)) == 0)
+                return false;
+        }
+        return true;
+    }
+
+    // return: whether the filter is worth rebuilding for the `held` hashes still held,
+    // because it grew past its capacity or holds more than twice as many hashes
+    [[nodiscard]] bool stale(std::size_t const held) const noexcept {
+        return enabled() && (count_ > capacity_ || count_ > 2 * held + min_capacity);
+    }
+};
+
+} // namespace nova
+
+#endif // NOVA_BLOOM_FILTER_HPP
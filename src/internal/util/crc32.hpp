@@ -0,0 +1,39 @@
+#ifndef NOVA_CRC32_HPP
+#define NOVA_CRC32_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace nova {
+
+namespace detail {
+
+// table for the reflected IEEE 802.3 polynomial
+inline constexpr std::array<std::uint32_t, 256> make_crc32_table() noexcept {
+    std::array<std::uint32_t, 256> table{};
+    for (std::uint32_t i = 0; i < 256; ++i) {
+        std::uint32_t c = i;
+        for (int k = 0; k < 8; ++k)
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        table[i] = c;
+    }
+    return table;
+}
+
+inline constexpr auto crc32_table = make_crc32_table();
+
+} // namespace detail
+
+// return: the crc of `data`, continuing from a previous `crc` when computing over several buffers
+[[nodiscard]] inline std::uint32_t crc32(void const* const data, std::size_t const size, std::uint32_t crc = 0) noexcept {
+    auto const bytes = static_cast<unsigned char const*>(data);
+    crc = ~crc;
+    for (std::size_t i = 0; i < size; ++i)
+        crc = detail::crc32_table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+} // namespace nova
+
+#endif // NOVA_CRC32_HPP
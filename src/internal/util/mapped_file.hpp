@@ -0,0 +1,98 @@
+#ifndef NOVA_MAPPED_FILE_HPP
+#define NOVA_MAPPED_FILE_HPP
+
+#include "span.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+namespace nova {
+
+// A read only, shared mapping of an entire file.
+// Pages are loaded lazily by the kernel and shared with every other process mapping the same file.
+class mapped_file {
+    std::byte const* data_ = nullptr;
+    std::size_t size_ = 0;
+
+    void unmap() noexcept {
+        if (data_)
+            ::munmap(const_cast<std::byte*>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+public:
+    enum class status : std::uint8_t { ok, not_found, io_error };
+
+    mapped_file() noexcept = default;
+
+    mapped_file(mapped_file&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr))
+        , size_(std::exchange(other.size_, 0))
+    {}
+
+    mapped_file& operator=(mapped_file&& other) noexcept {
+        if (this != &other) {
+            unmap();
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+        }
+        return *this;
+    }
+
+    mapped_file(mapped_file const&) = delete;
+    mapped_file& operator=(mapped_file const&) = delete;
+
+    ~mapped_file() { unmap(); }
+
+    [[nodiscard]] status open(std::string const& path) noexcept {
+        unmap();
+        auto const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return errno == ENOENT ? status::not_found : status::io_error;
+
+        struct stat st{};
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            return status::io_error;
+        }
+        if (st.st_size > 0) {
+            auto const ptr = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+            if (ptr == MAP_FAILED) {
+                ::close(fd);
+                return status::io_error;
+            }
+            data_ = static_cast<std::byte const*>(ptr);
+            size_ = static_cast<std::size_t>(st.st_size);
+        }
+        // the mapping keeps the file alive
+        ::close(fd);
+        return status::ok;
+    }
+
+    // hints that the whole file will be read front to back
+    void advise_sequential() const noexcept {
+        if (data_)
+            static_cast<void>(::madvise(const_cast<std::byte*>(data_), size_, MADV_SEQUENTIAL));
+    }
+
+    [[nodiscard]] bool is_open() const noexcept { return data_ != nullptr; }
+    [[nodiscard]] std::byte const* data() const noexcept { return data_; }
+    [[nodiscard]] std::size_t size() const noexcept { return size_; }
+    [[nodiscard]] span<std::byte const> bytes() const noexcept {
+        static constexpr std::byte empty{};
+        return {data_ ? data_ : &empty, size_};
+    }
+};
+
+} // namespace nova
+
+#endif // NOVA_MAPPED_FILE_HPP
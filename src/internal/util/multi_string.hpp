@@ -28,12 +28,12 @@ class multi_string {
         storage_ = new char[size_of_ptrs + size_of_strs];
 
         // assign pointer values
-        *ptrs_ptr() = reinterpret_cast<char const*>(ptrs_ptr() + size_of_ptrs);
-        for (std::size_t i = 0; i < size_ + 1; ++i)
+        *ptrs_ptr() = storage_ + size_of_ptrs;
+        for (std::size_t i = 0; i < size_; ++i)
             ptrs_ptr()[i + 1] = ptrs_ptr()[i] + (other.ptrs_ptr()[i + 1] - other.ptrs_ptr()[i]);
 
         // copy over characters
-        std::memcpy(ptrs_ptr() + size_of_ptrs, other.ptrs_ptr() + size_of_ptrs, size_of_strs);
+        std::memcpy(storage_ + size_of_ptrs, other.storage_ + size_of_ptrs, size_of_strs);
     }
 
 public:
@@ -58,7 +58,7 @@ public:
         storage_ = new char[size_of_ptrs + size_of_strs];
 
         char** ptrs_ptr = reinterpret_cast<char**>(storage_);
-        char* strs_ptr = reinterpret_cast<char*>(ptrs_ptr + size_of_ptrs);
+        char* strs_ptr = storage_ + size_of_ptrs;
 
         // assign pointer value and copy string characters
         auto create_strings = [&](std::string_view const view) {
@@ -0,0 +1,58 @@
+#ifndef NOVA_PARALLEL_SORT_HPP
+#define NOVA_PARALLEL_SORT_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+namespace nova {
+
+// Stable sort of [first, last) on up to `max_threads` threads.
+// Chunks of equal size are sorted on their own threads, then merged pairwise, elements that compare equal keep their order.
+template<class It, class Cmp>
+void parallel_stable_sort(It const first, It const last, Cmp cmp, std::size_t const max_threads = std::thread::hardware_concurrency()) {
+    // below this many elements per thread, threads cost more than they save
+    constexpr std::size_t min_chunk = 1 << 14;
+
+    auto const size = static_cast<std::size_t>(std::distance(first, last));
+    auto const chunks = std::min(std::max<std::size_t>(max_threads, 1), std::max<std::size_t>(size / min_chunk, 1));
+    if (chunks == 1) {
+        std::stable_sort(first, last, cmp);
+        return;
+    }
+
+    std::vector<It> bounds;
+    bounds.reserve(chunks + 1);
+    for (std::size_t i = 0; i < chunks; ++i)
+        bounds.push_back(std::next(first, static_cast<std::ptrdiff_t>(size * i / chunks)));
+    bounds.push_back(last);
+
+    auto run = [](std::size_t const count, auto&& task) {
+        std::vector<std::thread> threads;
+        for (std::size_t i = 1; i < count; ++i)
+            threads.emplace_back(task, i);
+        task(0);
+        for (auto&& t : threads)
+            t.join();
+    };
+
+    run(chunks, [&](std::size_t const i) { std::stable_sort(bounds[i], bounds[i + 1], cmp); });
+
+    // merge neighbouring runs until one is left
+    for (std::size_t width = 1; width < chunks; width *= 2) {
+        auto const merges = (chunks + 2 * width - 1) / (2 * width);
+        run(merges, [&](std::size_t const i) {
+            auto const lo = i * 2 * width;
+            auto const mid = std::min(lo + width, chunks);
+            auto const hi = std::min(lo + 2 * width, chunks);
+            if (mid < hi)
+                std::inplace_merge(bounds[lo], bounds[mid], bounds[hi], cmp);
+        });
+    }
+}
+
+} // namespace nova
+
+#endif // NOVA_PARALLEL_SORT_HPP
@@ -0,0 +1,297 @@
+#ifndef NOVA_ROARING_BITMAP_HPP
+#define NOVA_ROARING_BITMAP_HPP
+
+#include "../../debug.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace nova {
+
+// A compressed set of 32 bit integers, after Roaring bitmaps.
+// Values are split by their high 16 bits into containers of their low 16 bits. A container holds a sorted array of
+// up to `array_max` values and a bitset of 65536 bits past that, so a sparse container costs 2 bytes per value and a
+// dense one at most 8 KiB. Intersections and unions go container by container, word by word between bitsets.
+class roaring_bitmap {
+    inline static constexpr std::uint32_t array_max = 4096;
+    inline static constexpr std::size_t bitset_words = 1024;
+
+    struct container {
+        std::vector<std::uint16_t> array{};
+        std::vector<std::uint64_t> bits{}; // `bitset_words` words when a bitset, empty when an array
+        std::uint32_t cardinality = 0;
+
+        [[nodiscard]] bool is_bitset() const noexcept { return !bits.empty(); }
+
+        [[nodiscard]] bool contains(std::uint16_t const low) const noexcept {
+            if (is_bitset())
+                return (bits[low / 64] >> (low % 64)) & 1;
+            return std::binary_search(array.begin(), array.end(), low);
+        }
+
+        bool add(std::uint16_t const low) {
+            if (is_bitset()) {
+                auto& word = bits[low / 64];
+                auto const mask = std::uint64_t{1} << (low % 64);
+                if (word & mask)
+                    return false;
+                word |= mask;
+            }
+            else {
+                auto const it = std::lower_bound(array.begin(), array.end(), low);
+                if (it != array.end() && *it == low)
+                    return false;
+                array.insert(it, low);
+            }
+            if (++cardinality > array_max && !is_bitset())
+                to_bitset();
+            return true;
+        }
+
+        bool remove(std::uint16_t const low) {
+            if (is_bitset()) {
+                auto& word = bits[low / 64];
+                auto const mask = std::uint64_t{1} << (low % 64);
+                if (!(word & mask))
+                    return false;
+                word &= ~mask;
+            }
+            else {
+                auto const it = std::lower_bound(array.begin(), array.end(), low);
+                if (it == array.end() || *it != low)
+                    return false;
+                array.erase(it);
+            }
+            if (--cardinality <= array_max && is_bitset())
+                to_array();
+            return true;
+        }
+
+        template<class Fn>
+        void for_each(std::uint32_t const high, Fn&& fn) const {
+            if (!is_bitset()) {
+                for (auto const low : array)
+                    fn(high | low);
+                return;
+            }
+            for (std::size_t w = 0; w < bitset_words; ++w)
+                for (auto word = bits[w]; word != 0; word &= word - 1)
+                    fn(high | static_cast<std::uint32_t>(w * 64 + static_cast<std::size_t>(__builtin_ctzll(word))));
+        }
+
+        void to_bitset() {
+            bits.assign(bitset_words, 0);
+            for (auto const low : array)
+                bits[low / 64] |= std::uint64_t{1} << (low % 64);
+            array = {};
+        }
+
+        void to_array() {
+            std::vector<std::uint16_t> values;
+            values.reserve(cardinality);
+            for_each(0, [&](std::uint32_t const low) { values.push_back(static_cast<std::uint16_t>(low)); });
+            array = std::move(values);
+            bits = {};
+        }
+
+        // the bitset `bits` holds, with its cardinality counted again, as the container fitting it
+        void settle_bitset() {
+            cardinality = 0;
+            for (auto const word : bits)
+                cardinality += static_cast<std::uint32_t>(__builtin_popcountll(word));
+            if (cardinality <= array_max)
+                to_array();
+        }
+
+        container& operator&=(container const& other) {
+            if (!is_bitset() && !other.is_bitset()) {
+                std::vector<std::uint16_t> result;
+                result.reserve(std::min(array.size(), other.array.size()));
+                std::set_intersection(array.begin(), array.end(), other.array.begin(), other.array.end(), std::back_inserter(result));
+                array = std::move(result);
+                cardinality = static_cast<std::uint32_t>(array.size());
+            }
+            else if (!is_bitset()) {
+                array.erase(std::remove_if(array.begin(), array.end(), [&](std::uint16_t const low) { return !other.contains(low); }), array.end());
+                cardinality = static_cast<std::uint32_t>(array.size());
+            }
+            else if (!other.is_bitset()) {
+                auto result = other;
+                result &= *this;
+                *this = std::move(result);
+            }
+            else {
+                for (std::size_t w = 0; w < bitset_words; ++w)
+                    bits[w] &= other.bits[w];
+                settle_bitset();
+            }
+            return *this;
+        }
+
+        container& operator|=(container const& other) {
+            if (!is_bitset() && !other.is_bitset() && cardinality + other.cardinality <= array_max) {
+                std::vector<std::uint16_t> result;
+                result.reserve(array.size() + other.array.size());
+                std::set_union(array.begin(), array.end(), other.array.begin(), other.array.end(), std::back_inserter(result));
+                array = std::move(result);
+                cardinality = static_cast<std::uint32_t>(array.size());
+                return *this;
+            }
+            if (!is_bitset())
+                to_bitset();
+            if (other.is_bitset())
+                for (std::size_t w = 0; w < bitset_words; ++w)
+                    bits[w] |= other.bits[w];
+            else
+                for (auto const low : other.array)
+                    bits[low / 64] |= std::uint64_t{1} << (low % 64);
+            settle_bitset();
+            return *this;
+        }
+
+        bool operator==(container const& other) const noexcept {
+            return array == other.array && bits == other.bits;
+        }
+    };
+
+    // containers by the high 16 bits of their values, ascending
+    std::vector<std::uint16_t> keys_{};
+    std::vector<container> containers_{};
+    std::size_t size_ = 0;
+
+    [[nodiscard]] std::size_t find(std::uint16_t const key) const noexcept {
+        return static_cast<std::size_t>(std::lower_bound(keys_.begin(), keys_.end(), key) - keys_.begin());
+    }
+
+    void erase_container(std::size_t const i) {
+        keys_.erase(keys_.begin() + static_cast<std::ptrdiff_t>(i));
+        containers_.erase(containers_.begin() + static_cast<std::ptrdiff_t>(i));
+    }
+
+public:
+    [[nodiscard]] std::size_t size() const noexcept { return size_; }
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+
+    [[nodiscard]] bool contains(std::uint32_t const val) const noexcept {
+        auto const key = static_cast<std::uint16_t>(val >> 16);
+        auto const i = find(key);
+        return i < keys_.size() && keys_[i] == key && containers_[i].contains(static_cast<std::uint16_t>(val));
+    }
+
+    // return: false if `val` is held already
+    bool insert(std::uint32_t const val) {
+        auto const key = static_cast<std::uint16_t>(val >> 16);
+        auto const i = find(key);
+        if (i == keys_.size() || keys_[i] != key) {
+            keys_.insert(keys_.begin() + static_cast<std::ptrdiff_t>(i), key);
+            containers_.emplace(containers_.begin() + static_cast<std::ptrdiff_t>(i));
+        }
+        if (!containers_[i].add(static_cast<std::uint16_t>(val)))
+            return false;
+        ++size_;
+        return true;
+    }
+
+    // return: false if `val` is not held
+    bool erase(std::uint32_t const val) {
+        auto const key = static_cast<std::uint16_t>(val >> 16);
+        auto const i = find(key);
+        if (i == keys_.size() || keys_[i] != key || !containers_[i].remove(static_cast<std::uint16_t>(val)))
+            return false;
+        if (containers_[i].cardinality == 0)
+            erase_container(i);
+        --size_;
+        return true;
+    }
+
+    void clear() noexcept {
+        keys_.clear();
+        containers_.clear();
+        size_ = 0;
+    }
+
+    // calls `fn(std::uint32_t)` with every value held, in increasing order
+    template<class Fn>
+    void for_each(Fn&& fn) const {
+        for (std::size_t i = 0; i < keys_.size(); ++i)
+            containers_[i].for_each(static_cast<std::uint32_t>(keys_[i]) << 16, fn);
+    }
+
+    // return: the values held, in increasing order
+    [[nodiscard]] std::vector<std::uint32_t> to_vector() const {
+        std::vector<std::uint32_t> values;
+        values.reserve(size_);
+        for_each([&values](std::uint32_t const val) { values.push_back(val); });
+        return values;
+    }
+
+    // return: the bytes held by the containers, the memory the bitmap takes beyond its own size
+    [[nodiscard]] std::size_t bytes() const noexcept {
+        std::size_t result = keys_.capacity() * sizeof(std::uint16_t) + containers_.capacity() * sizeof(container);
+        for (auto&& c : containers_)
+            result += c.array.capacity() * sizeof(std::uint16_t) + c.bits.capacity() * sizeof(std::uint64_t);
+        return result;
+    }
+
+    roaring_bitmap& operator&=(roaring_bitmap const& other) {
+        std::size_t kept = 0;
+        size_ = 0;
+        for (std::size_t i = 0, j = 0; i < keys_.size(); ++i) {
+            for (; j < other.keys_.size() && other.keys_[j] < keys_[i]; ++j) {}
+            if (j == other.keys_.size() || other.keys_[j] != keys_[i])
+                continue;
+            containers_[i] &= other.containers_[j];
+            if (containers_[i].cardinality == 0)
+                continue;
+            size_ += containers_[i].cardinality;
+            keys_[kept] = keys_[i];
+            if (kept != i)
+                containers_[kept] = std::move(containers_[i]);
+            ++kept;
+        }
+        keys_.resize(kept);
+        containers_.resize(kept);
+        return *this;
+    }
+
+    roaring_bitmap& operator|=(roaring_bitmap const& other) {
+        std::size_t i = 0;
+        for (std::size_t j = 0; j < other.keys_.size(); ++j) {
+            for (; i < keys_.size() && keys_[i] < other.keys_[j]; ++i) {}
+            if (i < keys_.size() && keys_[i] == other.keys_[j]) {
+                size_ -= containers_[i].cardinality;
+                containers_[i] |= other.containers_[j];
+            }
+            else {
+                keys_.insert(keys_.begin() + static_cast<std::ptrdiff_t>(i), other.keys_[j]);
+                containers_.insert(containers_.begin() + static_cast<std::ptrdiff_t>(i), other.containers_[j]);
+            }
+            size_ += containers_[i].cardinality;
+        }
+        return *this;
+    }
+
+    [[nodiscard]] friend roaring_bitmap operator&(roaring_bitmap lhs, roaring_bitmap const& rhs) {
+        return lhs &= rhs;
+    }
+
+    [[nodiscard]] friend roaring_bitmap operator|(roaring_bitmap lhs, roaring_bitmap const& rhs) {
+        return lhs |= rhs;
+    }
+
+    bool operator==(roaring_bitmap const& other) const noexcept {
+        return keys_ == other.keys_ && containers_ == other.containers_;
+    }
+
+    bool operator!=(roaring_bitmap const& other) const noexcept {
+        return !(*this == other);
+    }
+};
+
+} // namespace nova
+
+#endif // NOVA_ROARING_BITMAP_HPP
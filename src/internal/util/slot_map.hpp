@@ -0,0 +1,162 @@
+#ifndef NOVA_SLOT_MAP_HPP
+#define NOVA_SLOT_MAP_HPP
+
+#include "../../debug.hpp"
+#include "optional.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace nova {
+
+// A stable reference to a value held in a `slot_map`.
+// A handle is invalidated when its value is erased, even if the slot is later reused.
+struct slot_handle {
+    std::uint32_t index = std::numeric_limits<std::uint32_t>::max();
+    std::uint32_t generation = 0;
+
+    constexpr bool operator==(slot_handle const& other) const noexcept {
+        return index == other.index && generation == other.generation;
+    }
+
+    constexpr bool operator!=(slot_handle const& other) const noexcept {
+        return !(*this == other);
+    }
+};
+
+// A container providing O(1) insertion, lookup and erasure through generation checked handles,
+// while keeping its values densely packed for iteration.
+// Erasure moves the last value into the erased position, so iteration order is not preserved.
+template<class T>
+class slot_map {
+    inline static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+    struct slot {
+        std::uint32_t dense_or_next_free; // dense position when occupied, next free slot otherwise
+        std::uint32_t generation;
+    };
+
+    std::vector<T> values_{};
+    std::vector<std::uint32_t> dense_to_slot_{};
+    std::vector<slot> slots_{};
+    std::uint32_t free_head_ = npos;
+
+    [[nodiscard]] slot const* find_slot(slot_handle const h) const noexcept {
+        if (h.index >= slots_.size())
+            return nullptr;
+        auto const& s = slots_[h.index];
+        if (s.generation != h.generation)
+            return nullptr;
+        DEBUG_ASSERT(s.dense_or_next_free < values_.size());
+        return std::addressof(s);
+    }
+
+public:
+    using value_type = T;
+    using handle = slot_handle;
+    using iterator = typename std::vector<T>::iterator;
+    using const_iterator = typename std::vector<T>::const_iterator;
+
+    template<class... Args>
+    handle emplace(Args&&... args) {
+        std::uint32_t index = free_head_;
+        if (index != npos)
+            free_head_ = slots_[index].dense_or_next_free;
+        else {
+            index = static_cast<std::uint32_t>(slots_.size());
+            slots_.push_back(slot{0, 0});
+        }
+
+        auto& s = slots_[index];
+        s.dense_or_next_free = static_cast<std::uint32_t>(values_.size());
+        values_.emplace_back(std::forward<Args>(args)...);
+        dense_to_slot_.push_back(index);
+        return handle{index, s.generation};
+    }
+
+    bool erase(handle const h) {
+        if (!find_slot(h))
+            return false;
+
+        auto& s = slots_[h.index];
+        auto const pos = s.dense_or_next_free;
+        auto const last = static_cast<std::uint32_t>(values_.size() - 1);
+        if (pos != last) {
+            values_[pos] = std::move(values_[last]);
+            dense_to_slot_[pos] = dense_to_slot_[last];
+            slots_[dense_to_slot_[pos]].dense_or_next_free = pos;
+        }
+        values_.pop_back();
+        dense_to_slot_.pop_back();
+
+        ++s.generation;
+        s.dense_or_next_free = free_head_;
+        free_head_ = h.index;
+        return true;
+    }
+
+    [[nodiscard]] bool contains(handle const h) const noexcept {
+        return find_slot(h) != nullptr;
+    }
+
+    [[nodiscard]] optional<T&> get(handle const h) noexcept {
+        if (auto const s = find_slot(h); s)
+            return {values_[s->dense_or_next_free]};
+        return {};
+    }
+
+    [[nodiscard]] optional<T const&> get(handle const h) const noexcept {
+        if (auto const s = find_slot(h); s)
+            return {values_[s->dense_or_next_free]};
+        return {};
+    }
+
+    // return: position of the handle's value within the dense storage
+    [[nodiscard]] std::size_t dense_index(handle const h) const noexcept {
+        DEBUG_ASSERT(contains(h));
+        return slots_[h.index].dense_or_next_free;
+    }
+
+    // return: handle of the value at the given position within the dense storage
+    [[nodiscard]] handle handle_at(std::size_t const pos) const noexcept {
+        DEBUG_ASSERT(pos < values_.size());
+        auto const index = dense_to_slot_[pos];
+        return handle{index, slots_[index].generation};
+    }
+
+    void reserve(std::size_t const n) {
+        values_.reserve(n);
+        dense_to_slot_.reserve(n);
+        slots_.reserve(n);
+    }
+
+    void clear() noexcept {
+        for (auto const index : dense_to_slot_) {
+            auto& s = slots_[index];
+            ++s.generation;
+            s.dense_or_next_free = free_head_;
+            free_head_ = index;
+        }
+        values_.clear();
+        dense_to_slot_.clear();
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept { return values_.size(); }
+    [[nodiscard]] bool empty() const noexcept { return values_.empty(); }
+
+    [[nodiscard]] T* data() noexcept { return values_.data(); }
+    [[nodiscard]] T const* data() const noexcept { return values_.data(); }
+
+    [[nodiscard]] iterator begin() noexcept { return values_.begin(); }
+    [[nodiscard]] const_iterator begin() const noexcept { return values_.begin(); }
+    [[nodiscard]] const_iterator cbegin() const noexcept { return values_.cbegin(); }
+    [[nodiscard]] iterator end() noexcept { return values_.end(); }
+    [[nodiscard]] const_iterator end() const noexcept { return values_.end(); }
+    [[nodiscard]] const_iterator cend() const noexcept { return values_.cend(); }
+};
+
+} // namespace nova
+
+#endif // NOVA_SLOT_MAP_HPP
@@ -21,6 +21,7 @@ struct span_size_storage {
 
 template<>
 struct span_size_storage<dynamic_extent> {
+    constexpr span_size_storage() noexcept : size_(0) {}
     constexpr span_size_storage(std::size_t const size) noexcept : size_(size) {}
     std::size_t size_;
 };
@@ -0,0 +1,530 @@
+#ifndef NOVA_WAL_HPP
+#define NOVA_WAL_HPP
+
+#include "../debug.hpp"
+#include "binary.hpp"
+#include "bson.hpp"
+#include "document.hpp"
+#include "util/crc32.hpp"
+#include "util/optional.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Record layout (integers in host byte order):
+//
+//  record := payload_len:u32 crc:u32 lsn:u64 op:u8 payload[payload_len]
+//
+// `crc` covers every byte after it (lsn, op and payload). Records are only ever appended,
+// a record that is cut short or fails its crc marks the end of the log.
+//
+// Payloads, using the value and document encodings of binary.hpp:
+//
+//  str               := len:u32 chars[len]
+//  create_collection := name:str
+//  insert            := collection:str document
+//  erase             := collection:str id:value
+//  update            := collection:str id:value field:str value
+//  create_index      := collection:str flags:u8 filter:str count:u8 field:str[count]   (flags: 1 unique, 2 hashed, 4 multikey, 8 text, 16 spatial, 32 bitmap)
+//  create_column     := collection:str type:u8 field:str
+
+namespace nova {
+
+enum class wal_op : std::uint8_t {
+    create_collection = 1, insert, erase, update, create_index, create_column
+};
+
+enum class fsync_policy : std::uint8_t {
+    every_op,   // the appending thread writes and syncs every record before append returns
+    group,      // records are written and synced in batches by the flusher thread, append returns once its batch is durable
+    periodic    // records are written and synced in batches by the flusher thread, append returns once its record is queued
+};
+
+struct wal_options {
+    fsync_policy policy = fsync_policy::every_op;
+    // group and periodic: a batch is flushed once it holds `max_batch_records` records,
+    // or once its first record has waited `max_batch_latency`, whichever comes first
+    std::size_t max_batch_records = 256;
+    std::chrono::microseconds max_batch_latency{1000};
+};
+
+enum class wal_status : std::uint8_t {
+    ok, io_error, not_open, not_found, corrupt, unknown_filter
+};
+
+namespace detail {
+
+using wal_len_t = std::uint32_t;
+
+inline static constexpr std::size_t wal_header_size = sizeof(wal_len_t) + sizeof(std::uint32_t) + sizeof(std::uint64_t) + sizeof(std::uint8_t);
+
+inline void store_string(byte_buffer& buf, std::string_view const str) {
+    store(buf, static_cast<wal_len_t>(str.size()));
+    store_bytes(buf, str.data(), str.size());
+}
+
+[[nodiscard]] inline bool write_all(int const fd, void const* const data, std::size_t size) noexcept {
+    auto ptr = static_cast<char const*>(data);
+    while (size > 0) {
+        auto const written = ::write(fd, ptr, size);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        ptr += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+[[nodiscard]] inline bool sync_fd(int const fd) noexcept {
+#if defined(__linux__)
+    return ::fdatasync(fd) == 0;
+#else
+    return ::fsync(fd) == 0;
+#endif
+}
+
+} // namespace detail
+
+// Sequential reader over a record's payload, or any other buffer in the log's encodings.
+// Every read is bounds checked, once a read fails `ok()` is false and all later reads fail.
+class wal_payload_reader {
+    std::byte const* pos_;
+    std::byte const* end_;
+    bool ok_ = true;
+
+    [[nodiscard]] bool has(std::size_t const n) noexcept {
+        ok_ = ok_ && static_cast<std::size_t>(end_ - pos_) >= n;
+        return ok_;
+    }
+
+public:
+    explicit wal_payload_reader(byte_span const payload) noexcept
+        : pos_(payload.begin()), end_(payload.end()) {}
+
+    [[nodiscard]] bool ok() const noexcept { return ok_; }
+    [[nodiscard]] bool done() const noexcept { return pos_ == end_; }
+
+    template<class T>
+    [[nodiscard]] T read() noexcept {
+        if (!has(sizeof(T)))
+            return T{};
+        auto const t = detail::load<T>(pos_);
+        pos_ += sizeof(T);
+        return t;
+    }
+
+    // return: the next `n` bytes, null if fewer remain
+    [[nodiscard]] std::byte const* read_bytes(std::size_t const n) noexcept {
+        if (!has(n))
+            return nullptr;
+        auto const bytes = pos_;
+        pos_ += n;
+        return bytes;
+    }
+
+    [[nodiscard]] std::string_view read_string() noexcept {
+        auto const len = read<detail::wal_len_t>();
+        if (!has(len))
+            return {};
+        std::string_view const str{reinterpret_cast<char const*>(pos_), len};
+        pos_ += len;
+        return str;
+    }
+
+    [[nodiscard]] optional<bson_view> read_value() noexcept {
+        if (!has(1))
+            return {};
+        bson_view const view{pos_};
+        if (!has(view.byte_size()))
+            return {};
+        pos_ += view.byte_size();
+        return {view};
+    }
+
+    [[nodiscard]] optional<document_view> read_document() noexcept {
+        if (!has(sizeof(detail::binary_len_t)))
+            return {};
+        document_view const view{pos_};
+        if (!has(view.byte_size()))
+            return {};
+        pos_ += view.byte_size();
+        return {view};
+    }
+};
+
+// An append only log of records stored in a single file.
+// All member functions may be called concurrently, with the exception of `open`.
+//
+// With the group and periodic policies a dedicated flusher thread turns every batch of records
+// appended by any number of threads into a single write and fdatasync (group commit).
+// Once a batch fails, later records would follow a gap in the log: every append fails, and the records queued
+// behind the failed batch are dropped, until `reset` empties the log.
+class write_ahead_log {
+    using clock = std::chrono::steady_clock;
+
+public:
+    using completion = std::function<void(optional<std::uint64_t>)>;
+
+private:
+    struct pending_completion {
+        std::uint64_t lsn;
+        completion done;
+    };
+
+    int fd_ = -1;
+    std::string path_{};
+    wal_options options_{};
+
+    mutable std::mutex mutex_{};
+    std::condition_variable work_cv_{};     // wakes the flusher
+    std::condition_variable flushed_cv_{};  // signalled after every batch
+    std::uint64_t next_lsn_ = 1;
+    std::uint64_t synced_lsn_ = 0;
+    std::uint64_t flushed_lsn_ = 0;         // last lsn of the last batch flushed, successfully or not
+    std::size_t size_bytes_ = 0;
+    std::size_t truncated_bytes_ = 0;
+    std::size_t batches_ = 0;
+    bool failed_ = false;                   // a batch failed since the last call to sync
+    bool broken_ = false;                   // a batch failed since the log was opened or emptied by reset
+    bool stop_ = false;
+    bool flush_requested_ = false;
+    bool writing_ = false;                  // the flusher is writing a batch without holding `mutex_`
+
+    byte_buffer pending_{};                 // records waiting for the flusher
+    std::size_t pending_records_ = 0;
+    clock::time_point batch_start_{};
+    std::vector<pending_completion> completions_{};
+    std::thread flusher_{};
+
+    [[nodiscard]] bool uses_flusher() const noexcept { return options_.policy != fsync_policy::every_op; }
+
+    // appends one record to `buf`
+    // precondition: `mutex_` is held
+    template<class Build>
+    std::uint64_t encode_record(byte_buffer& buf, wal_op const op, Build&& build) {
+        auto const start = buf.size();
+        buf.resize(start + detail::wal_header_size);
+        build(buf);
+
+        auto const lsn = next_lsn_++;
+        auto const len = buf.size() - start - detail::wal_header_size;
+        auto const crc_pos = start + sizeof(detail::wal_len_t);
+        auto const checked_pos = crc_pos + sizeof(std::uint32_t);
+        detail::store_at(buf, start, static_cast<detail::wal_len_t>(len));
+        detail::store_at(buf, checked_pos, lsn);
+        detail::store_at(buf, checked_pos + sizeof(std::uint64_t), static_cast<std::uint8_t>(op));
+        detail::store_at(buf, crc_pos, crc32(buf.data() + checked_pos, buf.size() - checked_pos));
+        return lsn;
+    }
+
+    // writes and syncs `bytes` at the end of the file, removing whatever reached the file on failure
+    // precondition: the caller is the only thread writing to the file
+    [[nodiscard]] bool write_durable(byte_buffer const& bytes, std::size_t const offset) noexcept {
+        if (detail::write_all(fd_, bytes.data(), bytes.size()) && detail::sync_fd(fd_))
+            return true;
+        static_cast<void>(::ftruncate(fd_, static_cast<off_t>(offset)));
+        static_cast<void>(::lseek(fd_, static_cast<off_t>(offset), SEEK_SET));
+        return false;
+    }
+
+    template<class Build>
+    [[nodiscard]] optional<std::uint64_t> enqueue(wal_op const op, Build&& build, completion done) {
+        std::unique_lock lock{mutex_};
+        if (!is_open() || stop_ || broken_)
+            return {};
+        if (pending_records_ == 0)
+            batch_start_ = clock::now();
+        auto const lsn = encode_record(pending_, op, std::forward<Build>(build));
+        if (done)
+            completions_.push_back(pending_completion{lsn, std::move(done)});
+        // the flusher only needs waking to start a batch's timer and when the batch is full
+        if (++pending_records_ == 1 || pending_records_ >= options_.max_batch_records)
+            work_cv_.notify_one();
+        return {lsn};
+    }
+
+    void flusher_loop() {
+        byte_buffer batch;
+        std::vector<pending_completion> done;
+        std::unique_lock lock{mutex_};
+        while (true) {
+            work_cv_.wait(lock, [this] { return stop_ || pending_records_ > 0; });
+            if (pending_records_ == 0)
+                break; // stopped with nothing left to flush
+            work_cv_.wait_until(lock, batch_start_ + options_.max_batch_latency, [this] {
+                return stop_ || flush_requested_ || pending_records_ >= options_.max_batch_records;
+            });
+            flush_requested_ = false;
+
+            batch.swap(pending_);
+            done.swap(completions_);
+            pending_records_ = 0;
+            auto const last_lsn = next_lsn_ - 1;
+            auto const offset = size_bytes_;
+            // records queued while an earlier batch failed are dropped, they would follow the records lost
+            auto const dropped = broken_;
+
+            writing_ = true;
+            lock.unlock();
+            auto const ok = !dropped && write_durable(batch, offset);
+            lock.lock();
+            writing_ = false;
+
+            if (ok) {
+                size_bytes_ += batch.size();
+                synced_lsn_ = last_lsn;
+            }
+            else
+                failed_ = broken_ = true;
+            flushed_lsn_ = last_lsn;
+            ++batches_;
+            flushed_cv_.notify_all();
+
+            lock.unlock();
+            for (auto&& c : done)
+                c.done(ok ? optional<std::uint64_t>{c.lsn} : optional<std::uint64_t>{});
+            done.clear();
+            batch.clear();
+            lock.lock();
+        }
+    }
+
+public:
+    write_ahead_log() = default;
+
+    write_ahead_log(write_ahead_log const&) = delete;
+    write_ahead_log& operator=(write_ahead_log const&) = delete;
+
+    ~write_ahead_log() { close(); }
+
+    // Opens the log at `path`, creating it if needed, and calls `on_record(lsn, op, payload)`
+    // for every intact record in order. Anything after the last intact record is truncated.
+    template<class F>
+    [[nodiscard]] wal_status open(std::string path, wal_options const options, F&& on_record) {
+        DEBUG_ASSERT(!is_open());
+        auto const fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0)
+            return wal_status::io_error;
+
+        struct stat st{};
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            return wal_status::io_error;
+        }
+
+        byte_buffer contents(static_cast<std::size_t>(st.st_size));
+        for (std::size_t read = 0; read < contents.size();) {
+            auto const n = ::pread(fd, contents.data() + read, contents.size() - read, static_cast<off_t>(read));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0) {
+                ::close(fd);
+                return wal_status::io_error;
+            }
+            read += static_cast<std::size_t>(n);
+        }
+
+        std::size_t pos = 0;
+        while (contents.size() - pos >= detail::wal_header_size) {
+            auto const header = contents.data() + pos;
+            auto const len = detail::load<detail::wal_len_t>(header);
+            auto const crc = detail::load<std::uint32_t>(header + sizeof(detail::wal_len_t));
+            auto const checked = header + sizeof(detail::wal_len_t) + sizeof(std::uint32_t);
+            auto const checked_size = detail::wal_header_size - sizeof(detail::wal_len_t) - sizeof(std::uint32_t) + len;
+            if (contents.size() - pos - detail::wal_header_size < len || crc32(checked, checked_size) != crc)
+                break;
+
+            auto const lsn = detail::load<std::uint64_t>(checked);
+            auto const op = static_cast<wal_op>(detail::load<std::uint8_t>(checked + sizeof(std::uint64_t)));
+            on_record(lsn, op, byte_span{header + detail::wal_header_size, static_cast<std::size_t>(len)});
+            next_lsn_ = lsn + 1;
+            pos += detail::wal_header_size + len;
+        }
+
+        if (pos != contents.size()) {
+            // a torn or corrupt tail, later appends must follow the last intact record
+            if (::ftruncate(fd, static_cast<off_t>(pos)) != 0 || !detail::sync_fd(fd)) {
+                ::close(fd);
+                return wal_status::io_error;
+            }
+            truncated_bytes_ = contents.size() - pos;
+        }
+        if (::lseek(fd, static_cast<off_t>(pos), SEEK_SET) < 0) {
+            ::close(fd);
+            return wal_status::io_error;
+        }
+
+        fd_ = fd;
+        path_ = std::move(path);
+        options_ = options;
+        size_bytes_ = pos;
+        synced_lsn_ = flushed_lsn_ = next_lsn_ - 1;
+        stop_ = failed_ = broken_ = false;
+        if (uses_flusher())
+            flusher_ = std::thread([this] { flusher_loop(); });
+        return wal_status::ok;
+    }
+
+    // Appends a record whose payload is built by `build(byte_buffer&)`.
+    // `build` runs while the log is locked and should only encode the payload.
+    // return: the record's log sequence number, empty if the record could not be written or a batch failed before it
+    template<class Build>
+    [[nodiscard]] optional<std::uint64_t> append(wal_op const op, Build&& build) {
+        switch (options_.policy) {
+            case fsync_policy::every_op: {
+                std::lock_guard lock{mutex_};
+                if (!is_open())
+                    return {};
+                pending_.clear();
+                auto const lsn = encode_record(pending_, op, std::forward<Build>(build));
+                if (!write_durable(pending_, size_bytes_))
+                    return {};
+                size_bytes_ += pending_.size();
+                synced_lsn_ = flushed_lsn_ = lsn;
+                return {lsn};
+            }
+            case fsync_policy::group:
+                return append_async(op, std::forward<Build>(build)).get();
+            case fsync_policy::periodic:
+                return enqueue(op, std::forward<Build>(build), completion{});
+        }
+        return {};
+    }
+
+    // Queues a record and calls `done` with its lsn once the record is durable, or with nothing if it could not be written.
+    // `done` runs on the flusher thread, or on the calling thread with the every_op policy and when the log is closed,
+    // and must not wait for other records to become durable.
+    template<class Build>
+    void append_async(wal_op const op, Build&& build, completion done) {
+        if (!uses_flusher()) {
+            done(append(op, std::forward<Build>(build)));
+            return;
+        }
+        auto callback = done;
+        if (!enqueue(op, std::forward<Build>(build), std::move(done)))
+            callback(optional<std::uint64_t>{});
+    }
+
+    // return: a future holding the record's lsn once the record is durable, empty if it could not be written
+    template<class Build>
+    [[nodiscard]] std::future<optional<std::uint64_t>> append_async(wal_op const op, Build&& build) {
+        auto promise = std::make_shared<std::promise<optional<std::uint64_t>>>();
+        auto future = promise->get_future();
+        append_async(op, std::forward<Build>(build), [promise](optional<std::uint64_t> const lsn) { promise->set_value(lsn); });
+        return future;
+    }
+
+    // makes every appended record durable
+    wal_status sync() {
+        std::unique_lock lock{mutex_};
+        if (!is_open())
+            return wal_status::not_open;
+        if (uses_flusher()) {
+            auto const target = next_lsn_ - 1;
+            flush_requested_ = true;
+            work_cv_.notify_one();
+            flushed_cv_.wait(lock, [&] { return flushed_lsn_ >= target; });
+        }
+        return std::exchange(failed_, false) ? wal_status::io_error : wal_status::ok;
+    }
+
+    // Removes every record once a checkpoint reflects them all, lsns keep increasing from `checkpoint_lsn`.
+    // Nothing is removed if records were appended after `checkpoint_lsn`. Emptying the log accepts appends again
+    // after a failed batch.
+    wal_status reset(std::uint64_t const checkpoint_lsn) {
+        std::unique_lock lock{mutex_};
+        if (!is_open())
+            return wal_status::not_open;
+        if (uses_flusher()) {
+            flush_requested_ = true;
+            work_cv_.notify_one();
+            flushed_cv_.wait(lock, [this] { return pending_records_ == 0 && !writing_; });
+        }
+        if (next_lsn_ - 1 != checkpoint_lsn)
+            return wal_status::ok;
+        if (::ftruncate(fd_, 0) != 0 || ::lseek(fd_, 0, SEEK_SET) < 0 || !detail::sync_fd(fd_))
+            return wal_status::io_error;
+        size_bytes_ = 0;
+        broken_ = false;
+        return wal_status::ok;
+    }
+
+    // makes the next record's lsn follow `lsn`, records replayed from elsewhere must not be reused
+    void advance_lsn(std::uint64_t const lsn) {
+        std::lock_guard lock{mutex_};
+        if (lsn >= next_lsn_) {
+            next_lsn_ = lsn + 1;
+            synced_lsn_ = flushed_lsn_ = lsn;
+        }
+    }
+
+    void close() {
+        if (!is_open())
+            return;
+        if (flusher_.joinable()) {
+            {
+                std::lock_guard lock{mutex_};
+                stop_ = true;
+            }
+            work_cv_.notify_one();
+            flusher_.join();
+        }
+        std::lock_guard lock{mutex_};
+        ::close(fd_);
+        fd_ = -1;
+    }
+
+    [[nodiscard]] bool is_open() const noexcept { return fd_ >= 0; }
+    [[nodiscard]] std::string const& path() const noexcept { return path_; }
+    [[nodiscard]] wal_options const& options() const noexcept { return options_; }
+
+    // return: lsn of the last record appended or replayed, 0 if the log is empty
+    [[nodiscard]] std::uint64_t last_lsn() const {
+        std::lock_guard lock{mutex_};
+        return next_lsn_ - 1;
+    }
+
+    // return: lsn of the last record known to be durable
+    [[nodiscard]] std::uint64_t synced_lsn() const {
+        std::lock_guard lock{mutex_};
+        return synced_lsn_;
+    }
+
+    // return: bytes of records written to the file
+    [[nodiscard]] std::size_t size_bytes() const {
+        std::lock_guard lock{mutex_};
+        return size_bytes_;
+    }
+
+    // return: number of batches written by the flusher thread
+    [[nodiscard]] std::size_t batches() const {
+        std::lock_guard lock{mutex_};
+        return batches_;
+    }
+
+    // return: bytes of a torn or corrupt tail removed when the log was opened
+    [[nodiscard]] std::size_t truncated_bytes() const noexcept { return truncated_bytes_; }
+};
+
+} // namespace nova
+
+#endif // NOVA_WAL_HPP
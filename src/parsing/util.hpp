@@ -7,11 +7,16 @@
 
 namespace nova {
 
+// the case folding str_eq compares with
+inline char to_lower(char const c) noexcept {
+    return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+}
+
 constexpr bool str_eq(std::string_view const a, std::string_view const b) noexcept {
     if (a.size() != b.size())
         return false;
     for (auto ait = a.cbegin(), bit = b.cbegin(); ait != a.cend(); ++ait, ++bit)
-        if (std::tolower(static_cast<unsigned char>(*ait)) != std::tolower(static_cast<unsigned char>(*bit)))
+        if (to_lower(*ait) != to_lower(*bit))
             return false;
     return true;
 }
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "../src/internal/binary.hpp"
+#include <cassert>
+
+using namespace nova;
+
+void test_binary() {
+    auto const id = unique_id::generate();
+
+    document inner(1);
+    inner.values().insert("city", "Hogsmeade");
+
+    document doc(id);
+    doc.values().insert("name", "Harry Potter");
+    doc.values().insert("gpa", 2.9);
+    doc.values().insert("year", bson{bson_type<std::int32_t>, 5});
+    doc.values().insert("seeker", true);
+    doc.values().insert("wand", bson{bson_type<bson::null_t>});
+    doc.values().insert("classes", std::vector<bson>({"Transfiguration", "Herbology"}));
+    doc.values().insert("address", bson{bson_type<document>, inner});
+
+    auto const buf = encode(doc);
+    document_view const view{byte_span{buf}};
+
+    assert(view.byte_size() == buf.size());
+    assert(view.size() == 7);
+    assert(view.id().equals_weak(id));
+
+    assert(view.lookup("name")->equals_weak("Harry Potter"));
+    assert(*view.lookup("name")->as<std::string>() == "Harry Potter");
+    assert(*view.lookup("gpa")->as<double>() == 2.9);
+    assert(!view.lookup("gpa")->as<float>());
+    assert(view.lookup("year")->equals_weak(5));
+    assert(*view.lookup("seeker")->as<bool>());
+    assert(view.lookup("wand")->type() == bson::types::Null);
+    assert(!view.lookup("missing"));
+
+    auto const classes = *view.lookup("classes")->as<bson::array_t>();
+    assert(classes.size() == 2);
+    assert(classes[1].equals_weak("Herbology"));
+
+    auto const address = *view.lookup("address")->as<document>();
+    assert(address.id().equals_weak(1));
+    assert(address.lookup("city")->equals_weak("Hogsmeade"));
+
+    for (auto&& [key, val] : view)
+        assert(val == doc.values().lookup(key).value());
+
+    assert(decode(view) == doc);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "../src/internal/collection.hpp"
+#include "../src/internal/util/roaring_bitmap.hpp"
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <random>
+#include <set>
+#include <string_view>
+#include <vector>
+
+using namespace nova;
+
+void test_bitmap_index() {
+    // bitmaps hold what a set holds, through containers turning from arrays to bitsets and back
+    {
+        std::mt19937 rng{3};
+        roaring_bitmap a;
+        roaring_bitmap b;
+        std::set<std::uint32_t> sa;
+        std::set<std::uint32_t> sb;
+        for (int i = 0; i < 20000; ++i) {
+            auto const dense = static_cast<std::uint32_t>(rng() % 10000); // one container past the array limit
+            auto const sparse = static_cast<std::uint32_t>(rng() % (1u << 22));
+            assert(a.insert(dense) == sa.insert(dense).second);
+            assert(b.insert(sparse) == sb.insert(sparse).second);
+            b.insert(dense / 3);
+            sb.insert(dense / 3);
+        }
+        assert(a.size() == sa.size() && b.size() == sb.size());
+        assert(a.to_vector() == std::vector<std::uint32_t>(sa.begin(), sa.end()));
+        assert(a.contains(*sa.begin()) && !a.contains(10000) && !a.contains(1u << 30));
+
+        std::vector<std::uint32_t> both;
+        std::set_intersection(sa.begin(), sa.end(), sb.begin(), sb.end(), std::back_inserter(both));
+        std::vector<std::uint32_t> either;
+        std::set_union(sa.begin(), sa.end(), sb.begin(), sb.end(), std::back_inserter(either));
+        assert((a & b).to_vector() == both && (b & a).to_vector() == both && (a & b).size() == both.size());
+        assert((a | b).to_vector() == either && (b | a).to_vector() == either && (a | b).size() == either.size());
+        assert((a & b) == (b & a) && (a | b) != a);
+
+        // erasing most values of the dense container turns it back into an array
+        auto const bytes = a.bytes();
+        for (std::uint32_t i = 0; i < 9000; ++i)
+            assert(a.erase(i) == (sa.erase(i) == 1));
+        assert(a.bytes() < bytes && a.to_vector() == std::vector<std::uint32_t>(sa.begin(), sa.end()));
+        assert(!a.erase(42) && (a & roaring_bitmap{}).empty());
+    }
+
+    // bitmap indices answer lookups on one field and intersect their bitmaps for several, through updates and erases
+    {
+        collection students;
+        assert(students.create_bitmap_index("house"));
+        static char const* const houses[] = {"Gryffindor", "Hufflepuff", "Ravenclaw", "Slytherin"};
+        for (int i = 0; i < 1000; ++i) {
+            document doc(i);
+            doc.values().insert("house", houses[i % 4]);
+            doc.values().insert("year", i % 7);
+            assert(students.insert(std::move(doc)));
+        }
+        assert((students.create_index<false, detail::no_filter, index_kind::bitmap>("year")));
+        assert(!students.create_bitmap_index("year"));
+
+        auto const& house = students.lookup_bitmap("house").value();
+        auto const& year = students.lookup_bitmap("year").value();
+        assert(house.size() == 1000 && house.key_count() == 4 && year.key_count() == 7);
+        assert(house.lookup_bits("Ravenclaw")->size() == 250 && !house.lookup_bits("Muggle"));
+        assert(students.lookup_indexed("house", "Slytherin")->size() == 250);
+
+        std::array<std::string_view, 2> const fields{"house", "year"};
+        std::array<bson, 2> const values{"Ravenclaw", 3};
+        std::size_t expected = 0;
+        for (int i = 0; i < 1000; ++i)
+            expected += i % 4 == 2 && i % 7 == 3;
+        auto const found = students.lookup_indexed(span<std::string_view const>{fields}, span<bson const>{values});
+        assert(found && found->size() == expected);
+        for (auto&& doc : *found)
+            assert(*doc.id().as<int>() % 28 == 10);
+
+        std::array<bson, 2> const early{bson{0}, bson{1}};
+        auto const in_early = year.lookup_in(span<bson const>{early});
+        assert(in_early == (*year.lookup_bits(0) | *year.lookup_bits(1)) && in_early.size() == 143 + 143);
+        bson const from{2};
+        bson const to{4};
+        assert(year.lookup_range(from, to, range_bounds::lower_closed).size() == 143 + 143);
+        assert(year.documents(in_early & *house.lookup_bits("Gryffindor")).size() == 36 + 36);
+
+        // an update moves a document to the bitmap of its new value, an erase drops it and its ordinal is reused
+        assert(students.update(10, "house", "Gryffindor"));
+        assert(house.lookup_bits("Ravenclaw")->size() == 249 && house.lookup_bits("Gryffindor")->size() == 251);
+        assert(students.lookup_indexed(span<std::string_view const>{fields}, span<bson const>{values})->size() == expected - 1);
+        for (int i = 0; i < 1000; i += 4)
+            assert(students.erase(i + 3));
+        assert(!house.lookup_bits("Slytherin") && house.key_count() == 3 && house.size() == 750);
+        document doc(1000);
+        doc.values().insert("house", "Slytherin");
+        assert(students.insert(std::move(doc)));
+        assert(house.lookup_bits("Slytherin")->to_vector().front() < 1000 && year.size() == 750);
+        auto const slytherin = students.lookup_indexed("house", "Slytherin");
+        assert(slytherin->size() == 1);
+        for (auto&& found_doc : *slytherin)
+            assert(found_doc.id() == bson{1000});
+    }
+}
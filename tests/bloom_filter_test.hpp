@@ -0,0 +1,117 @@
+#pragma once
+
+#include "../src/internal/collection.hpp"
+#include "../src/internal/index.hpp"
+#include "../src/internal/util/bloom_filter.hpp"
+#include <cassert>
+#include <string>
+#include <vector>
+
+using namespace nova;
+
+void test_bloom_filter() {
+    // no hash inserted is missed, and few others are taken for inserted ones
+    {
+        assert(bloom_filter{}.may_contain(42) && !bloom_filter{}.enabled());
+        bloom_filter filter(10000);
+        for (std::size_t i = 0; i < 10000; ++i)
+            filter.insert(detail::mix_hash(i));
+        for (std::size_t i = 0; i < 10000; ++i)
+            assert(filter.may_contain(detail::mix_hash(i)));
+        std::size_t false_positives = 0;
+        for (std::size_t i = 10000; i < 20000; ++i)
+            false_positives += filter.may_contain(detail::mix_hash(i));
+        assert(false_positives < 300);
+        assert(!filter.stale(10000) && filter.stale(1000));
+    }
+
+    // indices answer lookups alike with and without their key filter, through inserts, bulk inserts and erases
+    {
+        std::vector<document> docs;
+        docs.reserve(4000);
+        for (int i = 0; i < 4000; ++i)
+            docs.emplace_back(i);
+
+        ordered_single_field_unique_index<> unique;
+        hashed_single_field_multi_index<> multi;
+        ordered_compound_multi_index<2> compound;
+        unique.set_key_filter(true);
+        compound.set_key_filter(true);
+        std::vector<non_null_ptr<bson const>> keys;
+        std::vector<non_null_ptr<document>> bulk;
+        std::vector<bson> values;
+        values.reserve(2000);
+        for (int i = 0; i < 2000; ++i) {
+            values.emplace_back(i * 2);
+            keys.push_back(std::addressof(values.back()));
+            bulk.push_back(std::addressof(docs[static_cast<std::size_t>(i)]));
+        }
+        assert(unique.bulk_insert(keys, bulk) == 2000);
+        for (int i = 2000; i < 4000; ++i) {
+            auto& doc = docs[static_cast<std::size_t>(i)];
+            assert(unique.insert(bson{i * 2}, std::addressof(doc)) == index_insert_result::success);
+            assert(multi.insert(bson{i % 100}, std::addressof(doc)) == index_insert_result::success);
+            std::array<bson, 2> const key{bson{i % 10}, bson{std::to_string(i % 7)}};
+            assert(compound.insert(span<bson const>{key}, std::addressof(doc)) == index_insert_result::success);
+        }
+        multi.set_key_filter(true);
+        assert(unique.key_filter().enabled() && multi.key_filter().enabled());
+
+        for (int i = 0; i < 4000; ++i) {
+            assert(unique.contains(bson{i * 2}) && !unique.contains(bson{i * 2 + 1}));
+            assert(!unique.lookup_one(bson{i * 2 + 1}));
+        }
+        assert(multi.lookup_many(bson{7}).size() == 20 && multi.lookup_many(bson{100}).size() == 0);
+        std::array<bson, 2> const held{bson{3}, bson{"3"}};
+        std::array<bson, 2> const missing{bson{3}, bson{"7"}};
+        assert(compound.lookup_many(span<bson const>{held}).size() > 0);
+        assert(compound.lookup_many(span<bson const>{missing}).size() == 0);
+
+        // erasing most keys rebuilds the filter from the keys left
+        auto const count = unique.key_filter().count();
+        assert(unique.erase_if([](bson const& key) { return *key.as<int>() >= 400; }) == 3800);
+        assert(unique.key_filter().count() < count);
+        for (int i = 0; i < 200; ++i)
+            assert(unique.contains(bson{i * 2}));
+        assert(!unique.contains(bson{1000}) && !unique.lookup_one(bson{7998}));
+        assert(multi.erase(bson{7}) == 20 && multi.lookup_many(bson{7}).size() == 0);
+        unique.clear();
+        assert(!unique.contains(bson{0}) && unique.key_filter().enabled());
+
+        unique.set_key_filter(false);
+        assert(!unique.key_filter().enabled());
+    }
+
+    // the id filter and index filters follow the collection's documents
+    {
+        collection students;
+        assert(students.create_index<false>("house"));
+        for (int i = 0; i < 500; ++i) {
+            document doc(i);
+            doc.values().insert("house", i % 2 == 0 ? "Gryffindor" : "Slytherin");
+            assert(students.insert(std::move(doc)));
+        }
+        students.set_key_filters(true);
+        assert(students.key_filters());
+        assert(students.create_hash_index<true>("name"));
+        assert(students.lookup(499) && !students.lookup(500));
+        assert(students.lookup_indexed("house", "Gryffindor")->size() == 250);
+        assert(students.lookup_indexed("house", "Ravenclaw")->size() == 0);
+
+        for (int i = 500; i < 3000; ++i) {
+            document doc(i);
+            doc.values().insert("house", "Ravenclaw");
+            doc.values().insert("name", std::to_string(i));
+            assert(students.insert(std::move(doc)));
+        }
+        for (int i = 0; i < 2900; ++i)
+            assert(students.erase(i));
+        for (int i = 0; i < 3000; ++i)
+            assert(static_cast<bool>(students.lookup(i)) == (i >= 2900));
+        assert(students.lookup_indexed("house", "Ravenclaw")->size() == 100);
+        assert(students.lookup_indexed("name", "2950")->size() == 1 && students.lookup_indexed("name", "50")->size() == 0);
+
+        students.set_key_filters(false);
+        assert(!students.key_filters() && students.lookup(2999) && !students.lookup(0));
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "../src/internal/checkpoint.hpp"
+#include "../src/internal/database.hpp"
+#include "../src/internal/query_util.hpp"
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+using namespace nova;
+
+void test_checkpoint() {
+    std::string const path = "/tmp/nova_checkpoint_test_" + std::to_string(::getpid()) + ".log";
+    std::string const checkpoint_path = path + ".checkpoint";
+    std::remove(path.c_str());
+    std::remove(checkpoint_path.c_str());
+
+    auto fill = [](collection& coll, int const first, int const last) {
+        for (int i = first; i < last; ++i) {
+            document doc(i);
+            doc.values().insert("name", "student " + std::to_string(i));
+            doc.values().insert("house", i % 2 == 0 ? "Ravenclaw" : "Hufflepuff");
+            doc.values().insert("gpa", (i % 40) / 10.);
+            assert(coll.insert(std::move(doc)));
+        }
+    };
+
+    std::uint64_t checkpoint_lsn = 0;
+    {
+        database db;
+        db.set_checkpoint_threshold(0);
+        assert(db.open(path) == wal_status::ok);
+        auto& students = db.insert("students")->value();
+        assert(students.create_index<true>("name"));
+        assert(students.create_index<false>("house", "gpa"));
+        assert(students.create_column<double>("gpa"));
+        fill(students, 0, 100);
+        assert(db.insert("empty"));
+
+        checkpoint_lsn = db.wal()->last_lsn();
+        assert(db.checkpoint() == wal_status::ok);
+        assert(db.wal()->size_bytes() == 0);
+
+        // the tail after the checkpoint
+        assert(students.erase(1));
+        assert(students.update(2, "gpa", 3.95));
+        fill(students, 100, 101);
+        assert(db.wal()->last_lsn() == checkpoint_lsn + 3);
+    }
+
+    // the checkpoint itself, documents are found without reading the others
+    {
+        checkpoint ckpt;
+        assert(ckpt.open(checkpoint_path) == wal_status::ok);
+        assert(ckpt.lsn() == checkpoint_lsn);
+        assert(ckpt.collections().size() == 2);
+        auto const& students = ckpt.lookup("students").value();
+        assert(students.size() == 100 && ckpt.lookup("empty")->empty());
+        assert(students.indices().size() == 2 && students.indices()[0].unique);
+        assert((students.indices()[1].fields == std::vector<std::string_view>{"house", "gpa"}));
+        assert(students.columns().size() == 1 && students.columns()[0].type == bson::types::Double);
+        for (int i = 0; i < 100; ++i) {
+            auto const doc = students.lookup(i);
+            assert(doc && doc->id().equals_weak(i));
+            assert(doc->lookup("name")->equals_weak("student " + std::to_string(i)));
+        }
+        assert(!students.lookup(100));
+        assert(!students.lookup(std::int64_t{5})); // ids compare with their exact type
+        std::size_t count = 0;
+        for (auto&& doc : students)
+            count += doc.contains("house");
+        assert(count == 100);
+    }
+
+    // startup loads the checkpoint and replays only the tail
+    {
+        database db;
+        assert(db.open(path) == wal_status::ok);
+        assert(db.contains("empty"));
+        auto& students = db["students"].value();
+        assert(students.size() == 100);
+        assert(!students.lookup(1) && students.lookup(100));
+        assert(students.lookup(2)->values().lookup("gpa").value().equals_weak(3.95));
+        assert(!students.create_index<true>("name"));
+        assert(students.lookup_column("gpa"));
+        assert(students.scan(is_greater_eq_query("gpa", 3.9)).size() == 3);
+        assert(db.wal()->last_lsn() == checkpoint_lsn + 3);
+
+        // automatic checkpoints keep the log small
+        db.set_checkpoint_threshold(4096);
+        fill(students, 200, 400);
+        assert(db.wal()->size_bytes() < 4096 + 256);
+    }
+    {
+        database db;
+        assert(db.open(path) == wal_status::ok);
+        assert(db["students"].value().size() == 300);
+        assert(db["students"].value().lookup(399));
+    }
+
+    // a damaged checkpoint is never loaded
+    {
+        std::fstream file(checkpoint_path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(40);
+        file.put('\x7f');
+    }
+    {
+        database db;
+        assert(db.open(path) == wal_status::corrupt);
+    }
+
+    std::remove(path.c_str());
+    std::remove(checkpoint_path.c_str());
+}
@@ -21,4 +21,96 @@ void test_collection() {
     assert(!c.lookup(id_a));
     
     assert(!c.erase(id_b));
+
+    std::unique_ptr<document> removed;
+    {
+        collection tmp;
+        document doc(id_a);
+        doc.values().insert("name", "Luna Lovegood");
+        assert(tmp.insert(std::move(doc)));
+        assert(tmp.arena_bytes_used() > 0);
+        removed = tmp.remove(id_a);
+        assert(!tmp.lookup(id_a));
+    }
+    assert(removed);
+    assert(removed->values().lookup("name").value().equals_weak("Luna Lovegood"));
+
+    // a multikey index follows every element of a document's array through inserts, updates and erases
+    {
+        collection students;
+        assert(students.create_multikey_index<false>("classes"));
+        for (int i = 0; i < 4; ++i) {
+            document doc(i);
+            doc.values().insert("classes", std::vector<bson>({i % 2 == 0 ? "Transfiguration" : "Potions", "Charms"}));
+            assert(students.insert(std::move(doc)));
+        }
+        assert(students.lookup_indexed("classes", "Transfiguration")->size() == 2);
+        assert(students.lookup_indexed("classes", "Charms")->size() == 4);
+        assert(!students.lookup_indexed("house", "Gryffindor"));
+        assert(students.erase(0));
+        assert(students.update(1, "classes", std::vector<bson>({"Transfiguration"})));
+        assert(students.lookup_indexed("classes", "Transfiguration")->size() == 2);
+        assert(students.lookup_indexed("classes", "Charms")->size() == 2);
+        assert(students.lookup_indexed("classes", "Potions")->size() == 1);
+    }
+
+    // dotted fields index and scan values of nested documents
+    {
+        collection students;
+        assert(students.create_index<false>("address.city"));
+        for (int i = 0; i < 6; ++i) {
+            document address(0);
+            address.values().insert("city", i % 3 == 0 ? "Hogsmeade" : "Godric's Hollow");
+            document doc(i);
+            doc.values().insert("address", std::move(address));
+            doc.values().insert("grades", std::vector<bson>({i, i + 1}));
+            assert(students.insert(std::move(doc)));
+        }
+        assert(students.insert(6));
+        assert(students.lookup_indexed("address.city", "Hogsmeade")->size() == 2);
+        assert(students.lookup_indexed("address.city", "Godric's Hollow")->size() == 4);
+        assert(students.scan(is_equal_query("address.city", "Hogsmeade")).size() == 2);
+        assert(students.scan(is_greater_query("grades.1", 3)).size() == 3);
+        assert(students.scan(is_equal_query("grades.2", 3)).size() == 0);
+    }
+
+    // several fields without a compound index over them are found by intersecting their single field indices
+    {
+        collection students;
+        assert(students.create_index<false>("house"));
+        assert(students.create_hash_index<false>("year"));
+        assert(students.create_multikey_index<false>("clubs"));
+        assert(students.create_index<false>("seat"));
+        static char const* const houses[] = {"Gryffindor", "Hufflepuff", "Ravenclaw", "Slytherin"};
+        for (int i = 0; i < 200; ++i) {
+            document doc(i);
+            doc.values().insert("house", houses[i % 4]);
+            doc.values().insert("year", i % 7);
+            doc.values().insert("seat", i % 50);
+            doc.values().insert("clubs", std::vector<bson>({i % 3 == 0 ? "Quidditch" : "Gobstones", "Charms"}));
+            assert(students.insert(std::move(doc)));
+        }
+        std::array<std::string_view, 3> const fields{"house", "year", "clubs"};
+        std::array<bson, 3> const values{"Ravenclaw", 3, "Quidditch"};
+        std::size_t expected = 0;
+        for (int i = 0; i < 200; ++i)
+            expected += i % 4 == 2 && i % 7 == 3 && i % 3 == 0;
+        assert(expected > 0);
+        auto const found = students.lookup_indexed(span<std::string_view const>{fields}, span<bson const>{values});
+        assert(found && found->size() == expected);
+        for (auto&& doc : *found)
+            assert(doc.values().lookup("house").value() == bson{"Ravenclaw"} && doc.values().lookup("year").value() == bson{3});
+
+        // an index holding many more documents than the smallest is checked on the documents found instead
+        std::array<std::string_view, 2> const selective{"clubs", "seat"};
+        std::array<bson, 2> const charms{"Charms", 7};
+        assert(students.lookup_indexed(span<std::string_view const>{selective}, span<bson const>{charms})->size() == 4);
+        std::array<bson, 2> const gobstones{"Gobstones", 9};
+        assert(students.lookup_indexed(span<std::string_view const>{selective}, span<bson const>{gobstones})->size() == 2);
+
+        std::array<bson, 3> const none{"Ravenclaw", 9, "Quidditch"};
+        assert(students.lookup_indexed(span<std::string_view const>{fields}, span<bson const>{none})->size() == 0);
+        std::array<std::string_view, 2> const unindexed{"house", "name"};
+        assert(!students.lookup_indexed(span<std::string_view const>{unindexed}, span<bson const>{values.data(), std::size_t{2}}));
+    }
 }
\ No newline at end of file
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "../src/internal/collection.hpp"
+#include "../src/internal/column.hpp"
+#include "../src/internal/query_util.hpp"
+#include "../src/internal/util/bitmap.hpp"
+#include <cassert>
+#include <set>
+#include <string>
+
+using namespace nova;
+
+template<class Cursor>
+std::set<int> scanned_ids(Cursor const& cursor) {
+    std::set<int> ids;
+    for (auto&& doc : cursor)
+        ids.insert(*doc.id().template as<std::int32_t>());
+    return ids;
+}
+
+void test_column() {
+    // bitmap
+    {
+        bitmap bits(130);
+        bits.set(0); bits.set(64); bits.set(129);
+        assert(bits.count() == 3);
+        assert((bits.to_selection() == std::vector<std::uint32_t>{0, 64, 129}));
+        bits.swap_remove(0);
+        assert(bits.size() == 129 && bits.test(0) && bits.count() == 2);
+        bitmap all(129, true);
+        assert(all.count() == 129);
+        all &= bits;
+        assert(all == bits);
+    }
+
+    std::string const houses[] = {"Gryffindor", "Ravenclaw", "Slytherin", "Hufflepuff"};
+    auto fill = [&](collection& c) {
+        for (int i = 0; i < 200; ++i) {
+            document doc(i);
+            if (i % 7 != 0)
+                doc.values().insert("gpa", static_cast<double>(i % 40) / 10.);
+            else
+                doc.values().insert("gpa", "n/a");
+            doc.values().insert("house", houses[i % 4]);
+            doc.values().insert("year", i % 7);
+            c.insert(std::move(doc));
+        }
+    };
+
+    collection plain, columnar;
+    fill(plain);
+    assert(columnar.create_column<double>("gpa"));
+    fill(columnar);
+    assert(columnar.create_column<std::string>("house"));
+    assert(!columnar.create_column<double>("gpa"));
+    assert(columnar.lookup_column("gpa")->size() == 200);
+    assert(columnar.lookup_column("house")->get<std::string>().dictionary_size() == 4);
+
+    auto check = [&](auto&&... queries) {
+        auto const expected = scanned_ids(plain.scan(queries...));
+        assert(scanned_ids(columnar.scan(queries...)) == expected);
+        return expected.size();
+    };
+
+    assert(check(is_greater_eq_query("gpa", 3.)) > 0);
+    assert(check(is_equal_query("house", "Ravenclaw")) == 50);
+    assert(check(is_not_equal_query("house", "Ravenclaw")) == 150);
+    assert(check(is_less_query("house", "Ravenclaw")) > 0);
+    assert(check(is_equal_query("house", "Beauxbatons")) == 0);
+    assert(check(is_equal_query("gpa", "n/a")) > 0);
+    assert(check(is_greater_query("gpa", 1.), is_equal_query("house", "Gryffindor"), is_less_query("year", 3)) > 0);
+    assert(check(is_greater_query("gpa", 1.), std::make_tuple("year", [](bson const& b) { return b.equals_weak(2); })) > 0);
+
+    // erasing keeps columns aligned with the documents
+    for (int i = 0; i < 200; i += 3) {
+        assert(plain.erase(i));
+        assert(columnar.erase(i));
+    }
+    assert(columnar.lookup_column("gpa")->size() == 133);
+    assert(check(is_greater_eq_query("gpa", 2.5), is_equal_query("house", "Slytherin")) > 0);
+
+    assert(columnar.drop_column("house"));
+    assert(!columnar.lookup_column("house"));
+    assert(check(is_equal_query("house", "Slytherin")) > 0);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "../src/internal/compact_bson.hpp"
+#include <cassert>
+#include <string>
+
+using namespace nova;
+
+template<class As, class Expected>
+void compact_bson_test_impl(compact_bson const& b, Expected const& val, bson::types const type) {
+    assert(b.type() == type);
+    assert(b.template as<As>());
+    assert(b.template equals_strong<As>(val));
+    assert(b.equals_weak(val));
+    assert((compact_bson{b.to_bson()} == b));
+}
+
+void test_compact_bson() {
+    static_assert(sizeof(compact_bson) == 16);
+
+    compact_bson_test_impl<bson::null_t>(compact_bson{}, bson::null_t{}, bson::types::Null);
+    compact_bson_test_impl<bool>(compact_bson{true}, true, bson::types::Bool);
+    compact_bson_test_impl<std::int32_t>(compact_bson{-42}, -42, bson::types::Int32);
+    compact_bson_test_impl<std::int64_t>(compact_bson{bson_type<std::int64_t>, -42}, std::int64_t{-42}, bson::types::Int64);
+    compact_bson_test_impl<std::uint32_t>(compact_bson{42u}, 42u, bson::types::uInt32);
+    compact_bson_test_impl<std::uint64_t>(compact_bson{bson_type<std::uint64_t>, 42}, std::uint64_t{42}, bson::types::uInt64);
+    compact_bson_test_impl<float>(compact_bson{3.14f}, 3.14f, bson::types::Float);
+    compact_bson_test_impl<double>(compact_bson{3.14}, 3.14, bson::types::Double);
+    // numbers of different signedness compare by value
+    assert(compact_bson{42u}.equals_weak(42) && !compact_bson{-1}.equals_weak(0xffffffffu));
+    assert(!(compact_bson{bson_type<std::uint64_t>, 0xffffffffffffffff}.equals_weak(std::int64_t{-1})));
+
+    auto const id = unique_id::generate();
+    compact_bson const uid{id};
+    compact_bson_test_impl<unique_id>(uid, id, bson::types::UniqueID);
+    assert(uid.is_inline());
+
+    // strings
+    {
+        compact_bson const small{"Hermione"};
+        compact_bson_test_impl<std::string>(small, std::string{"Hermione"}, bson::types::String);
+        assert(small.is_inline());
+        assert(*small.as<std::string>() == "Hermione");
+
+        std::string const long_str = "Hermione Jean Granger";
+        compact_bson large{long_str};
+        compact_bson_test_impl<std::string>(large, long_str, bson::types::String);
+        assert(!large.is_inline());
+
+        compact_bson const edge{std::string(compact_bson::inline_string_capacity, 'x')};
+        assert(edge.is_inline());
+        assert(edge.as<std::string>()->size() == compact_bson::inline_string_capacity);
+
+        compact_bson const empty{""};
+        assert(empty.is_inline() && empty.as<std::string>()->empty());
+
+        auto copy = large;
+        assert(copy == large);
+        auto moved = std::move(large);
+        assert(moved == copy);
+        assert(large.type() == bson::types::Null);
+        copy = small;
+        assert(copy == small);
+        assert(small < moved);
+    }
+    // arrays and documents
+    {
+        bson const arr{bson::array_t{bson{1}, bson{"two"}, bson{3.0}}};
+        compact_bson const c{arr};
+        assert(c.type() == bson::types::Array);
+        assert(c.as<compact_bson::array_t>()->size() == 3);
+        assert((*c.as<compact_bson::array_t>())[1].equals_weak("two"));
+        assert(c.to_bson() == arr);
+        assert(fmt::format("{}", c) == "[1, two, 3.0]");
+
+        document doc(1);
+        doc.values().insert("name", "Luna");
+        compact_bson d{bson_type<document>, doc};
+        assert(d.equals_weak(doc));
+        d.as<document>()->values().insert("house", "Ravenclaw");
+        assert(!d.equals_weak(doc));
+        assert(d.to_bson().as<document>()->values().contains("house"));
+    }
+}
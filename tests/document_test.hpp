@@ -1,4 +1,21 @@
 #include "../src/internal/document.hpp"
 
 void test_document() {
-}
\ No newline at end of file
+    using namespace nova;
+
+    // dotted keys name values inside nested documents and arrays
+    document address(0);
+    address.values().insert("city", "Ottery St Catchpole");
+    document doc(1);
+    doc.values().insert("name", "Luna Lovegood");
+    doc.values().insert("address", std::move(address));
+    doc.values().insert("grades", std::vector<bson>({"O", "E"}));
+
+    auto const& values = doc.values();
+    assert(values.lookup("address.city").value().equals_weak("Ottery St Catchpole"));
+    assert(values.lookup("address.city").key() == "address");
+    assert(values.lookup(field_path{"grades.1"}).value().equals_weak("E"));
+    assert(values.contains("grades.0") && !values.contains("grades.2") && !values.contains("grades.first"));
+    assert(!values.lookup("address.street") && !values.lookup("name.first") && !values.lookup("house.name"));
+    assert(values.lookup_as<std::string>("address.city").ok() == "Ottery St Catchpole");
+}
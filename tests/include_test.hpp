@@ -1,6 +1,21 @@
 #pragma once
 
 #include "bson_test.hpp"
+#include "binary_test.hpp"
+#include "compact_bson_test.hpp"
 #include "document_test.hpp"
 #include "collection_test.hpp"
-#include "index_manager_test.hpp"
\ No newline at end of file
+#include "slot_map_test.hpp"
+#include "shape_test.hpp"
+#include "column_test.hpp"
+#include "simd_test.hpp"
+#include "index_manager_test.hpp"
+#include "wal_test.hpp"
+#include "checkpoint_test.hpp"
+#include "mapped_collection_test.hpp"
+#include "text_index_test.hpp"
+#include "spatial_index_test.hpp"
+#include "bloom_filter_test.hpp"
+#include "ttl_test.hpp"
+#include "bitmap_index_test.hpp"
+#include "index_stats_test.hpp"
\ No newline at end of file
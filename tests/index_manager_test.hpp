@@ -1,6 +1,11 @@
 #pragma once
 
 #include "../src/internal/index_manager.hpp"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <string>
+#include <vector>
 
 using namespace nova;
 
@@ -27,4 +32,328 @@ void test_index_manager() {
 
 
     // compound-multi
-}
\ No newline at end of file
+
+    // hashed indices
+    std::vector<document> docs;
+    for (int i = 0; i < 100; ++i) {
+        document doc(i);
+        doc.values().insert("email", "student" + std::to_string(i) + "@hogwarts.edu");
+        doc.values().insert("house", i % 4);
+        doc.values().insert("gpa", (i % 40) / 10.);
+        docs.push_back(std::move(doc));
+    }
+
+    index_manager hashed;
+    assert((hashed.create_index<true, detail::no_filter, index_kind::hashed>("email")));
+    assert((!hashed.create_index<false, detail::no_filter, index_kind::ordered>("email")));
+    assert((hashed.create_index<false, detail::no_filter, index_kind::hashed>("house")));
+    assert((hashed.create_index<false, detail::no_filter, index_kind::hashed>("house", "gpa")));
+    for (auto&& doc : docs)
+        hashed.register_document(doc);
+
+    auto emails = hashed.lookup("email");
+    assert(emails && emails->size() == 100);
+    auto houses = hashed.lookup("house", "gpa");
+    assert(houses && std::holds_alternative<cmp_index_cursor>(*houses));
+    std::size_t count = 0;
+    for (auto&& [vals, doc] : std::get<cmp_index_cursor>(*houses)) {
+        assert(vals.size() == 2 && doc->values().lookup("house").value() == vals[0]);
+        ++count;
+    }
+    assert(count == 100);
+
+    for (auto&& doc : docs)
+        hashed.remove_document(doc);
+    assert(hashed.lookup("email")->size() == 0 && std::get<cmp_index_cursor>(*hashed.lookup("house", "gpa")).size() == 0);
+
+    // the hashed index types themselves
+    hashed_single_field_multi_index<> by_house;
+    for (auto&& doc : docs)
+        by_house.insert(doc.values().lookup("house").value(), std::addressof(doc));
+    assert(by_house.lookup_many(bson{2}).size() == 25 && by_house.lookup_many(bson{4}).size() == 0);
+    assert(by_house.erase(bson{2}, std::addressof(docs[2])) && !by_house.erase(bson{2}, std::addressof(docs[2])));
+    assert(by_house.lookup_many(bson{2}).size() == 24);
+    assert(by_house.erase_if([](bson const& b) { return b.equals_weak(1) || b.equals_weak(3); }) == 50);
+    assert(by_house.size() == 49);
+
+    hashed_compound_unique_index<2> by_house_gpa;
+    for (std::size_t i = 0; i < docs.size(); ++i) {
+        std::array<bson, 2> const key{docs[i].values().lookup("house").value(), docs[i].values().lookup("gpa").value()};
+        // document i + 40 has the same house and gpa as document i
+        auto const inserted = by_house_gpa.insert(span<bson const>{key}, std::addressof(docs[i]));
+        assert(inserted == (i < 40 ? index_insert_result::success : index_insert_result::already_exists));
+    }
+    assert(by_house_gpa.size() == 40);
+    std::array<bson, 2> const key{bson{3}, bson{0.3}};
+    auto const found = by_house_gpa.lookup_one(span<bson const>{key});
+    assert(found && found.value().id().equals_weak(3));
+    std::array<bson, 2> const missing{bson{3}, bson{0.4}};
+    assert(!by_house_gpa.lookup_one(span<bson const>{missing}));
+
+    hashed_compound_multi_index<2> by_house_gpa_multi;
+    for (auto&& doc : docs) {
+        std::array<non_null_ptr<bson const>, 2> vals{std::addressof(doc.values().lookup("house").value()), std::addressof(doc.values().lookup("gpa").value())};
+        by_house_gpa_multi.insert(span<non_null_ptr<bson const>>{vals}, std::addressof(doc));
+    }
+    assert(by_house_gpa_multi.lookup_many(span<bson const>{key}).size() == 3);
+    assert(by_house_gpa_multi.erase(span<bson const>{key}, std::addressof(docs[43])));
+    assert(by_house_gpa_multi.lookup_many(span<bson const>{key}).size() == 2);
+
+    // range lookups, ordered indices descend to the bounds, hashed indices filter every key
+    ordered_single_field_multi_index<> by_gpa;
+    hashed_single_field_multi_index<> by_gpa_hashed;
+    for (auto&& doc : docs) {
+        by_gpa.insert(doc.values().lookup("gpa").value(), std::addressof(doc));
+        by_gpa_hashed.insert(doc.values().lookup("gpa").value(), std::addressof(doc));
+    }
+    bson const one{1.0}, two{2.0}, three{3.0}, five{5.0};
+    std::array<single_field_multi_index_interface const*, 2> const gpa_indices{&by_gpa, &by_gpa_hashed};
+    for (auto const idx : gpa_indices) {
+        assert(idx->lookup_range(three, {}).size() == 20);
+        assert(idx->lookup_range(one, two, range_bounds::lower_closed).size() == 30);
+        assert(idx->lookup_range(one, two, range_bounds::upper_closed).size() == 29);
+        assert(idx->lookup_range(one, two, range_bounds::open).size() == 27);
+        assert(idx->lookup_range({}, one, range_bounds::open).size() == 30);
+        assert(idx->lookup_range(one, one).size() == 3 && idx->lookup_range(one, one, range_bounds::open).size() == 0);
+        assert(idx->lookup_range(two, one).size() == 0 && idx->lookup_range(five, {}).size() == 0);
+        assert(idx->lookup_range({}, {}).size() == 100);
+        for (auto&& doc : idx->lookup_range(one, two)) {
+            auto const gpa = doc.values().lookup("gpa").value().as<double>().value();
+            assert(gpa >= 1.0 && gpa <= 2.0);
+        }
+    }
+    double last = 0.;
+    for (auto&& doc : by_gpa.lookup_range(one, three)) {
+        auto const gpa = doc.values().lookup("gpa").value().as<double>().value();
+        assert(last <= gpa);
+        last = gpa;
+    }
+
+    ordered_compound_multi_index<2> by_house_gpa_ordered;
+    for (auto&& doc : docs) {
+        std::array<bson, 2> const vals{doc.values().lookup("house").value(), doc.values().lookup("gpa").value()};
+        by_house_gpa_ordered.insert(span<bson const>{vals}, std::addressof(doc));
+    }
+    std::size_t expected = 0;
+    for (auto&& doc : docs) {
+        auto const gpa = doc.values().lookup("gpa").value().as<double>().value();
+        expected += doc.values().lookup("house").value().equals_weak(2) && gpa >= 1.0 && gpa <= 2.0;
+    }
+    std::array<bson, 1> const house{bson{2}}, next_house{bson{3}};
+    std::array<bson, 2> const lower{bson{2}, bson{1.0}}, upper{bson{2}, bson{2.0}};
+    std::array<compound_multi_index_interface const*, 2> const house_gpa_indices{&by_house_gpa_ordered, &by_house_gpa_multi};
+    for (auto const idx : house_gpa_indices) {
+        // a bound shorter than the key selects by the leading fields
+        assert(idx->lookup_range(span<bson const>{house}, span<bson const>{house}).size() == 25);
+        assert(idx->lookup_range(span<bson const>{lower}, span<bson const>{upper}).size() == expected);
+        assert(idx->lookup_range(span<bson const>{house}, {}, range_bounds::open).size() == idx->lookup_range(span<bson const>{next_house}, {}).size());
+        // prefix scans, alone or with a range over the following field
+        assert(idx->lookup_prefix(span<bson const>{house}).size() == 25);
+        assert(idx->lookup_prefix(span<bson const>{lower}).size() == 3);
+        assert(idx->lookup_prefix_range(span<bson const>{house}, one, two).size() == expected);
+        assert(idx->lookup_prefix_range(span<bson const>{house}, one, {}, range_bounds::open).size() == 16);
+        assert(idx->lookup_prefix_range(span<bson const>{house}, {}, one, range_bounds::open).size() == 6);
+        assert(idx->lookup_prefix_range(span<bson const>{house}, {}, {}).size() == 25);
+        assert(idx->lookup_prefix_range(span<bson const>{house}, five, {}).size() == 0);
+    }
+    last = 0.;
+    for (auto&& doc : by_house_gpa_ordered.lookup_prefix(span<bson const>{house})) {
+        auto const gpa = doc.values().lookup("gpa").value().as<double>().value();
+        assert(doc.values().lookup("house").value().equals_weak(2) && last <= gpa);
+        last = gpa;
+    }
+
+    // equality lookups go through the index led by their fields
+    index_manager leading;
+    assert(leading.create_index<false>("house", "gpa", "email"));
+    assert(leading.create_index<true>("house", "email"));
+    for (auto&& doc : docs)
+        leading.register_document(doc);
+    std::array<std::string_view, 1> const house_field{"house"};
+    std::array<std::string_view, 2> const house_gpa_fields{"house", "gpa"}, gpa_house_fields{"gpa", "house"};
+    assert(leading.lookup_equal(span<std::string_view const>{house_field}, span<bson const>{house})->size() == 25);
+    assert(leading.lookup_equal(span<std::string_view const>{house_gpa_fields}, span<bson const>{lower})->size() == 3);
+    assert(!leading.lookup_equal(span<std::string_view const>{gpa_house_fields}, span<bson const>{lower}));
+    // hashed compound indices are only searched by all of their fields
+    index_manager hashed_leading;
+    assert((hashed_leading.create_index<false, detail::no_filter, index_kind::hashed>("gpa", "house", "email")));
+    for (auto&& doc : docs)
+        hashed_leading.register_document(doc);
+    std::array<bson, 2> const gpa_house{bson{1.0}, bson{2}};
+    std::array<bson, 1> const gpa{bson{1.0}};
+    std::array<std::string_view, 1> const gpa_field{"gpa"};
+    assert(!hashed_leading.lookup_equal(span<std::string_view const>{gpa_house_fields}, span<bson const>{gpa_house}));
+    assert(!hashed_leading.lookup_equal(span<std::string_view const>{gpa_field}, span<bson const>{gpa}));
+    index_manager hashed_exact;
+    assert((hashed_exact.create_index<false, detail::no_filter, index_kind::hashed>("gpa", "house")));
+    for (auto&& doc : docs)
+        hashed_exact.register_document(doc);
+    assert(hashed_exact.lookup_equal(span<std::string_view const>{gpa_house_fields}, span<bson const>{gpa_house})->size() == 3);
+    auto const led = leading.lookup("house", "gpa");
+    assert(led && std::get<cmp_index_cursor>(*led).size() == 100);
+
+    // indices know the key of each of their documents
+    assert(by_gpa.contains_doc(std::addressof(docs[7])) && by_gpa.erase_doc(std::addressof(docs[7])));
+    assert(!by_gpa.contains_doc(std::addressof(docs[7])) && !by_gpa.erase_doc(std::addressof(docs[7])));
+    assert(by_gpa.size() == 99 && by_gpa.lookup_many(docs[7].values().lookup("gpa").value()).size() == 2);
+    assert(by_gpa.erase(bson{0.0}) == 3 && !by_gpa.contains_doc(std::addressof(docs[40])));
+    assert(by_house_gpa_ordered.erase_doc(std::addressof(docs[43])) && !by_house_gpa_ordered.contains_doc(std::addressof(docs[43])));
+    assert(by_house_gpa_ordered.lookup_many(span<bson const>{key}).size() == 2);
+
+    // the documents of a key are erased one at a time, whichever of them goes first
+    std::array<single_field_multi_index_interface*, 2> const house_indices{&by_gpa, &by_house};
+    for (auto const index : house_indices) {
+        index->clear();
+        for (auto&& doc : docs)
+            index->insert(bson{0}, std::addressof(doc));
+        for (std::size_t i = 0; i < docs.size(); i += 2)
+            assert(index->erase_doc(std::addressof(docs[i])) && !index->erase(bson{0}, std::addressof(docs[i])));
+        assert(index->size() == 50 && index->lookup_many(bson{0}).size() == 50);
+        for (std::size_t i = 0; i < docs.size(); ++i)
+            assert(index->contains_doc(std::addressof(docs[i])) == (i % 2 == 1));
+    }
+
+    // a document refused by a unique index is not removed from it in place of the document holding its key
+    index_manager by_email;
+    assert(by_email.create_index<true>("email"));
+    document first(1), second(2);
+    first.values().insert("email", "same@hogwarts.edu");
+    second.values().insert("email", "same@hogwarts.edu");
+    by_email.register_document(first);
+    by_email.register_document(second);
+    by_email.remove_document(second);
+    assert(by_email.lookup("email")->size() == 1);
+    // fields changed after registering do not keep a document in its indices
+    first.values().update("email", "changed@hogwarts.edu");
+    by_email.remove_document(first);
+    assert(by_email.lookup("email")->size() == 0);
+
+    // bulk inserts hold the same entries as inserting one by one, the first document of a duplicate unique key wins
+    std::vector<non_null_ptr<bson const>> gpas, house_gpas;
+    std::vector<non_null_ptr<document>> doc_ptrs;
+    for (auto&& doc : docs) {
+        gpas.push_back(std::addressof(doc.values().lookup("gpa").value()));
+        house_gpas.push_back(std::addressof(doc.values().lookup("house").value()));
+        house_gpas.push_back(std::addressof(doc.values().lookup("gpa").value()));
+        doc_ptrs.push_back(std::addressof(doc));
+    }
+    auto same_entries = [](auto const& lhs, auto const& rhs) {
+        std::vector<document const*> l, r;
+        for (auto&& [key, doc] : lhs.iterate())
+            l.push_back(doc);
+        for (auto&& [key, doc] : rhs.iterate())
+            r.push_back(doc);
+        return l == r;
+    };
+    ordered_single_field_unique_index<> unique_bulk, unique_each;
+    assert(unique_bulk.bulk_insert(gpas, doc_ptrs) == 40);
+    for (auto&& doc : docs)
+        unique_each.insert(doc.values().lookup("gpa").value(), std::addressof(doc));
+    assert(same_entries(unique_bulk, unique_each) && unique_bulk.contains_doc(std::addressof(docs[39])) && !unique_bulk.contains_doc(std::addressof(docs[40])));
+    // keys held before the bulk insert are kept
+    assert(unique_bulk.bulk_insert(span<non_null_ptr<bson const> const>{gpas.data() + 40, std::size_t{60}}, span<non_null_ptr<document> const>{doc_ptrs.data() + 40, std::size_t{60}}) == 0);
+
+    ordered_single_field_multi_index<> multi_bulk, multi_each;
+    assert(multi_bulk.bulk_insert(gpas, doc_ptrs, 4) == 100);
+    for (auto&& doc : docs)
+        multi_each.insert(doc.values().lookup("gpa").value(), std::addressof(doc));
+    assert(same_entries(multi_bulk, multi_each));
+
+    ordered_compound_unique_index<2> compound_unique_bulk;
+    assert(compound_unique_bulk.bulk_insert(house_gpas, doc_ptrs) == 40);
+    assert(compound_unique_bulk.lookup_one(span<bson const>{key}).value().id().equals_weak(3));
+    ordered_compound_multi_index<2> compound_multi_bulk;
+    assert(compound_multi_bulk.bulk_insert(house_gpas, doc_ptrs) == 100);
+    assert(compound_multi_bulk.lookup_many(span<bson const>{key}).size() == 3);
+    hashed_compound_unique_index<2> hashed_bulk;
+    assert(hashed_bulk.bulk_insert(house_gpas, doc_ptrs) == 40 && hashed_bulk.contains_doc(std::addressof(docs[0])));
+
+    // keys are sorted by their value, whatever their sign or type
+    std::vector<document> mixed;
+    std::vector<bson> const values{bson{-2.5}, bson{0.0}, bson{1.5}, bson{-0.0}, bson{-1e300}, bson{3}, bson{-3}, bson{"b"}, bson{"a"}, bson{1e300}};
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        document doc(static_cast<int>(i));
+        doc.values().insert("value", values[i]);
+        mixed.push_back(std::move(doc));
+    }
+    std::vector<non_null_ptr<bson const>> mixed_keys;
+    std::vector<non_null_ptr<document>> mixed_docs;
+    for (auto&& doc : mixed) {
+        mixed_keys.push_back(std::addressof(doc.values().lookup("value").value()));
+        mixed_docs.push_back(std::addressof(doc));
+    }
+    ordered_single_field_multi_index<> mixed_bulk, mixed_each;
+    assert(mixed_bulk.bulk_insert(mixed_keys, mixed_docs) == values.size());
+    for (auto&& doc : mixed)
+        mixed_each.insert(doc.values().lookup("value").value(), std::addressof(doc));
+    assert(same_entries(mixed_bulk, mixed_each));
+    ordered_single_field_unique_index<> mixed_unique;
+    assert(mixed_unique.bulk_insert(mixed_keys, mixed_docs) == values.size() - 1); // -0 equals 0
+
+    // the sort behind bulk inserts is stable across threads
+    std::vector<std::pair<int, int>> pairs;
+    for (int i = 0; i < 100'000; ++i)
+        pairs.emplace_back((i * 7919) % 1000, i);
+    parallel_stable_sort(pairs.begin(), pairs.end(), [](auto&& a, auto&& b) { return a.first < b.first; }, 8);
+    assert(std::is_sorted(pairs.begin(), pairs.end()));
+
+    // multikey indices hold a document under each distinct element of an array
+    {
+        document harry(1), hermione(2), ron(3), luna(4);
+        harry.values().insert("classes", std::vector<bson>({"Transfiguration", "Herbology", "Transfiguration"}));
+        harry.values().insert("house", "Gryffindor");
+        hermione.values().insert("classes", std::vector<bson>({"Charms", "Transfiguration"}));
+        hermione.values().insert("house", "Gryffindor");
+        ron.values().insert("classes", "Potions"); // not an array, held under itself
+        ron.values().insert("house", "Gryffindor");
+        luna.values().insert("classes", std::vector<bson>({"Charms"}));
+        luna.values().insert("house", std::vector<bson>({"Ravenclaw", "Gryffindor"}));
+        std::array<document*, 4> const students{std::addressof(harry), std::addressof(hermione), std::addressof(ron), std::addressof(luna)};
+        auto classes = [](document const& doc) -> bson const& { return doc.values().lookup("classes").value(); };
+
+        ordered_single_field_multi_index<> by_class;
+        by_class.set_multikey(true);
+        for (auto const doc : students)
+            assert(by_class.insert(classes(*doc), doc) == index_insert_result::success);
+        assert(by_class.size() == 6);
+        assert(by_class.lookup_many(bson{"Transfiguration"}).size() == 2);
+        assert(by_class.lookup_many(bson{"Potions"}).size() == 1);
+        assert(by_class.erase_doc(std::addressof(harry)) && by_class.size() == 4 && !by_class.contains(bson{"Herbology"}));
+        assert(by_class.erase(bson{"Charms"}) == 2 && by_class.size() == 1 && !by_class.contains_doc(std::addressof(hermione)));
+        assert(by_class.erase_if([](bson const&) { return true; }) == 1 && by_class.empty());
+
+        // a unique multikey index refuses a document sharing any of its elements with another
+        hashed_single_field_unique_index<> unique_class;
+        unique_class.set_multikey(true);
+        assert(unique_class.insert(classes(harry), std::addressof(harry)) == index_insert_result::success);
+        assert(unique_class.insert(classes(hermione), std::addressof(hermione)) == index_insert_result::already_exists);
+        assert(unique_class.size() == 2 && !unique_class.contains_doc(std::addressof(hermione)));
+        assert(unique_class.lookup_one(bson{"Herbology"}).value().id().equals_weak(1));
+        assert(unique_class.erase(bson{"Herbology"}) == 1 && unique_class.empty());
+
+        // a compound key holds one array at most
+        ordered_compound_multi_index<2> by_house_class;
+        by_house_class.set_multikey(true);
+        auto insert_compound = [&](document& doc) {
+            std::array<non_null_ptr<bson const>, 2> key{std::addressof(doc.values().lookup("house").value()), std::addressof(classes(doc))};
+            return by_house_class.insert(span<non_null_ptr<bson const>>{key}, std::addressof(doc));
+        };
+        assert(insert_compound(harry) == index_insert_result::success);
+        assert(insert_compound(luna) == index_insert_result::parallel_arrays);
+        assert(by_house_class.size() == 2 && !by_house_class.contains_doc(std::addressof(luna)));
+        std::array<bson, 2> const house_class{bson{"Gryffindor"}, bson{"Herbology"}};
+        assert(by_house_class.lookup_many(span<bson const>{house_class}).size() == 1);
+        assert(by_house_class.erase(span<bson const>{house_class}) == 1 && by_house_class.empty());
+
+        // bulk inserts expand every array as well
+        std::vector<non_null_ptr<bson const>> keys;
+        std::vector<non_null_ptr<document>> docs;
+        for (auto const doc : students) {
+            keys.push_back(std::addressof(classes(*doc)));
+            docs.push_back(doc);
+        }
+        ordered_single_field_unique_index<> bulk_unique;
+        bulk_unique.set_multikey(true);
+        assert(bulk_unique.bulk_insert(keys, docs) == 3 && bulk_unique.size() == 4); // all but hermione
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "../src/internal/collection.hpp"
+#include "../src/internal/index_stats.hpp"
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <string_view>
+
+using namespace nova;
+
+void test_index_stats() {
+    // indices of either kind count their keys exactly and describe their values by common values and a histogram
+    {
+        collection students;
+        assert(students.create_index<false>("house"));
+        assert((students.create_index<false, detail::no_filter, index_kind::hashed>("year")));
+        assert(students.create_index<true>("name"));
+        assert(students.create_index<true>("year", "name"));
+        assert(students.create_bitmap_index("house"));
+        static char const* const houses[] = {"Gryffindor", "Hufflepuff", "Ravenclaw", "Slytherin"};
+        for (int i = 0; i < 1000; ++i) {
+            document doc(i);
+            // half the students are in Gryffindor, the others spread over the other houses
+            if (i % 100 != 99)
+                doc.values().insert("house", i % 2 == 0 ? houses[0] : houses[1 + i % 3]);
+            else
+                doc.values().insert("house", bson::null_t{});
+            if (i % 10 != 0)
+                doc.values().insert("year", i % 7);
+            doc.values().insert("name", "student " + std::to_string(i));
+            assert(students.insert(std::move(doc)));
+        }
+
+        auto const& house = students.index_statistics("house").value();
+        assert(house.entries == 1000 && house.documents == 1000 && house.missing == 0);
+        assert(house.distinct == 5 && house.nulls == 10 && house.sampled == 1000);
+        assert(!house.most_common.empty() && house.most_common.front().first == bson{"Gryffindor"});
+        assert(house.estimate_equal("Gryffindor") == 500. && house.selectivity("Gryffindor") == .5);
+        assert(house.estimate_equal("Muggle") == 0.);
+
+        auto const& year = students.index_statistics("year").value();
+        assert(year.entries == 900 && year.missing == 100 && year.distinct == 7 && year.nulls == 0);
+        bson const from{2};
+        bson const to{4};
+        assert(std::abs(year.estimate_range(from, to) - 3 * 900. / 7) < 40.);
+        assert(year.estimate_range({}, {}) == 900.);
+
+        // unique keys have no common values, the histogram's buckets hold about as many entries each
+        auto const& name = students.index_statistics("name").value();
+        assert(name.distinct == 1000 && name.most_common.empty());
+        assert(name.histogram.size() == 100 && name.histogram.front().entries == 10 && name.histogram.back().upper == bson{"student 999"});
+        assert(name.estimate_equal("student 42") == 1.);
+
+        std::array<std::string_view, 2> const fields{"year", "name"};
+        auto const& year_name = students.index_statistics(span<std::string_view const>{fields}).value();
+        assert(year_name.entries == 900 && year_name.distinct == 900 && year_name.estimate_equal(3) > 100.);
+        std::array<std::string_view, 2> const unindexed{"name", "year"};
+        assert(!students.index_statistics(span<std::string_view const>{unindexed}) && !students.index_statistics("gpa"));
+
+        // statistics are gathered again once a tenth of the index has changed
+        for (int i = 0; i < 40; ++i)
+            assert(students.erase(i));
+        assert(students.index_statistics("name")->entries == 1000 && students.index_statistics("name")->missing == 0);
+        for (int i = 40; i < 101; ++i)
+            assert(students.erase(i));
+        assert(students.index_statistics("name")->entries == 899);
+    }
+
+    // bitmap indices count their values exactly from their bitmaps
+    {
+        collection students;
+        assert(students.create_bitmap_index("house"));
+        for (int i = 0; i < 100; ++i) {
+            document doc(i);
+            if (i % 4 != 0)
+                doc.values().insert("house", i % 4 == 1 ? "Ravenclaw" : "Slytherin");
+            assert(students.insert(std::move(doc)));
+        }
+        auto const& house = students.index_statistics("house").value();
+        assert(house.entries == 75 && house.missing == 25 && house.distinct == 2);
+        assert(house.estimate_equal("Slytherin") == 50. && house.estimate_equal("Ravenclaw") == 25.);
+    }
+}
@@ -6,8 +6,23 @@ using namespace nova;
 
 int main() {
     test_bson();
+    test_binary();
+    test_compact_bson();
     test_document();
+    test_slot_map();
+    test_shape();
     test_collection();    
+    test_column();
+    test_simd();
     test_index_manager();
+    test_wal();
+    test_checkpoint();
+    test_mapped_collection();
+    test_text_index();
+    test_spatial_index();
+    test_bloom_filter();
+    test_ttl();
+    test_bitmap_index();
+    test_index_stats();
 }
 
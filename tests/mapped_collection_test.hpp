@@ -0,0 +1,120 @@
+#pragma once
+
+#include "../src/internal/database.hpp"
+#include "../src/internal/mapped_collection.hpp"
+#include "../src/internal/query_util.hpp"
+#include <cassert>
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace nova;
+
+void test_mapped_collection() {
+    std::string const path = "/tmp/nova_mapped_collection_test_" + std::to_string(::getpid()) + ".log";
+    std::string const checkpoint_path = path + ".checkpoint";
+    std::remove(path.c_str());
+    std::remove(checkpoint_path.c_str());
+
+    {
+        database db;
+        db.set_checkpoint_threshold(0);
+        assert(db.open(path) == wal_status::ok);
+        auto& students = db.insert("students")->value();
+        assert(students.create_index<true>("name"));
+        assert(students.create_index<false>("house"));
+        assert(students.create_index<false>("house", "year"));
+        assert(students.create_hash_index<false>("gpa"));
+        assert(students.create_multikey_index<false>("clubs"));
+        assert(students.create_text_index("name"));
+        assert((students.create_index<false, detail::no_filter, index_kind::spatial>("year", "gpa")));
+        assert(students.create_bitmap_index("year"));
+        // inserted in reverse so the order of the index differs from the order of the documents
+        for (int i = 99; i >= 0; --i) {
+            document doc(i);
+            doc.values().insert("name", "student " + std::to_string(100 + i));
+            doc.values().insert("house", i % 2 == 0 ? "Ravenclaw" : "Hufflepuff");
+            doc.values().insert("year", i % 7);
+            doc.values().insert("gpa", (i % 40) / 10.);
+            doc.values().insert("clubs", std::vector<bson>({i % 3 == 0 ? "Quidditch" : "Chess", "Charms"}));
+            assert(students.insert(std::move(doc)));
+        }
+        assert(students.erase(50));
+        assert(db.checkpoint() == wal_status::ok);
+    }
+
+    mapped_collection students;
+    assert(students.open(checkpoint_path, "missing") == wal_status::not_found);
+    assert(students.open(checkpoint_path, "students", true) == wal_status::ok);
+    assert(students.size() == 99);
+
+    // lookups by id
+    assert(students.lookup(7)->lookup("name")->equals_weak("student 107"));
+    assert(!students.lookup(50) && !students[100]);
+
+    // scans, with and without query_util predicates
+    std::size_t count = 0;
+    for (auto&& doc : students.scan(is_equal_query("house", "Ravenclaw"), is_greater_eq_query("gpa", 3.0))) {
+        assert(doc.lookup("house")->equals_weak("Ravenclaw") && doc.lookup("gpa")->as<double>().value() >= 3.0);
+        ++count;
+    }
+    assert(count == 10);
+    assert(students.scan(std::make_tuple("year", [](bson const& b) { return b.equals_weak(6); })).size() == 14);
+    assert(students.scan(is_equal_query("clubs.0", "Quidditch")).size() == 34);
+
+    // a unique index is ordered by its keys
+    auto const& by_name = students.index("name").value();
+    assert(by_name.unique() && by_name.size() == 99);
+    std::string last;
+    for (auto&& doc : by_name.iterate()) {
+        std::string const name{doc.lookup("name")->as<std::string>().value()};
+        assert(last < name);
+        last = name;
+    }
+    assert(by_name.lookup_one("student 142")->id().equals_weak(42));
+    assert(!by_name.lookup_one("student 150"));
+    assert(by_name.lookup_many("student 100").size() == 1);
+
+    // a multi index holds every document of a key
+    auto const& by_house = students.index("house").value();
+    assert(!by_house.unique());
+    assert(by_house.lookup_many("Ravenclaw").size() == 49 && by_house.lookup_many("Hufflepuff").size() == 50);
+    assert(by_house.lookup_many("Slytherin").size() == 0);
+
+    // a compound index is searched by its full key or a prefix of it
+    assert(!students.index("year", "house"));
+    auto const& by_house_year = students.index("house", "year").value();
+    for (auto&& doc : by_house_year.lookup_many("Hufflepuff", 3))
+        assert(doc.lookup("year")->equals_weak(3) && doc.id().as<std::int32_t>().value() % 2 == 1);
+    assert(by_house_year.lookup_many("Hufflepuff", 3).size() == 7);
+    assert(by_house_year.lookup_many("Ravenclaw").size() == 49);
+    assert(by_house_year.lookup_many("Ravenclaw", 3, 1).size() == 0);
+
+    // a hashed index is stored ordered by its keys as well
+    auto const& by_gpa = students.index("gpa").value();
+    assert(by_gpa.kind() == index_kind::hashed && by_gpa.size() == 99);
+    assert(by_gpa.lookup_many(3.9).size() == 2 && by_gpa.lookup_many(1.0).size() == 2);
+    assert(by_gpa.lookup_many(1.05).size() == 0);
+
+    // multikey, text, spatial and bitmap indices are stored without entries, a database rebuilds them when it loads the checkpoint
+    assert(!students.index("clubs") && students.indices().size() == 4);
+    {
+        database db;
+        assert(db.open(path) == wal_status::ok);
+        auto const& loaded = db["students"].value();
+        assert(loaded.lookup_indexed("clubs", "Quidditch")->size() == 34 && loaded.lookup_indexed("clubs", "Charms")->size() == 99);
+        assert(loaded.lookup_text("name")->lookup_all("student 142").size() == 1 && loaded.lookup_text("name")->count("student") == 99);
+        assert(loaded.lookup_spatial("year", "gpa")->lookup_box({{6., 3.}, {6., 4.}}).size() == 2);
+        assert(loaded.lookup_bitmap("year")->size() == 99 && loaded.lookup_bitmap("year")->key_count() == 7);
+    }
+
+    // several mappings of the same checkpoint are independent
+    mapped_collection other;
+    assert(other.open(checkpoint_path, "students") == wal_status::ok);
+    assert(other.lookup(7)->data() != students.lookup(7)->data());
+    assert(*other.lookup(7) == *students.lookup(7));
+
+    std::remove(path.c_str());
+    std::remove(checkpoint_path.c_str());
+}
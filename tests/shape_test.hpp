@@ -0,0 +1,69 @@
+#pragma once
+
+#include "../src/internal/shape.hpp"
+#include "../src/internal/collection.hpp"
+#include "../src/internal/query_util.hpp"
+#include <cassert>
+#include <string>
+
+using namespace nova;
+
+void test_shape() {
+    // transitions are shared
+    {
+        shape_tree tree;
+        auto const& a = tree.root().transition("a");
+        auto const& ab = a.transition("b");
+        assert(std::addressof(a.transition("b")) == std::addressof(ab));
+        assert(std::addressof(tree.root().transition("b")) != std::addressof(ab));
+        assert(ab.size() == 2 && ab.parent() == std::addressof(a));
+        assert(*ab.slot("b") == 1);
+        assert(!ab.slot("c"));
+        assert(tree.size() == 4);
+    }
+    // wide shapes
+    {
+        shape_tree tree;
+        auto const* s = std::addressof(tree.root());
+        for (int i = 0; i < 20; ++i)
+            s = std::addressof(s->transition(std::to_string(i)));
+        for (std::uint32_t i = 0; i < 20; ++i)
+            assert(*s->slot(std::to_string(i)) == i);
+        assert(!s->slot("20"));
+    }
+    // documents with the same insertion order share a shape
+    {
+        document a(1), b(2), c(3);
+        a.values().insert("x", 1); a.values().insert("y", 2);
+        b.values().insert("x", 3); b.values().insert("y", 4);
+        c.values().insert("y", 2); c.values().insert("x", 1);
+        assert(std::addressof(a.values().get_shape()) == std::addressof(b.values().get_shape()));
+        assert(std::addressof(a.values().get_shape()) != std::addressof(c.values().get_shape()));
+        assert(a.values() == c.values());
+        assert(!(a.values() == b.values()));
+        assert(!a.values().insert("x", 5).is_inserted());
+        assert(a.values().lookup_as<int>("x").ok() == 1);
+    }
+    // collection documents use the collection's shapes and leave them on remove
+    {
+        collection coll;
+        for (int i = 0; i < 10; ++i) {
+            auto doc = coll.insert(i);
+            doc->values().insert("i", i);
+            if (i % 2 == 0)
+                doc->values().insert("even", true);
+        }
+        auto const cursor = coll.scan(is_equal_query("even", true), is_greater_eq_query("i", 4));
+        std::size_t count = 0;
+        for (auto&& doc : cursor) {
+            assert(doc.values().lookup_as<int>("i").ok() % 2 == 0);
+            ++count;
+        }
+        assert(count == 3);
+
+        auto removed = coll.remove(0);
+        assert(removed);
+        assert(std::addressof(removed->values().get_shape().tree()) == std::addressof(shape_tree::global()));
+        assert(removed->values().contains("even"));
+    }
+}
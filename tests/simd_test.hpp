@@ -0,0 +1,79 @@
+#pragma once
+
+#include "../src/internal/compact_bson.hpp"
+#include "../src/internal/simd.hpp"
+#include "../src/internal/util/bitmap.hpp"
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace nova;
+
+template<class T>
+void simd_test_type(std::mt19937_64& rng) {
+    constexpr std::size_t n = 203; // not a multiple of any vector width or of 64
+    std::vector<T> values(n);
+    for (auto& v : values) {
+        if constexpr (std::is_floating_point_v<T>)
+            v = static_cast<T>(static_cast<int>(rng() % 21) - 10) / 2;
+        else
+            v = static_cast<T>(rng() % 21) - static_cast<T>(10);
+    }
+    if constexpr (std::is_floating_point_v<T>)
+        values[5] = std::numeric_limits<T>::quiet_NaN();
+    values[7] = std::numeric_limits<T>::max();
+    values[8] = std::numeric_limits<T>::lowest();
+
+    T const probes[] = {T{0}, T{3}, static_cast<T>(-2), std::numeric_limits<T>::max()};
+    cmp_op const ops[] = {cmp_op::eq, cmp_op::ne, cmp_op::lt, cmp_op::le, cmp_op::gt, cmp_op::ge};
+    simd_level const levels[] = {simd_level::sse42, simd_level::avx2};
+
+    for (auto const probe : probes) {
+        for (auto const op : ops) {
+            bitmap expected(n);
+            compare(values.data(), n, probe, op, expected.data(), simd_level::scalar);
+            for (auto const level : levels) {
+                if (level > active_simd_level())
+                    continue;
+                bitmap actual(n);
+                compare(values.data(), n, probe, op, actual.data(), level);
+                assert(actual == expected);
+            }
+        }
+        bitmap ge(n);
+        compare<std::greater_equal<>>(values.data(), n, probe, ge.data());
+        for (std::size_t i = 0; i < n; ++i)
+            assert(ge.test(i) == (values[i] >= probe));
+    }
+}
+
+void test_simd() {
+    std::mt19937_64 rng{42};
+    simd_test_type<std::int32_t>(rng);
+    simd_test_type<std::int64_t>(rng);
+    simd_test_type<std::uint32_t>(rng);
+    simd_test_type<std::uint64_t>(rng);
+    simd_test_type<float>(rng);
+    simd_test_type<double>(rng);
+
+    // short string equality over compact values
+    compact_bson::array_t values;
+    char const* const names[] = {"Gryffindor", "Ravenclaw", "", "Hufflepuff", "Slytherin", "Ravenclaw Tower East Wing"};
+    for (std::size_t i = 0; i < 150; ++i) {
+        if (i % 11 == 0)
+            values.emplace_back(static_cast<std::int32_t>(i));
+        else
+            values.emplace_back(names[i % 6]);
+    }
+    for (auto const name : {"Ravenclaw", "", "Ravenclaw Tower East Wing", "Durmstrang", "Ravenclaws"}) {
+        for (auto const level : {simd_level::scalar, simd_level::sse42, simd_level::avx2}) {
+            if (level > active_simd_level())
+                continue;
+            auto const matches = compact_bson::equal_strings(values, name, level);
+            for (std::size_t i = 0; i < values.size(); ++i)
+                assert(matches.test(i) == values[i].equals_weak(std::string_view{name}));
+        }
+    }
+}
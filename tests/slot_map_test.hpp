@@ -0,0 +1,41 @@
+#pragma once
+
+#include "../src/internal/util/slot_map.hpp"
+#include <cassert>
+#include <string>
+
+using namespace nova;
+
+void test_slot_map() {
+    slot_map<std::string> map;
+
+    auto const a = map.emplace("a");
+    auto const b = map.emplace("b");
+    auto const c = map.emplace("c");
+    assert(map.size() == 3);
+    assert(*map.get(b) == "b");
+
+    // erasing moves the last value into the hole
+    assert(map.erase(a));
+    assert(!map.erase(a));
+    assert(!map.contains(a));
+    assert(map.size() == 2);
+    assert(*map.get(c) == "c");
+    assert(map.dense_index(c) == 0);
+    assert(map.handle_at(0) == c);
+
+    // reused slots do not revive stale handles
+    auto const d = map.emplace("d");
+    assert(d.index == a.index);
+    assert(!map.get(a));
+    assert(*map.get(d) == "d");
+
+    std::string joined;
+    for (auto&& str : map)
+        joined += str;
+    assert(joined == "cbd");
+
+    map.clear();
+    assert(map.empty());
+    assert(!map.contains(b) && !map.contains(c) && !map.contains(d));
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "../src/internal/collection.hpp"
+#include "../src/internal/spatial_index.hpp"
+#include <cassert>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace nova;
+
+void test_spatial_index() {
+    collection places;
+    auto add = [&](int const id, double const x, double const y) {
+        document doc(id);
+        doc.values().insert("x", x);
+        doc.values().insert("y", y);
+        doc.values().insert("loc", std::vector<bson>({x, bson{bson_type<std::int32_t>, static_cast<std::int32_t>(y)}}));
+        assert(places.insert(std::move(doc)));
+    };
+    add(0, 0., 0.);
+    add(1, 3., 4.);
+    add(2, -2., 1.);
+    assert(places.create_spatial_index("x", "y"));
+    assert(!places.create_spatial_index("x", "y"));
+    assert((places.create_index<false, detail::no_filter, index_kind::spatial>("loc")));
+    add(3, 10., 10.);
+    add(4, -100., 250.);
+    assert(places.insert(5));
+
+    auto const& by_xy = places.lookup_spatial("x", "y").value();
+    auto const& by_loc = places.lookup_spatial("loc").value();
+    assert(!places.lookup_spatial("y", "x") && !places.lookup_spatial("x"));
+    assert(by_xy.size() == 5 && by_loc.size() == 5);
+
+    // box edges are part of the box, a radius reaches as far as its length
+    assert(scanned_ids(by_xy.lookup_box({{-2., 0.}, {3., 4.}})) == (std::set<int>{0, 1, 2}));
+    assert(scanned_ids(by_loc.lookup_box({{0., 0.}, {20., 20.}})) == (std::set<int>{0, 1, 3}));
+    assert(scanned_ids(by_xy.lookup_radius({0., 0.}, 5.)) == (std::set<int>{0, 1, 2}));
+    assert(scanned_ids(by_xy.lookup_radius({0., 0.}, 4.9)) == (std::set<int>{0, 2}));
+    assert(scanned_ids(by_xy.lookup_box({{1000., 1000.}, {2000., 2000.}})).empty());
+
+    // updates and erases are followed
+    assert(places.update(3, "x", 1.));
+    assert(places.erase(2));
+    assert(scanned_ids(by_xy.lookup_box({{0., 0.}, {5., 10.}})) == (std::set<int>{0, 1, 3}));
+    assert(places.update(0, "x", "nowhere"));
+    assert(by_xy.size() == 3 && scanned_ids(by_xy.lookup_radius({0., 0.}, 1.)).empty());
+
+    // many positions split the regions and grow the root, queries match a scan of every position
+    {
+        spatial_index index({"pos"});
+        std::mt19937 rng{7};
+        std::uniform_real_distribution<double> coord{-1000., 1000.};
+        std::vector<document> docs;
+        std::vector<point> positions;
+        docs.reserve(5000);
+        for (int i = 0; i < 5000; ++i) {
+            docs.emplace_back(i);
+            // a tenth of the documents share a single position
+            positions.push_back(i % 10 == 0 ? point{5., 5.} : point{coord(rng), coord(rng)});
+            assert(index.insert(positions.back(), std::addressof(docs.back())));
+        }
+        assert(!index.insert(point{1., 1.}, std::addressof(docs[0])));
+        for (int i = 0; i < 5000; i += 3)
+            assert(index.erase_doc(std::addressof(docs[static_cast<std::size_t>(i)])));
+
+        auto expected = [&](auto&& pred) {
+            std::set<int> ids;
+            for (int i = 0; i < 5000; ++i)
+                if (i % 3 != 0 && pred(positions[static_cast<std::size_t>(i)]))
+                    ids.insert(i);
+            return ids;
+        };
+        bounding_box const box{{-100., 0.}, {250., 400.}};
+        assert(scanned_ids(index.lookup_box(box)) == expected([&](point const p) { return box.contains(p); }));
+        assert(scanned_ids(index.lookup_radius({5., 5.}, 120.)) == expected([](point const p) {
+            return (p.x - 5.) * (p.x - 5.) + (p.y - 5.) * (p.y - 5.) <= 120. * 120.;
+        }));
+        assert(!index.insert(point{std::nan(""), 0.}, std::addressof(docs[0])));
+    }
+
+    // positions far out grow the root up to them without overflowing, the largest doubles are refused
+    {
+        spatial_index index({"pos"});
+        std::vector<document> docs;
+        docs.reserve(4);
+        for (int i = 0; i < 4; ++i)
+            docs.emplace_back(i);
+        assert(index.insert(point{0., 0.}, std::addressof(docs[0])));
+        assert(index.insert(point{0x1p999, -0x1p999}, std::addressof(docs[1])));
+        assert(index.insert(point{-0x1p999, 0x1p999}, std::addressof(docs[2])));
+        assert(!index.insert(point{1.7e308, 0.}, std::addressof(docs[3])) && !index.insert(point{0., -0x1p1000}, std::addressof(docs[3])));
+        assert(index.size() == 3 && index.lookup_box({{-1., -1.}, {1., 1.}}).size() == 1);
+        assert(index.lookup_box({{0x1p998, -0x1p1000}, {0x1p1000, 0.}}).size() == 1);
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "../src/internal/collection.hpp"
+#include "../src/internal/text_index.hpp"
+#include <cassert>
+#include <set>
+#include <string>
+
+using namespace nova;
+
+void test_text_index() {
+    collection books;
+    auto add = [&](int const id, char const* const title) {
+        document doc(id);
+        doc.values().insert("title", title);
+        assert(books.insert(std::move(doc)));
+    };
+    add(0, "Harry Potter and the Philosopher's Stone");
+    add(1, "Harry Potter and the Chamber of Secrets");
+    add(2, "Fantastic Beasts and Where to Find Them");
+    assert(books.create_text_index("title"));
+    assert(!books.create_text_index("title"));
+    // documents inserted after the index is created are indexed as well
+    add(3, "The Tales of Beedle the Bard");
+    add(4, "HARRY POTTER and the half-blood prince");
+    assert(books.insert(5));
+
+    auto const& titles = books.lookup_text("title").value();
+    assert(!books.lookup_text("author"));
+    assert(titles.size() == 5 && titles.count("Harry") == 3 && titles.count("wizard") == 0);
+
+    // terms are compared as str_eq compares, and split at anything but letters and digits
+    assert(scanned_ids(titles.lookup_all("harry potter")) == (std::set<int>{0, 1, 4}));
+    assert(scanned_ids(titles.lookup_all("potter, BLOOD")) == (std::set<int>{4}));
+    assert(scanned_ids(titles.lookup_all("potter beasts")).empty());
+    assert(scanned_ids(titles.lookup_all("")).empty());
+    assert(scanned_ids(titles.lookup_any("secrets beasts bard")) == (std::set<int>{1, 2, 3}));
+    assert(scanned_ids(titles.lookup_any("dragons")).empty());
+
+    // a phrase holds its terms next to each other and in order
+    assert(scanned_ids(titles.lookup_phrase("and the")) == (std::set<int>{0, 1, 4}));
+    assert(scanned_ids(titles.lookup_phrase("the bard")) == (std::set<int>{3}));
+    assert(scanned_ids(titles.lookup_phrase("potter harry")).empty());
+    assert(scanned_ids(titles.lookup_phrase("half blood prince")) == (std::set<int>{4}));
+    assert(scanned_ids(titles.lookup_phrase("the the")).empty());
+
+    // updates and erases are followed
+    assert(books.update(2, "title", "The Philosopher's Stone"));
+    assert(books.erase(0));
+    assert(scanned_ids(titles.lookup_phrase("philosopher s stone")) == (std::set<int>{2}));
+    assert(titles.count("beasts") == 0 && titles.count("harry") == 2);
+
+    // erased numbers are reclaimed without losing the documents still held
+    {
+        text_index index("text");
+        std::vector<document> docs;
+        docs.reserve(300);
+        for (int i = 0; i < 300; ++i) {
+            docs.emplace_back(i);
+            assert(index.insert(bson{i % 2 == 0 ? "even number" : "odd number"}, std::addressof(docs.back())));
+        }
+        assert(!index.insert(bson{"even"}, std::addressof(docs[0])) && !index.insert(bson{7}, std::addressof(docs[1])));
+        for (int i = 0; i < 200; ++i)
+            assert(index.erase_doc(std::addressof(docs[static_cast<std::size_t>(i)])));
+        assert(!index.erase_doc(std::addressof(docs[0])));
+        assert(index.size() == 100 && index.count("number") == 100 && index.count("even") == 50);
+        // the last erased numbers are only cleared, lookups skip them
+        assert(index.lookup_any("odd even").size() == 100 && index.lookup_all("even number").size() == 50);
+        for (int i = 201; i < 300; i += 2)
+            assert(index.erase_doc(std::addressof(docs[static_cast<std::size_t>(i)])));
+        assert(index.count("odd") == 0 && index.term_count() == 2 && index.lookup_any("odd").size() == 0);
+        std::set<int> expected;
+        for (int i = 200; i < 300; i += 2)
+            expected.insert(i);
+        assert(scanned_ids(index.lookup_phrase("even number")) == expected);
+        assert(index.insert(bson{"odd one"}, std::addressof(docs[0])));
+        assert(index.lookup_all("odd").size() == 1);
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "../src/internal/collection.hpp"
+#include "../src/internal/ttl_index.hpp"
+#include "../src/internal/unique_id.hpp"
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+
+using namespace nova;
+
+void test_ttl() {
+    using std::chrono::seconds;
+    auto const at = [](std::int64_t const s) { return expiry_time{seconds{s}}; };
+
+    // documents expire by a date field, oldest first, and leave every index
+    {
+        collection sessions;
+        assert(sessions.create_index<false>("user"));
+        for (int i = 0; i < 10; ++i) {
+            document doc(i);
+            doc.values().insert("user", i % 2);
+            doc.values().insert("created", std::int64_t{100} + i);
+            assert(sessions.insert(std::move(doc)));
+        }
+        assert(sessions.insert(10)); // no timestamp, never expires
+        sessions.set_ttl({seconds{10}, "created", 128, std::chrono::hours{1}});
+        assert(sessions.ttl()->size() == 10);
+        assert(sessions.ttl()->next_expiry() == at(110));
+
+        assert(sessions.reap_expired(at(109)) == 0);
+        assert(sessions.reap_expired(at(112), 2) == 2);
+        assert(!sessions.lookup(0) && !sessions.lookup(1) && sessions.lookup(2));
+        assert(sessions.reap_expired(at(112)) == 1);
+        assert(sessions.lookup_indexed("user", 0)->size() == 3 && sessions.lookup_indexed("user", 1)->size() == 4);
+
+        // an update moves a document's expiry
+        assert(sessions.update(9, "created", std::int64_t{0}));
+        assert(sessions.update(3, "created", 1000.5));
+        assert(sessions.reap_expired(at(115)) == 3);
+        assert(!sessions.lookup(9) && sessions.lookup(3) && sessions.lookup(6));
+        assert(sessions.reap_expired(at(1000)) == 3);
+        assert(sessions.reap_expired(at(1010)) == 1 && sessions.size() == 1);
+        assert(sessions.ttl()->empty() && !sessions.ttl()->next_expiry());
+
+        sessions.clear_ttl();
+        assert(!sessions.ttl() && sessions.reap_expired(at(2000)) == 0);
+    }
+
+    // documents expire by the timestamp of their unique_id
+    {
+        collection events;
+        auto const now = std::chrono::time_point_cast<seconds>(std::chrono::system_clock::now());
+        events.set_ttl({std::chrono::hours{1}});
+        for (int i = 0; i < 5; ++i)
+            assert(events.insert(unique_id::generate()));
+        assert(events.insert(1)); // an integer id holds no timestamp
+        assert(events.ttl()->size() == 5);
+        assert(events.reap_expired(now + std::chrono::minutes{59}) == 0);
+        assert(events.reap_expired(now + std::chrono::hours{2}) == 5 && events.size() == 1);
+    }
+
+    // writes run batches of the reaper, a batch of `batch_size` documents each interval
+    {
+        collection cache;
+        for (int i = 0; i < 10; ++i) {
+            document doc(i);
+            doc.values().insert("created", 0);
+            assert(cache.insert(std::move(doc)));
+        }
+        cache.set_ttl({seconds{1}, "created", 4, std::chrono::milliseconds{0}});
+        assert(cache.insert(10) && cache.size() == 7);
+        assert(cache.update(10, "created", 5) && cache.size() == 3);
+        assert(cache.insert(11) && cache.size() == 1);
+        assert(!cache.lookup(10) && cache.lookup(11) && cache.ttl()->empty());
+
+        // a long interval holds the next batch back
+        cache.set_ttl({seconds{1}, "created", 4, std::chrono::hours{1}});
+        assert(cache.update(11, "created", 0) && cache.insert(12) && cache.size() == 2);
+        assert(cache.reap_expired(at(10)) == 1 && !cache.lookup(11));
+
+        // a date field filled through the reference of `insert(id)` is only timed by a later update
+        auto& late = cache.insert(13).value();
+        late.values().insert("created", 0);
+        assert(!cache.ttl()->contains_doc(std::addressof(late)));
+        assert(cache.update(13, "created", 0) && cache.ttl()->contains_doc(std::addressof(late)));
+    }
+}
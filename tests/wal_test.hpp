@@ -0,0 +1,166 @@
+#pragma once
+
+#include "../src/internal/database.hpp"
+#include "../src/internal/query_util.hpp"
+#include "../src/internal/wal.hpp"
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <set>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace nova;
+
+struct wal_test_filter {
+    template<class T>
+    bool operator()(T&&) const noexcept { return true; }
+};
+
+void test_wal() {
+    std::string const path = "/tmp/nova_wal_test_" + std::to_string(::getpid()) + ".log";
+    std::remove(path.c_str());
+
+    {
+        database db;
+        db.register_filter<wal_test_filter>("always");
+        assert(db.open(path) == wal_status::ok);
+
+        auto& students = db.insert("students")->value();
+        assert(students.create_index<true>("name"));
+        assert((students.create_index<false, wal_test_filter>("house")));
+        assert((students.create_index<true, wal_test_filter>("name", "year")));
+        assert(students.create_hash_index<false>("year"));
+        assert(students.create_multikey_index<false>("clubs"));
+        assert(students.create_column<double>("gpa"));
+        for (int i = 0; i < 10; ++i) {
+            document doc(i);
+            doc.values().insert("name", "student " + std::to_string(i));
+            doc.values().insert("house", i % 2 == 0 ? "Ravenclaw" : "Hufflepuff");
+            doc.values().insert("year", i % 7);
+            doc.values().insert("gpa", i / 2.);
+            doc.values().insert("clubs", std::vector<bson>({i % 3 == 0 ? "Quidditch" : "Chess", "Charms"}));
+            assert(students.insert(std::move(doc)));
+        }
+        assert(students.erase(3));
+        assert(students.update(4, "gpa", 3.9));
+        assert(!students.update(3, "gpa", 1.));
+
+        // filters have to be registered to be logged
+        struct unnamed_filter : wal_test_filter {};
+        assert(!(students.create_index<false, unnamed_filter>("gpa")));
+        assert(db.insert("empty"));
+        assert(db.wal()->last_lsn() == 20);
+    }
+
+    {
+        database db;
+        db.register_filter<wal_test_filter>("always");
+        assert(db.open(path) == wal_status::ok);
+        assert(db.contains("empty"));
+
+        auto& students = db["students"].value();
+        assert(students.size() == 9);
+        assert(!students.lookup(3));
+        assert(students.lookup(4)->values().lookup("gpa").value().equals_weak(3.9));
+        assert(!students.create_index<true>("name"));
+        assert(!(students.create_index<false, wal_test_filter>("house")));
+        assert(students.lookup_column("gpa"));
+        assert(students.scan(is_greater_eq_query("gpa", 3.)).size() == 5);
+        assert(students.lookup_indexed("clubs", "Quidditch")->size() == 3 && students.lookup_indexed("clubs", "Charms")->size() == 9);
+
+        // later changes are appended after the replayed records
+        assert(!students.create_hash_index<false>("year"));
+        assert(!students.create_multikey_index<false>("clubs"));
+        assert(students.insert(100));
+        assert(db.wal()->last_lsn() == 21);
+    }
+
+    // a torn tail is dropped on open
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::app);
+        out.write("\x20\x00\x00\x00garbage", 11);
+    }
+    {
+        database db;
+        db.register_filter<wal_test_filter>("always");
+        assert(db.open(path) == wal_status::ok);
+        assert(db.wal()->truncated_bytes() == 11);
+        assert(db["students"].value().size() == 10);
+    }
+
+    // indices with filters that were not registered can not be restored
+    {
+        database db;
+        assert(db.open(path) == wal_status::unknown_filter);
+        assert(!db.wal());
+    }
+
+    std::remove(path.c_str());
+
+    // group commit, concurrent writers share batches
+    {
+        write_ahead_log wal;
+        wal_options const options{fsync_policy::group, 64, std::chrono::milliseconds{2}};
+        assert(wal.open(path, options, [](auto&&...) { assert(false); }) == wal_status::ok);
+
+        std::vector<std::vector<std::uint64_t>> lsns(4);
+        std::vector<std::thread> writers;
+        for (std::size_t t = 0; t < lsns.size(); ++t) {
+            writers.emplace_back([&, t] {
+                for (int i = 0; i < 50; ++i) {
+                    auto const lsn = wal.append(wal_op::create_collection, [&](byte_buffer& buf) { detail::store_string(buf, std::to_string(i)); });
+                    assert(lsn && *lsn <= wal.synced_lsn());
+                    lsns[t].push_back(*lsn);
+                }
+            });
+        }
+        for (auto&& w : writers)
+            w.join();
+
+        std::set<std::uint64_t> all;
+        for (auto&& l : lsns)
+            all.insert(l.begin(), l.end());
+        assert(all.size() == 200 && *all.rbegin() == 200);
+        assert(wal.batches() < 200);
+
+        auto future = wal.append_async(wal_op::create_collection, [](byte_buffer& buf) { detail::store_string(buf, "async"); });
+        assert(future.get() == optional<std::uint64_t>{201});
+    }
+
+    // periodic, records are flushed by sync and close
+    {
+        write_ahead_log wal;
+        wal_options const options{fsync_policy::periodic, 1024, std::chrono::seconds{10}};
+        std::size_t replayed = 0;
+        assert(wal.open(path, options, [&](auto&&...) { ++replayed; }) == wal_status::ok);
+        assert(replayed == 201);
+        assert(wal.append(wal_op::create_collection, [](byte_buffer& buf) { detail::store_string(buf, "a"); }) == optional<std::uint64_t>{202});
+        assert(wal.synced_lsn() == 201);
+        assert(wal.sync() == wal_status::ok);
+        assert(wal.synced_lsn() == 202);
+        assert(wal.append(wal_op::create_collection, [](byte_buffer& buf) { detail::store_string(buf, "b"); }));
+    }
+    {
+        write_ahead_log wal;
+        std::size_t replayed = 0;
+        assert(wal.open(path, {}, [&](auto&&...) { ++replayed; }) == wal_status::ok);
+        assert(replayed == 203);
+    }
+
+    // once a batch fails appends fail as well, later records would follow the lost ones
+    {
+        write_ahead_log wal;
+        wal_options const options{fsync_policy::periodic, 1024, std::chrono::seconds{10}};
+        assert(wal.open("/dev/full", options, [](auto&&...) { assert(false); }) == wal_status::ok);
+        assert(wal.append(wal_op::create_collection, [](byte_buffer& buf) { detail::store_string(buf, "a"); }));
+        assert(wal.sync() == wal_status::io_error && wal.synced_lsn() == 0);
+        assert(!wal.append(wal_op::create_collection, [](byte_buffer& buf) { detail::store_string(buf, "b"); }));
+        assert(!wal.append_async(wal_op::create_collection, [](byte_buffer& buf) { detail::store_string(buf, "c"); }).get());
+        assert(wal.sync() == wal_status::ok && wal.last_lsn() == 1);
+    }
+
+    std::remove(path.c_str());
+}